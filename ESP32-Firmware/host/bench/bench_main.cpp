@@ -0,0 +1,266 @@
+// Host microbenchmarks for the firmware's hot paths, with a regression gate.
+//
+// Prints one CSV line per benchmark on stdout ("bench,ns_per_op,iterations")
+// so runs can be diffed or stored. Every benchmark is auto-scaled to run for
+// at least MIN_RUN_MS per repetition and reported as the fastest of REPS
+// repetitions, which is far more stable than the mean on a shared machine.
+//
+//   firmware_bench                             # just measure
+//   firmware_bench --write-baseline FILE       # store a new baseline
+//   firmware_bench --baseline FILE --threshold 25
+//                                              # exit 1 if any benchmark is
+//                                              # more than 25% slower
+
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Heartbeat.h"
+#include "LeaderElection.h"
+#include "TelemetryJson.h"
+#include "TemperatureBus.h"
+#include "FakeSensorBus.h"
+
+static const uint32_t MIN_RUN_MS = 20;
+static const int REPS = 7;
+
+// Keeps the optimiser from discarding a result.
+template <class T>
+static inline void keep(const T& v) {
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+struct Bench {
+  const char* name;
+  void (*fn)(uint64_t iters);
+};
+
+struct Result {
+  std::string name;
+  double nsPerOp;
+  uint64_t iters;
+};
+
+// ------------------
+// Benchmarks
+// ------------------
+
+static void benchCrc8(uint64_t iters) {
+  uint8_t payload[4] = {'A', 0, 3, 'A'};
+  for (uint64_t i = 0; i < iters; i++) {
+    payload[1] = (uint8_t)i;
+    uint8_t c = Heartbeat::crc8(payload, sizeof(payload));
+    keep(c);
+  }
+}
+
+static void benchParseFrame(uint64_t iters) {
+  static HardwareSerial ser(1);
+  static Heartbeat hb(ser);
+  uint8_t frame[7] = {0xAA, 0x55, 'B', 0, 3, 'A', 0};
+  frame[6] = Heartbeat::crc8(&frame[2], 4);
+
+  for (uint64_t i = 0; i < iters; i++) {
+    for (uint8_t b : frame) hb.parseByte(b);
+  }
+  keep(hb.framesOk());
+}
+
+static const float COOL[TemperatureBus::SENSORS_PER_BUS] = {21.25f, 22.5f, NAN};
+static const float EXHAUST[TemperatureBus::SENSORS_PER_BUS] = {30.75f, 31.0f, 33.5f};
+
+static void benchTempArray(uint64_t iters) {
+  char out[96];
+  for (uint64_t i = 0; i < iters; i++) {
+    out[0] = '\0';
+    appendTempArray(out, sizeof(out), COOL);
+    keep(out);
+  }
+}
+
+static void benchBuildTelemetry(uint64_t iters) {
+  static char json[1536];
+  static char extra[1024];
+  Heartbeat::Peer peers[2] = {{'B', 990, 3, 'A'}, {'C', 980, 3, 'A'}};
+  TelemetryCounters c = {123456, 7, 123000, 12};
+
+  for (uint64_t i = 0; i < iters; i++) {
+    size_t used = formatCountersItem(extra, sizeof(extra), c);
+    formatMembershipItem(extra + used, sizeof(extra) - used, 'A', 'A', 3, peers, 2, 1000, 2000);
+    buildTelemetryJson(json, sizeof(json), "AA:BB:CC:DD:EE:FF", 'A', (uint32_t)i,
+                       123456789ULL, 1700000000000ULL, 3,
+                       true, true, COOL, EXHAUST, false, "", extra);
+    keep(json);
+  }
+}
+
+static void benchTempBusCycle(uint64_t iters) {
+  static FakeSensorBus intake;
+  static FakeSensorBus exhaust;
+  static TemperatureBus bus;
+  static bool started = false;
+  if (!started) {
+    bus.begin(intake, exhaust);
+    started = true;
+  }
+
+  static uint32_t now = 1;
+  for (uint64_t i = 0; i < iters; i++) {
+    // request -> conversion done -> read: one full sample
+    for (int s = 0; s < 3; s++) {
+      now += bus.msUntilNextStep(now);
+      bus.tick(now);
+    }
+    bus.clearNewSampleFlag();
+  }
+  keep(bus.intakeC(0));
+}
+
+static void benchElectionUpdate(uint64_t iters) {
+  LeaderElection e('B', 'A', 2000, 5000);
+  Heartbeat::Peer peers[3] = {{'A', 6000, 1, 'A'}, {'C', 6000, 1, 'A'}, {'D', 6000, 1, 'A'}};
+  for (uint64_t i = 0; i < iters; i++) {
+    const uint32_t now = 6000 + (uint32_t)(i & 1023);
+    bool changed = e.update(peers, 3, now);
+    keep(changed);
+  }
+}
+
+static const Bench BENCHES[] = {
+  {"hb_crc8", benchCrc8},
+  {"hb_parse_frame", benchParseFrame},
+  {"json_temp_array", benchTempArray},
+  {"json_build_telemetry", benchBuildTelemetry},
+  {"tempbus_cycle", benchTempBusCycle},
+  {"election_update", benchElectionUpdate},
+};
+
+// ------------------
+// Runner
+// ------------------
+
+static double runNs(void (*fn)(uint64_t), uint64_t iters) {
+  const auto t0 = std::chrono::steady_clock::now();
+  fn(iters);
+  const auto t1 = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+static Result measure(const Bench& b) {
+  // Grow the iteration count until one repetition takes MIN_RUN_MS.
+  uint64_t iters = 1;
+  while (runNs(b.fn, iters) < MIN_RUN_MS * 1e6 && iters < (1ull << 40)) iters *= 2;
+
+  double best = 0;
+  for (int r = 0; r < REPS; r++) {
+    const double ns = runNs(b.fn, iters) / (double)iters;
+    if (r == 0 || ns < best) best = ns;
+  }
+  return {b.name, best, iters};
+}
+
+static bool loadBaseline(const char* path, std::vector<Result>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char name[128];
+    double ns;
+    unsigned long long iters;
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%127[^,],%lf,%llu", name, &ns, &iters) == 3) {
+      out.push_back({name, ns, iters});
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void writeCsv(FILE* f, const std::vector<Result>& results) {
+  fprintf(f, "bench,ns_per_op,iterations\n");
+  for (const Result& r : results) {
+    fprintf(f, "%s,%.3f,%llu\n", r.name.c_str(), r.nsPerOp, (unsigned long long)r.iters);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* baselinePath = nullptr;
+  const char* writePath = nullptr;
+  const char* filter = nullptr;
+  double thresholdPct = 25.0;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    if (a == "--baseline" && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else if (a == "--write-baseline" && i + 1 < argc) {
+      writePath = argv[++i];
+    } else if (a == "--threshold" && i + 1 < argc) {
+      thresholdPct = atof(argv[++i]);
+    } else if (a == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--baseline FILE] [--threshold PCT] [--write-baseline FILE] [--filter SUBSTR]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // The firmware logs through Serial; keep stdout to the CSV.
+  Serial.quiet = true;
+
+  std::vector<Result> results;
+  for (const Bench& b : BENCHES) {
+    if (filter && !strstr(b.name, filter)) continue;
+    results.push_back(measure(b));
+  }
+  writeCsv(stdout, results);
+
+  if (writePath) {
+    FILE* f = fopen(writePath, "w");
+    if (!f) {
+      fprintf(stderr, "cannot write %s\n", writePath);
+      return 2;
+    }
+    fprintf(f, "# Host benchmark baseline (ns per operation, fastest of %d runs).\n", REPS);
+    writeCsv(f, results);
+    fclose(f);
+  }
+
+  if (!baselinePath) return 0;
+
+  std::vector<Result> baseline;
+  if (!loadBaseline(baselinePath, baseline)) {
+    fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+    return 2;
+  }
+
+  int regressions = 0;
+  for (const Result& r : results) {
+    const Result* base = nullptr;
+    for (const Result& b : baseline) {
+      if (b.name == r.name) base = &b;
+    }
+    if (!base || base->nsPerOp <= 0) {
+      fprintf(stderr, "%-24s %10.1f ns  (no baseline)\n", r.name.c_str(), r.nsPerOp);
+      continue;
+    }
+
+    const double pct = (r.nsPerOp - base->nsPerOp) * 100.0 / base->nsPerOp;
+    const bool regressed = pct > thresholdPct;
+    if (regressed) regressions++;
+    fprintf(stderr, "%-24s %10.1f ns  baseline %10.1f ns  %+6.1f%%%s\n",
+            r.name.c_str(), r.nsPerOp, base->nsPerOp, pct,
+            regressed ? "  REGRESSION" : "");
+  }
+
+  if (regressions) {
+    fprintf(stderr, "%d benchmark(s) more than %.0f%% slower than %s\n",
+            regressions, thresholdPct, baselinePath);
+    return 1;
+  }
+  return 0;
+}
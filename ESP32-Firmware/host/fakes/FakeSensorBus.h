@@ -0,0 +1,26 @@
+#pragma once
+#include "SensorBus.h"
+
+// In-memory 1-Wire bus for host tests. Readings are whatever the test put in
+// temps[]; sensors past deviceCount read as disconnected (-127 C).
+class FakeSensorBus : public SensorBus{
+public:
+    static constexpr uint8_t MAX_SENSORS = 8;
+    static constexpr float DISCONNECTED_C = -127.0f;
+
+    uint8_t devices = 3;
+    float temps[MAX_SENSORS] = {21.0f, 22.0f, 23.0f, 24.0f, 25.0f, 26.0f, 27.0f, 28.0f};
+
+    uint32_t begins = 0;
+    uint32_t scans = 0;
+    uint32_t requests = 0;
+    uint32_t reads = 0;
+
+    void begin() override { begins++; }
+    uint8_t deviceCount() override { scans++; return devices; }
+    void requestTemperatures() override { requests++; }
+    float tempC(uint8_t idx) override {
+        reads++;
+        return (idx < devices && idx < MAX_SENSORS) ? temps[idx] : DISCONNECTED_C;
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stand-in for the Radxa time service on a simulated network path.
+//
+// Everything runs on one "true" clock in microseconds. The device's local
+// clock is derived from it with a fixed offset and a crystal error in ppm;
+// the server answers in epoch ms. Each direction of the path gets
+// baseDelayUs plus uniform jitter in [0, jitterUs], drawn independently so
+// the path is asymmetric, and requests can be dropped. The PRNG is seeded, so
+// a run is repeatable.
+class FakeTimeServer{
+public:
+    uint64_t epochAtZeroMs = 1700000000000ULL;
+    uint64_t localAtZeroMs = 5000;
+    double driftPpm = 0;
+
+    uint32_t baseDelayUs = 300;
+    uint32_t jitterUs = 0;
+    uint32_t processUs = 50;
+    uint8_t dropPercent = 0;
+
+    uint64_t nowUs = 0;
+    uint32_t answered = 0;
+    uint32_t dropped = 0;
+
+    explicit FakeTimeServer(uint32_t seed = 1) : _rng(seed ? seed : 1) {}
+
+    void advanceMs(uint64_t ms) { nowUs += ms * 1000; }
+
+    // Device millis64() at the current true time.
+    uint64_t localMs() const {
+        return localAtZeroMs + (uint64_t)((double)nowUs * (1.0 + driftPpm * 1e-6) / 1000.0);
+    }
+    // What a perfect clock would report as epoch ms right now.
+    uint64_t trueEpochMs() const { return epochAtZeroMs + nowUs / 1000; }
+
+    // Delivers a time_request sent at the current time and builds the reply.
+    // Time advances to when the reply reaches the device (or, for a dropped
+    // request, by one base round trip). Returns false if it was dropped or
+    // is not a time_request.
+    bool exchange(const char* request, char* response, size_t responseSz) {
+        const char* p = request ? strstr(request, "\"t0_ms\"") : nullptr;
+        if (!p || !strstr(request, "\"time_request\"")) return false;
+        p += strlen("\"t0_ms\"");
+        while (*p == ' ' || *p == ':') p++;
+        const unsigned long long t0 = strtoull(p, nullptr, 10);
+
+        if (dropPercent && next() % 100 < dropPercent) {
+            nowUs += 2 * (uint64_t)baseDelayUs;
+            dropped++;
+            return false;
+        }
+
+        nowUs += baseDelayUs + jitter();
+        const unsigned long long t1 = trueEpochMs();
+        nowUs += processUs;
+        const unsigned long long t2 = trueEpochMs();
+        nowUs += baseDelayUs + jitter();
+
+        snprintf(response, responseSz,
+                 "{ \"message_type\": \"time_response\", \"t0_ms\": %llu, \"t1_ms\": %llu, \"t2_ms\": %llu }",
+                 t0, t1, t2);
+        answered++;
+        return true;
+    }
+
+private:
+    uint32_t _rng;
+
+    uint32_t next() {
+        // xorshift32
+        _rng ^= _rng << 13;
+        _rng ^= _rng >> 17;
+        _rng ^= _rng << 5;
+        return _rng;
+    }
+    uint32_t jitter() { return jitterUs ? next() % (jitterUs + 1) : 0; }
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+#include "Transport.h"
+
+// Simulated Ethernet or Wi-Fi path with a collector on the far end.
+//
+// linkUp is the PHY/association state: while it is false every send fails,
+// as on the real drivers. blackhole models a degraded path (cable to a dead
+// switch port, AP without uplink): the link stays up and sends "succeed", but
+// nothing arrives and nothing comes back.
+//
+// Telemetry that gets through is kept in delivered[]. time_requests are
+// answered by the far-end collector straight away (t1 = t2 = hostMillis in
+// epoch ms), so a probe's reply is waiting on the next receive().
+class SimTransport : public Transport{
+public:
+    struct Datagram{
+        IPAddress peer;
+        std::string payload;
+    };
+
+    bool link = true;
+    bool blackhole = false;
+    uint64_t epochAtZeroMs = 1700000000000ULL;
+
+    uint32_t sendCalls = 0;
+    uint32_t sendFailures = 0;
+    std::vector<Datagram> delivered;   // telemetry that reached the collector
+    std::deque<Datagram> inbox;        // replies waiting for receive()
+
+    explicit SimTransport(const char* name) : _name(name) {}
+
+    const char* name() const override { return _name; }
+    bool begin() override { return link; }
+    bool linkUp() override { return link; }
+
+    bool send(const IPAddress& dst, uint16_t, const uint8_t* data, size_t len) override {
+        sendCalls++;
+        if (!link) {
+            sendFailures++;
+            return false;
+        }
+        if (blackhole) return true;
+
+        std::string payload((const char*)data, len);
+        const char* t0 = strstr(payload.c_str(), "\"t0_ms\": ");
+        if (strstr(payload.c_str(), "\"time_request\"") && t0) {
+            const unsigned long long now = epochAtZeroMs + hostMillis;
+            char reply[160];
+            snprintf(reply, sizeof(reply),
+                     "{ \"message_type\": \"time_response\", \"t0_ms\": %llu, \"t1_ms\": %llu, \"t2_ms\": %llu }",
+                     strtoull(t0 + strlen("\"t0_ms\": "), nullptr, 10), now, now);
+            inbox.push_back({dst, reply});
+        } else {
+            delivered.push_back({dst, payload});
+        }
+        return true;
+    }
+
+    size_t receive(uint8_t* out, size_t outSz, IPAddress& from) override {
+        if (inbox.empty() || !link) return 0;
+        const Datagram d = inbox.front();
+        inbox.pop_front();
+        const size_t n = (d.payload.size() < outSz) ? d.payload.size() : outSz;
+        memcpy(out, d.payload.data(), n);
+        from = d.peer;
+        return n;
+    }
+
+private:
+    const char* _name;
+};
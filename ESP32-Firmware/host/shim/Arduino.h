@@ -0,0 +1,136 @@
+#pragma once
+
+// Minimal Arduino core for host builds (unit tests and benchmarks).
+//
+// Covers only what the firmware's hardware-independent sources use. Time is
+// virtual: millis() returns hostMillis, which a test sets or advances itself,
+// and delay() just moves it forward. Header-only so the PlatformIO native
+// env and the CMake host build need nothing extra.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef uint8_t byte;
+
+// ------------------
+// Virtual clock
+// ------------------
+inline uint32_t hostMillis = 0;
+
+inline uint32_t millis(){ return hostMillis; }
+inline uint32_t micros(){ return hostMillis * 1000u; }
+inline void delay(uint32_t ms){ hostMillis += ms; }
+
+// ------------------
+// String (just enough for c_str() round trips)
+// ------------------
+class String{
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    const char* c_str() const {return _s.c_str();}
+    size_t length() const {return _s.size();}
+    bool operator==(const char* s) const {return _s == s;}
+
+private:
+    std::string _s;
+};
+
+// ------------------
+// IPAddress
+// ------------------
+class IPAddress{
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+
+    bool fromString(const char* s){
+        unsigned v[4];
+        char tail;
+        if(!s || sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4) return false;
+        for(int i = 0; i < 4; i++){
+            if(v[i] > 255) return false;
+            _b[i] = (uint8_t)v[i];
+        }
+        return true;
+    }
+
+    uint8_t operator[](int i) const {return _b[i];}
+    bool operator==(const IPAddress& o) const {return memcmp(_b, o._b, 4) == 0;}
+    bool operator!=(const IPAddress& o) const {return !(*this == o);}
+
+private:
+    uint8_t _b[4] = {0, 0, 0, 0};
+};
+
+// ------------------
+// HardwareSerial
+// ------------------
+#define SERIAL_8N1 0x800001c
+
+// A UART backed by byte queues. Tests push received bytes into rx and read
+// what the code wrote from tx, or set onWrite to wire several ports onto one
+// simulated bus. The console port (Serial) writes to stdout instead.
+class HardwareSerial{
+public:
+    explicit HardwareSerial(int uartNum, bool console = false) : _console(console) { (void)uartNum; }
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1){
+        (void)baud; (void)config; (void)rxPin; (void)txPin;
+    }
+
+    int available(){ return (int)rx.size(); }
+    int read(){
+        if(rx.empty()) return -1;
+        const uint8_t b = rx.front();
+        rx.pop_front();
+        return b;
+    }
+
+    size_t write(const uint8_t* data, size_t n){
+        if(_console){
+            if(!quiet) fwrite(data, 1, n, stdout);
+        } else if(onWrite){
+            onWrite(data, n);
+        } else {
+            tx.insert(tx.end(), data, data + n);
+        }
+        return n;
+    }
+    size_t write(uint8_t b){ return write(&b, 1); }
+
+    size_t print(const char* s){ return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s){ return print(s.c_str()); }
+    size_t println(const char* s = ""){ return print(s) + print("\n"); }
+    size_t println(const String& s){ return println(s.c_str()); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))){
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        const int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if(n <= 0) return 0;
+        return write((const uint8_t*)buf, ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+    }
+
+    // Host side of the port
+    std::deque<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    std::function<void(const uint8_t*, size_t)> onWrite;
+    bool quiet = false;
+
+private:
+    bool _console;
+};
+
+inline HardwareSerial Serial(0, true);
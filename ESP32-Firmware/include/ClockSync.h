@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+
+// NTP-lite clock synchronisation against the Radxa.
+//
+// Each burst sends a few time requests over the telemetry UDP socket. Every
+// reply gives one sample (t0 local send, t1 server receive, t2 server send,
+// t3 local receive):
+//   offset = ((t1 - t0) + (t2 - t3)) / 2
+//   rtt    = (t3 - t0) - (t2 - t1)
+// Only the minimum-RTT sample of a burst is kept (least queueing, least
+// asymmetry). The last few burst results are fitted with a least-squares line
+// to estimate crystal drift, so epochMs() stays accurate between bursts.
+//
+// All times are passed in, so the filter runs unchanged against a fake clock.
+class ClockSync{
+public:
+    static constexpr uint8_t HISTORY = 8;
+
+    void beginBurst();
+    // Returns false if the sample is rejected (negative or oversized RTT).
+    bool addSample(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3);
+    // Keeps the best sample of the burst. Returns false if there was none.
+    bool endBurst();
+
+    bool synced() const {return _histLen > 0;}
+
+    // Device local ms (millis64()) -> Radxa epoch ms. 0 if not synced.
+    uint64_t epochMs(uint64_t localMs) const;
+    // Bound on |epochMs() - true epoch| in ms.
+    uint32_t uncertaintyMs(uint64_t localMs) const;
+    int32_t driftPpm() const {return (int32_t)(_drift * 1e6);}
+    uint32_t lastRttMs() const {return _lastRttMs;}
+
+    // Wire format helpers (JSON, like the telemetry payload).
+    static size_t formatRequest(char* out, size_t outSz, const char* macStr, uint64_t t0);
+    static bool parseResponse(const char* msg, uint64_t& t0, uint64_t& t1, uint64_t& t2);
+
+private:
+    struct Point{
+        uint64_t localMs;
+        int64_t offsetMs;
+    };
+
+    Point _hist[HISTORY];
+    uint8_t _histLen = 0;
+    uint8_t _histHead = 0;
+
+    // Best sample of the current burst
+    bool _haveBest = false;
+    int64_t _bestOffsetMs = 0;
+    uint32_t _bestRttMs = 0;
+    uint64_t _bestLocalMs = 0;
+
+    uint32_t _lastRttMs = 0;
+    uint64_t _lastSyncLocalMs = 0;
+
+    // Fitted line: offset(local) = _fitOffset + _drift * (local - _fitLocal)
+    uint64_t _fitLocal = 0;
+    double _fitOffset = 0;
+    double _drift = 0;
+    bool _driftKnown = false;
+
+    void refit();
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include "SensorBus.h"
+
+// DS18B20 sensors on one OneWire pin, with non-blocking conversions.
+class DallasSensorBus : public SensorBus{
+public:
+    explicit DallasSensorBus(int pin);
+
+    void begin() override;
+    uint8_t deviceCount() override;
+    void requestTemperatures() override;
+    float tempC(uint8_t idx) override;
+
+private:
+    OneWire _wire;
+    DallasTemperature _dt;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include "Transport.h"
+
+// W5500 over SPI (Arduino Ethernet library). The primary telemetry path.
+class EthernetTransport : public Transport{
+public:
+    const char* name() const override {return "ethernet";}
+    bool begin() override;
+    bool linkUp() override;
+    bool send(const IPAddress& dst, uint16_t port, const uint8_t* data, size_t len) override;
+    size_t receive(uint8_t* out, size_t outSz, IPAddress& from) override;
+};
@@ -1,28 +1,86 @@
 #pragma once
 #include <Arduino.h>
 
+// Heartbeat link between the controllers of a rack.
+//
+// Every controller on the (multi-drop) UART hears every other one, so we
+// keep a small liveness table with one entry per peer. Each frame also
+// carries the sender's election view (term + leader) so peers can converge.
 class Heartbeat{
 public:
+    static constexpr uint8_t MAX_PEERS = 3;   // up to 4 controllers per rack
+    // Controller IDs on the bus are 'A'..'D'; frames with any other ID are
+    // dropped even if their CRC checks out.
+    static constexpr char FIRST_ID = 'A';
+    static constexpr char LAST_ID = (char)('A' + MAX_PEERS);
+
+    struct Peer{
+        char id;
+        uint32_t lastRxMs;
+        uint8_t term;       // election term the peer last advertised
+        char leader;        // leader the peer last advertised
+    };
+
     explicit Heartbeat(HardwareSerial& ser);
 
     void begin(int rxPin, int txPin, uint32_t baund);
     void tick();
-    void send(char myId, uint32_t nowMs);
+    void send(char myId, uint32_t nowMs, uint8_t term = 0, char leader = '?');
 
+    // Most recently heard peer (the only peer in a two-controller rack).
     bool peerAlive(uint32_t nowMs, uint32_t timeoutMs) const;
     uint32_t lastRxMS() const {return _lastRxMs;}
     char peerId() const {return _peerId;}
 
+    // Per-peer liveness table
+    uint8_t peerCount() const {return _peerCount;}
+    const Peer* peers() const {return _peers;}
+    const Peer* findPeer(char id) const;
+    bool peerAlive(char id, uint32_t nowMs, uint32_t timeoutMs) const;
+
+    // Cumulative since boot
+    uint32_t framesOk() const {return _framesOk;}
+    uint32_t crcErrors() const {return _crcErrors;}
+
+    // CRC-8 (poly 0x07) over the frame payload. Stateless, so it can be used
+    // without a serial port.
+    static uint8_t crc8(const uint8_t* data, size_t n);
+
+    // Feeds one received byte to the frame parser. tick() calls this for
+    // everything waiting on the UART; exposed so frames can be fed directly.
+    void parseByte(uint8_t b);
+
+    static bool validId(char id){ return id >= FIRST_ID && id <= LAST_ID; }
+
+    // A frame parsed after the caller read its clock is stamped a little
+    // later than nowMs; that counts as age 0, not as ~49 days.
+    static uint32_t ageMs(const Peer& p, uint32_t nowMs){
+        const int32_t age = (int32_t)(nowMs - p.lastRxMs);
+        return (age > 0) ? (uint32_t)age : 0;
+    }
+    static bool alive(const Peer& p, uint32_t nowMs, uint32_t timeoutMs){
+        return p.lastRxMs != 0 && ageMs(p, nowMs) <= timeoutMs;
+    }
+
 private:
+    static constexpr uint8_t PAYLOAD_LEN = 4;   // ID SEQ TERM LEADER
+
     HardwareSerial& _ser;
 
     uint32_t _lastRxMs = 0;
     char _peerId = '?';
+    char _selfId = 0;   // our own frames echo back on a shared bus
+
+    Peer _peers[MAX_PEERS];
+    uint8_t _peerCount = 0;
 
     uint8_t _state = 0;
-    uint8_t _buf[2];
+    uint8_t _buf[PAYLOAD_LEN];
     uint8_t _idx = 0;
 
-    void parseByte(uint8_t b);
-    uint8_t crc8(const uint8_t* data, size_t n) const;
-};
\ No newline at end of file
+    uint32_t _framesOk = 0;
+    uint32_t _crcErrors = 0;
+
+    void onFrame(char id, uint8_t term, char leader);
+    void forgetPeer(char id);
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include "Heartbeat.h"
+
+// Deterministic leader election for N controllers sharing a heartbeat bus.
+//
+// Bully rule: the live controller with the lowest ID ('A' < 'B' < 'C' ...)
+// leads, and only the leader sends telemetry. Every node computes this from
+// its own heartbeat table, so no extra messages are needed. The term number
+// is bumped on every leader change and the highest term heard from any peer
+// is adopted, so the Radxa can order takeovers and tell a stale sender
+// (e.g. one side of a partition) from the current one.
+//
+// The primary may lead immediately after boot. Every other node waits
+// bootGraceMs first, so it doesn't grab the rack before it has heard from
+// the controllers that outrank it.
+class LeaderElection{
+public:
+    static constexpr char NO_LEADER = '?';
+
+    LeaderElection(char myId, char primaryId, uint32_t timeoutMs, uint32_t bootGraceMs);
+
+    // Re-evaluates from the heartbeat table. Returns true if the leader changed.
+    bool update(const Heartbeat::Peer* peers, uint8_t count, uint32_t nowMs);
+
+    char leader() const {return _leader;}
+    char previousLeader() const {return _prevLeader;}
+    uint8_t term() const {return _term;}
+    bool isLeader() const {return _leader == _myId;}
+
+    // Terms are 8-bit on the wire; compare with wraparound.
+    static bool newerTerm(uint8_t a, uint8_t b){ return (int8_t)(a - b) > 0; }
+
+private:
+    char _myId;
+    char _primaryId;
+    uint32_t _timeoutMs;
+    uint32_t _bootGraceMs;
+
+    char _leader = NO_LEADER;
+    char _prevLeader = NO_LEADER;
+    uint8_t _term = 0;
+};
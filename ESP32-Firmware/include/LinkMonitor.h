@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// Chooses between the Ethernet and Wi-Fi transports.
+//
+// Fed one health observation per probe period:
+//  - Ethernet PHY link down: switch to Wi-Fi on the next probe.
+//  - Ethernet link up but failProbes probes in a row unanswered (degraded):
+//    switch to Wi-Fi. Worst case failover is therefore failProbes probe periods.
+//  - Back on Ethernet only once it has been healthy for stableMs without a
+//    single failed probe (hysteresis). Earlier only if Wi-Fi fails too: its
+//    link goes down, or failProbes probes in a row go unanswered.
+// A switch only happens if the target link is up; back to Ethernet only if
+// its probes are answered as well, so a blackholed Ethernet is not retried
+// on a single Wi-Fi miss.
+//
+// Pure logic with the time passed in, so it runs against simulated transports.
+class LinkMonitor{
+public:
+    enum Link : uint8_t { ETHERNET, WIFI };
+
+    struct Event{
+        uint64_t localMs;       // millis64() when the switch happened
+        Link from;
+        Link to;
+        const char* reason;
+        uint32_t detectMs;      // first sign of trouble -> switch
+    };
+
+    static constexpr uint8_t LOG_SIZE = 4;
+
+    LinkMonitor(uint8_t failProbes, uint32_t stableMs);
+
+    // Returns true if the active link changed.
+    bool update(bool ethLink, bool ethProbeOk, bool wifiLink, bool wifiProbeOk, uint64_t nowMs);
+
+    Link active() const {return _active;}
+    static const char* linkName(Link l){ return (l == ETHERNET) ? "ethernet" : "wifi"; }
+
+    // Most recent switches, oldest first.
+    uint8_t eventCount() const {return _logLen;}
+    const Event& event(uint8_t i) const;
+    uint32_t switchCount() const {return _switches;}
+
+private:
+    uint8_t _failProbes;
+    uint32_t _stableMs;
+
+    Link _active = ETHERNET;
+
+    uint8_t _ethFails = 0;
+    uint8_t _wifiFails = 0;
+    uint64_t _troubleSinceMs = 0;   // 0 = no trouble on the active link
+    uint64_t _ethGoodSinceMs = 0;   // 0 = Ethernet not currently healthy
+
+    Event _log[LOG_SIZE];
+    uint8_t _logLen = 0;
+    uint8_t _logHead = 0;
+    uint32_t _switches = 0;
+
+    void switchTo(Link to, const char* reason, uint64_t nowMs);
+};
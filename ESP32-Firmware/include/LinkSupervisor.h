@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include "LinkMonitor.h"
+
+class TelemetrySender;
+class Transport;
+
+// Runs the Ethernet/Wi-Fi probe rounds and feeds their results to the
+// LinkMonitor.
+//
+// A round probes Ethernet always (so its recovery is seen) and Wi-Fi only
+// while it carries traffic, and is evaluated once the last result is in.
+// Probe misses only count once some collector has answered a probe: a Radxa
+// without the time service never does, and then only the PHY links decide.
+// On a switch the TelemetrySender moves to the new link and re-sends what
+// queued up on the old one.
+//
+// Sending probes and matching replies is left to the caller (main.cpp's time
+// requests), so the same rounds run against simulated transports.
+class LinkSupervisor{
+public:
+    // Sends a link probe over via. False if it could not be sent; otherwise
+    // exactly one onProbe() for it must follow, answered or not.
+    typedef bool (*ProbeFn)(Transport& via);
+    // Called after a switch with the event and how many queued payloads went
+    // out on the new link.
+    typedef void (*SwitchFn)(const LinkMonitor::Event& e, uint8_t resent);
+
+    LinkSupervisor(LinkMonitor& mon, TelemetrySender& net, Transport& eth, Transport& wifi,
+                   ProbeFn probe, SwitchFn onSwitch);
+
+    // Starts a round, unless one is still waiting for results (that one will
+    // report). collectorAnswered: whether probe misses mean anything yet.
+    void startRound(bool collectorAnswered, uint64_t nowMs);
+
+    // Result of a probe posted by this round.
+    void onProbe(const Transport* via, bool answered, uint64_t nowMs);
+
+    bool roundPending() const {return _probesOut != 0;}
+
+private:
+    LinkMonitor& _mon;
+    TelemetrySender& _net;
+    Transport& _eth;
+    Transport& _wifi;
+    ProbeFn _probe;
+    SwitchFn _onSwitch;
+
+    uint8_t _probesOut = 0;
+    bool _trustProbes = false;
+    bool _ethProbeOk = false;
+    bool _wifiProbeOk = false;
+
+    void evaluate(uint64_t nowMs);
+};
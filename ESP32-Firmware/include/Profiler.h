@@ -0,0 +1,78 @@
+#pragma once
+#include <Arduino.h>
+
+// Per-stage loop profiler.
+//
+// PROFILE_SCOPE(stage) measures the enclosing scope with the CPU cycle counter
+// (std::chrono on host builds) and adds the duration to a fixed log2 histogram
+// for that stage. Percentiles are read back from the histogram, so recording
+// is a couple of adds and no allocation.
+//
+// Build with -DPROFILE_ENABLED=0 to compile every scope out.
+
+#ifndef PROFILE_ENABLED
+  #define PROFILE_ENABLED 1
+#endif
+
+// How often the "profile" item is attached to telemetry (histograms reset after).
+#ifndef PROFILE_REPORT_MS
+  #define PROFILE_REPORT_MS 60000
+#endif
+
+class Profiler{
+public:
+    enum Stage : uint8_t {
+        HB_RX,      // hb.tick(): UART parse
+        HB_TX,      // hb.send()
+        TEMP,       // tempBus.tick(): 1-Wire, interrupts off during reads
+        JSON,       // buildTelemetryJson()
+        UDP,        // net.sendUDP(): SPI to the W5500
+        LOG,        // Serial.printf status/temperature logging
+        STAGE_COUNT
+    };
+
+    static constexpr uint8_t BUCKETS = 32;
+
+    static uint32_t now();
+    static void record(Stage stage, uint32_t ticks);
+    static void reset();
+
+    // Upper bound (in us) of the bucket holding the given percentile.
+    static uint32_t percentileUs(Stage stage, uint8_t pct);
+    static uint32_t maxUs(Stage stage);
+    static uint32_t count(Stage stage);
+
+    static const char* stageName(Stage stage);
+
+    // Writes a telemetry item: { "kind": "profile", "stages": { "<stage>": [n, p50, p99, max] } }.
+    // Returns the number of characters written (0 if compiled out).
+    static size_t formatItem(char* out, size_t outSz, uint32_t windowMs);
+
+private:
+    struct Hist{
+        uint32_t buckets[BUCKETS];
+        uint32_t count;
+        uint32_t maxTicks;
+    };
+
+    static Hist _hist[STAGE_COUNT];
+
+    static uint32_t ticksPerUs();
+    static uint32_t toUs(uint32_t ticks);
+};
+
+class ProfileScope{
+public:
+    explicit ProfileScope(Profiler::Stage stage) : _stage(stage), _start(Profiler::now()) {}
+    ~ProfileScope(){ Profiler::record(_stage, Profiler::now() - _start); }
+
+private:
+    Profiler::Stage _stage;
+    uint32_t _start;
+};
+
+#if PROFILE_ENABLED
+  #define PROFILE_SCOPE(stage) ProfileScope _profileScope(Profiler::stage)
+#else
+  #define PROFILE_SCOPE(stage) do {} while (0)
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+
+// Small cooperative deadline scheduler for loop().
+//
+// Tasks are periodic or one-shot and live in a fixed table; pending deadlines
+// are kept in a binary min-heap so the next wakeup is always heap[0]. runDue()
+// fires everything that is due, idle() sleeps until the next deadline (or until
+// woken early by the platform sleep function).
+//
+// Time and sleep are injected so the same code runs against a virtual clock
+// in a host build.
+class Scheduler{
+public:
+    typedef void (*TaskFn)(uint32_t nowMs);
+    typedef uint32_t (*ClockFn)();
+    typedef void (*SleepFn)(uint32_t ms);
+
+    static constexpr uint8_t MAX_TASKS = 12;
+    static constexpr uint8_t INVALID_TASK = 0xFF;
+
+    struct TaskStats{
+        const char* name;
+        uint32_t runs;
+        uint32_t lateMaxMs;
+        uint32_t lateSumMs;
+    };
+
+    Scheduler(ClockFn clock, SleepFn sleep);
+
+    // Registers a task. Returns its id, or INVALID_TASK if the table is full.
+    uint8_t every(const char* name, uint32_t periodMs, TaskFn fn, uint32_t firstDelayMs = 0);
+    uint8_t once(const char* name, uint32_t delayMs, TaskFn fn);
+
+    // (Re)arms a task to run delayMs from now. Safe to call from inside the task.
+    void schedule(uint8_t id, uint32_t delayMs);
+    void cancel(uint8_t id);
+
+    // Event wakeup: run the task on the next runDue(). Only sets flags, so it
+    // may be called from another FreeRTOS task (e.g. a UART receive callback).
+    void wake(uint8_t id);
+
+    // Runs every task whose deadline has passed.
+    void runDue();
+
+    // ms until the next deadline, capped at maxMs (0 if something is due).
+    uint32_t msUntilNext(uint32_t maxMs) const;
+
+    // Sleeps until the next deadline (at most maxMs) and accounts idle time.
+    void idle(uint32_t maxMs);
+
+    // Lateness = how long after its deadline a task actually ran.
+    TaskStats stats(uint8_t id) const;
+    uint8_t taskCount() const {return _count;}
+
+    // Share of wall time spent in idle() since the last resetStats().
+    uint8_t idlePercent() const;
+    void resetStats();
+
+private:
+    static constexpr uint8_t NOT_QUEUED = 0xFF;
+
+    struct Task{
+        const char* name;
+        TaskFn fn;
+        uint32_t periodMs;      // 0 = one-shot
+        uint32_t dueMs;
+        uint8_t heapPos;        // index into _heap, NOT_QUEUED if not armed
+        volatile bool wake;
+
+        uint32_t runs;
+        uint32_t lateMaxMs;
+        uint32_t lateSumMs;
+    };
+
+    ClockFn _clock;
+    SleepFn _sleep;
+
+    Task _tasks[MAX_TASKS];
+    uint8_t _count = 0;
+
+    uint8_t _heap[MAX_TASKS];
+    uint8_t _heapLen = 0;
+
+    volatile bool _wakePending = false;
+
+    uint32_t _statsSinceMs = 0;
+    uint32_t _idleMs = 0;
+
+    uint8_t addTask(const char* name, uint32_t periodMs, TaskFn fn, uint32_t delayMs);
+
+    bool earlier(uint8_t a, uint8_t b) const;
+    void swapHeap(uint8_t i, uint8_t j);
+    void siftUp(uint8_t i);
+    void siftDown(uint8_t i);
+    void push(uint8_t id);
+    void removeAt(uint8_t pos);
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// One 1-Wire temperature bus as TemperatureBus sees it. DallasSensorBus is
+// the DS18B20 implementation; host builds substitute a fake bus.
+class SensorBus{
+public:
+    virtual ~SensorBus() {}
+
+    virtual void begin() = 0;
+    virtual uint8_t deviceCount() = 0;
+
+    // Starts a conversion on every sensor and returns without waiting.
+    virtual void requestTemperatures() = 0;
+
+    // Latest conversion of sensor idx in degrees C. Readings <= -120 C
+    // (DEVICE_DISCONNECTED_C) mean the sensor did not answer.
+    virtual float tempC(uint8_t idx) = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include "TemperatureBus.h"
+#include "Heartbeat.h"
+#include "LinkMonitor.h"
+
+// Telemetry payload formatting. Pure string building with no I/O, so it
+// builds and runs the same on the host as on the ESP32.
+
+// Appends a JSON array of one bus's readings to out, e.g. [21.23, 22.00, null].
+void appendTempArray(char* out, size_t outSz, const float vals[TemperatureBus::SENSORS_PER_BUS]);
+
+// Writes the full "telemetry" message into out (always NUL-terminated).
+// epochMs == 0 means the clock is not synced yet and is sent as null.
+// extraItems is appended to items[] verbatim; each entry must start with ",\n    ".
+void buildTelemetryJson(char* out, size_t outSz,
+                        const char* macStr,
+                        char controllerId,
+                        uint32_t seq,
+                        uint64_t deviceMs,
+                        uint64_t epochMs,
+                        uint32_t uncertaintyMs,
+                        bool aAlive,
+                        bool bAlive,
+                        const float cool[TemperatureBus::SENSORS_PER_BUS],
+                        const float exhaust[TemperatureBus::SENSORS_PER_BUS],
+                        bool failoverOccurred,
+                        const char* failoverDetails,
+                        const char* extraItems);
+
+// Cumulative device-side counters, reported so the ingest side can tell
+// packets that never left the device from packets lost on the way.
+struct TelemetryCounters{
+    uint32_t hbFramesOk;
+    uint32_t hbCrcErrors;
+    uint32_t udpSent;
+    uint32_t udpSendFailures;
+};
+
+// Writes ",\n    { \"kind\": \"counters\", ... }" for use as extraItems.
+// Returns the number of characters written.
+size_t formatCountersItem(char* out, size_t outSz, const TelemetryCounters& c);
+
+// Writes the full membership view for extraItems: this node's election state
+// plus every peer in the heartbeat table with its liveness and the leader and
+// term it last advertised. Returns the number of characters written.
+size_t formatMembershipItem(char* out, size_t outSz,
+                            char selfId, char leader, uint8_t term,
+                            const Heartbeat::Peer* peers, uint8_t count,
+                            uint32_t nowMs, uint32_t timeoutMs);
+
+// Writes the "network_failover" item: the active interface, the retry
+// queue's totals and the monitor's recent switches (oldest first), each with
+// its reason and how long detection took. Returns the number of characters
+// written.
+size_t formatNetworkEventItem(char* out, size_t outSz, const LinkMonitor& mon,
+                              uint32_t udpRetried, uint32_t udpDropped);
+
+// Writes a "telemetry" message that carries only the given items (formatted
+// like extraItems), for reports too large to ride along with the sensors.
+void buildItemsJson(char* out, size_t outSz,
+                    const char* macStr,
+                    char controllerId,
+                    uint32_t seq,
+                    uint64_t deviceMs,
+                    uint64_t epochMs,
+                    uint32_t uncertaintyMs,
+                    const char* items);
@@ -1,16 +1,76 @@
 #pragma once
 
 #include <Arduino.h>
+#include "Transport.h"
 
-// Lightweight UDP sender for telemetry JSON payloads over a W5500.
+// Lightweight UDP sender for telemetry JSON payloads.
 // (No ArduinoJson dependency; we send a pre-built JSON string.)
+//
+// Datagrams go out over the active Transport: Ethernet (W5500) normally,
+// Wi-Fi while the link monitor has failed over. Telemetry that cannot be
+// sent is kept in a small retry queue and re-sent, in order, once a link
+// is usable again, so in-flight packets migrate across a switch.
 
 class TelemetrySender {
 public:
+  static constexpr uint8_t MAX_COLLECTORS = 4;
+  static constexpr size_t MAX_PAYLOAD = 1536;
+
+  TelemetrySender(Transport& primary, Transport& fallback);
+
   bool begin();
   bool isUp() const;
+
+  // Transport selection (driven by the LinkMonitor)
+  Transport& primary() {return _primary;}
+  Transport& fallback() {return _fallback;}
+  Transport& active() {return *_active;}
+  void setActive(Transport& t) {_active = &t;}
+  const char* interfaceName() const {return _active->name();}
+
+  // Sends telemetry to the active collector. On failure the payload is
+  // queued for retry and false is returned.
   bool sendUDP(const char* jsonPayload);
+  // Sends to a specific collector, whichever one is active, over the given
+  // transport (default: the active one). Never queued; used for probing.
+  bool sendUDPTo(uint8_t collectorIdx, const char* jsonPayload, Transport* via = nullptr);
+
+  // Re-sends queued payloads over the active transport, oldest first.
+  // Returns how many went out.
+  uint8_t flushPending();
+  uint8_t pendingCount() const;
+
+  // Reads one pending datagram from any configured collector into out
+  // (NUL-terminated), checking both transports. Returns its length, or 0 if
+  // nothing is waiting. Never blocks. fromIdx, if given, receives the
+  // sender's collector index, and via the transport it arrived on.
+  size_t receiveUDP(char* out, size_t outSz, uint8_t* fromIdx = nullptr,
+                    Transport** via = nullptr);
+
+  // Ordered collector list from COLLECTOR_IPS (or just RADXA_IP_A..D).
+  // Index 0 is the preferred collector.
+  uint8_t collectorCount() const;
+  uint8_t activeCollector() const;
+  void selectCollector(uint8_t idx);
+  String collectorString(uint8_t idx) const;
+
+  // Cumulative since boot (every datagram, telemetry and time requests).
+  uint32_t sentCount() const;
+  uint32_t sendFailCount() const;
+  // Queued payloads that were later delivered / had to be discarded.
+  uint32_t retriedCount() const;
+  uint32_t droppedCount() const;
 
   // Formats ESP32 base MAC (EFUSE) as "AA:BB:CC:DD:EE:FF".
   static String deviceMacString();
+
+  // Cached "AA:BB:CC:DD:EE:FF" form. Formatted once, cheap to use per packet.
+  static const char* deviceMacCStr();
+
+private:
+  Transport& _primary;
+  Transport& _fallback;
+  Transport* _active;
+
+  bool enqueue(const char* jsonPayload);
 };
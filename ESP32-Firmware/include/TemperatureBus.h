@@ -1,13 +1,18 @@
 #pragma once
 #include <Arduino.h>
+#include "SensorBus.h"
 
 class TemperatureBus{
     public:
         static constexpr uint8_t SENSORS_PER_BUS = 3;
 
-        bool begin(int intakePin, int exhaustPin); // once in setup
+        bool begin(SensorBus& intake, SensorBus& exhaust); // once in setup
         void tick(uint32_t nowMs);
 
+        // How long until tick() has work to do (0 = call it now).
+        // Lets the scheduler sleep through the 5 s period and the conversion wait.
+        uint32_t msUntilNextStep(uint32_t nowMs) const;
+
         // true if we have at least one reading on each bus
         bool ready() const;
 
@@ -38,13 +43,8 @@ class TemperatureBus{
         void requestConversion();
         void readTemperatures();
 
-        int _intakePin;
-        int _exhaustPin;
-
-        void* _oneWireIntake = nullptr;
-        void* _oneWireExhaust = nullptr;
-        void* _dtIntake = nullptr;
-        void* _dtExhaust = nullptr;
+        SensorBus* _intake = nullptr;
+        SensorBus* _exhaust = nullptr;
 
         uint8_t _intakeDeviceCount = 0;
         uint8_t _exhaustDeviceCount = 0;
@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+
+class Transport;
+
+// Time requests that are out on the network and not answered yet.
+//
+// Sending a time_request only records it here; the network receive task
+// matches each time_response against it (same collector, same transport,
+// echoed t0) and anything left after the wait window is taken out as a miss.
+// Nothing waits for a reply, so the loop keeps serving the heartbeat bus.
+//
+// One request can serve several purposes: a clock-sync sample and a collector
+// probe posted to the same collector over the same link in the same
+// millisecond share one datagram and one reply.
+class TimeRequests{
+public:
+    static constexpr uint8_t MAX_PENDING = 8;
+
+    enum Purpose : uint8_t{
+        SYNC            = 1 << 0,   // feed the reply to ClockSync
+        COLLECTOR_PROBE = 1 << 1,   // collector failover
+        LINK_PROBE      = 1 << 2,   // Ethernet/Wi-Fi failover
+    };
+
+    struct Request{
+        uint64_t t0;                // local send time, echoed in the reply
+        Transport* via;
+        uint8_t collector;
+        uint8_t purposes;
+    };
+
+    // Records a request. Returns false if the table is full (nothing is
+    // recorded; the caller should count it as unanswered). merged is set when
+    // an identical request was already pending, in which case it must not be
+    // sent again.
+    bool add(uint64_t t0, uint8_t collector, Transport* via, uint8_t purposes, bool& merged);
+
+    // Removes the request a reply belongs to. False for replies to requests
+    // that already expired, or that were never sent.
+    bool take(uint64_t t0, uint8_t collector, Transport* via, Request& out);
+
+    // Removes one request older than waitMs. Call until it returns false.
+    bool takeExpired(uint64_t nowMs, uint32_t waitMs, Request& out);
+
+    uint8_t pending() const {return _count;}
+
+private:
+    Request _req[MAX_PENDING];
+    bool _used[MAX_PENDING] = {};
+    uint8_t _count = 0;
+
+    void removeAt(uint8_t i, Request& out);
+};
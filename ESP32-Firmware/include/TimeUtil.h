@@ -5,3 +5,15 @@ static inline bool elapsed(uint32_t now, uint32_t since, uint32_t interval){
     return (uint32_t)(now-since) >= interval;
 }
 
+// 64-bit milliseconds since boot. millis() wraps every ~49.7 days; this
+// extends it as long as it is called at least once per wrap (any periodic
+// task does). Not static: every translation unit must share the same state.
+inline uint64_t millis64(){
+    static uint32_t last = 0;
+    static uint32_t high = 0;
+
+    uint32_t now = millis();
+    if(now < last) high++;
+    last = now;
+    return ((uint64_t)high << 32) | now;
+}
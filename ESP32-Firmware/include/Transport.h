@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+
+// One network path for telemetry datagrams. TelemetrySender talks to the
+// collectors through whichever Transport the LinkMonitor has made active.
+// Implemented by EthernetTransport (W5500, primary) and WifiTransport
+// (fallback); host builds can substitute a simulated one.
+class Transport{
+public:
+    virtual ~Transport() {}
+
+    virtual const char* name() const = 0;
+    virtual bool begin() = 0;
+
+    // Physical link / association state. Cheap enough to call every probe.
+    virtual bool linkUp() = 0;
+
+    virtual bool send(const IPAddress& dst, uint16_t port, const uint8_t* data, size_t len) = 0;
+
+    // Copies one pending datagram into out and returns its length, or 0 if
+    // nothing is waiting. Never blocks.
+    virtual size_t receive(uint8_t* out, size_t outSz, IPAddress& from) = 0;
+};
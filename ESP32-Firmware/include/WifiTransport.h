@@ -0,0 +1,16 @@
+#pragma once
+#include "Transport.h"
+
+// ESP32 station-mode Wi-Fi. Only used while Ethernet is down or degraded.
+// Disabled (never up) when WIFI_SSID is empty.
+class WifiTransport : public Transport{
+public:
+    const char* name() const override {return "wifi";}
+    bool begin() override;
+    bool linkUp() override;
+    bool send(const IPAddress& dst, uint16_t port, const uint8_t* data, size_t len) override;
+    size_t receive(uint8_t* out, size_t outSz, IPAddress& from) override;
+
+private:
+    bool _enabled = false;
+};
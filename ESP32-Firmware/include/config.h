@@ -10,6 +10,10 @@
 #ifndef DEVICE_ID
   #error "DEVICE_ID must be set in platformio.ini (e.g., -DDEVICE_ID=65 for 'A')"
 #endif
+// Heartbeat frames are only accepted from 'A'..'D' (see Heartbeat::validId).
+#if DEVICE_ID < 65 || DEVICE_ID > 68
+  #error "DEVICE_ID must be 65..68 ('A'..'D')"
+#endif
 
 // ------------------
 // Heartbeat (UART)
@@ -47,11 +51,48 @@
   #define HB_TIMEOUT_MS 2000
 #endif
 
+// Leader election across the rack's controllers (DEVICE_ID 'A', 'B', 'C', ...).
+// The lowest live ID leads. The primary may lead right after boot; the others
+// wait BOOT_GRACE_MS so they don't take over before hearing from it.
+#ifndef ELECTION_PRIMARY_ID
+  #define ELECTION_PRIMARY_ID 'A'
+#endif
+
+// If the primary never shows up after boot, the next controller starts sending after this long.
+#ifndef BOOT_GRACE_MS
+  #define BOOT_GRACE_MS 5000
+#endif
+
 // Used by the older RoleManager logic (still fine to keep defined).
 #ifndef HB_TAKEOVER_HOLD_MS
   #define HB_TAKEOVER_HOLD_MS 5000
 #endif
 
+// Fallback poll for heartbeat RX. UART receive normally wakes the loop
+// early; this bounds how late a heartbeat timeout can be noticed.
+#ifndef HB_POLL_MS
+  #define HB_POLL_MS 50
+#endif
+
+// ------------------
+// Loop scheduler
+// ------------------
+// Longest single sleep between deadlines.
+#ifndef SCHED_MAX_SLEEP_MS
+  #define SCHED_MAX_SLEEP_MS 1000
+#endif
+
+// How often per-task lateness and idle % are printed (and reset).
+#ifndef SCHED_STATS_MS
+  #define SCHED_STATS_MS 60000
+#endif
+
+// Set to 1 to enable automatic light sleep while idle. The heartbeat UART
+// can drop bytes on wake, so leave this off unless the IDF config supports it.
+#ifndef SCHED_LIGHT_SLEEP
+  #define SCHED_LIGHT_SLEEP 0
+#endif
+
 // ------------------
 // 1-Wire busses
 // ------------------
@@ -100,11 +141,103 @@
   #define RADXA_IP_D 10
 #endif
 
+// Optional ordered list of collectors for multi-node ingestion, e.g.
+//   -DCOLLECTOR_IPS=\"192.168.1.10,192.168.1.11,192.168.1.12\"
+// The first is preferred. Unset means RADXA_IP_A..D is the only collector.
+// Liveness is probed with clock-sync requests.
+#ifndef COLLECTOR_PROBE_MS
+  #define COLLECTOR_PROBE_MS 2000
+#endif
+// Move to the next collector after this many unanswered probes in a row...
+#ifndef COLLECTOR_FAILOVER_PROBES
+  #define COLLECTOR_FAILOVER_PROBES 3
+#endif
+// ...and back to the preferred one after this many answered probes in a row.
+#ifndef COLLECTOR_RECOVER_PROBES
+  #define COLLECTOR_RECOVER_PROBES 5
+#endif
+
+// ------------------
+// Wi-Fi fallback
+// ------------------
+// Secondary path while Ethernet is down. Leave WIFI_SSID empty to disable.
+#ifndef WIFI_SSID
+  #define WIFI_SSID ""
+#endif
+#ifndef WIFI_PASS
+  #define WIFI_PASS ""
+#endif
+// Both links are checked every NET_PROBE_MS. A dead PHY link switches on the
+// next check; a link that is up but unanswered switches after
+// NET_FAIL_PROBES misses, so failover takes at most
+// NET_FAIL_PROBES * NET_PROBE_MS + CLOCK_SYNC_WAIT_MS.
+#ifndef NET_PROBE_MS
+  #define NET_PROBE_MS 1000
+#endif
+#ifndef NET_FAIL_PROBES
+  #define NET_FAIL_PROBES 3
+#endif
+// Ethernet must be healthy this long before traffic moves back to it.
+#ifndef NET_SWITCHBACK_STABLE_MS
+  #define NET_SWITCHBACK_STABLE_MS 30000
+#endif
+// Telemetry payloads kept for re-sending while no link works (oldest dropped).
+#ifndef NET_RETRY_SLOTS
+  #define NET_RETRY_SLOTS 4
+#endif
+// The network_failover item is sent this many times after a switch
+// (one per telemetry period), since UDP may lose any single copy.
+#ifndef NET_EVENT_REPEAT
+  #define NET_EVENT_REPEAT 3
+#endif
+
 // How often to send the JSON payload.
 #ifndef TELEMETRY_SEND_MS
   #define TELEMETRY_SEND_MS 1000
 #endif
 
+// ------------------
+// Clock sync (NTP-lite against the Radxa)
+// ------------------
+// A burst of CLOCK_SYNC_SAMPLES requests every CLOCK_SYNC_INTERVAL_MS.
+#ifndef CLOCK_SYNC_INTERVAL_MS
+  #define CLOCK_SYNC_INTERVAL_MS 64000
+#endif
+#ifndef CLOCK_SYNC_SAMPLES
+  #define CLOCK_SYNC_SAMPLES 8
+#endif
+#ifndef CLOCK_SYNC_SAMPLE_GAP_MS
+  #define CLOCK_SYNC_SAMPLE_GAP_MS 250
+#endif
+// Samples with a larger round trip are discarded.
+#ifndef CLOCK_SYNC_MAX_RTT_MS
+  #define CLOCK_SYNC_MAX_RTT_MS 200
+#endif
+// How long a time request stays outstanding before it counts as unanswered
+// (a sync miss, and a failed collector or link probe). Nothing blocks on it;
+// the socket is polled every NET_RX_POLL_MS meanwhile. Any reply that could
+// still pass the RTT filter must be waited for.
+#ifndef CLOCK_SYNC_WAIT_MS
+  #define CLOCK_SYNC_WAIT_MS CLOCK_SYNC_MAX_RTT_MS
+#endif
+#ifndef NET_RX_POLL_MS
+  #define NET_RX_POLL_MS 1
+#endif
+#if CLOCK_SYNC_WAIT_MS < CLOCK_SYNC_MAX_RTT_MS
+  #error "CLOCK_SYNC_WAIT_MS must cover CLOCK_SYNC_MAX_RTT_MS"
+#endif
+#if CLOCK_SYNC_SAMPLE_GAP_MS < CLOCK_SYNC_WAIT_MS
+  #error "CLOCK_SYNC_SAMPLE_GAP_MS must leave the last reply time to arrive"
+#endif
+// Crystal tolerance assumed before drift is estimated; larger fits are rejected.
+#ifndef CLOCK_SYNC_DRIFT_BOUND_PPM
+  #define CLOCK_SYNC_DRIFT_BOUND_PPM 100
+#endif
+// Remaining drift error once the slope is known.
+#ifndef CLOCK_SYNC_RESIDUAL_PPM
+  #define CLOCK_SYNC_RESIDUAL_PPM 5
+#endif
+
 // ------------------
 // Relay/switch pins
 // ------------------
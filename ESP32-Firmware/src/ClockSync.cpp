@@ -0,0 +1,126 @@
+#include "ClockSync.h"
+#include "config.h"
+
+#include <stdlib.h>
+
+void ClockSync::beginBurst(){
+    _haveBest = false;
+}
+
+bool ClockSync::addSample(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3){
+    if(t3 < t0 || t2 < t1) return false;
+
+    int64_t rtt = (int64_t)(t3 - t0) - (int64_t)(t2 - t1);
+    if(rtt < 0 || rtt > (int64_t)CLOCK_SYNC_MAX_RTT_MS) return false;
+
+    if(!_haveBest || (uint32_t)rtt < _bestRttMs){
+        _haveBest = true;
+        _bestRttMs = (uint32_t)rtt;
+        _bestOffsetMs = (((int64_t)t1 - (int64_t)t0) + ((int64_t)t2 - (int64_t)t3)) / 2;
+        _bestLocalMs = t3;
+    }
+    return true;
+}
+
+bool ClockSync::endBurst(){
+    if(!_haveBest) return false;
+    _haveBest = false;
+
+    _hist[_histHead] = { _bestLocalMs, _bestOffsetMs };
+    _histHead = (uint8_t)((_histHead + 1) % HISTORY);
+    if(_histLen < HISTORY) _histLen++;
+
+    _lastRttMs = _bestRttMs;
+    _lastSyncLocalMs = _bestLocalMs;
+
+    refit();
+    return true;
+}
+
+void ClockSync::refit(){
+    // Newest point anchors the line until there is enough history for a slope.
+    const Point& newest = _hist[(_histHead + HISTORY - 1) % HISTORY];
+    _fitLocal = newest.localMs;
+    _fitOffset = (double)newest.offsetMs;
+    _drift = 0;
+    _driftKnown = false;
+
+    if(_histLen < 3) return;
+
+    // Least squares over the history, x relative to the newest point.
+    double sx = 0, sy = 0;
+    for(uint8_t i = 0; i < _histLen; i++){
+        sx += (double)(int64_t)(_hist[i].localMs - _fitLocal);
+        sy += (double)_hist[i].offsetMs;
+    }
+    const double mx = sx / _histLen;
+    const double my = sy / _histLen;
+
+    double sxx = 0, sxy = 0;
+    for(uint8_t i = 0; i < _histLen; i++){
+        double dx = (double)(int64_t)(_hist[i].localMs - _fitLocal) - mx;
+        double dy = (double)_hist[i].offsetMs - my;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    // Need a few seconds of spread before the slope means anything.
+    if(sxx < 1e6) return;
+
+    const double slope = sxy / sxx;
+    if(slope > CLOCK_SYNC_DRIFT_BOUND_PPM * 1e-6 || slope < -CLOCK_SYNC_DRIFT_BOUND_PPM * 1e-6) return;
+
+    _drift = slope;
+    _fitOffset = my - slope * mx;
+    _driftKnown = true;
+}
+
+uint64_t ClockSync::epochMs(uint64_t localMs) const{
+    if(!synced()) return 0;
+
+    double dt = (double)(int64_t)(localMs - _fitLocal);
+    double offset = _fitOffset + _drift * dt;
+    return (uint64_t)((int64_t)localMs + (int64_t)(offset >= 0 ? offset + 0.5 : offset - 0.5));
+}
+
+uint32_t ClockSync::uncertaintyMs(uint64_t localMs) const{
+    if(!synced()) return 0xFFFFFFFFu;
+
+    // Half the best RTT bounds the path asymmetry; +1 for ms resolution.
+    // Then allow for drift since the last sync: the residual once the slope is
+    // known, the crystal tolerance before that.
+    uint64_t age = localMs - _lastSyncLocalMs;
+    uint32_t ppm = _driftKnown ? CLOCK_SYNC_RESIDUAL_PPM : CLOCK_SYNC_DRIFT_BOUND_PPM;
+    uint64_t u = _lastRttMs / 2 + 1 + (age * ppm + 999999) / 1000000;
+    return (u > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)u;
+}
+
+size_t ClockSync::formatRequest(char* out, size_t outSz, const char* macStr, uint64_t t0){
+    if(!out || outSz == 0) return 0;
+    int n = snprintf(out, outSz,
+        "{\"message_type\": \"time_request\", \"device\": {\"mac\": \"%s\"}, \"t0_ms\": %llu}",
+        macStr ? macStr : "",
+        (unsigned long long)t0);
+    if(n < 0) return 0;
+    return ((size_t)n < outSz) ? (size_t)n : outSz - 1;
+}
+
+// Finds "key": <unsigned integer> in a flat JSON object.
+static bool findU64(const char* msg, const char* key, uint64_t& out){
+    const char* p = strstr(msg, key);
+    if(!p) return false;
+    p += strlen(key);
+    while(*p == '"' || *p == ' ' || *p == ':') p++;
+    if(*p < '0' || *p > '9') return false;
+
+    char* end = nullptr;
+    out = strtoull(p, &end, 10);
+    return end != p;
+}
+
+bool ClockSync::parseResponse(const char* msg, uint64_t& t0, uint64_t& t1, uint64_t& t2){
+    if(!msg || !strstr(msg, "\"time_response\"")) return false;
+    return findU64(msg, "\"t0_ms\"", t0)
+        && findU64(msg, "\"t1_ms\"", t1)
+        && findU64(msg, "\"t2_ms\"", t2);
+}
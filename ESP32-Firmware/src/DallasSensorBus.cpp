@@ -0,0 +1,22 @@
+#include "DallasSensorBus.h"
+
+DallasSensorBus::DallasSensorBus(int pin) : _wire(pin), _dt(&_wire) {}
+
+void DallasSensorBus::begin(){
+    _dt.begin();
+
+    // non-blocking conversions (TemperatureBus waits in tick())
+    _dt.setWaitForConversion(false);
+}
+
+uint8_t DallasSensorBus::deviceCount(){
+    return _dt.getDeviceCount();
+}
+
+void DallasSensorBus::requestTemperatures(){
+    _dt.requestTemperatures();
+}
+
+float DallasSensorBus::tempC(uint8_t idx){
+    return _dt.getTempCByIndex(idx);
+}
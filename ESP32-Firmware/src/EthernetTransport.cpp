@@ -0,0 +1,71 @@
+#include "EthernetTransport.h"
+#include "config.h"
+
+#include <SPI.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+
+#ifdef ESP32
+  #include <esp_mac.h>
+#endif
+
+static EthernetUDP gUdp;
+
+bool EthernetTransport::begin() {
+  // Initialize SPI for W5500
+  SPI.begin(W5500_SCK_PIN, W5500_MISO_PIN, W5500_MOSI_PIN, W5500_CS_PIN);
+  Ethernet.init(W5500_CS_PIN);
+
+  // W5500 requires a MAC for Ethernet.begin (even if we use DHCP).
+  // Use the chip's Ethernet MAC, not the Wi-Fi STA one: the Wi-Fi fallback
+  // may be associated at the same time, and two interfaces sharing a MAC
+  // confuse DHCP and the switch's address tables.
+  uint8_t base[6] = {0};
+  #ifdef ESP32
+    esp_read_mac(base, ESP_MAC_ETH);
+  #else
+    base[0]=0xDE; base[1]=0xAD; base[2]=0xBE; base[3]=0xEF; base[4]=0x00; base[5]=0x01;
+  #endif
+  byte ethMac[6] = { base[0], base[1], base[2], base[3], base[4], base[5] };
+
+  Serial.println("[NET] Initializing W5500...");
+
+  // Try DHCP first.
+  if (Ethernet.begin(ethMac) == 0) {
+    Serial.println("[NET] DHCP failed (continuing, link might still be down).");
+  }
+
+  delay(200);
+
+  const bool up = linkUp();
+  if (up) {
+    Serial.print("[NET] Link up. IP=");
+    Serial.println(Ethernet.localIP());
+  } else {
+    Serial.println("[NET] Ethernet link DOWN (check cable/switch).");
+  }
+
+  // UDP does not need bind, but begin() sets a local port.
+  gUdp.begin(0);
+  return up;
+}
+
+bool EthernetTransport::linkUp() {
+  return Ethernet.linkStatus() == LinkON;
+}
+
+bool EthernetTransport::send(const IPAddress& dst, uint16_t port, const uint8_t* data, size_t len) {
+  if (gUdp.beginPacket(dst, port) != 1) return false;
+  gUdp.write(data, len);
+  return gUdp.endPacket() == 1;
+}
+
+size_t EthernetTransport::receive(uint8_t* out, size_t outSz, IPAddress& from) {
+  const int size = gUdp.parsePacket();
+  if (size <= 0) return 0;
+
+  // (Unread bytes are discarded by the next parsePacket().)
+  from = gUdp.remoteIP();
+  const int n = gUdp.read(out, outSz);
+  return (n > 0) ? (size_t)n : 0;
+}
@@ -6,7 +6,7 @@ void Heartbeat::begin(int rxPin, int txPin, uint32_t baud){
     _ser.begin(baud, SERIAL_8N1, rxPin, txPin);
 }
 
-uint8_t Heartbeat::crc8(const uint8_t* data, size_t n) const {
+uint8_t Heartbeat::crc8(const uint8_t* data, size_t n) {
     uint8_t crc = 0;
     for(size_t i = 0; i<n; i++){
         crc ^= data[i];
@@ -17,15 +17,22 @@ uint8_t Heartbeat::crc8(const uint8_t* data, size_t n) const {
     return crc;
 }
 
-void Heartbeat::send(char myId, uint32_t /*nowMs*/){
+void Heartbeat::send(char myId, uint32_t /*nowMs*/, uint8_t term, char leader){
     static uint8_t seq = 0;
+    if(_selfId != myId){
+        // Our own frames may have been heard before we knew our ID.
+        _selfId = myId;
+        forgetPeer(myId);
+    }
 
-    uint8_t pkt[5];
+    uint8_t pkt[3 + PAYLOAD_LEN];
     pkt[0] = 0xAA;
     pkt[1] = 0x55;
     pkt[2] = (uint8_t)myId;
     pkt[3] = seq++;
-    pkt[4] = crc8(&pkt[2], 2);
+    pkt[4] = term;
+    pkt[5] = (uint8_t)leader;
+    pkt[6] = crc8(&pkt[2], PAYLOAD_LEN);
 
     _ser.write(pkt, sizeof(pkt));
 
@@ -33,7 +40,20 @@ void Heartbeat::send(char myId, uint32_t /*nowMs*/){
 
 bool Heartbeat::peerAlive(uint32_t nowMs, uint32_t timeoutMs) const{
     if (_lastRxMs == 0) return false;
-    return (u_int32_t)(nowMs - _lastRxMs) <= timeoutMs;
+    const int32_t age = (int32_t)(nowMs - _lastRxMs);
+    return age <= 0 || (uint32_t)age <= timeoutMs;
+}
+
+const Heartbeat::Peer* Heartbeat::findPeer(char id) const{
+    for(uint8_t i = 0; i < _peerCount; i++){
+        if(_peers[i].id == id) return &_peers[i];
+    }
+    return nullptr;
+}
+
+bool Heartbeat::peerAlive(char id, uint32_t nowMs, uint32_t timeoutMs) const{
+    const Peer* p = findPeer(id);
+    return p && alive(*p, nowMs, timeoutMs);
 }
 
 void Heartbeat::tick(){
@@ -42,8 +62,45 @@ void Heartbeat::tick(){
     }
 }
 
+void Heartbeat::forgetPeer(char id){
+    for(uint8_t i = 0; i < _peerCount; i++){
+        if(_peers[i].id != id) continue;
+        _peers[i] = _peers[--_peerCount];
+        return;
+    }
+}
+
+void Heartbeat::onFrame(char id, uint8_t term, char leader){
+    if(id == _selfId || !validId(id)) return;
+    if(!validId(leader)) leader = '?';
+
+    uint32_t now = millis();
+    _peerId = id;
+    _lastRxMs = now;
+
+    Peer* p = nullptr;
+    for(uint8_t i = 0; i < _peerCount && !p; i++){
+        if(_peers[i].id == id) p = &_peers[i];
+    }
+    if(!p){
+        if(_peerCount < MAX_PEERS){
+            p = &_peers[_peerCount++];
+        } else {
+            // Full: reuse the slot heard from longest ago.
+            p = &_peers[0];
+            for(uint8_t i = 1; i < _peerCount; i++){
+                if((int32_t)(_peers[i].lastRxMs - p->lastRxMs) < 0) p = &_peers[i];
+            }
+        }
+        p->id = id;
+    }
+    p->lastRxMs = now;
+    p->term = term;
+    p->leader = leader;
+}
+
 void Heartbeat::parseByte(uint8_t b){
-    // Frame: AA 55 ID SEQ CRC
+    // Frame: AA 55 ID SEQ TERM LEADER CRC
     switch(_state){
         case 0:
             _state = (b== 0xAA) ? 1 : 0;
@@ -53,23 +110,22 @@ void Heartbeat::parseByte(uint8_t b){
                 _state = 2;
                 _idx = 0;
             } else {
-                _state = 0;
+                // AA AA 55: the second AA may be the real start.
+                _state = (b == 0xAA) ? 1 : 0;
             }
             break;
         case 2:
             _buf[_idx++] = b;
-            _state = 3;
-            break;
-        case 3:
-            _buf[_idx++] = b;
-            _state = 4;
+            if(_idx == PAYLOAD_LEN) _state = 3;
             break;
-        case 4: {
+        case 3: {
             uint8_t got = b;
-            uint8_t calc = crc8(_buf, 2);
+            uint8_t calc = crc8(_buf, PAYLOAD_LEN);
             if (got == calc){
-                _peerId = (char)_buf[0];
-                _lastRxMs = millis();
+                onFrame((char)_buf[0], _buf[2], (char)_buf[3]);
+                _framesOk++;
+            } else {
+                _crcErrors++;
             }
             _state = 0;
         } break;
@@ -78,4 +134,4 @@ void Heartbeat::parseByte(uint8_t b){
             _state = 0;
             break;
     }
-}
\ No newline at end of file
+}
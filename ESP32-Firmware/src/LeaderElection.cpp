@@ -0,0 +1,26 @@
+#include "LeaderElection.h"
+
+LeaderElection::LeaderElection(char myId, char primaryId, uint32_t timeoutMs, uint32_t bootGraceMs)
+    : _myId(myId), _primaryId(primaryId), _timeoutMs(timeoutMs), _bootGraceMs(bootGraceMs) {}
+
+bool LeaderElection::update(const Heartbeat::Peer* peers, uint8_t count, uint32_t nowMs){
+    // Ourselves, unless still in the boot grace window
+    char best = (_myId == _primaryId || nowMs > _bootGraceMs) ? _myId : NO_LEADER;
+    uint8_t maxTerm = _term;
+
+    for(uint8_t i = 0; i < count; i++){
+        const Heartbeat::Peer& p = peers[i];
+        if(!Heartbeat::alive(p, nowMs, _timeoutMs)) continue;
+
+        if(best == NO_LEADER || p.id < best) best = p.id;
+        if(newerTerm(p.term, maxTerm)) maxTerm = p.term;
+    }
+
+    _term = maxTerm;
+    if(best == _leader) return false;
+
+    _prevLeader = _leader;
+    _leader = best;
+    _term = (uint8_t)(maxTerm + 1);
+    return true;
+}
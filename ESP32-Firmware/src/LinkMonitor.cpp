@@ -0,0 +1,89 @@
+#include "LinkMonitor.h"
+
+LinkMonitor::LinkMonitor(uint8_t failProbes, uint32_t stableMs)
+    : _failProbes(failProbes ? failProbes : 1), _stableMs(stableMs) {}
+
+bool LinkMonitor::update(bool ethLink, bool ethProbeOk, bool wifiLink, bool wifiProbeOk, uint64_t nowMs){
+    const bool ethHealthy = ethLink && ethProbeOk;
+
+    if(ethHealthy){
+        _ethFails = 0;
+        if(_ethGoodSinceMs == 0) _ethGoodSinceMs = nowMs;
+    } else {
+        if(_ethFails < 0xFF) _ethFails++;
+        _ethGoodSinceMs = 0;
+    }
+
+    if(_active == ETHERNET){
+        if(ethHealthy){
+            _troubleSinceMs = 0;
+            return false;
+        }
+        if(_troubleSinceMs == 0) _troubleSinceMs = nowMs;
+
+        // Nowhere better to go.
+        if(!wifiLink) return false;
+
+        if(!ethLink){
+            switchTo(WIFI, "ethernet_link_down", nowMs);
+            return true;
+        }
+        if(_ethFails >= _failProbes){
+            switchTo(WIFI, "ethernet_degraded", nowMs);
+            return true;
+        }
+        return false;
+    }
+
+    // On Wi-Fi
+    if(!wifiLink || !wifiProbeOk){
+        if(_troubleSinceMs == 0) _troubleSinceMs = nowMs;
+        if(_wifiFails < 0xFF) _wifiFails++;
+
+        // Only to an Ethernet that is answering: it may be the link that
+        // just failed its probes.
+        if(!ethHealthy) return false;
+
+        if(!wifiLink){
+            switchTo(ETHERNET, "wifi_link_down", nowMs);
+            return true;
+        }
+        if(_wifiFails >= _failProbes){
+            switchTo(ETHERNET, "wifi_degraded", nowMs);
+            return true;
+        }
+        return false;
+    }
+    _wifiFails = 0;
+    _troubleSinceMs = 0;
+
+    if(_ethGoodSinceMs != 0 && nowMs - _ethGoodSinceMs >= _stableMs){
+        switchTo(ETHERNET, "ethernet_restored", nowMs);
+        return true;
+    }
+    return false;
+}
+
+void LinkMonitor::switchTo(Link to, const char* reason, uint64_t nowMs){
+    Event& e = _log[_logHead];
+    e.localMs = nowMs;
+    e.from = _active;
+    e.to = to;
+    e.reason = reason;
+    e.detectMs = (_troubleSinceMs != 0) ? (uint32_t)(nowMs - _troubleSinceMs) : 0;
+
+    _logHead = (uint8_t)((_logHead + 1) % LOG_SIZE);
+    if(_logLen < LOG_SIZE) _logLen++;
+    _switches++;
+
+    _active = to;
+    _ethFails = 0;
+    _wifiFails = 0;
+    _troubleSinceMs = 0;
+}
+
+const LinkMonitor::Event& LinkMonitor::event(uint8_t i) const{
+    // Oldest entry sits at _logHead once the ring is full.
+    uint8_t start = (_logLen < LOG_SIZE) ? 0 : _logHead;
+    return _log[(start + i) % LOG_SIZE];
+}
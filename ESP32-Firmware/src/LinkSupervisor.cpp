@@ -0,0 +1,43 @@
+#include "LinkSupervisor.h"
+#include "TelemetrySender.h"
+
+LinkSupervisor::LinkSupervisor(LinkMonitor& mon, TelemetrySender& net, Transport& eth, Transport& wifi,
+                               ProbeFn probe, SwitchFn onSwitch)
+    : _mon(mon), _net(net), _eth(eth), _wifi(wifi), _probe(probe), _onSwitch(onSwitch) {}
+
+void LinkSupervisor::startRound(bool collectorAnswered, uint64_t nowMs){
+    if(_probesOut) return;
+
+    const bool onWifi = (_mon.active() == LinkMonitor::WIFI);
+    _trustProbes = collectorAnswered;
+    _ethProbeOk = false;
+    _wifiProbeOk = false;
+
+    if(_trustProbes){
+        if(_eth.linkUp() && _probe(_eth)) _probesOut++;
+        if(onWifi && _wifi.linkUp() && _probe(_wifi)) _probesOut++;
+    }
+    if(_probesOut == 0) evaluate(nowMs);
+}
+
+void LinkSupervisor::onProbe(const Transport* via, bool answered, uint64_t nowMs){
+    if(via == &_eth) _ethProbeOk = answered;
+    if(via == &_wifi) _wifiProbeOk = answered;
+    if(_probesOut && --_probesOut == 0) evaluate(nowMs);
+}
+
+void LinkSupervisor::evaluate(uint64_t nowMs){
+    const bool onWifi = (_mon.active() == LinkMonitor::WIFI);
+    const bool ethLink = _eth.linkUp();
+    const bool wifiLink = _wifi.linkUp();
+    const bool ethOk = ethLink && (!_trustProbes || _ethProbeOk);
+    const bool wifiOk = wifiLink && (!onWifi || !_trustProbes || _wifiProbeOk);
+
+    if(!_mon.update(ethLink, ethOk, wifiLink, wifiOk, nowMs)) return;
+
+    _net.setActive(_mon.active() == LinkMonitor::WIFI ? _wifi : _eth);
+
+    // Whatever queued up while the old link was failing goes out on the new one.
+    const uint8_t resent = _net.flushPending();
+    if(_onSwitch) _onSwitch(_mon.event(_mon.eventCount() - 1), resent);
+}
@@ -0,0 +1,128 @@
+#include "Profiler.h"
+
+#ifndef ESP32
+  #include <chrono>
+#endif
+
+Profiler::Hist Profiler::_hist[Profiler::STAGE_COUNT];
+
+uint32_t Profiler::now(){
+#ifdef ESP32
+    return ESP.getCycleCount();
+#else
+    // Host builds: nanoseconds from a monotonic clock.
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t Profiler::ticksPerUs(){
+#ifdef ESP32
+    return ESP.getCpuFreqMHz();
+#else
+    return 1000;
+#endif
+}
+
+uint32_t Profiler::toUs(uint32_t ticks){
+    uint32_t perUs = ticksPerUs();
+    return perUs ? ticks / perUs : ticks;
+}
+
+void Profiler::record(Stage stage, uint32_t ticks){
+    if(stage >= STAGE_COUNT) return;
+    Hist& h = _hist[stage];
+
+    // Bucket i holds durations in [2^i, 2^(i+1)); 0 and 1 both land in bucket 0.
+    uint8_t b = (ticks > 1) ? (uint8_t)(31 - __builtin_clz(ticks)) : 0;
+    h.buckets[b]++;
+    h.count++;
+    if(ticks > h.maxTicks) h.maxTicks = ticks;
+}
+
+void Profiler::reset(){
+    memset(_hist, 0, sizeof(_hist));
+}
+
+uint32_t Profiler::percentileUs(Stage stage, uint8_t pct){
+    if(stage >= STAGE_COUNT) return 0;
+    const Hist& h = _hist[stage];
+    if(h.count == 0) return 0;
+
+    // Rank of the requested percentile, 1-based, rounded up.
+    uint32_t rank = (uint32_t)(((uint64_t)h.count * pct + 99) / 100);
+    if(rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for(uint8_t b = 0; b < BUCKETS; b++){
+        seen += h.buckets[b];
+        if(seen >= rank){
+            uint32_t upper = (b >= 31) ? 0xFFFFFFFFu : ((1u << (b + 1)) - 1);
+            // Never report more than what was actually observed.
+            if(upper > h.maxTicks) upper = h.maxTicks;
+            return toUs(upper);
+        }
+    }
+    return toUs(h.maxTicks);
+}
+
+uint32_t Profiler::maxUs(Stage stage){
+    return (stage < STAGE_COUNT) ? toUs(_hist[stage].maxTicks) : 0;
+}
+
+uint32_t Profiler::count(Stage stage){
+    return (stage < STAGE_COUNT) ? _hist[stage].count : 0;
+}
+
+const char* Profiler::stageName(Stage stage){
+    switch(stage){
+        case HB_RX: return "hb_rx";
+        case HB_TX: return "hb_tx";
+        case TEMP:  return "temp";
+        case JSON:  return "json";
+        case UDP:   return "udp";
+        case LOG:   return "log";
+        default:    return "?";
+    }
+}
+
+size_t Profiler::formatItem(char* out, size_t outSz, uint32_t windowMs){
+    if(!out || outSz == 0) return 0;
+    out[0] = '\0';
+
+#if PROFILE_ENABLED
+    size_t used = 0;
+    auto append = [&](int n){
+        if(n > 0) used += (size_t)n;
+        if(used >= outSz) used = outSz - 1;
+    };
+
+    // Compact row per stage so the item fits next to the rest of the payload
+    // in one Ethernet frame.
+    append(snprintf(out, outSz,
+        "{\n"
+        "      \"kind\": \"profile\",\n"
+        "      \"window_ms\": %lu,\n"
+        "      \"fields\": [\"n\", \"p50_us\", \"p99_us\", \"max_us\"],\n"
+        "      \"stages\": {",
+        (unsigned long)windowMs));
+
+    for(uint8_t s = 0; s < STAGE_COUNT; s++){
+        Stage st = (Stage)s;
+        append(snprintf(out + used, outSz - used,
+            "%s\n        \"%s\": [%lu, %lu, %lu, %lu]",
+            s ? "," : "",
+            stageName(st),
+            (unsigned long)count(st),
+            (unsigned long)percentileUs(st, 50),
+            (unsigned long)percentileUs(st, 99),
+            (unsigned long)maxUs(st)));
+    }
+
+    append(snprintf(out + used, outSz - used, "\n      }\n    }"));
+    return used;
+#else
+    (void)windowMs;
+    return 0;
+#endif
+}
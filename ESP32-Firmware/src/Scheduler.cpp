@@ -0,0 +1,200 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler(ClockFn clock, SleepFn sleep) : _clock(clock), _sleep(sleep) {
+    _statsSinceMs = _clock();
+}
+
+uint8_t Scheduler::every(const char* name, uint32_t periodMs, TaskFn fn, uint32_t firstDelayMs){
+    if(periodMs == 0) return INVALID_TASK;
+    return addTask(name, periodMs, fn, firstDelayMs);
+}
+
+uint8_t Scheduler::once(const char* name, uint32_t delayMs, TaskFn fn){
+    return addTask(name, 0, fn, delayMs);
+}
+
+uint8_t Scheduler::addTask(const char* name, uint32_t periodMs, TaskFn fn, uint32_t delayMs){
+    if(_count >= MAX_TASKS || !fn) return INVALID_TASK;
+
+    uint8_t id = _count++;
+    Task& t = _tasks[id];
+    t.name = name;
+    t.fn = fn;
+    t.periodMs = periodMs;
+    t.dueMs = _clock() + delayMs;
+    t.heapPos = NOT_QUEUED;
+    t.wake = false;
+    t.runs = 0;
+    t.lateMaxMs = 0;
+    t.lateSumMs = 0;
+
+    push(id);
+    return id;
+}
+
+void Scheduler::schedule(uint8_t id, uint32_t delayMs){
+    if(id >= _count) return;
+    Task& t = _tasks[id];
+    t.dueMs = _clock() + delayMs;
+
+    if(t.heapPos == NOT_QUEUED){
+        push(id);
+    } else {
+        siftUp(t.heapPos);
+        siftDown(t.heapPos);
+    }
+}
+
+void Scheduler::cancel(uint8_t id){
+    if(id >= _count) return;
+    if(_tasks[id].heapPos != NOT_QUEUED) removeAt(_tasks[id].heapPos);
+}
+
+void Scheduler::wake(uint8_t id){
+    if(id >= _count) return;
+    _tasks[id].wake = true;
+    _wakePending = true;
+}
+
+void Scheduler::runDue(){
+    uint32_t now = _clock();
+
+    // Event wakeups pull the task's deadline forward to "now".
+    if(_wakePending){
+        _wakePending = false;
+        for(uint8_t i = 0; i < _count; i++){
+            if(_tasks[i].wake){
+                _tasks[i].wake = false;
+                schedule(i, 0);
+            }
+        }
+        now = _clock();
+    }
+
+    while(_heapLen > 0){
+        uint8_t id = _heap[0];
+        Task& t = _tasks[id];
+
+        int32_t late = (int32_t)(now - t.dueMs);
+        if(late < 0) break;
+
+        removeAt(0);
+
+        t.runs++;
+        t.lateSumMs += (uint32_t)late;
+        if((uint32_t)late > t.lateMaxMs) t.lateMaxMs = (uint32_t)late;
+
+        // Re-arm before running so the task may reschedule or cancel itself.
+        if(t.periodMs){
+            t.dueMs += t.periodMs;
+            // Fell more than a whole period behind: skip ahead instead of bursting.
+            if((int32_t)(now - t.dueMs) >= 0) t.dueMs = now + t.periodMs;
+            push(id);
+        }
+
+        t.fn(now);
+        now = _clock();
+    }
+}
+
+uint32_t Scheduler::msUntilNext(uint32_t maxMs) const{
+    if(_wakePending) return 0;
+    if(_heapLen == 0) return maxMs;
+
+    int32_t left = (int32_t)(_tasks[_heap[0]].dueMs - _clock());
+    if(left <= 0) return 0;
+    return ((uint32_t)left < maxMs) ? (uint32_t)left : maxMs;
+}
+
+void Scheduler::idle(uint32_t maxMs){
+    uint32_t ms = msUntilNext(maxMs);
+    if(ms == 0) return;
+
+    uint32_t t0 = _clock();
+    _sleep(ms);
+    _idleMs += _clock() - t0;
+}
+
+Scheduler::TaskStats Scheduler::stats(uint8_t id) const{
+    TaskStats s = {nullptr, 0, 0, 0};
+    if(id >= _count) return s;
+
+    const Task& t = _tasks[id];
+    s.name = t.name;
+    s.runs = t.runs;
+    s.lateMaxMs = t.lateMaxMs;
+    s.lateSumMs = t.lateSumMs;
+    return s;
+}
+
+uint8_t Scheduler::idlePercent() const{
+    uint32_t total = _clock() - _statsSinceMs;
+    if(total == 0) return 0;
+    uint64_t pct = (uint64_t)_idleMs * 100 / total;
+    return (pct > 100) ? 100 : (uint8_t)pct;
+}
+
+void Scheduler::resetStats(){
+    for(uint8_t i = 0; i < _count; i++){
+        _tasks[i].runs = 0;
+        _tasks[i].lateMaxMs = 0;
+        _tasks[i].lateSumMs = 0;
+    }
+    _statsSinceMs = _clock();
+    _idleMs = 0;
+}
+
+// ---- min-heap on dueMs (wrap-safe) ----
+
+bool Scheduler::earlier(uint8_t a, uint8_t b) const{
+    return (int32_t)(_tasks[a].dueMs - _tasks[b].dueMs) < 0;
+}
+
+void Scheduler::swapHeap(uint8_t i, uint8_t j){
+    uint8_t tmp = _heap[i];
+    _heap[i] = _heap[j];
+    _heap[j] = tmp;
+    _tasks[_heap[i]].heapPos = i;
+    _tasks[_heap[j]].heapPos = j;
+}
+
+void Scheduler::siftUp(uint8_t i){
+    while(i > 0){
+        uint8_t parent = (i - 1) / 2;
+        if(!earlier(_heap[i], _heap[parent])) break;
+        swapHeap(i, parent);
+        i = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t i){
+    for(;;){
+        uint8_t l = 2 * i + 1;
+        uint8_t r = l + 1;
+        uint8_t m = i;
+        if(l < _heapLen && earlier(_heap[l], _heap[m])) m = l;
+        if(r < _heapLen && earlier(_heap[r], _heap[m])) m = r;
+        if(m == i) break;
+        swapHeap(i, m);
+        i = m;
+    }
+}
+
+void Scheduler::push(uint8_t id){
+    uint8_t pos = _heapLen++;
+    _heap[pos] = id;
+    _tasks[id].heapPos = pos;
+    siftUp(pos);
+}
+
+void Scheduler::removeAt(uint8_t pos){
+    uint8_t id = _heap[pos];
+    uint8_t last = --_heapLen;
+
+    if(pos != last){
+        swapHeap(pos, last);
+        siftUp(pos);
+        siftDown(pos);
+    }
+    _tasks[id].heapPos = NOT_QUEUED;
+}
@@ -0,0 +1,292 @@
+#include "TelemetryJson.h"
+
+void appendTempArray(char* out, size_t outSz, const float vals[TemperatureBus::SENSORS_PER_BUS]) {
+  // Writes something like: [21.23, 22.00, null]
+  // NAN -> null
+  size_t used = strnlen(out, outSz);
+  if (used >= outSz) return;
+
+  auto append = [&](const char* s) {
+    size_t u = strnlen(out, outSz);
+    if (u < outSz) strncat(out, s, outSz - u - 1);
+  };
+
+  append("[");
+  for (uint8_t i = 0; i < TemperatureBus::SENSORS_PER_BUS; i++) {
+    if (i) append(", ");
+    if (isnan(vals[i])) {
+      append("null");
+    } else {
+      char b[16];
+      snprintf(b, sizeof(b), "%.2f", (double)vals[i]);
+      append(b);
+    }
+  }
+  append("]");
+}
+
+// Radxa-synchronised time, or null until the first clock sync succeeds.
+static void formatEpoch(char* epochStr, size_t epochSz,
+                        char* uncertaintyStr, size_t uncertaintySz,
+                        uint64_t epochMs, uint32_t uncertaintyMs) {
+  if (epochMs) {
+    snprintf(epochStr, epochSz, "%llu", (unsigned long long)epochMs);
+    snprintf(uncertaintyStr, uncertaintySz, "%lu", (unsigned long)uncertaintyMs);
+  } else {
+    snprintf(epochStr, epochSz, "null");
+    snprintf(uncertaintyStr, uncertaintySz, "null");
+  }
+}
+
+void buildTelemetryJson(char* out, size_t outSz,
+                        const char* macStr,
+                        char controllerId,
+                        uint32_t seq,
+                        uint64_t deviceMs,
+                        uint64_t epochMs,
+                        uint32_t uncertaintyMs,
+                        bool aAlive,
+                        bool bAlive,
+                        const float cool[TemperatureBus::SENSORS_PER_BUS],
+                        const float exhaust[TemperatureBus::SENSORS_PER_BUS],
+                        bool failoverOccurred,
+                        const char* failoverDetails,
+                        const char* extraItems) {
+  // NOTE: Kept close to the JSON structure shown in the image.
+  // We avoid ArduinoJson to keep dependencies minimal.
+  if (!out || outSz == 0) return;
+  out[0] = '\0';
+
+  // Pre-build temperature arrays
+  char coolArr[96] = {0};
+  char exhArr[96] = {0};
+  appendTempArray(coolArr, sizeof(coolArr), cool);
+  appendTempArray(exhArr, sizeof(exhArr), exhaust);
+
+  // Escape details minimally (replace \" with ').
+  char detailsSafe[128];
+  size_t di = 0;
+  if (!failoverDetails) failoverDetails = "";
+  for (size_t i = 0; failoverDetails[i] && di + 1 < sizeof(detailsSafe); i++) {
+    char c = failoverDetails[i];
+    if (c == '"') c = '\'';
+    if ((uint8_t)c < 0x20) c = ' '; // strip control chars
+    detailsSafe[di++] = c;
+  }
+  detailsSafe[di] = '\0';
+
+  char epochStr[24];
+  char uncertaintyStr[16];
+  formatEpoch(epochStr, sizeof(epochStr), uncertaintyStr, sizeof(uncertaintyStr),
+              epochMs, uncertaintyMs);
+
+  // Optional trailing items, each already formatted as ",\n    { ... }".
+  if (!extraItems) extraItems = "";
+
+  snprintf(
+    out, outSz,
+    "{\n"
+    "  \"message_type\": \"telemetry\",\n\n"
+    "  \"device\": {\n"
+    "    \"mac\": \"%s\",\n"
+    "    \"controller\": \"%c\"\n"
+    "  },\n\n"
+    "  \"seq\": %lu,\n"
+    "  \"timestamp_device_ms\": %llu,\n"
+    "  \"timestamp_epoch_ms\": %s,\n"
+    "  \"timestamp_uncertainty_ms\": %s,\n\n"
+    "  \"items\": [\n"
+    "    {\n"
+    "      \"kind\": \"heartbeat\",\n"
+    "      \"controller_a_alive\": %s,\n"
+    "      \"controller_b_alive\": %s\n"
+    "    },\n"
+    "    {\n"
+    "      \"kind\": \"sensors\",\n"
+    "      \"buses\": [\n"
+    "        {\n"
+    "          \"bus\": \"cool\",\n"
+    "          \"temperatures_c\": %s\n"
+    "        },\n"
+    "        {\n"
+    "          \"bus\": \"exhaust\",\n"
+    "          \"temperatures_c\": %s\n"
+    "        }\n"
+    "      ]\n"
+    "    },\n"
+    "    {\n"
+    "      \"kind\": \"event\",\n"
+    "      \"type\": \"failover\",\n"
+    "      \"occurred\": %s,\n"
+    "      \"details\": \"%s\"\n"
+    "    }%s\n"
+    "  ]\n"
+    "}\n",
+    macStr,
+    controllerId,
+    (unsigned long)seq,
+    (unsigned long long)deviceMs,
+    epochStr,
+    uncertaintyStr,
+    aAlive ? "true" : "false",
+    bAlive ? "true" : "false",
+    coolArr,
+    exhArr,
+    failoverOccurred ? "true" : "false",
+    detailsSafe,
+    extraItems
+  );
+}
+
+size_t formatCountersItem(char* out, size_t outSz, const TelemetryCounters& c) {
+  if (!out || outSz == 0) return 0;
+
+  int n = snprintf(
+    out, outSz,
+    ",\n"
+    "    {\n"
+    "      \"kind\": \"counters\",\n"
+    "      \"hb_frames_ok\": %lu,\n"
+    "      \"hb_crc_errors\": %lu,\n"
+    "      \"udp_sent\": %lu,\n"
+    "      \"udp_send_failures\": %lu\n"
+    "    }",
+    (unsigned long)c.hbFramesOk,
+    (unsigned long)c.hbCrcErrors,
+    (unsigned long)c.udpSent,
+    (unsigned long)c.udpSendFailures
+  );
+  if (n < 0) return 0;
+  return ((size_t)n < outSz) ? (size_t)n : outSz - 1;
+}
+
+size_t formatMembershipItem(char* out, size_t outSz,
+                            char selfId, char leader, uint8_t term,
+                            const Heartbeat::Peer* peers, uint8_t count,
+                            uint32_t nowMs, uint32_t timeoutMs) {
+  if (!out || outSz == 0) return 0;
+
+  size_t used = 0;
+  auto append = [&](int n) {
+    if (n > 0) used += (size_t)n;
+    if (used >= outSz) used = outSz - 1;
+  };
+
+  append(snprintf(
+    out, outSz,
+    ",\n"
+    "    {\n"
+    "      \"kind\": \"membership\",\n"
+    "      \"leader\": \"%c\",\n"
+    "      \"term\": %u,\n"
+    "      \"members\": [\n"
+    "        {\"id\": \"%c\", \"alive\": true, \"age_ms\": 0, \"leader\": \"%c\", \"term\": %u}",
+    leader, (unsigned)term,
+    selfId, leader, (unsigned)term
+  ));
+
+  for (uint8_t i = 0; i < count; i++) {
+    const Heartbeat::Peer& p = peers[i];
+    append(snprintf(
+      out + used, outSz - used,
+      ",\n        {\"id\": \"%c\", \"alive\": %s, \"age_ms\": %lu, \"leader\": \"%c\", \"term\": %u}",
+      p.id,
+      Heartbeat::alive(p, nowMs, timeoutMs) ? "true" : "false",
+      (unsigned long)Heartbeat::ageMs(p, nowMs),
+      p.leader,
+      (unsigned)p.term
+    ));
+  }
+
+  append(snprintf(out + used, outSz - used, "\n      ]\n    }"));
+  return used;
+}
+
+size_t formatNetworkEventItem(char* out, size_t outSz, const LinkMonitor& mon,
+                              uint32_t udpRetried, uint32_t udpDropped) {
+  if (!out || outSz == 0) return 0;
+
+  size_t used = 0;
+  auto append = [&](int n) {
+    if (n > 0) used += (size_t)n;
+    if (used >= outSz) used = outSz - 1;
+  };
+
+  append(snprintf(
+    out, outSz,
+    ",\n"
+    "    {\n"
+    "      \"kind\": \"network_failover\",\n"
+    "      \"interface\": \"%s\",\n"
+    "      \"switches\": %lu,\n"
+    "      \"udp_retried\": %lu,\n"
+    "      \"udp_dropped\": %lu,\n"
+    "      \"events\": [",
+    LinkMonitor::linkName(mon.active()),
+    (unsigned long)mon.switchCount(),
+    (unsigned long)udpRetried,
+    (unsigned long)udpDropped
+  ));
+
+  for (uint8_t i = 0; i < mon.eventCount(); i++) {
+    const LinkMonitor::Event& e = mon.event(i);
+    append(snprintf(
+      out + used, outSz - used,
+      "%s\n        {\"device_ms\": %llu, \"from\": \"%s\", \"to\": \"%s\", \"reason\": \"%s\", \"detect_ms\": %lu}",
+      i ? "," : "",
+      (unsigned long long)e.localMs,
+      LinkMonitor::linkName(e.from),
+      LinkMonitor::linkName(e.to),
+      e.reason,
+      (unsigned long)e.detectMs
+    ));
+  }
+
+  append(snprintf(out + used, outSz - used, "\n      ]\n    }"));
+  return used;
+}
+
+void buildItemsJson(char* out, size_t outSz,
+                    const char* macStr,
+                    char controllerId,
+                    uint32_t seq,
+                    uint64_t deviceMs,
+                    uint64_t epochMs,
+                    uint32_t uncertaintyMs,
+                    const char* items) {
+  if (!out || outSz == 0) return;
+  out[0] = '\0';
+
+  char epochStr[24];
+  char uncertaintyStr[16];
+  formatEpoch(epochStr, sizeof(epochStr), uncertaintyStr, sizeof(uncertaintyStr),
+              epochMs, uncertaintyMs);
+
+  // items uses the extraItems format; drop the separator before the first one.
+  if (!items) items = "";
+  if (items[0] == ',') items++;
+
+  snprintf(
+    out, outSz,
+    "{\n"
+    "  \"message_type\": \"telemetry\",\n\n"
+    "  \"device\": {\n"
+    "    \"mac\": \"%s\",\n"
+    "    \"controller\": \"%c\"\n"
+    "  },\n\n"
+    "  \"seq\": %lu,\n"
+    "  \"timestamp_device_ms\": %llu,\n"
+    "  \"timestamp_epoch_ms\": %s,\n"
+    "  \"timestamp_uncertainty_ms\": %s,\n\n"
+    "  \"items\": [%s\n"
+    "  ]\n"
+    "}\n",
+    macStr,
+    controllerId,
+    (unsigned long)seq,
+    (unsigned long long)deviceMs,
+    epochStr,
+    uncertaintyStr,
+    items
+  );
+}
@@ -1,24 +1,49 @@
 #include "TelemetrySender.h"
 #include "config.h"
 
-#include <SPI.h>
-#include <Ethernet.h>
-#include <EthernetUdp.h>
-
 #ifdef ESP32
   #include <esp_mac.h>
 #endif
 
-static EthernetUDP gUdp;
-static bool gEthUp = false;
+static uint32_t gSent = 0;
+static uint32_t gSendFail = 0;
+static uint32_t gRetried = 0;
+static uint32_t gDropped = 0;
+
+// Retry queue: a ring of whole payloads, oldest at gPendingHead.
+static char gPending[NET_RETRY_SLOTS][TelemetrySender::MAX_PAYLOAD];
+static uint8_t gPendingHead = 0;
+static uint8_t gPendingLen = 0;
+
+static IPAddress gCollectors[TelemetrySender::MAX_COLLECTORS];
+static uint8_t gCollectorCount = 0;
+static uint8_t gActive = 0;
+
+static void loadCollectors() {
+  gCollectorCount = 0;
+  gActive = 0;
+
+#ifdef COLLECTOR_IPS
+  char list[] = COLLECTOR_IPS;
+  for (char* tok = strtok(list, ", "); tok; tok = strtok(nullptr, ", ")) {
+    IPAddress ip;
+    if (gCollectorCount >= TelemetrySender::MAX_COLLECTORS) {
+      Serial.printf("[NET] Too many collectors, ignoring %s\n", tok);
+    } else if (ip.fromString(tok)) {
+      gCollectors[gCollectorCount++] = ip;
+    } else {
+      Serial.printf("[NET] Bad collector address '%s', ignoring\n", tok);
+    }
+  }
+#endif
 
-static IPAddress radxaIP() {
-  return IPAddress(RADXA_IP_A, RADXA_IP_B, RADXA_IP_C, RADXA_IP_D);
+  // Single-Radxa setups (and a COLLECTOR_IPS with nothing usable)
+  if (gCollectorCount == 0) {
+    gCollectors[gCollectorCount++] = IPAddress(RADXA_IP_A, RADXA_IP_B, RADXA_IP_C, RADXA_IP_D);
+  }
 }
 
-String TelemetrySender::deviceMacString() {
-  uint8_t mac[6] = {0};
-
+static void readBaseMac(uint8_t mac[6]) {
   #ifdef ESP32
     // ESP32 "base MAC" is stable and unique per chip.
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
@@ -27,66 +52,171 @@ String TelemetrySender::deviceMacString() {
     mac[0] = 0xAA; mac[1] = 0xBB; mac[2] = 0xCC;
     mac[3] = 0xDD; mac[4] = 0xEE; mac[5] = 0xFF;
   #endif
+}
 
-  char buf[18];
-  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X",
+// The MAC never changes at runtime, so format it once instead of on every send.
+static char gMacStr[18] = {0};
+
+static void cacheMac() {
+  if (gMacStr[0]) return;
+
+  uint8_t mac[6] = {0};
+  readBaseMac(mac);
+
+  snprintf(gMacStr, sizeof(gMacStr), "%02X:%02X:%02X:%02X:%02X:%02X",
            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-  return String(buf);
 }
 
-bool TelemetrySender::begin() {
-  // Initialize SPI for W5500
-  SPI.begin(W5500_SCK_PIN, W5500_MISO_PIN, W5500_MOSI_PIN, W5500_CS_PIN);
-  Ethernet.init(W5500_CS_PIN);
-
-  // W5500 requires a MAC for Ethernet.begin (even if we use DHCP).
-  // We'll derive one from the ESP32 base MAC.
-  uint8_t base[6] = {0};
-  #ifdef ESP32
-    esp_read_mac(base, ESP_MAC_WIFI_STA);
-  #else
-    base[0]=0xDE; base[1]=0xAD; base[2]=0xBE; base[3]=0xEF; base[4]=0x00; base[5]=0x01;
-  #endif
-  byte ethMac[6] = { base[0], base[1], base[2], base[3], base[4], base[5] };
+String TelemetrySender::deviceMacString() {
+  return String(deviceMacCStr());
+}
 
-  Serial.println("[NET] Initializing W5500...");
+const char* TelemetrySender::deviceMacCStr() {
+  cacheMac();
+  return gMacStr;
+}
 
-  // Try DHCP first.
-  if (Ethernet.begin(ethMac) == 0) {
-    Serial.println("[NET] DHCP failed (continuing, link might still be down).");
-  }
+TelemetrySender::TelemetrySender(Transport& primary, Transport& fallback)
+  : _primary(primary), _fallback(fallback), _active(&primary) {}
 
-  delay(200);
+bool TelemetrySender::begin() {
+  loadCollectors();
 
-  if (Ethernet.linkStatus() == LinkON) {
-    gEthUp = true;
-    Serial.print("[NET] Link up. IP=");
-    Serial.println(Ethernet.localIP());
-  } else {
-    gEthUp = false;
-    Serial.println("[NET] Link DOWN (check cable/switch). Telemetry will not send.");
+  _fallback.begin();
+  const bool up = _primary.begin();
+  if (!up) {
+    Serial.println("[NET] Primary link down; telemetry waits for Wi-Fi fallback.");
   }
-
-  // UDP does not need bind, but begin() sets a local port.
-  gUdp.begin(0);
-  return gEthUp;
+  return up;
 }
 
 bool TelemetrySender::isUp() const {
-  // Update link status opportunistically.
-  gEthUp = (Ethernet.linkStatus() == LinkON);
-  return gEthUp;
+  return _active->linkUp();
 }
 
 bool TelemetrySender::sendUDP(const char* jsonPayload) {
   if (!jsonPayload || !jsonPayload[0]) return false;
-  if (!isUp()) return false;
 
-  const IPAddress dst = radxaIP();
+  // Keep order: anything already waiting goes out first.
+  if (gPendingLen > 0) flushPending();
+
+  if (gPendingLen == 0 && sendUDPTo(gActive, jsonPayload)) return true;
+
+  enqueue(jsonPayload);
+  return false;
+}
+
+bool TelemetrySender::sendUDPTo(uint8_t collectorIdx, const char* jsonPayload, Transport* via) {
+  if (!jsonPayload || !jsonPayload[0]) return false;
+  if (collectorIdx >= gCollectorCount) return false;
+
+  Transport& t = via ? *via : *_active;
+  if (!t.linkUp() ||
+      !t.send(gCollectors[collectorIdx], (uint16_t)RADXA_UDP_PORT,
+              (const uint8_t*)jsonPayload, strlen(jsonPayload))) {
+    gSendFail++;
+    return false;
+  }
+  gSent++;
+  return true;
+}
 
-  if (gUdp.beginPacket(dst, (uint16_t)RADXA_UDP_PORT) != 1) {
+bool TelemetrySender::enqueue(const char* jsonPayload) {
+  if (NET_RETRY_SLOTS == 0) {
+    gDropped++;
     return false;
   }
-  gUdp.write((const uint8_t*)jsonPayload, strlen(jsonPayload));
-  return (gUdp.endPacket() == 1);
+
+  // Full: the oldest sample is the least useful one, drop it.
+  if (gPendingLen == NET_RETRY_SLOTS) {
+    gPendingHead = (uint8_t)((gPendingHead + 1) % NET_RETRY_SLOTS);
+    gPendingLen--;
+    gDropped++;
+  }
+
+  const uint8_t slot = (uint8_t)((gPendingHead + gPendingLen) % NET_RETRY_SLOTS);
+  strncpy(gPending[slot], jsonPayload, MAX_PAYLOAD - 1);
+  gPending[slot][MAX_PAYLOAD - 1] = '\0';
+  gPendingLen++;
+  return true;
+}
+
+uint8_t TelemetrySender::flushPending() {
+  uint8_t sent = 0;
+  while (gPendingLen > 0 && sendUDPTo(gActive, gPending[gPendingHead])) {
+    gPendingHead = (uint8_t)((gPendingHead + 1) % NET_RETRY_SLOTS);
+    gPendingLen--;
+    gRetried++;
+    sent++;
+  }
+  return sent;
+}
+
+uint8_t TelemetrySender::pendingCount() const {
+  return gPendingLen;
+}
+
+uint32_t TelemetrySender::sentCount() const {
+  return gSent;
+}
+
+uint32_t TelemetrySender::sendFailCount() const {
+  return gSendFail;
+}
+
+uint32_t TelemetrySender::retriedCount() const {
+  return gRetried;
+}
+
+uint32_t TelemetrySender::droppedCount() const {
+  return gDropped;
+}
+
+size_t TelemetrySender::receiveUDP(char* out, size_t outSz, uint8_t* fromIdx,
+                                   Transport** via) {
+  if (!out || outSz == 0) return 0;
+  out[0] = '\0';
+
+  // Replies come back on whichever link the request left on.
+  Transport* links[2] = { _active, (_active == &_primary) ? &_fallback : &_primary };
+  for (Transport* t : links) {
+    if (!t->linkUp()) continue;
+
+    IPAddress from;
+    const size_t n = t->receive((uint8_t*)out, outSz - 1, from);
+    if (n == 0) continue;
+
+    // Only collectors talk to us; ignore anything else on the socket.
+    uint8_t idx = 0;
+    while (idx < gCollectorCount && gCollectors[idx] != from) idx++;
+    if (idx == gCollectorCount) continue;
+    if (fromIdx) *fromIdx = idx;
+    if (via) *via = t;
+
+    out[n] = '\0';
+    return n;
+  }
+
+  out[0] = '\0';
+  return 0;
+}
+
+uint8_t TelemetrySender::collectorCount() const {
+  return gCollectorCount;
+}
+
+uint8_t TelemetrySender::activeCollector() const {
+  return gActive;
+}
+
+void TelemetrySender::selectCollector(uint8_t idx) {
+  if (idx < gCollectorCount) gActive = idx;
+}
+
+String TelemetrySender::collectorString(uint8_t idx) const {
+  if (idx >= gCollectorCount) return String("");
+  const IPAddress& ip = gCollectors[idx];
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return String(buf);
 }
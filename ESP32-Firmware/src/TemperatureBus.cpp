@@ -1,5 +1,3 @@
-#include <OneWire.h>
-#include <DallasTemperature.h>
 #include "TemperatureBus.h"
 
 // DS18B20 conversion time depends on resolution.
@@ -9,26 +7,12 @@ static const uint32_t CONVERSION_MS = 750;
 // Sample every 5 seconds
 static const uint32_t SAMPLE_PERIOD_MS = 5000;
 
-bool TemperatureBus::begin(int intakePin, int exhaustPin){
-    _intakePin = intakePin;
-    _exhaustPin = exhaustPin;
+bool TemperatureBus::begin(SensorBus& intake, SensorBus& exhaust){
+    _intake = &intake;
+    _exhaust = &exhaust;
 
-    auto* owI = new OneWire(_intakePin);
-    auto* owE = new OneWire(_exhaustPin);
-    _oneWireIntake = owI;
-    _oneWireExhaust = owE;
-
-    auto* dtI = new DallasTemperature(owI);
-    auto* dtE = new DallasTemperature(owE);
-    _dtIntake = dtI;
-    _dtExhaust = dtE;
-
-    dtI->begin();
-    dtE->begin();
-
-    // non-blocking conversions (we wait in tick())
-    dtI->setWaitForConversion(false);
-    dtE->setWaitForConversion(false);
+    _intake->begin();
+    _exhaust->begin();
 
     // how many sensors are on each bus
     if(!scanBuses()) return false;
@@ -51,11 +35,8 @@ bool TemperatureBus::begin(int intakePin, int exhaustPin){
 }
 
 bool TemperatureBus::scanBuses(){
-    auto* dtI = static_cast<DallasTemperature*>(_dtIntake);
-    auto* dtE = static_cast<DallasTemperature*>(_dtExhaust);
-
-    _intakeDeviceCount = dtI->getDeviceCount();
-    _exhaustDeviceCount = dtE->getDeviceCount();
+    _intakeDeviceCount = _intake->deviceCount();
+    _exhaustDeviceCount = _exhaust->deviceCount();
 
     // If one side has 0 on early bring-up that's ok, but "ready()" will remain false
     // until we successfully read something on each bus.
@@ -90,19 +71,31 @@ void TemperatureBus::tick(uint32_t nowMs){
     }
 }
 
-void TemperatureBus::requestConversion(){
-    auto* dtI = static_cast<DallasTemperature*>(_dtIntake);
-    auto* dtE = static_cast<DallasTemperature*>(_dtExhaust);
+uint32_t TemperatureBus::msUntilNextStep(uint32_t nowMs) const{
+    uint32_t waited;
+    switch(_state){
+        case IDLE:
+            if(_lastSampleMs == 0) return 0;
+            waited = nowMs - _lastSampleMs;
+            return (waited >= SAMPLE_PERIOD_MS) ? 0 : SAMPLE_PERIOD_MS - waited;
 
+        case REQUESTED:
+            waited = nowMs - _lastRequestMs;
+            return (waited >= CONVERSION_MS) ? 0 : CONVERSION_MS - waited;
+
+        case READ_READY:
+        default:
+            return 0;
+    }
+}
+
+void TemperatureBus::requestConversion(){
     // Kick both buses at the same time so the sample is coherent.
-    dtI->requestTemperatures();
-    dtE->requestTemperatures();
+    _intake->requestTemperatures();
+    _exhaust->requestTemperatures();
 }
 
 void TemperatureBus::readTemperatures(){
-    auto* dtI = static_cast<DallasTemperature*>(_dtIntake);
-    auto* dtE = static_cast<DallasTemperature*>(_dtExhaust);
-
     // Read up to 3 sensors from each bus by index.
     // NOTE: index ordering is not guaranteed stable across power cycles.
     // If you need stable "top/mid/bottom" identities, bind by ROM address instead.
@@ -111,11 +104,11 @@ void TemperatureBus::readTemperatures(){
         float tE = NAN;
 
         if(_intakeDeviceCount > i){
-            tI = dtI->getTempCByIndex(i);
+            tI = _intake->tempC(i);
             if(tI <= -120.0f) tI = NAN;
         }
         if(_exhaustDeviceCount > i){
-            tE = dtE->getTempCByIndex(i);
+            tE = _exhaust->tempC(i);
             if(tE <= -120.0f) tE = NAN;
         }
 
@@ -0,0 +1,55 @@
+#include "TimeRequests.h"
+
+bool TimeRequests::add(uint64_t t0, uint8_t collector, Transport* via, uint8_t purposes, bool& merged){
+    merged = false;
+    int8_t free = -1;
+
+    for(uint8_t i = 0; i < MAX_PENDING; i++){
+        if(!_used[i]){
+            if(free < 0) free = (int8_t)i;
+            continue;
+        }
+        Request& r = _req[i];
+        if(r.t0 == t0 && r.collector == collector && r.via == via){
+            r.purposes |= purposes;
+            merged = true;
+            return true;
+        }
+    }
+
+    if(free < 0) return false;
+
+    _req[free] = {t0, via, collector, purposes};
+    _used[free] = true;
+    _count++;
+    return true;
+}
+
+bool TimeRequests::take(uint64_t t0, uint8_t collector, Transport* via, Request& out){
+    for(uint8_t i = 0; i < MAX_PENDING; i++){
+        if(!_used[i]) continue;
+        const Request& r = _req[i];
+        if(r.t0 == t0 && r.collector == collector && r.via == via){
+            removeAt(i, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TimeRequests::takeExpired(uint64_t nowMs, uint32_t waitMs, Request& out){
+    for(uint8_t i = 0; i < MAX_PENDING; i++){
+        if(!_used[i]) continue;
+        if(nowMs - _req[i].t0 >= waitMs){
+            removeAt(i, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimeRequests::removeAt(uint8_t i, Request& out){
+    out = _req[i];
+    _used[i] = false;
+    _count--;
+}
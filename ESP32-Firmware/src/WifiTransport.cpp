@@ -0,0 +1,49 @@
+#include "WifiTransport.h"
+#include "config.h"
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+static WiFiUDP gWifiUdp;
+
+bool WifiTransport::begin() {
+  if (!WIFI_SSID[0]) {
+    Serial.println("[NET] Wi-Fi fallback disabled (WIFI_SSID not set).");
+    _enabled = false;
+    return false;
+  }
+
+  // Connect in the background; the link monitor only uses Wi-Fi once it
+  // reports connected, and the driver reconnects by itself.
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+
+  gWifiUdp.begin(0);
+  _enabled = true;
+
+  Serial.printf("[NET] Wi-Fi fallback connecting to '%s'\n", WIFI_SSID);
+  return true;
+}
+
+bool WifiTransport::linkUp() {
+  return _enabled && WiFi.status() == WL_CONNECTED;
+}
+
+bool WifiTransport::send(const IPAddress& dst, uint16_t port, const uint8_t* data, size_t len) {
+  if (!_enabled) return false;
+  if (gWifiUdp.beginPacket(dst, port) != 1) return false;
+  gWifiUdp.write(data, len);
+  return gWifiUdp.endPacket() == 1;
+}
+
+size_t WifiTransport::receive(uint8_t* out, size_t outSz, IPAddress& from) {
+  if (!_enabled) return 0;
+
+  const int size = gWifiUdp.parsePacket();
+  if (size <= 0) return 0;
+
+  from = gWifiUdp.remoteIP();
+  const int n = gWifiUdp.read(out, outSz);
+  return (n > 0) ? (size_t)n : 0;
+}
@@ -2,15 +2,39 @@
 #include "config.h"
 #include "Heartbeat.h"
 #include "TemperatureBus.h"
+#include "DallasSensorBus.h"
 #include "TelemetrySender.h"
+#include "EthernetTransport.h"
+#include "WifiTransport.h"
+#include "LinkMonitor.h"
+#include "LinkSupervisor.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "ClockSync.h"
+#include "TimeRequests.h"
+#include "TimeUtil.h"
+#include "TelemetryJson.h"
+#include "LeaderElection.h"
+
+#if SCHED_LIGHT_SLEEP
+  #include <esp_pm.h>
+#endif
+
+static uint32_t clockMs() { return millis(); }
+static void sleepMs(uint32_t ms);
 
 HardwareSerial HBSerial(HB_UART_NUM);
 Heartbeat hb(HBSerial);
+DallasSensorBus intakeBus(ONE_WIRE_BUS_COOL);
+DallasSensorBus exhaustBus(ONE_WIRE_BUS_EXHAUST);
 TemperatureBus tempBus;
-TelemetrySender net;
-
-static inline bool isControllerA() { return DEVICE_ID == 'A' || DEVICE_ID == 65; }
-static inline bool isControllerB() { return DEVICE_ID == 'B' || DEVICE_ID == 66; }
+EthernetTransport eth;
+WifiTransport wifi;
+TelemetrySender net(eth, wifi);
+LinkMonitor linkMon(NET_FAIL_PROBES, NET_SWITCHBACK_STABLE_MS);
+Scheduler sched(clockMs, sleepMs);
+ClockSync clockSync;
+TimeRequests timeRequests;
 
 static void printTemps() {
   Serial.printf(
@@ -23,267 +47,499 @@ static void printTemps() {
 static void maybePrintTemps() {
   if (tempBus.hasNewSample()) {
     tempBus.clearNewSampleFlag();
+    PROFILE_SCOPE(LOG);
     printTemps();
   }
 }
 
-static void appendTempArray(char* out, size_t outSz, const float vals[TemperatureBus::SENSORS_PER_BUS]) {
-  // Writes something like: [21.23, 22.00, null]
-  // NAN -> null
-  size_t used = strnlen(out, outSz);
-  if (used >= outSz) return;
+// ------------------
+// Heartbeat-derived role state
+// ------------------
+// Refreshed by hbRxTask, read by the other tasks.
+static const char myId = (char)DEVICE_ID;
+static LeaderElection election(myId, ELECTION_PRIMARY_ID, HB_TIMEOUT_MS, BOOT_GRACE_MS);
+static bool iAmActiveSender = false;
+static bool failoverOccurred = false;
+static char failoverDetails[96] = {0};
+
+static uint8_t tHbRx = Scheduler::INVALID_TASK;
+static uint8_t tTelemetry = Scheduler::INVALID_TASK;
+static uint8_t tTemp = Scheduler::INVALID_TASK;
+static uint8_t tClockSync = Scheduler::INVALID_TASK;
+static uint8_t tLink = Scheduler::INVALID_TASK;
+static uint8_t tNetRx = Scheduler::INVALID_TASK;
+
+// Probe misses only mean "unreachable" once some collector has answered a
+// probe; a Radxa without the time service never does.
+static bool collectorAnswered = false;
+// network_failover copies still to send after the last link switch.
+static uint8_t netEventRepeat = 0;
+
+#ifdef ESP32
+static TaskHandle_t gLoopTask = nullptr;
+
+// Sleep until the next deadline, or until a task notification (heartbeat RX).
+static void sleepMs(uint32_t ms) {
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+}
 
-  auto append = [&](const char* s) {
-    size_t u = strnlen(out, outSz);
-    if (u < outSz) strncat(out, s, outSz - u - 1);
-  };
+// Runs in the UART event task, not in loop(): only flag and notify.
+static void onHeartbeatRx() {
+  sched.wake(tHbRx);
+  if (gLoopTask) xTaskNotifyGive(gLoopTask);
+}
+#else
+static void sleepMs(uint32_t ms) { delay(ms); }
+#endif
 
-  append("[");
-  for (uint8_t i = 0; i < TemperatureBus::SENSORS_PER_BUS; i++) {
-    if (i) append(", ");
-    if (isnan(vals[i])) {
-      append("null");
+// Self is always alive; anyone else is judged from the heartbeat table.
+static bool controllerAlive(char id, uint32_t now) {
+  return (id == myId) || hb.peerAlive(id, now, HB_TIMEOUT_MS);
+}
+
+static uint32_t peerAgeMs(char id, uint32_t now) {
+  const Heartbeat::Peer* p = hb.findPeer(id);
+  return (p && p->lastRxMs) ? Heartbeat::ageMs(*p, now) : 0;
+}
+
+// Logs every peer that goes silent or comes back.
+static void logPeerTransitions(uint32_t now) {
+  static uint8_t lastAliveMask = 0;
+  static uint8_t everAliveMask = 0;
+
+  for (uint8_t i = 0; i < hb.peerCount(); i++) {
+    const Heartbeat::Peer& p = hb.peers()[i];
+    const uint8_t bit = (uint8_t)(1u << i);
+    const bool alive = Heartbeat::alive(p, now, HB_TIMEOUT_MS);
+    const bool wasAlive = (lastAliveMask & bit) != 0;
+
+    if (wasAlive && !alive) {
+      Serial.printf("[ALERT:%c] Lost heartbeat from %c (timeout=%d ms). age_ms=%lu\n",
+                    myId, p.id, (int)HB_TIMEOUT_MS, (unsigned long)Heartbeat::ageMs(p, now));
+    }
+    if (!wasAlive && alive && (everAliveMask & bit)) {
+      Serial.printf("[RECOVER:%c] Heartbeat from %c restored.\n", myId, p.id);
+    }
+
+    if (alive) {
+      lastAliveMask |= bit;
+      everAliveMask |= bit;
     } else {
-      char b[16];
-      snprintf(b, sizeof(b), "%.2f", (double)vals[i]);
-      append(b);
+      lastAliveMask &= (uint8_t)~bit;
     }
   }
-  append("]");
 }
 
-static void buildTelemetryJson(char* out, size_t outSz,
-                               const char* macStr,
-                               uint32_t nowMs,
-                               bool aAlive,
-                               bool bAlive,
-                               const float cool[TemperatureBus::SENSORS_PER_BUS],
-                               const float exhaust[TemperatureBus::SENSORS_PER_BUS],
-                               bool failoverOccurred,
-                               const char* failoverDetails) {
-  // NOTE: Kept close to the JSON structure shown in the image.
-  // We avoid ArduinoJson to keep dependencies minimal.
-  if (!out || outSz == 0) return;
-  out[0] = '\0';
-
-  // Pre-build temperature arrays
-  char coolArr[96] = {0};
-  char exhArr[96] = {0};
-  appendTempArray(coolArr, sizeof(coolArr), cool);
-  appendTempArray(exhArr, sizeof(exhArr), exhaust);
-
-  // Escape details minimally (replace \" with ').
-  char detailsSafe[128];
-  size_t di = 0;
-  if (!failoverDetails) failoverDetails = "";
-  for (size_t i = 0; failoverDetails[i] && di + 1 < sizeof(detailsSafe); i++) {
-    char c = failoverDetails[i];
-    if (c == '"') c = '\'';
-    if ((uint8_t)c < 0x20) c = ' '; // strip control chars
-    detailsSafe[di++] = c;
+static void updateRole(uint32_t now) {
+  logPeerTransitions(now);
+
+  if (!election.update(hb.peers(), hb.peerCount(), now)) return;
+
+  const char prev = election.previousLeader();
+  const char leader = election.leader();
+  Serial.printf("[ELECT:%c] leader %c -> %c (term %u)\n",
+                myId, prev, leader, (unsigned)election.term());
+
+  // Failover event tracking (purely logical in this "no-relay" version):
+  // a non-primary controller taking over from a leader that went silent.
+  if (leader == myId && myId != ELECTION_PRIMARY_ID &&
+      prev != LeaderElection::NO_LEADER && !failoverOccurred) {
+    failoverOccurred = true;
+    snprintf(failoverDetails, sizeof(failoverDetails),
+             "%c took over from %c after %lu ms heartbeat silence (term %u)",
+             myId, prev, (unsigned long)peerAgeMs(prev, now), (unsigned)election.term());
   }
-  detailsSafe[di] = '\0';
-
-  snprintf(
-    out, outSz,
-    "{\n"
-    "  \"message_type\": \"telemetry\",\n\n"
-    "  \"device\": {\n"
-    "    \"mac\": \"%s\"\n"
-    "  },\n\n"
-    "  \"timestamp_device_ms\": %lu,\n\n"
-    "  \"items\": [\n"
-    "    {\n"
-    "      \"kind\": \"heartbeat\",\n"
-    "      \"controller_a_alive\": %s,\n"
-    "      \"controller_b_alive\": %s\n"
-    "    },\n"
-    "    {\n"
-    "      \"kind\": \"sensors\",\n"
-    "      \"buses\": [\n"
-    "        {\n"
-    "          \"bus\": \"cool\",\n"
-    "          \"temperatures_c\": %s\n"
-    "        },\n"
-    "        {\n"
-    "          \"bus\": \"exhaust\",\n"
-    "          \"temperatures_c\": %s\n"
-    "        }\n"
-    "      ]\n"
-    "    },\n"
-    "    {\n"
-    "      \"kind\": \"event\",\n"
-    "      \"type\": \"failover\",\n"
-    "      \"occurred\": %s,\n"
-    "      \"details\": \"%s\"\n"
-    "    }\n"
-    "  ]\n"
-    "}\n",
-    macStr,
-    (unsigned long)nowMs,
-    aAlive ? "true" : "false",
-    bAlive ? "true" : "false",
-    coolArr,
-    exhArr,
-    failoverOccurred ? "true" : "false",
-    detailsSafe
-  );
-}
 
-void setup() {
-  Serial.begin(115200);
-  delay(200);
+  if (prev == myId && leader != myId) {
+    Serial.printf("[INFO:%c] Releasing the bus communication to device %c\n", myId, leader);
+  }
 
-  Serial.println();
-  Serial.printf("Booting Controller %c\n", (char)DEVICE_ID);
+  const bool wasActive = iAmActiveSender;
+  iAmActiveSender = election.isLeader();
 
-  // Start heartbeat UART link
-  hb.begin(HB_UART_RX_PIN, HB_UART_TX_PIN, HB_UART_BAUD);
+  // Don't wait out the telemetry period after taking over.
+  if (iAmActiveSender && !wasActive) sched.wake(tTelemetry);
+}
 
-  // Start temperature buses (intake + exhaust)
-  tempBus.begin(ONE_WIRE_BUS_COOL, ONE_WIRE_BUS_EXHAUST);
+// ------------------
+// Scheduler tasks
+// ------------------
 
-  // Start Ethernet telemetry
-  net.begin();
+// Parse heartbeat RX and re-evaluate the role. Woken early by the UART
+// callback; the period only bounds how late a timeout is noticed.
+static void hbRxTask(uint32_t /*now*/) {
+  {
+    PROFILE_SCOPE(HB_RX);
+    hb.tick();
+  }
+  // Frames parsed above are stamped after the scheduler read the clock.
+  updateRole(clockMs());
+}
 
-  Serial.println("Heartbeat + TemperatureBus started\n");
+static void hbTxTask(uint32_t now) {
+  PROFILE_SCOPE(HB_TX);
+  hb.send(myId, now, election.term(), election.leader());
+}
 
-  // Optional sanity check (keep if you want)
-  Serial.printf("[TEMP:init] intakeN=%u exhaustN=%u\n",
-                tempBus.intakeDeviceCount(),
-                tempBus.exhaustDeviceCount());
+// One-shot that re-arms itself for exactly the next TemperatureBus step.
+static void tempTask(uint32_t now) {
+  {
+    PROFILE_SCOPE(TEMP);
+    tempBus.tick(now);
+  }
+
+  // Only the leader prints temps (for A/B: A normally, B while A is down).
+  if (election.isLeader()) {
+    maybePrintTemps();
+  }
+
+  sched.schedule(tTemp, tempBus.msUntilNextStep(clockMs()));
 }
 
-void loop() {
-  const uint32_t now = millis();
+static void telemetryTask(uint32_t now) {
+  // Only the active controller sends
+  if (!iAmActiveSender) return;
 
-  // 1) Always parse RX
-  hb.tick();
+  // A/B alive flags kept for the two-controller dashboards
+  const bool controllerAAlive = controllerAlive('A', now);
+  const bool controllerBAlive = controllerAlive('B', now);
 
-  // 2) Send heartbeat periodically
-  static uint32_t lastSend = 0;
-  if ((uint32_t)(now - lastSend) >= (uint32_t)HB_SEND_MS) {
-    lastSend = now;
-    hb.send((char)DEVICE_ID, now);
+  float cool[TemperatureBus::SENSORS_PER_BUS];
+  float exhaust[TemperatureBus::SENSORS_PER_BUS];
+  for (uint8_t i = 0; i < TemperatureBus::SENSORS_PER_BUS; i++) {
+    cool[i] = tempBus.intakeC(i);
+    exhaust[i] = tempBus.exhaustC(i);
   }
 
-  // 3) Temperature sampling (tick exactly once per loop)
-  tempBus.tick(now);
-
-  // 4) Heartbeat status
-  const bool peerAlive = hb.peerAlive(now, HB_TIMEOUT_MS);
-  const uint32_t ageMs = (hb.lastRxMS() == 0) ? 0 : (now - hb.lastRxMS());
-
-  // Determine A/B alive flags (self is always alive)
-  const char myId = (char)DEVICE_ID;
-  const bool controllerAAlive = (myId == 'A') ? true : peerAlive;
-  const bool controllerBAlive = (myId == 'B') ? true : peerAlive;
-
-  // Failover event tracking (purely logical in this "no-relay" version)
-  static bool failoverOccurred = false;
-  static char failoverDetails[96] = {0};
-  if ((myId == 'B') && !failoverOccurred) {
-    const bool healthy = (hb.peerId() == 'A') && peerAlive;
-    if (!healthy && hb.peerId() == 'A') {
-      failoverOccurred = true;
-      snprintf(failoverDetails, sizeof(failoverDetails),
-               "B took over after %lu ms heartbeat silence", (unsigned long)ageMs);
-    }
+  // Per-sender sequence number. Around a failover both controllers can be
+  // sending for the same rack; the ingest StreamStitcher drops resends by
+  // (mac, seq, time) and keeps the designated sender where the two overlap.
+  static uint32_t telemetrySeq = 0;
+
+  // Counters go out with every message; they are cumulative, so the Radxa
+  // can take rates from any two of them.
+  static char extra[1024];
+  TelemetryCounters counters;
+  counters.hbFramesOk = hb.framesOk();
+  counters.hbCrcErrors = hb.crcErrors();
+  counters.udpSent = net.sentCount();
+  counters.udpSendFailures = net.sendFailCount();
+  size_t used = formatCountersItem(extra, sizeof(extra), counters);
+  used += formatMembershipItem(extra + used, sizeof(extra) - used, myId,
+                               election.leader(), election.term(),
+                               hb.peers(), hb.peerCount(), now, HB_TIMEOUT_MS);
+
+  const uint64_t local = millis64();
+
+  static char json[1536];
+  {
+    PROFILE_SCOPE(JSON);
+    buildTelemetryJson(json, sizeof(json),
+                       TelemetrySender::deviceMacCStr(), myId, telemetrySeq++,
+                       local, clockSync.epochMs(local), clockSync.uncertaintyMs(local),
+                       controllerAAlive, controllerBAlive,
+                       cool, exhaust,
+                       failoverOccurred,
+                       failoverDetails,
+                       extra);
+  }
+
+  bool ok;
+  {
+    PROFILE_SCOPE(UDP);
+    ok = net.sendUDP(json);
+  }
+  if (!ok) {
+    Serial.printf("[NET] Telemetry send failed over %s, %u queued for retry\n",
+                  net.interfaceName(), (unsigned)net.pendingCount());
+    // Check the links now rather than at the next probe.
+    sched.wake(tLink);
+  }
+
+  // After a link switch, report it (a few times: any one datagram may be lost).
+  if (netEventRepeat > 0) {
+    netEventRepeat--;
+    formatNetworkEventItem(extra, sizeof(extra), linkMon,
+                           net.retriedCount(), net.droppedCount());
+    buildItemsJson(json, sizeof(json),
+                   TelemetrySender::deviceMacCStr(), myId, telemetrySeq++,
+                   local, clockSync.epochMs(local), clockSync.uncertaintyMs(local),
+                   extra);
+    net.sendUDP(json);
+  }
+
+  // Once per PROFILE_REPORT_MS the per-stage profile goes out in a message of
+  // its own (it would not fit in one Ethernet frame next to the rest), then a
+  // new window starts.
+#if PROFILE_ENABLED
+  static uint32_t lastProfile = 0;
+  if ((uint32_t)(now - lastProfile) >= (uint32_t)PROFILE_REPORT_MS) {
+    used = (size_t)snprintf(extra, sizeof(extra), ",\n    ");
+    Profiler::formatItem(extra + used, sizeof(extra) - used, now - lastProfile);
+    Profiler::reset();
+    lastProfile = now;
+
+    buildItemsJson(json, sizeof(json),
+                   TelemetrySender::deviceMacCStr(), myId, telemetrySeq++,
+                   local, clockSync.epochMs(local), clockSync.uncertaintyMs(local),
+                   extra);
+    net.sendUDP(json);
   }
+#endif
+}
 
-  // 5) Telemetry send (only active controller sends)
-  static uint32_t lastTelemetry = 0;
+// Time requests are fire-and-forget: postTimeRequest() sends one and records
+// it, netRxTask picks up the reply (or notices it never came) on a later run
+// and hands the result to onTimeResult(). Clock sync, collector probes and
+// link probes all go through here, and none of them waits on the network.
+static void onTimeResult(const TimeRequests::Request& req, bool answered,
+                         uint64_t t1, uint64_t t2, uint64_t t3);
+
+// Sends a time_request to a collector over via (default: the active
+// transport). Returns false if it could not even be recorded; otherwise
+// exactly one onTimeResult() follows, answered or not.
+static bool postTimeRequest(uint8_t collector, uint8_t purposes, Transport* via = nullptr) {
+  static char buf[160];
+  Transport* t = via ? via : &net.active();
+  const uint64_t t0 = millis64();
+
+  bool merged = false;
+  if (!timeRequests.add(t0, collector, t, purposes, merged)) return false;
+  if (merged) return true;
+
+  // A failed send is left to expire, so it reports like any other miss.
+  ClockSync::formatRequest(buf, sizeof(buf), TelemetrySender::deviceMacCStr(), t0);
+  net.sendUDPTo(collector, buf, t);
+
+  sched.schedule(tNetRx, NET_RX_POLL_MS);
+  return true;
+}
 
-  // Determine whether B should take over sending:
-  // - "healthy" means A is the peer and is alive
-  static bool everSawA = false;
-  if (hb.peerId() == 'A') everSawA = true;
+// Polls the UDP socket every NET_RX_POLL_MS while time requests are
+// outstanding. A reply is matched by collector, transport and echoed t0, so a
+// late answer to an expired request is simply dropped. Polling (rather than
+// sleeping on the socket) bounds how late t3 is stamped; any lateness only
+// inflates the sample's RTT, which the min-RTT filter and the uncertainty
+// bound already account for.
+static void netRxTask(uint32_t /*now*/) {
+  static char buf[192];
+
+  for (uint8_t n = 0; n < TimeRequests::MAX_PENDING; n++) {
+    uint8_t from = 0;
+    Transport* via = nullptr;
+    if (net.receiveUDP(buf, sizeof(buf), &from, &via) == 0) break;
+    const uint64_t t3 = millis64();
+
+    uint64_t echo, t1, t2;
+    TimeRequests::Request req;
+    if (!ClockSync::parseResponse(buf, echo, t1, t2)) continue;
+    if (!timeRequests.take(echo, from, via, req)) continue;
+    onTimeResult(req, true, t1, t2, t3);
+  }
 
-  const bool healthyA = (hb.peerId() == 'A') && peerAlive;
+  TimeRequests::Request req;
+  while (timeRequests.takeExpired(millis64(), CLOCK_SYNC_WAIT_MS, req)) {
+    onTimeResult(req, false, 0, 0, 0);
+  }
 
-  // Optional boot grace: if A never appears, let B start sending after a few seconds
-  const uint32_t BOOT_GRACE_MS = 5000;
-  const bool allowBootTakeover = (now > BOOT_GRACE_MS) && !everSawA;
+  if (timeRequests.pending()) sched.schedule(tNetRx, NET_RX_POLL_MS);
+}
 
-  bool iAmActiveSender = false;
-  if (isControllerA()) {
-    iAmActiveSender = true;                  // A always sends
-  } else if (isControllerB()) {
-    // B sends only if A is unhealthy (after timeout) OR A never appeared after grace
-    iAmActiveSender = (!healthyA && everSawA) || allowBootTakeover;
+// One request per run; a burst is CLOCK_SYNC_SAMPLES runs spaced
+// CLOCK_SYNC_SAMPLE_GAP_MS apart. One more run after the last gap (by then
+// the last reply is in or has expired) closes the burst, then the task
+// sleeps until the next one.
+static void clockSyncTask(uint32_t /*now*/) {
+  static uint8_t sent = 0;
+  if (sent == 0) clockSync.beginBurst();
+
+  if (sent < CLOCK_SYNC_SAMPLES) {
+    postTimeRequest(net.activeCollector(), TimeRequests::SYNC);
+    sent++;
+    sched.schedule(tClockSync, CLOCK_SYNC_SAMPLE_GAP_MS);
+    return;
   }
 
-  if (iAmActiveSender && (uint32_t)(now - lastTelemetry) >= (uint32_t)TELEMETRY_SEND_MS) {
-    lastTelemetry = now;
+  sent = 0;
+  if (clockSync.endBurst()) {
+    const uint64_t local = millis64();
+    Serial.printf("[TIME] synced rtt=%lu ms uncertainty=%lu ms drift=%ld ppm\n",
+                  (unsigned long)clockSync.lastRttMs(),
+                  (unsigned long)clockSync.uncertaintyMs(local),
+                  (long)clockSync.driftPpm());
+  } else {
+    Serial.println("[TIME] No usable time replies from Radxa");
+  }
+  sched.schedule(tClockSync, CLOCK_SYNC_INTERVAL_MS);
+}
 
-    float cool[TemperatureBus::SENSORS_PER_BUS];
-    float exhaust[TemperatureBus::SENSORS_PER_BUS];
-    for (uint8_t i = 0; i < TemperatureBus::SENSORS_PER_BUS; i++) {
-      cool[i] = tempBus.intakeC(i);
-      exhaust[i] = tempBus.exhaustC(i);
+// Multi-collector failover. The active collector is probed every
+// COLLECTOR_PROBE_MS and abandoned for the next one in the list after
+// COLLECTOR_FAILOVER_PROBES misses. While on a backup, the preferred
+// collector is probed as well and taken back after COLLECTOR_RECOVER_PROBES
+// answers in a row, so a flapping node doesn't bounce traffic around.
+// Misses are not counted until some collector has answered at least once:
+// a Radxa without the time service never answers, and rotating through the
+// list would then never stop.
+static uint8_t collectorMisses = 0;
+static uint8_t preferredOk = 0;
+
+static void onCollectorProbe(uint8_t collector, bool answered) {
+  const uint8_t active = net.activeCollector();
+
+  if (collector == active) {
+    if (answered) {
+      collectorMisses = 0;
+    } else if (collectorAnswered && ++collectorMisses >= COLLECTOR_FAILOVER_PROBES) {
+      collectorMisses = 0;
+      preferredOk = 0;
+      const uint8_t next = (uint8_t)((active + 1) % net.collectorCount());
+      net.selectCollector(next);
+      Serial.printf("[NET] Collector %s not answering, switching to %s\n",
+                    net.collectorString(active).c_str(),
+                    net.collectorString(next).c_str());
     }
+    return;
+  }
 
-    static char json[768];
-    const String macStr = TelemetrySender::deviceMacString();
-    buildTelemetryJson(json, sizeof(json),
-                       macStr.c_str(), now,
-                       controllerAAlive, controllerBAlive,
-                       cool, exhaust,
-                       failoverOccurred,
-                       failoverDetails);
+  // Results for a collector we have since moved off are stale.
+  if (collector != 0) return;
+
+  if (!answered) {
+    preferredOk = 0;
+  } else if (++preferredOk >= COLLECTOR_RECOVER_PROBES) {
+    preferredOk = 0;
+    collectorMisses = 0;
+    net.selectCollector(0);
+    Serial.printf("[NET] Preferred collector %s is back, switching to it\n",
+                  net.collectorString(0).c_str());
+  }
+}
 
-    const bool ok = net.sendUDP(json);
-    if (!ok) {
-      Serial.println("[NET] Telemetry send failed (link down or UDP error)");
-    }
+static void collectorProbeTask(uint32_t /*now*/) {
+  const uint8_t active = net.activeCollector();
+  if (!postTimeRequest(active, TimeRequests::COLLECTOR_PROBE)) onCollectorProbe(active, false);
+  if (active != 0 && !postTimeRequest(0, TimeRequests::COLLECTOR_PROBE)) onCollectorProbe(0, false);
+}
+
+// Ethernet/Wi-Fi failover. A probe round runs every NET_PROBE_MS (and right
+// after a failed telemetry send); the LinkSupervisor posts its probes through
+// postTimeRequest() and lets the LinkMonitor decide once they are in.
+static bool postLinkProbe(Transport& via) {
+  return postTimeRequest(net.activeCollector(), TimeRequests::LINK_PROBE, &via);
+}
+
+static void onLinkSwitch(const LinkMonitor::Event& e, uint8_t resent) {
+  Serial.printf("[NET] Switched %s -> %s (%s, detected in %lu ms)\n",
+                LinkMonitor::linkName(e.from), LinkMonitor::linkName(e.to),
+                e.reason, (unsigned long)e.detectMs);
+  if (resent) Serial.printf("[NET] Re-sent %u queued payloads\n", (unsigned)resent);
+
+  netEventRepeat = NET_EVENT_REPEAT;
+  sched.wake(tTelemetry);
+}
+
+static LinkSupervisor linkSup(linkMon, net, eth, wifi, postLinkProbe, onLinkSwitch);
+
+static void linkTask(uint32_t /*now*/) {
+  linkSup.startRound(collectorAnswered, millis64());
+}
+
+static void onTimeResult(const TimeRequests::Request& req, bool answered,
+                         uint64_t t1, uint64_t t2, uint64_t t3) {
+  if (answered) {
+    collectorAnswered = true;
+    if (req.purposes & TimeRequests::SYNC) clockSync.addSample(req.t0, t1, t2, t3);
   }
+  if (req.purposes & TimeRequests::COLLECTOR_PROBE) onCollectorProbe(req.collector, answered);
+  if (req.purposes & TimeRequests::LINK_PROBE) linkSup.onProbe(req.via, answered, millis64());
+}
 
-  // Controller A: prints HB status periodically + always prints temps when sampled
-  if (isControllerA()) {
-    static uint32_t lastStatus = 0;
-    if ((uint32_t)(now - lastStatus) >= 1000) {
-      lastStatus = now;
-      Serial.printf("[HB:A] peer=%c, alive=%d, age_ms=%lu\n",
-                    hb.peerId(),
-                    peerAlive ? 1 : 0,
-                    (unsigned long)ageMs);
-    }
+// Primary: prints HB status for every peer periodically
+static void statusTask(uint32_t now) {
+  PROFILE_SCOPE(LOG);
+  for (uint8_t i = 0; i < hb.peerCount(); i++) {
+    const Heartbeat::Peer& p = hb.peers()[i];
+    Serial.printf("[HB:%c] peer=%c, alive=%d, age_ms=%lu, leader=%c, term=%u\n",
+                  myId, p.id,
+                  Heartbeat::alive(p, now, HB_TIMEOUT_MS) ? 1 : 0,
+                  (unsigned long)Heartbeat::ageMs(p, now),
+                  election.leader(), (unsigned)election.term());
+  }
+}
 
-    maybePrintTemps();
+static void schedStatsTask(uint32_t /*now*/) {
+  Serial.printf("[SCHED] idle=%u%%", (unsigned)sched.idlePercent());
+  for (uint8_t i = 0; i < sched.taskCount(); i++) {
+    const Scheduler::TaskStats st = sched.stats(i);
+    if (st.runs == 0) continue;
+    Serial.printf(" %s:late_avg=%lu,max=%lu", st.name,
+                  (unsigned long)(st.lateSumMs / st.runs),
+                  (unsigned long)st.lateMaxMs);
   }
+  Serial.println();
+  sched.resetStats();
+}
 
-  // Controller B: prints temps only when A is unhealthy; logs transitions
-  if (isControllerB()) {
-    static bool lastHealthy = false;
-    static bool everHealthy = false;
+void setup() {
+  Serial.begin(115200);
+  delay(200);
 
-    // Your original policy: B considers "healthy" only if the peer is A and alive.
-    const bool healthy = (hb.peerId() == 'A') && peerAlive;
+  Serial.println();
+  Serial.printf("Booting Controller %c\n", (char)DEVICE_ID);
 
-    if (lastHealthy && !healthy) {
-      Serial.printf("[ALERT:B] Lost heartbeat from A (timeout=%d ms). peer=%c age_ms=%lu\n",
-                    (int)HB_TIMEOUT_MS, hb.peerId(), (unsigned long)ageMs);
-      Serial.printf("[INFO:B] Trying to recover the bus communication...\n");
-    }
+  // Start heartbeat UART link
+  hb.begin(HB_UART_RX_PIN, HB_UART_TX_PIN, HB_UART_BAUD);
 
-    if (!lastHealthy && healthy) {
-      if (everHealthy) {
-        Serial.printf("[RECOVER:B] Heartbeat from A restored. age_ms=%lu\n",
-                      (unsigned long)ageMs);
-        Serial.printf("[INFO:B] Releasing the bus communication to device %c\n", hb.peerId());
-      }
-      everHealthy = true;
-    }
+  // Start temperature buses (intake + exhaust)
+  tempBus.begin(intakeBus, exhaustBus);
 
-    lastHealthy = healthy;
+  // Start telemetry links (Ethernet, plus Wi-Fi fallback if configured)
+  net.begin();
 
-    // Print temps continuously while unhealthy (more useful than edge-only)
-    if (!healthy) {
-      maybePrintTemps();
-    } else {
-      // Stay quiet when healthy.
-    }
+  Serial.println("Heartbeat + TemperatureBus started\n");
+
+  // Optional sanity check (keep if you want)
+  Serial.printf("[TEMP:init] intakeN=%u exhaustN=%u\n",
+                tempBus.intakeDeviceCount(),
+                tempBus.exhaustDeviceCount());
+
+  tHbRx = sched.every("hb_rx", HB_POLL_MS, hbRxTask);
+  // Stagger heartbeat slots by ID so frames on the shared bus don't collide.
+  const uint32_t hbSlotMs = (uint32_t)(myId - 'A') * (HB_SEND_MS / (Heartbeat::MAX_PEERS + 1));
+  sched.every("hb_tx", HB_SEND_MS, hbTxTask, hbSlotMs % HB_SEND_MS);
+  tTemp = sched.once("temp", 0, tempTask);
+  tTelemetry = sched.every("telemetry", TELEMETRY_SEND_MS, telemetryTask);
+  tNetRx = sched.once("net_rx", NET_RX_POLL_MS, netRxTask);
+  tClockSync = sched.once("clock_sync", 0, clockSyncTask);
+  if (net.collectorCount() > 1) {
+    sched.every("collector_probe", COLLECTOR_PROBE_MS, collectorProbeTask, COLLECTOR_PROBE_MS);
+  }
+  if (WIFI_SSID[0]) {
+    tLink = sched.every("link", NET_PROBE_MS, linkTask, NET_PROBE_MS);
   }
+  if (myId == ELECTION_PRIMARY_ID) sched.every("status", 1000, statusTask);
+  sched.every("sched_stats", SCHED_STATS_MS, schedStatsTask, SCHED_STATS_MS);
+
+#ifdef ESP32
+  gLoopTask = xTaskGetCurrentTaskHandle();
+  HBSerial.onReceive(onHeartbeatRx);
+#endif
+
+#if SCHED_LIGHT_SLEEP
+  // Let the idle task enter automatic light sleep between deadlines.
+  // Requires an IDF build with CONFIG_PM_ENABLE and tickless idle.
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = 240;
+  pm.min_freq_mhz = 80;
+  pm.light_sleep_enable = true;
+  if (esp_pm_configure(&pm) != ESP_OK) {
+    Serial.println("[SCHED] Light sleep not available in this build");
+  }
+#endif
+}
 
-  delay(1);
+void loop() {
+  sched.runDue();
+  sched.idle(SCHED_MAX_SLEEP_MS);
 }
@@ -0,0 +1,251 @@
+#include <unity.h>
+#include "ClockSync.h"
+#include "TimeRequests.h"
+#include "FakeTimeServer.h"
+#include "config.h"
+
+static const char* MAC = "24:6F:28:AA:BB:CC";
+
+// Distinct addresses are all TimeRequests needs to tell links apart.
+static Transport* const ETH = reinterpret_cast<Transport*>(0x1000);
+static Transport* const WIFI = reinterpret_cast<Transport*>(0x2000);
+
+static ClockSync sync;
+static TimeRequests requests;
+
+void setUp(void) {
+  sync = ClockSync();
+  requests = TimeRequests();
+}
+
+void tearDown(void) {}
+
+// One exchange the way the firmware does it: the request is recorded and
+// sent, the reply sits in the socket until the next NET_RX_POLL_MS poll, and
+// only then is it matched by echoed t0 and stamped with t3.
+static void exchange(FakeTimeServer& server) {
+  char req[160];
+  char resp[160];
+  const uint64_t t0 = server.localMs();
+  bool merged = false;
+  TEST_ASSERT_TRUE(requests.add(t0, 0, ETH, TimeRequests::SYNC, merged));
+  ClockSync::formatRequest(req, sizeof(req), MAC, t0);
+
+  if (!server.exchange(req, resp, sizeof(resp))) {
+    server.advanceMs(CLOCK_SYNC_WAIT_MS);
+    TimeRequests::Request expired;
+    TEST_ASSERT_TRUE(requests.takeExpired(server.localMs(), CLOCK_SYNC_WAIT_MS, expired));
+    return;
+  }
+  // Poll phase: the reply is seen somewhere within the next poll interval.
+  server.nowUs += (server.nowUs * 7919) % (NET_RX_POLL_MS * 1000);
+
+  // Too late: the request has already expired and the reply is ignored.
+  if (server.localMs() - t0 >= CLOCK_SYNC_WAIT_MS) {
+    TimeRequests::Request expired;
+    TEST_ASSERT_TRUE(requests.takeExpired(server.localMs(), CLOCK_SYNC_WAIT_MS, expired));
+    return;
+  }
+
+  uint64_t echo, t1, t2;
+  TEST_ASSERT_TRUE(ClockSync::parseResponse(resp, echo, t1, t2));
+  TimeRequests::Request r;
+  TEST_ASSERT_TRUE(requests.take(echo, 0, ETH, r));
+  sync.addSample(r.t0, t1, t2, server.localMs());
+}
+
+static bool burst(FakeTimeServer& server) {
+  sync.beginBurst();
+  for (uint8_t i = 0; i < CLOCK_SYNC_SAMPLES; i++) {
+    exchange(server);
+    server.advanceMs(CLOCK_SYNC_SAMPLE_GAP_MS);
+  }
+  return sync.endBurst();
+}
+
+// |epochMs() - true epoch| against the claimed bound. The reference itself is
+// truncated to whole ms, hence the extra 1.
+static void assertWithinBound(const FakeTimeServer& server) {
+  const uint64_t local = server.localMs();
+  const int64_t err = (int64_t)sync.epochMs(local) - (int64_t)server.trueEpochMs();
+  const int64_t bound = (int64_t)sync.uncertaintyMs(local) + 1;
+  char msg[96];
+  snprintf(msg, sizeof(msg), "err=%lld ms bound=%lld ms", (long long)err, (long long)bound);
+  TEST_ASSERT_TRUE_MESSAGE(err <= bound && -err <= bound, msg);
+}
+
+static void test_server_echoes_t0(void) {
+  FakeTimeServer server;
+  char req[160];
+  char resp[160];
+  ClockSync::formatRequest(req, sizeof(req), MAC, 123456);
+  TEST_ASSERT_TRUE(server.exchange(req, resp, sizeof(resp)));
+
+  uint64_t t0, t1, t2;
+  TEST_ASSERT_TRUE(ClockSync::parseResponse(resp, t0, t1, t2));
+  TEST_ASSERT_EQUAL_UINT64(123456, t0);
+  TEST_ASSERT_TRUE(t2 >= t1);
+  TEST_ASSERT_TRUE(t1 >= server.epochAtZeroMs);
+}
+
+static void test_requests_match_on_t0_collector_and_link(void) {
+  bool merged = false;
+  TEST_ASSERT_TRUE(requests.add(100, 0, ETH, TimeRequests::SYNC, merged));
+  TEST_ASSERT_TRUE(requests.add(100, 0, WIFI, TimeRequests::LINK_PROBE, merged));
+  TEST_ASSERT_TRUE(requests.add(100, 1, ETH, TimeRequests::COLLECTOR_PROBE, merged));
+  TEST_ASSERT_FALSE(merged);
+  TEST_ASSERT_EQUAL_UINT8(3, requests.pending());
+
+  TimeRequests::Request r;
+  TEST_ASSERT_FALSE(requests.take(99, 0, ETH, r));
+  TEST_ASSERT_TRUE(requests.take(100, 0, WIFI, r));
+  TEST_ASSERT_EQUAL_UINT8(TimeRequests::LINK_PROBE, r.purposes);
+  TEST_ASSERT_TRUE(r.via == WIFI);
+  TEST_ASSERT_FALSE(requests.take(100, 0, WIFI, r));
+  TEST_ASSERT_EQUAL_UINT8(2, requests.pending());
+}
+
+static void test_same_request_is_merged(void) {
+  bool merged = false;
+  TEST_ASSERT_TRUE(requests.add(100, 0, ETH, TimeRequests::SYNC, merged));
+  TEST_ASSERT_FALSE(merged);
+  TEST_ASSERT_TRUE(requests.add(100, 0, ETH, TimeRequests::COLLECTOR_PROBE, merged));
+  TEST_ASSERT_TRUE(merged);
+  TEST_ASSERT_EQUAL_UINT8(1, requests.pending());
+
+  TimeRequests::Request r;
+  TEST_ASSERT_TRUE(requests.take(100, 0, ETH, r));
+  TEST_ASSERT_EQUAL_UINT8(TimeRequests::SYNC | TimeRequests::COLLECTOR_PROBE, r.purposes);
+}
+
+static void test_unanswered_requests_expire_once(void) {
+  bool merged = false;
+  requests.add(100, 0, ETH, TimeRequests::SYNC, merged);
+  requests.add(110, 0, ETH, TimeRequests::SYNC, merged);
+
+  TimeRequests::Request r;
+  TEST_ASSERT_FALSE(requests.takeExpired(100 + CLOCK_SYNC_WAIT_MS - 1, CLOCK_SYNC_WAIT_MS, r));
+  TEST_ASSERT_TRUE(requests.takeExpired(100 + CLOCK_SYNC_WAIT_MS, CLOCK_SYNC_WAIT_MS, r));
+  TEST_ASSERT_EQUAL_UINT64(100, r.t0);
+  TEST_ASSERT_FALSE(requests.takeExpired(100 + CLOCK_SYNC_WAIT_MS, CLOCK_SYNC_WAIT_MS, r));
+
+  // The reply to the expired request turns up late: nothing to match.
+  TEST_ASSERT_FALSE(requests.take(100, 0, ETH, r));
+  TEST_ASSERT_EQUAL_UINT8(1, requests.pending());
+}
+
+static void test_full_table_refuses(void) {
+  bool merged = false;
+  for (uint8_t i = 0; i < TimeRequests::MAX_PENDING; i++) {
+    TEST_ASSERT_TRUE(requests.add(100 + i, 0, ETH, TimeRequests::SYNC, merged));
+  }
+  TEST_ASSERT_FALSE(requests.add(200, 0, ETH, TimeRequests::SYNC, merged));
+  // Merging into an existing entry still works.
+  TEST_ASSERT_TRUE(requests.add(100, 0, ETH, TimeRequests::LINK_PROBE, merged));
+  TEST_ASSERT_TRUE(merged);
+}
+
+static void test_lan_sync_is_tight(void) {
+  FakeTimeServer server;
+  TEST_ASSERT_TRUE(burst(server));
+  TEST_ASSERT_TRUE(sync.synced());
+  TEST_ASSERT_TRUE(sync.lastRttMs() <= 2);
+  TEST_ASSERT_TRUE(sync.uncertaintyMs(server.localMs()) <= 3);
+  assertWithinBound(server);
+}
+
+// Asymmetric jitter plus a fast crystal: the bound has to hold right after
+// each burst and all the way to the next one, and the fit has to find the
+// drift. A device clock running fast makes epoch - local shrink, so the
+// fitted slope is negative.
+static void test_jitter_and_drift_stay_within_bound(void) {
+  FakeTimeServer server(7);
+  server.driftPpm = 40;
+  server.baseDelayUs = 1000;
+  server.jitterUs = 8000;
+
+  for (uint8_t b = 0; b < 12; b++) {
+    TEST_ASSERT_TRUE(burst(server));
+    for (uint8_t i = 0; i < 8; i++) {
+      assertWithinBound(server);
+      server.advanceMs(CLOCK_SYNC_INTERVAL_MS / 8);
+    }
+  }
+  TEST_ASSERT_INT32_WITHIN(10, -40, sync.driftPpm());
+}
+
+static void test_lossy_path_still_syncs(void) {
+  FakeTimeServer server(3);
+  server.dropPercent = 60;
+  server.jitterUs = 2000;
+
+  uint8_t synced = 0;
+  for (uint8_t b = 0; b < 6; b++) {
+    if (burst(server)) synced++;
+    assertWithinBound(server);
+    server.advanceMs(CLOCK_SYNC_INTERVAL_MS);
+  }
+  TEST_ASSERT_TRUE(server.dropped > 0);
+  TEST_ASSERT_EQUAL_UINT8(6, synced);
+  TEST_ASSERT_EQUAL_UINT8(0, requests.pending());
+}
+
+static void test_everything_dropped_keeps_last_sync(void) {
+  FakeTimeServer server;
+  TEST_ASSERT_TRUE(burst(server));
+  const uint32_t rtt = sync.lastRttMs();
+
+  server.dropPercent = 100;
+  server.advanceMs(CLOCK_SYNC_INTERVAL_MS);
+  TEST_ASSERT_FALSE(burst(server));
+  TEST_ASSERT_TRUE(sync.synced());
+  TEST_ASSERT_EQUAL_UINT32(rtt, sync.lastRttMs());
+  // The bound widens with age instead of pretending nothing happened.
+  assertWithinBound(server);
+}
+
+// Replies slower than the RTT limit count as misses.
+static void test_slow_path_is_rejected(void) {
+  FakeTimeServer server;
+  server.baseDelayUs = (CLOCK_SYNC_MAX_RTT_MS / 2 + 1) * 1000;
+  TEST_ASSERT_FALSE(burst(server));
+  TEST_ASSERT_FALSE(sync.synced());
+  TEST_ASSERT_EQUAL_UINT64(0, sync.epochMs(server.localMs()));
+}
+
+// A 50 ms round trip, ordinary on a busy Wi-Fi link, is still a reply: the
+// request must not expire before the RTT filter gets to judge it.
+static void test_50ms_reply_is_used(void) {
+  TimeRequests::Request r;
+  bool merged = false;
+  TEST_ASSERT_TRUE(requests.add(1000, 0, WIFI, TimeRequests::SYNC | TimeRequests::LINK_PROBE, merged));
+  TEST_ASSERT_FALSE(requests.takeExpired(1050, CLOCK_SYNC_WAIT_MS, r));
+  TEST_ASSERT_TRUE(requests.take(1000, 0, WIFI, r));
+  TEST_ASSERT_EQUAL_UINT8(TimeRequests::SYNC | TimeRequests::LINK_PROBE, r.purposes);
+
+  FakeTimeServer server;
+  server.baseDelayUs = 25000;
+  server.jitterUs = 2000;
+  TEST_ASSERT_TRUE(burst(server));
+  TEST_ASSERT_TRUE(sync.synced());
+  TEST_ASSERT_TRUE(sync.lastRttMs() >= 50);
+  TEST_ASSERT_TRUE(sync.lastRttMs() <= 55);
+  TEST_ASSERT_EQUAL_UINT32(CLOCK_SYNC_SAMPLES, server.answered);
+  assertWithinBound(server);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_server_echoes_t0);
+  RUN_TEST(test_requests_match_on_t0_collector_and_link);
+  RUN_TEST(test_same_request_is_merged);
+  RUN_TEST(test_unanswered_requests_expire_once);
+  RUN_TEST(test_full_table_refuses);
+  RUN_TEST(test_lan_sync_is_tight);
+  RUN_TEST(test_jitter_and_drift_stay_within_bound);
+  RUN_TEST(test_lossy_path_still_syncs);
+  RUN_TEST(test_everything_dropped_keeps_last_sync);
+  RUN_TEST(test_slow_path_is_rejected);
+  RUN_TEST(test_50ms_reply_is_used);
+  return UNITY_END();
+}
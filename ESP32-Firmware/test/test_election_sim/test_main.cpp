@@ -0,0 +1,291 @@
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "config.h"
+#include "Heartbeat.h"
+#include "LeaderElection.h"
+#include "Scheduler.h"
+#include "SimTransport.h"
+
+// N controllers of one rack on a simulated heartbeat bus and the virtual
+// clock. Each runs the firmware's hb_rx, hb_tx and telemetry tasks (main.cpp,
+// minus everything that is not about the election) on its own Scheduler,
+// with the real Heartbeat frame parser and LeaderElection. The leader's
+// telemetry goes over a SimTransport to the collector, so the scenarios
+// judge leadership the way the Radxa sees it: by who is sending.
+//
+// Faults are crashes (a controller stops running and goes quiet on the bus)
+// and bus partitions (frames only reach controllers on the same side).
+
+static uint32_t clockMs() { return hostMillis; }
+static void noSleep(uint32_t) {}
+
+struct Controller {
+  char id;
+  bool running = true;
+  int side = 0;
+  bool sender = false;
+  HardwareSerial port{HB_UART_NUM};
+  Heartbeat hb{port};
+  LeaderElection election;
+  Scheduler sched{clockMs, noSleep};
+  SimTransport uplink{"ethernet"};
+  uint8_t tHbRx = Scheduler::INVALID_TASK;
+  uint8_t tTelemetry = Scheduler::INVALID_TASK;
+
+  explicit Controller(char id_) : id(id_), election(id_, ELECTION_PRIMARY_ID, HB_TIMEOUT_MS, BOOT_GRACE_MS) {}
+};
+
+static std::vector<std::unique_ptr<Controller>> rack;
+static Controller* cur = nullptr;   // the controller whose scheduler is running
+static const IPAddress COLLECTOR(192, 168, 0, 10);
+
+// ------------------
+// The firmware's tasks, for the current controller
+// ------------------
+
+static void hbRxTask(uint32_t) {
+  cur->hb.tick();
+  if (!cur->election.update(cur->hb.peers(), cur->hb.peerCount(), clockMs())) return;
+  const bool wasSender = cur->sender;
+  cur->sender = cur->election.isLeader();
+  if (cur->sender && !wasSender) cur->sched.wake(cur->tTelemetry);
+}
+
+static void hbTxTask(uint32_t now) {
+  cur->hb.send(cur->id, now, cur->election.term(), cur->election.leader());
+}
+
+static void telemetryTask(uint32_t now) {
+  if (!cur->sender) return;
+  char json[128];
+  const int n = snprintf(json, sizeof(json),
+                         "{\"message_type\": \"telemetry\", \"controller\": \"%c\", \"term\": %u, \"t\": %lu}",
+                         cur->id, (unsigned)cur->election.term(), (unsigned long)now);
+  cur->uplink.send(COLLECTOR, RADXA_UDP_PORT, (const uint8_t*)json, (size_t)n);
+}
+
+// ------------------
+// Simulation
+// ------------------
+
+// Boots n controllers together.
+static void startRack(uint8_t n) {
+  rack.clear();
+  hostMillis = 1;     // 0 means "never heard" in the heartbeat table
+  for (uint8_t i = 0; i < n; i++) rack.emplace_back(new Controller((char)('A' + i)));
+  for (uint8_t i = 0; i < n; i++) {
+    Controller& c = *rack[i];
+    // The bus: every frame reaches the running controllers on the same side
+    // and wakes their hb_rx, as the UART receive callback does.
+    c.port.onWrite = [i](const uint8_t* data, size_t len) {
+      const Controller& from = *rack[i];
+      for (std::unique_ptr<Controller>& to : rack) {
+        if (to.get() == &from || !to->running || to->side != from.side) continue;
+        to->port.rx.insert(to->port.rx.end(), data, data + len);
+        to->sched.wake(to->tHbRx);
+      }
+    };
+    c.tHbRx = c.sched.every("hb_rx", HB_POLL_MS, hbRxTask);
+    const uint32_t slotMs = (uint32_t)(c.id - 'A') * (HB_SEND_MS / (Heartbeat::MAX_PEERS + 1));
+    c.sched.every("hb_tx", HB_SEND_MS, hbTxTask, slotMs % HB_SEND_MS);
+    c.tTelemetry = c.sched.every("telemetry", TELEMETRY_SEND_MS, telemetryTask);
+  }
+}
+
+// Runs every controller's scheduler on the shared clock, jumping from one
+// deadline to the next.
+static void runFor(uint32_t durationMs) {
+  const uint32_t end = hostMillis + durationMs;
+  while ((int32_t)(hostMillis - end) < 0) {
+    for (std::unique_ptr<Controller>& c : rack) {
+      if (!c->running) continue;
+      cur = c.get();
+      c->sched.runDue();
+    }
+    uint32_t step = end - hostMillis;
+    for (std::unique_ptr<Controller>& c : rack) {
+      if (c->running) step = c->sched.msUntilNext(step);
+      if (step == 0) break;
+    }
+    hostMillis += step;
+  }
+}
+
+static void crash(char id) { rack[(size_t)(id - 'A')]->running = false; }
+
+struct Sent {
+  uint32_t t;
+  char id;
+  unsigned term;
+};
+
+// Telemetry the collector got, from every controller, in time order.
+static std::vector<Sent> collected(uint32_t sinceMs) {
+  std::vector<Sent> out;
+  for (std::unique_ptr<Controller>& c : rack) {
+    for (const SimTransport::Datagram& d : c->uplink.delivered) {
+      Sent s;
+      unsigned long t;
+      if (sscanf(d.payload.c_str(), "{\"message_type\": \"telemetry\", \"controller\": \"%c\", \"term\": %u, \"t\": %lu}",
+                 &s.id, &s.term, &t) != 3 || t < sinceMs) {
+        continue;
+      }
+      s.t = (uint32_t)t;
+      out.push_back(s);
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const Sent& a, const Sent& b) { return a.t < b.t; });
+  return out;
+}
+
+// Running controllers that believe they lead (side -1: any side).
+static uint8_t leaders(int side = -1) {
+  uint8_t n = 0;
+  for (std::unique_ptr<Controller>& c : rack) {
+    if (c->running && (side < 0 || c->side == side) && c->election.isLeader()) n++;
+  }
+  return n;
+}
+
+// Every running controller (on the side) names this leader, in one term.
+static void assertAgree(char leader, int side = -1) {
+  int term = -1;
+  for (std::unique_ptr<Controller>& c : rack) {
+    if (!c->running || (side >= 0 && c->side != side)) continue;
+    TEST_ASSERT_EQUAL(leader, c->election.leader());
+    if (term < 0) term = c->election.term();
+    TEST_ASSERT_EQUAL_INT(term, c->election.term());
+  }
+}
+
+// A leader's heartbeat may have gone out just before the crash, so its
+// peers time it out HB_TIMEOUT_MS after the crash at the latest, and notice
+// within one hb_rx poll.
+static const uint32_t ELECTION_BOUND_MS = HB_TIMEOUT_MS + HB_POLL_MS + 1;
+
+// ------------------
+// Scenarios
+// ------------------
+
+void setUp(void) {
+  Serial.quiet = true;
+}
+
+void tearDown(void) {
+  rack.clear();
+}
+
+static void test_primary_leads_from_boot(void) {
+  for (uint8_t n = 2; n <= 4; n++) {
+    startRack(n);
+    runFor(BOOT_GRACE_MS + 10000);
+    TEST_ASSERT_EQUAL_UINT8(1, leaders());
+    assertAgree('A');
+    // Nobody else ever sent: the backups heard A within their boot grace.
+    for (const Sent& s : collected(0)) TEST_ASSERT_EQUAL('A', s.id);
+    TEST_ASSERT_TRUE(collected(0).size() >= 10);
+    rack.clear();
+  }
+}
+
+static void test_crashes_elect_one_successor_in_bounded_time(void) {
+  for (uint8_t n = 2; n <= 4; n++) {
+    startRack(n);
+    runFor(BOOT_GRACE_MS + 5000);
+    for (char victim = 'A'; victim < (char)('A' + n - 1); victim++) {
+      const char successor = (char)(victim + 1);
+      const uint32_t crashedAt = hostMillis;
+      crash(victim);
+      runFor(ELECTION_BOUND_MS + 10000);
+
+      const std::vector<Sent> after = collected(crashedAt);
+      uint32_t takeoverAt = 0;
+      for (const Sent& s : after) {
+        if (s.id == successor) {
+          takeoverAt = s.t;
+          break;
+        }
+      }
+      TEST_ASSERT_TRUE(takeoverAt != 0);
+      const uint32_t electionMs = takeoverAt - crashedAt;
+      printf("[election] %u controllers, %c crashed: %c sends after %lu ms\n", (unsigned)n, victim, successor,
+             (unsigned long)electionMs);
+      TEST_ASSERT_TRUE(electionMs <= ELECTION_BOUND_MS);
+      // Not before the heartbeat timeout: no premature takeover.
+      TEST_ASSERT_TRUE(electionMs + HB_SEND_MS >= HB_TIMEOUT_MS);
+
+      // One leader, agreed on, and the only sender from the takeover on.
+      TEST_ASSERT_EQUAL_UINT8(1, leaders());
+      assertAgree(successor);
+      for (const Sent& s : after) {
+        if (s.t >= takeoverAt) TEST_ASSERT_EQUAL(successor, s.id);
+      }
+
+      // The term holds still while nothing changes.
+      const uint8_t term = rack[(size_t)(successor - 'A')]->election.term();
+      runFor(20000);
+      TEST_ASSERT_EQUAL_UINT8(term, rack[(size_t)(successor - 'A')]->election.term());
+      assertAgree(successor);
+    }
+    rack.clear();
+  }
+}
+
+// Splits the bus into sides (a side per controller, in ID order), lets both
+// halves elect, then heals it.
+static void partitionAndHeal(const int* sides, char minorityLeader) {
+  startRack(4);
+  runFor(BOOT_GRACE_MS + 5000);
+  for (size_t i = 0; i < rack.size(); i++) rack[i]->side = sides[i];
+  runFor(ELECTION_BOUND_MS + 10000);
+
+  // Each side is a rack of its own while it is cut off.
+  TEST_ASSERT_EQUAL_UINT8(1, leaders(0));
+  TEST_ASSERT_EQUAL_UINT8(1, leaders(1));
+  assertAgree('A', sides[0]);
+  assertAgree(minorityLeader, 1 - sides[0]);
+
+  const uint32_t healedAt = hostMillis;
+  for (std::unique_ptr<Controller>& c : rack) c->side = 0;
+  runFor(30000);
+
+  // The other side's leader hears A within a heartbeat period and stands
+  // down; from then on A alone sends and nobody changes its mind.
+  const std::vector<Sent> after = collected(healedAt);
+  uint32_t lastOther = healedAt;
+  for (const Sent& s : after) {
+    if (s.id != 'A') lastOther = s.t;
+  }
+  printf("[election] partition healed: %c stopped sending after %lu ms\n", minorityLeader,
+         (unsigned long)(lastOther - healedAt));
+  TEST_ASSERT_TRUE(lastOther - healedAt <= HB_SEND_MS + HB_POLL_MS);
+  TEST_ASSERT_EQUAL_UINT8(1, leaders());
+  assertAgree('A');
+
+  const uint8_t term = rack[0]->election.term();
+  runFor(20000);
+  TEST_ASSERT_EQUAL_UINT8(1, leaders());
+  TEST_ASSERT_EQUAL_UINT8(term, rack[0]->election.term());
+  for (const Sent& s : collected(healedAt + HB_SEND_MS + HB_POLL_MS + 1)) TEST_ASSERT_EQUAL('A', s.id);
+}
+
+static void test_partition_heals_without_split_leadership(void) {
+  static const int HALVES[] = {0, 0, 1, 1};     // A B | C D
+  partitionAndHeal(HALVES, 'C');
+}
+
+static void test_isolated_primary_takes_back_the_rack(void) {
+  static const int ALONE[] = {0, 1, 1, 1};      // A | B C D
+  partitionAndHeal(ALONE, 'B');
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_primary_leads_from_boot);
+  RUN_TEST(test_crashes_elect_one_successor_in_bounded_time);
+  RUN_TEST(test_partition_heals_without_split_leadership);
+  RUN_TEST(test_isolated_primary_takes_back_the_rack);
+  return UNITY_END();
+}
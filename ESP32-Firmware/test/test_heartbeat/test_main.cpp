@@ -0,0 +1,200 @@
+#include <unity.h>
+#include "Heartbeat.h"
+
+// Frame: AA 55 ID SEQ TERM LEADER CRC
+static void makeFrame(uint8_t out[7], char id, uint8_t seq, uint8_t term, char leader) {
+  out[0] = 0xAA;
+  out[1] = 0x55;
+  out[2] = (uint8_t)id;
+  out[3] = seq;
+  out[4] = term;
+  out[5] = (uint8_t)leader;
+  out[6] = Heartbeat::crc8(&out[2], 4);
+}
+
+static void feed(Heartbeat& hb, const uint8_t* data, size_t n) {
+  for (size_t i = 0; i < n; i++) hb.parseByte(data[i]);
+}
+
+static void feedFrame(Heartbeat& hb, char id, uint8_t term = 0, char leader = 'A') {
+  uint8_t f[7];
+  makeFrame(f, id, 0, term, leader);
+  feed(hb, f, sizeof(f));
+}
+
+void setUp(void) {
+  hostMillis = 1000;
+}
+
+void tearDown(void) {}
+
+static void test_crc8_check_value(void) {
+  // CRC-8/SMBUS (poly 0x07, init 0) check value
+  const uint8_t msg[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_HEX8(0xF4, Heartbeat::crc8(msg, sizeof(msg)));
+  TEST_ASSERT_EQUAL_HEX8(0x00, Heartbeat::crc8(msg, 0));
+}
+
+static void test_valid_frame_registers_peer(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  feedFrame(hb, 'B', 7, 'A');
+
+  TEST_ASSERT_EQUAL_UINT32(1, hb.framesOk());
+  TEST_ASSERT_EQUAL_UINT32(0, hb.crcErrors());
+  TEST_ASSERT_EQUAL_UINT8(1, hb.peerCount());
+  const Heartbeat::Peer* p = hb.findPeer('B');
+  TEST_ASSERT_NOT_NULL(p);
+  TEST_ASSERT_EQUAL_UINT32(1000, p->lastRxMs);
+  TEST_ASSERT_EQUAL_UINT8(7, p->term);
+  TEST_ASSERT_EQUAL('A', p->leader);
+  TEST_ASSERT_TRUE(hb.peerAlive('B', 1000, 2000));
+}
+
+static void test_bad_crc_is_counted_and_dropped(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  uint8_t f[7];
+  makeFrame(f, 'B', 0, 0, 'A');
+  f[6] ^= 0x01;
+  feed(hb, f, sizeof(f));
+
+  TEST_ASSERT_EQUAL_UINT32(0, hb.framesOk());
+  TEST_ASSERT_EQUAL_UINT32(1, hb.crcErrors());
+  TEST_ASSERT_EQUAL_UINT8(0, hb.peerCount());
+}
+
+static void test_resyncs_after_noise(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  const uint8_t noise[] = {0x00, 0x55, 0xAA, 0x13, 0xAA};
+  feed(hb, noise, sizeof(noise));
+  // The trailing AA above plus this frame's AA: "AA AA 55 ..." must still parse.
+  feedFrame(hb, 'C');
+
+  TEST_ASSERT_EQUAL_UINT32(1, hb.framesOk());
+  TEST_ASSERT_NOT_NULL(hb.findPeer('C'));
+}
+
+static void test_tick_drains_uart(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  uint8_t f[7];
+  makeFrame(f, 'B', 1, 3, 'B');
+  ser.rx.insert(ser.rx.end(), f, f + sizeof(f));
+  hb.tick();
+
+  TEST_ASSERT_EQUAL_INT(0, ser.available());
+  TEST_ASSERT_EQUAL_UINT32(1, hb.framesOk());
+}
+
+static void test_send_round_trip(void) {
+  HardwareSerial serA(1);
+  HardwareSerial serB(1);
+  Heartbeat a(serA);
+  Heartbeat b(serB);
+
+  a.send('A', 1000, 5, 'A');
+  TEST_ASSERT_EQUAL_UINT32(7, serA.tx.size());
+  serB.rx.insert(serB.rx.end(), serA.tx.begin(), serA.tx.end());
+  b.tick();
+
+  const Heartbeat::Peer* p = b.findPeer('A');
+  TEST_ASSERT_NOT_NULL(p);
+  TEST_ASSERT_EQUAL_UINT8(5, p->term);
+  TEST_ASSERT_EQUAL('A', p->leader);
+}
+
+static void test_own_frames_are_ignored(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  // Heard before our ID is known (first send), then forgotten.
+  feedFrame(hb, 'A');
+  TEST_ASSERT_EQUAL_UINT8(1, hb.peerCount());
+  hb.send('A', 1000);
+  TEST_ASSERT_EQUAL_UINT8(0, hb.peerCount());
+
+  feedFrame(hb, 'A');
+  TEST_ASSERT_EQUAL_UINT8(0, hb.peerCount());
+  TEST_ASSERT_EQUAL_UINT32(2, hb.framesOk());
+}
+
+static void test_ids_outside_range_are_rejected(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  feedFrame(hb, '@');
+  feedFrame(hb, 'E');
+  feedFrame(hb, (char)0x00);
+  feedFrame(hb, (char)0xFF);
+  TEST_ASSERT_EQUAL_UINT8(0, hb.peerCount());
+
+  // A bogus advertised leader is stored as unknown.
+  feedFrame(hb, 'D', 1, '!');
+  TEST_ASSERT_EQUAL('?', hb.findPeer('D')->leader);
+}
+
+static void test_full_table_reuses_oldest_slot(void) {
+  HardwareSerial ser(1);
+  Heartbeat hb(ser);
+
+  hostMillis = 100;
+  feedFrame(hb, 'B');
+  hostMillis = 200;
+  feedFrame(hb, 'C');
+  hostMillis = 300;
+  feedFrame(hb, 'D');
+  hostMillis = 400;
+  feedFrame(hb, 'B');
+  hostMillis = 500;
+  feedFrame(hb, 'A');   // table full: C was heard longest ago
+
+  TEST_ASSERT_EQUAL_UINT8(Heartbeat::MAX_PEERS, hb.peerCount());
+  TEST_ASSERT_NULL(hb.findPeer('C'));
+  TEST_ASSERT_NOT_NULL(hb.findPeer('A'));
+  TEST_ASSERT_NOT_NULL(hb.findPeer('B'));
+  TEST_ASSERT_NOT_NULL(hb.findPeer('D'));
+}
+
+static void test_stamp_after_now_counts_as_alive(void) {
+  // The scheduler reads the clock, then a frame parsed one tick later is
+  // stamped now + 1. That is age 0, not ~49 days.
+  Heartbeat::Peer p = {'B', 1001, 0, 'A'};
+  TEST_ASSERT_EQUAL_UINT32(0, Heartbeat::ageMs(p, 1000));
+  TEST_ASSERT_TRUE(Heartbeat::alive(p, 1000, 2000));
+
+  p.lastRxMs = 1000;
+  TEST_ASSERT_TRUE(Heartbeat::alive(p, 3000, 2000));
+  TEST_ASSERT_FALSE(Heartbeat::alive(p, 3001, 2000));
+
+  // Never heard
+  p.lastRxMs = 0;
+  TEST_ASSERT_FALSE(Heartbeat::alive(p, 1000, 2000));
+}
+
+static void test_alive_across_millis_wrap(void) {
+  Heartbeat::Peer p = {'B', 0xFFFFFF00u, 0, 'A'};
+  TEST_ASSERT_EQUAL_UINT32(0x200, Heartbeat::ageMs(p, 0x100));
+  TEST_ASSERT_TRUE(Heartbeat::alive(p, 0x100, 2000));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc8_check_value);
+  RUN_TEST(test_valid_frame_registers_peer);
+  RUN_TEST(test_bad_crc_is_counted_and_dropped);
+  RUN_TEST(test_resyncs_after_noise);
+  RUN_TEST(test_tick_drains_uart);
+  RUN_TEST(test_send_round_trip);
+  RUN_TEST(test_own_frames_are_ignored);
+  RUN_TEST(test_ids_outside_range_are_rejected);
+  RUN_TEST(test_full_table_reuses_oldest_slot);
+  RUN_TEST(test_stamp_after_now_counts_as_alive);
+  RUN_TEST(test_alive_across_millis_wrap);
+  return UNITY_END();
+}
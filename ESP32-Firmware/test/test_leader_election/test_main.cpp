@@ -0,0 +1,116 @@
+#include <unity.h>
+#include "LeaderElection.h"
+
+static const uint32_t TIMEOUT_MS = 2000;
+static const uint32_t GRACE_MS = 5000;
+
+static Heartbeat::Peer peers[Heartbeat::MAX_PEERS];
+static uint8_t peerCount = 0;
+
+static void heard(char id, uint32_t now, uint8_t term = 0, char leader = '?') {
+  for (uint8_t i = 0; i < peerCount; i++) {
+    if (peers[i].id == id) {
+      peers[i] = {id, now, term, leader};
+      return;
+    }
+  }
+  if (peerCount < Heartbeat::MAX_PEERS) peers[peerCount++] = {id, now, term, leader};
+}
+
+void setUp(void) {
+  peerCount = 0;
+}
+
+void tearDown(void) {}
+
+static void test_primary_leads_at_boot(void) {
+  LeaderElection e('A', 'A', TIMEOUT_MS, GRACE_MS);
+  TEST_ASSERT_TRUE(e.update(peers, peerCount, 10));
+  TEST_ASSERT_EQUAL('A', e.leader());
+  TEST_ASSERT_TRUE(e.isLeader());
+  TEST_ASSERT_EQUAL_UINT8(1, e.term());
+}
+
+static void test_backup_waits_out_boot_grace(void) {
+  LeaderElection e('B', 'A', TIMEOUT_MS, GRACE_MS);
+  TEST_ASSERT_FALSE(e.update(peers, peerCount, 10));
+  TEST_ASSERT_EQUAL(LeaderElection::NO_LEADER, e.leader());
+
+  TEST_ASSERT_TRUE(e.update(peers, peerCount, GRACE_MS + 1));
+  TEST_ASSERT_EQUAL('B', e.leader());
+}
+
+static void test_lowest_live_id_leads(void) {
+  LeaderElection e('C', 'A', TIMEOUT_MS, GRACE_MS);
+  heard('B', 100);
+  heard('D', 100);
+  e.update(peers, peerCount, 200);
+  TEST_ASSERT_EQUAL('B', e.leader());
+  TEST_ASSERT_FALSE(e.isLeader());
+}
+
+static void test_failover_and_failback(void) {
+  LeaderElection e('B', 'A', TIMEOUT_MS, GRACE_MS);
+  heard('A', 6000, 1, 'A');
+  e.update(peers, peerCount, 6000);
+  TEST_ASSERT_EQUAL('A', e.leader());
+  const uint8_t t0 = e.term();
+
+  // A silent for exactly the timeout: still alive.
+  TEST_ASSERT_FALSE(e.update(peers, peerCount, 6000 + TIMEOUT_MS));
+  // One ms later it is gone and B takes over in a newer term.
+  TEST_ASSERT_TRUE(e.update(peers, peerCount, 6001 + TIMEOUT_MS));
+  TEST_ASSERT_EQUAL('B', e.leader());
+  TEST_ASSERT_EQUAL('A', e.previousLeader());
+  TEST_ASSERT_TRUE(LeaderElection::newerTerm(e.term(), t0));
+
+  // A comes back: the lower ID wins again.
+  heard('A', 10000, 1, 'A');
+  TEST_ASSERT_TRUE(e.update(peers, peerCount, 10000));
+  TEST_ASSERT_EQUAL('A', e.leader());
+}
+
+static void test_adopts_higher_peer_term(void) {
+  LeaderElection e('B', 'A', TIMEOUT_MS, GRACE_MS);
+  heard('A', 6000, 40, 'A');
+  e.update(peers, peerCount, 6000);
+  TEST_ASSERT_EQUAL_UINT8(41, e.term());
+
+  // No leader change, but a peer is ahead: catch up without bumping.
+  heard('A', 6500, 50, 'A');
+  TEST_ASSERT_FALSE(e.update(peers, peerCount, 6500));
+  TEST_ASSERT_EQUAL_UINT8(50, e.term());
+}
+
+static void test_stable_while_heartbeats_keep_coming(void) {
+  LeaderElection e('B', 'A', TIMEOUT_MS, GRACE_MS);
+  heard('A', 6000, 1, 'A');
+  e.update(peers, peerCount, 6000);
+  const uint8_t term = e.term();
+
+  // A frame stamped just after the caller read its clock must not look dead.
+  for (uint32_t now = 6000; now < 60000; now += 250) {
+    heard('A', now + 1, 1, 'A');
+    TEST_ASSERT_FALSE(e.update(peers, peerCount, now));
+  }
+  TEST_ASSERT_EQUAL_UINT8(term, e.term());
+}
+
+static void test_term_comparison_wraps(void) {
+  TEST_ASSERT_TRUE(LeaderElection::newerTerm(1, 0));
+  TEST_ASSERT_TRUE(LeaderElection::newerTerm(2, 255));
+  TEST_ASSERT_FALSE(LeaderElection::newerTerm(255, 2));
+  TEST_ASSERT_FALSE(LeaderElection::newerTerm(7, 7));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_primary_leads_at_boot);
+  RUN_TEST(test_backup_waits_out_boot_grace);
+  RUN_TEST(test_lowest_live_id_leads);
+  RUN_TEST(test_failover_and_failback);
+  RUN_TEST(test_adopts_higher_peer_term);
+  RUN_TEST(test_stable_while_heartbeats_keep_coming);
+  RUN_TEST(test_term_comparison_wraps);
+  return UNITY_END();
+}
@@ -0,0 +1,288 @@
+#include <unity.h>
+#include <set>
+#include "config.h"
+#include "ClockSync.h"
+#include "LinkMonitor.h"
+#include "LinkSupervisor.h"
+#include "Scheduler.h"
+#include "SimTransport.h"
+#include "TelemetrySender.h"
+#include "TimeRequests.h"
+#include "TimeUtil.h"
+
+// Ethernet/Wi-Fi failover end to end on simulated transports and the virtual
+// clock. Probe rounds and link decisions are the firmware's own
+// LinkSupervisor and LinkMonitor; the tasks below only stand in for main.cpp's
+// telemetry, link and net_rx tasks around them, on the real Scheduler,
+// TelemetrySender and TimeRequests. Each scenario injects a fault and
+// measures switch-over latency and how many telemetry datagrams never reached
+// the collector.
+
+static uint32_t clockMs() { return hostMillis; }
+static void sleepMs(uint32_t ms) { hostMillis += ms; }
+
+static SimTransport* eth = nullptr;
+static SimTransport* wifi = nullptr;
+static TelemetrySender* net = nullptr;
+static LinkMonitor* linkMon = nullptr;
+static Scheduler* sched = nullptr;
+static TimeRequests requests;
+
+static uint8_t tTelemetry = Scheduler::INVALID_TASK;
+static uint8_t tLink = Scheduler::INVALID_TASK;
+static uint8_t tNetRx = Scheduler::INVALID_TASK;
+
+static LinkSupervisor* linkSup = nullptr;
+
+static uint32_t seq = 0;
+// As in main.cpp: set once any time request is answered (there, usually by
+// clock sync first).
+static bool collectorAnswered = false;
+static std::vector<uint64_t> switchedAt;
+
+static bool postProbe(Transport& via) {
+  char buf[160];
+  const uint64_t t0 = millis64();
+  bool merged = false;
+  if (!requests.add(t0, 0, &via, TimeRequests::LINK_PROBE, merged)) return false;
+  if (merged) return true;
+  ClockSync::formatRequest(buf, sizeof(buf), "AA:BB:CC:DD:EE:FF", t0);
+  net->sendUDPTo(0, buf, &via);
+  sched->schedule(tNetRx, NET_RX_POLL_MS);
+  return true;
+}
+
+static void onSwitch(const LinkMonitor::Event&, uint8_t) {
+  switchedAt.push_back(millis64());
+  sched->wake(tTelemetry);
+}
+
+static void netRxTask(uint32_t) {
+  char buf[192];
+  uint8_t from = 0;
+  Transport* via = nullptr;
+  while (net->receiveUDP(buf, sizeof(buf), &from, &via) > 0) {
+    uint64_t echo, t1, t2;
+    TimeRequests::Request r;
+    if (ClockSync::parseResponse(buf, echo, t1, t2) && requests.take(echo, from, via, r)) {
+      collectorAnswered = true;
+      linkSup->onProbe(r.via, true, millis64());
+    }
+  }
+  TimeRequests::Request r;
+  while (requests.takeExpired(millis64(), CLOCK_SYNC_WAIT_MS, r)) linkSup->onProbe(r.via, false, millis64());
+  if (requests.pending()) sched->schedule(tNetRx, NET_RX_POLL_MS);
+}
+
+static void linkTask(uint32_t) { linkSup->startRound(collectorAnswered, millis64()); }
+
+static void telemetryTask(uint32_t) {
+  char json[96];
+  snprintf(json, sizeof(json), "{\"message_type\": \"telemetry\", \"seq\": %lu}", (unsigned long)seq++);
+  if (!net->sendUDP(json)) sched->wake(tLink);
+}
+
+static void runFor(uint32_t durationMs) {
+  const uint32_t end = hostMillis + durationMs;
+  while ((int32_t)(hostMillis - end) < 0) {
+    sched->runDue();
+    sched->idle(SCHED_MAX_SLEEP_MS);
+  }
+}
+
+// Telemetry sequence numbers that never reached the collector on either link.
+static uint32_t lostCount() {
+  std::set<unsigned long> got;
+  for (SimTransport* t : {eth, wifi}) {
+    for (const SimTransport::Datagram& d : t->delivered) {
+      const char* p = strstr(d.payload.c_str(), "\"seq\": ");
+      if (p) got.insert(strtoul(p + 7, nullptr, 10));
+    }
+  }
+  return seq - (uint32_t)got.size();
+}
+
+static void report(const char* scenario, uint64_t faultAt) {
+  printf("[failover] %s: switch after %llu ms, %lu of %lu datagrams lost\n", scenario,
+         switchedAt.empty() ? 0ULL : (unsigned long long)(switchedAt.back() - faultAt),
+         (unsigned long)lostCount(), (unsigned long)seq);
+}
+
+void setUp(void) {
+  // millis64() keeps state across tests, so the clock only moves forward.
+  delete sched;
+  delete linkSup;
+  delete linkMon;
+  delete net;
+  delete eth;
+  delete wifi;
+  eth = new SimTransport("ethernet");
+  wifi = new SimTransport("wifi");
+  net = new TelemetrySender(*eth, *wifi);
+  linkMon = new LinkMonitor(NET_FAIL_PROBES, NET_SWITCHBACK_STABLE_MS);
+  linkSup = new LinkSupervisor(*linkMon, *net, *eth, *wifi, postProbe, onSwitch);
+  sched = new Scheduler(clockMs, sleepMs);
+  requests = TimeRequests();
+  seq = 0;
+  collectorAnswered = true;
+  switchedAt.clear();
+
+  TEST_ASSERT_TRUE(net->begin());
+  tNetRx = sched->once("net_rx", NET_RX_POLL_MS, netRxTask);
+  tTelemetry = sched->every("telemetry", TELEMETRY_SEND_MS, telemetryTask);
+  tLink = sched->every("link", NET_PROBE_MS, linkTask, NET_PROBE_MS);
+
+  // Settle on Ethernet first.
+  runFor(5000);
+  TEST_ASSERT_EQUAL(LinkMonitor::ETHERNET, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(0, lostCount());
+}
+
+void tearDown(void) {
+  // The retry queue lives in TelemetrySender's statics; leave it empty.
+  eth->link = true;
+  eth->blackhole = false;
+  wifi->link = true;
+  wifi->blackhole = false;
+  net->setActive(*eth);
+  net->flushPending();
+}
+
+// A dead PHY link makes the next telemetry send fail, which wakes the link
+// check, so the switch happens well before the next probe period and the
+// failed datagram is re-sent over Wi-Fi.
+static void test_ethernet_link_down_switches_without_loss(void) {
+  runFor(300);
+  const uint64_t faultAt = millis64();
+  eth->link = false;
+  runFor(5000);
+
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(1, switchedAt.size());
+  TEST_ASSERT_TRUE(switchedAt[0] - faultAt <= TELEMETRY_SEND_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, lostCount());
+  TEST_ASSERT_EQUAL_UINT8(0, net->pendingCount());
+  report("ethernet_link_down", faultAt);
+}
+
+// Link up but nothing gets through: sends look fine, so only the probes can
+// tell. The switch takes NET_FAIL_PROBES probe periods, and telemetry sent
+// into the dead path during that time is lost.
+static void test_degraded_ethernet_switches_after_failed_probes(void) {
+  runFor(300);
+  const uint64_t faultAt = millis64();
+  eth->blackhole = true;
+  runFor(10000);
+
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(1, switchedAt.size());
+  const uint64_t latency = switchedAt[0] - faultAt;
+  TEST_ASSERT_TRUE(latency <= (uint64_t)NET_FAIL_PROBES * NET_PROBE_MS + CLOCK_SYNC_WAIT_MS);
+  TEST_ASSERT_TRUE(latency >= (uint64_t)(NET_FAIL_PROBES - 1) * NET_PROBE_MS);
+  TEST_ASSERT_TRUE(lostCount() > 0);
+  TEST_ASSERT_TRUE(lostCount() <= latency / TELEMETRY_SEND_MS + 1);
+  TEST_ASSERT_EQUAL_STRING("ethernet_degraded", linkMon->event(0).reason);
+  report("ethernet_degraded", faultAt);
+}
+
+// Back to Ethernet only after it has been healthy for the whole hold time,
+// and nothing is lost on the way back.
+static void test_switch_back_waits_for_stable_ethernet(void) {
+  eth->link = false;
+  runFor(3000);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  const uint32_t lostBefore = lostCount();
+
+  const uint64_t restoredAt = millis64();
+  eth->link = true;
+  runFor(NET_SWITCHBACK_STABLE_MS - NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+
+  runFor(3 * NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::ETHERNET, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(2, switchedAt.size());
+  TEST_ASSERT_TRUE(switchedAt[1] - restoredAt >= NET_SWITCHBACK_STABLE_MS);
+  TEST_ASSERT_TRUE(switchedAt[1] - restoredAt <= NET_SWITCHBACK_STABLE_MS + NET_PROBE_MS + CLOCK_SYNC_WAIT_MS);
+  TEST_ASSERT_EQUAL_UINT32(lostBefore, lostCount());
+  report("ethernet_restored", restoredAt);
+}
+
+// With both links gone there is nowhere to go: telemetry is queued up to
+// NET_RETRY_SLOTS, older payloads are dropped, and the queue drains once
+// Wi-Fi is back.
+static void test_both_links_down_queues_then_drains(void) {
+  const uint32_t droppedBefore = net->droppedCount();
+  eth->link = false;
+  wifi->link = false;
+  runFor(8000);
+  TEST_ASSERT_EQUAL(LinkMonitor::ETHERNET, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT8(NET_RETRY_SLOTS, net->pendingCount());
+
+  const uint64_t backAt = millis64();
+  wifi->link = true;
+  runFor(3000);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT8(0, net->pendingCount());
+  TEST_ASSERT_EQUAL_UINT32(net->droppedCount() - droppedBefore, lostCount());
+  report("both_down_then_wifi", backAt);
+}
+
+// Off a blackholed Ethernet, a single lost Wi-Fi probe is no reason to go
+// back: Ethernet is still not answering. Wi-Fi is only given up once it has
+// missed NET_FAIL_PROBES probes in a row and Ethernet answers again.
+static void test_wifi_miss_does_not_return_to_dead_ethernet(void) {
+  eth->blackhole = true;
+  runFor((NET_FAIL_PROBES + 1) * NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(1, switchedAt.size());
+
+  // Exactly one probe round falls into the window.
+  wifi->blackhole = true;
+  runFor(NET_PROBE_MS);
+  wifi->blackhole = false;
+  runFor(5 * NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(1, switchedAt.size());
+
+  // Both degraded: nowhere better to go.
+  wifi->blackhole = true;
+  runFor((NET_FAIL_PROBES + 1) * NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(1, switchedAt.size());
+
+  // Ethernet answers again while Wi-Fi is still dead: back on the next round.
+  const uint64_t fixedAt = millis64();
+  eth->blackhole = false;
+  runFor(2 * NET_PROBE_MS);
+  TEST_ASSERT_EQUAL(LinkMonitor::ETHERNET, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(2, switchedAt.size());
+  TEST_ASSERT_TRUE(switchedAt[1] - fixedAt <= NET_PROBE_MS + CLOCK_SYNC_WAIT_MS);
+  TEST_ASSERT_EQUAL_STRING("wifi_degraded", linkMon->event(1).reason);
+  report("wifi_degraded", fixedAt);
+}
+
+// A Radxa without the time service never answers, so probe misses mean
+// nothing and only the PHY links decide: a blackholed Ethernet is kept.
+static void test_without_time_service_only_link_state_counts(void) {
+  collectorAnswered = false;
+  eth->blackhole = true;
+  runFor(10000);
+  TEST_ASSERT_EQUAL(LinkMonitor::ETHERNET, linkMon->active());
+  TEST_ASSERT_EQUAL_UINT32(0, switchedAt.size());
+
+  eth->link = false;
+  runFor(3000);
+  TEST_ASSERT_EQUAL(LinkMonitor::WIFI, linkMon->active());
+  TEST_ASSERT_EQUAL_STRING("ethernet_link_down", linkMon->event(0).reason);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ethernet_link_down_switches_without_loss);
+  RUN_TEST(test_degraded_ethernet_switches_after_failed_probes);
+  RUN_TEST(test_switch_back_waits_for_stable_ethernet);
+  RUN_TEST(test_both_links_down_queues_then_drains);
+  RUN_TEST(test_wifi_miss_does_not_return_to_dead_ethernet);
+  RUN_TEST(test_without_time_service_only_link_state_counts);
+  return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "Profiler.h"
+
+// Host builds count nanoseconds: 1000 ticks per reported microsecond.
+static const uint32_t TICKS_PER_US = 1000;
+
+void setUp(void) {
+  Profiler::reset();
+}
+
+void tearDown(void) {}
+
+static void recordN(Profiler::Stage st, uint32_t ticks, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) Profiler::record(st, ticks);
+}
+
+static void test_empty_stage_reports_zero(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::count(Profiler::JSON));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::percentileUs(Profiler::JSON, 50));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::maxUs(Profiler::JSON));
+}
+
+// 0 and 1 share bucket 0, and a percentile never exceeds the observed max.
+static void test_zero_and_one_ticks(void) {
+  Profiler::record(Profiler::HB_RX, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, Profiler::count(Profiler::HB_RX));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::percentileUs(Profiler::HB_RX, 100));
+
+  Profiler::record(Profiler::HB_RX, 1);
+  TEST_ASSERT_EQUAL_UINT32(2, Profiler::count(Profiler::HB_RX));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::percentileUs(Profiler::HB_RX, 50));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::maxUs(Profiler::HB_RX));
+}
+
+// Bucket i holds [2^i, 2^(i+1)); a percentile reports the bucket's upper
+// bound, clipped to the largest value seen.
+static void test_power_of_two_edges(void) {
+  const uint32_t lo = 1u << 20;  // 1048 us
+  Profiler::record(Profiler::TEMP, lo);
+  TEST_ASSERT_EQUAL_UINT32(lo / TICKS_PER_US, Profiler::percentileUs(Profiler::TEMP, 50));
+
+  // The top of the same bucket: p50 is now the bucket's upper bound.
+  Profiler::record(Profiler::TEMP, 2 * lo - 1);
+  TEST_ASSERT_EQUAL_UINT32((2 * lo - 1) / TICKS_PER_US, Profiler::percentileUs(Profiler::TEMP, 50));
+  TEST_ASSERT_EQUAL_UINT32((2 * lo - 1) / TICKS_PER_US, Profiler::percentileUs(Profiler::TEMP, 1));
+
+  // 2^21 opens the next bucket; p50 of three stays in the lower one.
+  Profiler::record(Profiler::TEMP, 2 * lo);
+  TEST_ASSERT_EQUAL_UINT32((2 * lo - 1) / TICKS_PER_US, Profiler::percentileUs(Profiler::TEMP, 50));
+  TEST_ASSERT_EQUAL_UINT32(2 * lo / TICKS_PER_US, Profiler::percentileUs(Profiler::TEMP, 100));
+  TEST_ASSERT_EQUAL_UINT32(2 * lo / TICKS_PER_US, Profiler::maxUs(Profiler::TEMP));
+}
+
+// The largest tick count lands in the last bucket without overflowing.
+static void test_overflow_bucket(void) {
+  Profiler::record(Profiler::UDP, 0xFFFFFFFFu);
+  Profiler::record(Profiler::UDP, 0x80000000u);
+  TEST_ASSERT_EQUAL_UINT32(2, Profiler::count(Profiler::UDP));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu / TICKS_PER_US, Profiler::percentileUs(Profiler::UDP, 50));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu / TICKS_PER_US, Profiler::maxUs(Profiler::UDP));
+}
+
+// 90 fast runs and 10 slow ones: p90 is in the fast bucket, p91 in the slow.
+static void test_percentiles_of_bimodal_runs(void) {
+  recordN(Profiler::JSON, 5000, 90);    // bucket 12: [4096, 8192)
+  recordN(Profiler::JSON, 300000, 10);  // bucket 18: [262144, 524288)
+  TEST_ASSERT_EQUAL_UINT32(8, Profiler::percentileUs(Profiler::JSON, 0));
+  TEST_ASSERT_EQUAL_UINT32(8, Profiler::percentileUs(Profiler::JSON, 50));
+  TEST_ASSERT_EQUAL_UINT32(8, Profiler::percentileUs(Profiler::JSON, 90));
+  TEST_ASSERT_EQUAL_UINT32(300, Profiler::percentileUs(Profiler::JSON, 91));
+  TEST_ASSERT_EQUAL_UINT32(300, Profiler::percentileUs(Profiler::JSON, 99));
+  TEST_ASSERT_EQUAL_UINT32(300, Profiler::maxUs(Profiler::JSON));
+}
+
+// On an even spread the reported percentile is never below the true value
+// and at most twice it: the cost of log2 buckets.
+static void test_percentiles_of_uniform_runs(void) {
+  for (uint32_t us = 1; us <= 1000; us++) Profiler::record(Profiler::LOG, us * TICKS_PER_US);
+  static const uint8_t PCTS[] = {1, 10, 25, 50, 75, 90, 99, 100};
+  for (uint8_t pct : PCTS) {
+    const uint32_t exact = 10u * pct;  // microseconds
+    const uint32_t got = Profiler::percentileUs(Profiler::LOG, pct);
+    TEST_ASSERT_TRUE_MESSAGE(got >= exact, "percentile below the true value");
+    TEST_ASSERT_TRUE_MESSAGE(got <= 2 * exact, "percentile more than one bucket high");
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, Profiler::maxUs(Profiler::LOG));
+}
+
+static void test_stage_out_of_range_and_reset(void) {
+  Profiler::record(Profiler::STAGE_COUNT, 1000);
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::count(Profiler::STAGE_COUNT));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::percentileUs(Profiler::STAGE_COUNT, 50));
+  TEST_ASSERT_EQUAL_STRING("?", Profiler::stageName(Profiler::STAGE_COUNT));
+
+  recordN(Profiler::HB_TX, 4000, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, Profiler::count(Profiler::HB_TX));
+  Profiler::reset();
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::count(Profiler::HB_TX));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::maxUs(Profiler::HB_TX));
+}
+
+static void test_format_item(void) {
+  recordN(Profiler::JSON, 5000, 90);
+  recordN(Profiler::JSON, 300000, 10);
+  char out[1024];
+  const size_t n = Profiler::formatItem(out, sizeof(out), 60000);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)strlen(out), n);
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"kind\": \"profile\""));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"window_ms\": 60000"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"json\": [100, 8, 300, 300]"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"hb_rx\": [0, 0, 0, 0]"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"log\": [0, 0, 0, 0]"));
+  TEST_ASSERT_EQUAL('}', out[n - 1]);
+}
+
+// A short buffer gets a NUL-terminated prefix and the length actually written.
+static void test_format_item_truncates(void) {
+  recordN(Profiler::UDP, 5000, 10);
+  char full[1024];
+  const size_t total = Profiler::formatItem(full, sizeof(full), 60000);
+
+  static const size_t SIZES[] = {1, 2, 16, 100, 200};
+  for (size_t sz : SIZES) {
+    char out[256];
+    memset(out, 'x', sizeof(out));
+    const size_t n = Profiler::formatItem(out, sz, 60000);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)sz - 1, n);
+    TEST_ASSERT_EQUAL_UINT32(n, strlen(out));
+    TEST_ASSERT_EQUAL_INT(0, strncmp(out, full, n));
+    TEST_ASSERT_EQUAL('x', out[sz]);  // nothing written past outSz
+  }
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)total, Profiler::formatItem(full, total + 1, 60000));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::formatItem(full, 0, 60000));
+  TEST_ASSERT_EQUAL_UINT32(0, Profiler::formatItem(nullptr, 10, 60000));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_stage_reports_zero);
+  RUN_TEST(test_zero_and_one_ticks);
+  RUN_TEST(test_power_of_two_edges);
+  RUN_TEST(test_overflow_bucket);
+  RUN_TEST(test_percentiles_of_bimodal_runs);
+  RUN_TEST(test_percentiles_of_uniform_runs);
+  RUN_TEST(test_stage_out_of_range_and_reset);
+  RUN_TEST(test_format_item);
+  RUN_TEST(test_format_item_truncates);
+  return UNITY_END();
+}
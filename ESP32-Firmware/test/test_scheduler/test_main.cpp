@@ -0,0 +1,188 @@
+#include <unity.h>
+#include "Scheduler.h"
+#include "config.h"
+
+// The scheduler runs on the shim's virtual clock: sleeping advances it, and a
+// task "uses CPU" by advancing it too. Lateness, idle share and period jitter
+// then come out exactly, independent of the host machine.
+
+static uint32_t clockMs() { return hostMillis; }
+
+static uint32_t sleeps = 0;
+static void sleepMs(uint32_t ms) {
+  sleeps++;
+  hostMillis += ms;
+}
+
+static Scheduler* sched = nullptr;
+
+// Per-task cost and a log of when each task ran.
+static const uint8_t MAX_LOG = 200;
+struct Probe {
+  uint32_t costMs;
+  uint32_t runs;
+  uint32_t at[MAX_LOG];
+};
+static Probe probes[Scheduler::MAX_TASKS];
+
+static void record(uint8_t i, uint32_t now) {
+  Probe& p = probes[i];
+  if (p.runs < MAX_LOG) p.at[p.runs] = now;
+  p.runs++;
+  hostMillis += p.costMs;
+}
+
+static void task0(uint32_t now) { record(0, now); }
+static void task1(uint32_t now) { record(1, now); }
+static void task2(uint32_t now) { record(2, now); }
+static void task3(uint32_t now) { record(3, now); }
+
+// Runs the firmware's loop() for durationMs of virtual time.
+static void runFor(uint32_t durationMs) {
+  const uint32_t end = hostMillis + durationMs;
+  while ((int32_t)(hostMillis - end) < 0) {
+    sched->runDue();
+    sched->idle(SCHED_MAX_SLEEP_MS);
+  }
+}
+
+// Largest deviation of a task's run-to-run interval from its period.
+static uint32_t periodJitterMs(uint8_t i, uint32_t periodMs) {
+  const Probe& p = probes[i];
+  const uint32_t n = (p.runs < MAX_LOG) ? p.runs : MAX_LOG;
+  uint32_t worst = 0;
+  for (uint32_t k = 1; k < n; k++) {
+    const int32_t d = (int32_t)(p.at[k] - p.at[k - 1]) - (int32_t)periodMs;
+    const uint32_t a = (uint32_t)(d < 0 ? -d : d);
+    if (a > worst) worst = a;
+  }
+  return worst;
+}
+
+void setUp(void) {
+  hostMillis = 1000;
+  sleeps = 0;
+  memset(probes, 0, sizeof(probes));
+  delete sched;
+  sched = new Scheduler(clockMs, sleepMs);
+}
+
+void tearDown(void) {}
+
+static void test_idle_loop_sleeps_until_each_deadline(void) {
+  const uint8_t id = sched->every("hb_tx", HB_SEND_MS, task0);
+  runFor(10000);
+
+  const Scheduler::TaskStats st = sched->stats(id);
+  TEST_ASSERT_EQUAL_UINT32(20, st.runs);
+  TEST_ASSERT_EQUAL_UINT32(0, st.lateMaxMs);
+  TEST_ASSERT_EQUAL_UINT32(0, periodJitterMs(0, HB_SEND_MS));
+  // One sleep per deadline, not one per poll tick.
+  TEST_ASSERT_EQUAL_UINT32(20, sleeps);
+  TEST_ASSERT_EQUAL_UINT8(100, sched->idlePercent());
+}
+
+// The firmware's task mix with a cost per run. A task can only be late by
+// whatever was running when it fell due, so lateness and heartbeat jitter are
+// bounded by the longest run, and idle time is what the costs leave over.
+static void test_task_mix_lateness_idle_and_heartbeat_jitter(void) {
+  probes[1].costMs = 1;   // heartbeat RX drain
+  probes[2].costMs = 4;   // telemetry JSON + UDP
+  probes[3].costMs = 12;  // 1-Wire scratchpad reads, two buses
+
+  const uint8_t hbTx = sched->every("hb_tx", HB_SEND_MS, task0, 5);
+  sched->every("hb_rx", HB_POLL_MS, task1);
+  sched->every("telemetry", TELEMETRY_SEND_MS, task2);
+  sched->every("temp", 5000, task3, 3);
+  sched->resetStats();
+
+  const uint32_t durationMs = 60000;
+  runFor(durationMs);
+
+  uint32_t lateMax = 0;
+  for (uint8_t i = 0; i < sched->taskCount(); i++) {
+    const Scheduler::TaskStats st = sched->stats(i);
+    if (st.lateMaxMs > lateMax) lateMax = st.lateMaxMs;
+  }
+  TEST_ASSERT_TRUE(lateMax <= probes[3].costMs);
+  TEST_ASSERT_TRUE(periodJitterMs(0, HB_SEND_MS) <= probes[3].costMs);
+  TEST_ASSERT_EQUAL_UINT32(durationMs / HB_SEND_MS, sched->stats(hbTx).runs);
+
+  const uint32_t busyMs = probes[1].runs * probes[1].costMs
+                        + probes[2].runs * probes[2].costMs
+                        + probes[3].runs * probes[3].costMs;
+  const uint32_t expectIdle = 100 - (busyMs * 100 + durationMs - 1) / durationMs;
+  TEST_ASSERT_UINT32_WITHIN(1, expectIdle, sched->idlePercent());
+}
+
+static void test_wake_runs_task_on_next_pass(void) {
+  const uint8_t id = sched->every("telemetry", TELEMETRY_SEND_MS, task0, TELEMETRY_SEND_MS);
+  runFor(200);
+  TEST_ASSERT_EQUAL_UINT32(0, probes[0].runs);
+
+  sched->wake(id);
+  TEST_ASSERT_EQUAL_UINT32(0, sched->msUntilNext(SCHED_MAX_SLEEP_MS));
+  const uint32_t wokeAt = hostMillis;
+  sched->runDue();
+  TEST_ASSERT_EQUAL_UINT32(1, probes[0].runs);
+  TEST_ASSERT_EQUAL_UINT32(wokeAt, probes[0].at[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, sched->stats(id).lateMaxMs);
+}
+
+static void test_overrun_skips_ahead_instead_of_bursting(void) {
+  probes[0].costMs = 250;
+  probes[1].costMs = 0;
+  sched->every("slow", 1000, task0);
+  sched->every("fast", 100, task1);
+  runFor(5000);
+
+  // The 100 ms task is held off by each 250 ms run, then resumes its period
+  // rather than firing the missed runs back to back.
+  for (uint32_t k = 1; k < probes[1].runs; k++) {
+    TEST_ASSERT_TRUE(probes[1].at[k] - probes[1].at[k - 1] >= 100);
+  }
+  TEST_ASSERT_TRUE(sched->stats(1).lateMaxMs <= probes[0].costMs);
+}
+
+static uint8_t oneShotId = Scheduler::INVALID_TASK;
+static void rescheduling(uint32_t now) {
+  record(0, now);
+  if (probes[0].runs < 3) sched->schedule(oneShotId, 750);
+}
+
+static void test_one_shot_reschedules_and_cancels(void) {
+  oneShotId = sched->once("temp", 0, rescheduling);
+  runFor(5000);
+  TEST_ASSERT_EQUAL_UINT32(3, probes[0].runs);
+  TEST_ASSERT_EQUAL_UINT32(750, probes[0].at[1] - probes[0].at[0]);
+  TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_SLEEP_MS, sched->msUntilNext(SCHED_MAX_SLEEP_MS));
+
+  const uint8_t id = sched->every("periodic", 100, task1);
+  sched->cancel(id);
+  runFor(1000);
+  TEST_ASSERT_EQUAL_UINT32(0, probes[1].runs);
+}
+
+static void test_reset_stats_starts_a_new_window(void) {
+  probes[0].costMs = 50;
+  const uint8_t id = sched->every("busy", 100, task0);
+  runFor(1000);
+  TEST_ASSERT_UINT32_WITHIN(1, 50, sched->idlePercent());
+
+  sched->resetStats();
+  TEST_ASSERT_EQUAL_UINT32(0, sched->stats(id).runs);
+  probes[0].costMs = 0;
+  runFor(1000);
+  TEST_ASSERT_UINT32_WITHIN(1, 100, sched->idlePercent());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_loop_sleeps_until_each_deadline);
+  RUN_TEST(test_task_mix_lateness_idle_and_heartbeat_jitter);
+  RUN_TEST(test_wake_runs_task_on_next_pass);
+  RUN_TEST(test_overrun_skips_ahead_instead_of_bursting);
+  RUN_TEST(test_one_shot_reschedules_and_cancels);
+  RUN_TEST(test_reset_stats_starts_a_new_window);
+  return UNITY_END();
+}
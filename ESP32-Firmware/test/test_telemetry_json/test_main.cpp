@@ -0,0 +1,119 @@
+#include <unity.h>
+#include "TelemetryJson.h"
+
+static const float COOL[TemperatureBus::SENSORS_PER_BUS] = {21.234f, 22.0f, NAN};
+static const float EXHAUST[TemperatureBus::SENSORS_PER_BUS] = {30.5f, 31.0f, 33.0f};
+
+// One Ethernet frame's UDP payload.
+static const size_t MAX_DATAGRAM = 1472;
+
+static char out[2048];
+static char extra[1024];
+
+void setUp(void) {
+  out[0] = '\0';
+  extra[0] = '\0';
+}
+
+void tearDown(void) {}
+
+static void test_temp_array_formats_and_nulls(void) {
+  appendTempArray(out, sizeof(out), COOL);
+  TEST_ASSERT_EQUAL_STRING("[21.23, 22.00, null]", out);
+}
+
+static void test_temp_array_appends_and_truncates(void) {
+  char small[12] = "x=";
+  appendTempArray(small, sizeof(small), EXHAUST);
+  TEST_ASSERT_EQUAL_STRING("x=[30.50, 3", small);
+}
+
+static void test_envelope_fields(void) {
+  buildTelemetryJson(out, sizeof(out), "AA:BB:CC:DD:EE:FF", 'B', 42,
+                     5000000000ULL, 1700000000123ULL, 7,
+                     true, false, COOL, EXHAUST, false, "", "");
+
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"mac\": \"AA:BB:CC:DD:EE:FF\""));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"controller\": \"B\""));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"seq\": 42,"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"timestamp_device_ms\": 5000000000,"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"timestamp_epoch_ms\": 1700000000123,"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"timestamp_uncertainty_ms\": 7,"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"controller_a_alive\": true"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"controller_b_alive\": false"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"temperatures_c\": [21.23, 22.00, null]"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"temperatures_c\": [30.50, 31.00, 33.00]"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"occurred\": false"));
+}
+
+static void test_unsynced_epoch_is_null(void) {
+  buildTelemetryJson(out, sizeof(out), "AA:BB:CC:DD:EE:FF", 'A', 0,
+                     1, 0, 0, true, true, COOL, EXHAUST, false, "", "");
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"timestamp_epoch_ms\": null,"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"timestamp_uncertainty_ms\": null,"));
+}
+
+static void test_details_are_escaped(void) {
+  buildTelemetryJson(out, sizeof(out), "AA:BB:CC:DD:EE:FF", 'A', 0,
+                     1, 0, 0, true, true, COOL, EXHAUST, true, "say \"hi\"\n", "");
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"details\": \"say 'hi' \""));
+}
+
+static void test_small_buffer_stays_terminated(void) {
+  char small[64];
+  memset(small, 'x', sizeof(small));
+  buildTelemetryJson(small, sizeof(small), "AA:BB:CC:DD:EE:FF", 'A', 0,
+                     1, 0, 0, true, true, COOL, EXHAUST, false, "", "");
+  TEST_ASSERT_EQUAL_UINT32(sizeof(small) - 1, strlen(small));
+}
+
+static void test_items_json_drops_leading_separator(void) {
+  TelemetryCounters c = {1, 2, 3, 4};
+  formatCountersItem(extra, sizeof(extra), c);
+  buildItemsJson(out, sizeof(out), "AA:BB:CC:DD:EE:FF", 'A', 9, 1, 0, 0, extra);
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"items\": [\n    {\n      \"kind\": \"counters\""));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"udp_send_failures\": 4"));
+}
+
+static void test_membership_lists_self_and_peers(void) {
+  Heartbeat::Peer peers[2] = {{'B', 900, 3, 'A'}, {'C', 100, 3, 'A'}};
+  formatMembershipItem(extra, sizeof(extra), 'A', 'A', 3, peers, 2, 1000, 500);
+  TEST_ASSERT_NOT_NULL(strstr(extra, "{\"id\": \"A\", \"alive\": true, \"age_ms\": 0"));
+  TEST_ASSERT_NOT_NULL(strstr(extra, "{\"id\": \"B\", \"alive\": true, \"age_ms\": 100"));
+  TEST_ASSERT_NOT_NULL(strstr(extra, "{\"id\": \"C\", \"alive\": false, \"age_ms\": 900"));
+}
+
+static void test_worst_case_fits_one_frame(void) {
+  // Widest value in every field, full peer table, longest failover text.
+  Heartbeat::Peer peers[Heartbeat::MAX_PEERS];
+  for (uint8_t i = 0; i < Heartbeat::MAX_PEERS; i++) {
+    peers[i] = {(char)('B' + i), 1, 200, 'A'};
+  }
+  const float cool[3] = {-55.55f, -55.55f, -55.55f};
+  const float hot[3] = {125.0f, 125.0f, 125.0f};
+  TelemetryCounters c = {4000000000u, 4000000000u, 4000000000u, 4000000000u};
+
+  size_t used = formatCountersItem(extra, sizeof(extra), c);
+  formatMembershipItem(extra + used, sizeof(extra) - used, 'A', 'A', 200,
+                       peers, Heartbeat::MAX_PEERS, 4000000000u, 2000);
+  buildTelemetryJson(out, sizeof(out), "AA:BB:CC:DD:EE:FF", 'D', 4000000000u,
+                     18446744073709551615ULL, 18446744073709551615ULL, 4000000000u,
+                     true, true, cool, hot, true,
+                     "D took over from A after 4294967295 ms heartbeat silence (term 255)",
+                     extra);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_DATAGRAM, strlen(out));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_temp_array_formats_and_nulls);
+  RUN_TEST(test_temp_array_appends_and_truncates);
+  RUN_TEST(test_envelope_fields);
+  RUN_TEST(test_unsynced_epoch_is_null);
+  RUN_TEST(test_details_are_escaped);
+  RUN_TEST(test_small_buffer_stays_terminated);
+  RUN_TEST(test_items_json_drops_leading_separator);
+  RUN_TEST(test_membership_lists_self_and_peers);
+  RUN_TEST(test_worst_case_fits_one_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include "TemperatureBus.h"
+#include "FakeSensorBus.h"
+
+static FakeSensorBus intake;
+static FakeSensorBus exhaust;
+static TemperatureBus bus;
+
+// Runs tick() exactly when msUntilNextStep() says it has work, the way the
+// firmware's temp task does. Returns the time after the step.
+static uint32_t step(uint32_t now) {
+  now += bus.msUntilNextStep(now);
+  bus.tick(now);
+  return now;
+}
+
+void setUp(void) {
+  intake = FakeSensorBus();
+  exhaust = FakeSensorBus();
+  exhaust.temps[0] = 30.0f;
+  exhaust.temps[1] = 31.0f;
+  exhaust.temps[2] = 32.0f;
+  bus = TemperatureBus();
+  TEST_ASSERT_TRUE(bus.begin(intake, exhaust));
+}
+
+void tearDown(void) {}
+
+static void test_begin_initialises_both_buses(void) {
+  TEST_ASSERT_EQUAL_UINT32(1, intake.begins);
+  TEST_ASSERT_EQUAL_UINT32(1, exhaust.begins);
+  TEST_ASSERT_EQUAL_UINT8(3, bus.intakeDeviceCount());
+  TEST_ASSERT_EQUAL_UINT8(3, bus.exhaustDeviceCount());
+  TEST_ASSERT_FALSE(bus.ready());
+  TEST_ASSERT_FLOAT_IS_NAN(bus.intakeC(0));
+}
+
+static void test_first_cycle_requests_then_reads(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, bus.msUntilNextStep(0));
+  bus.tick(0);
+  TEST_ASSERT_EQUAL_UINT32(1, intake.requests);
+  TEST_ASSERT_EQUAL_UINT32(1, exhaust.requests);
+
+  // Waits out the 750 ms DS18B20 conversion, not a moment less.
+  TEST_ASSERT_EQUAL_UINT32(750, bus.msUntilNextStep(0));
+  TEST_ASSERT_EQUAL_UINT32(1, bus.msUntilNextStep(749));
+  bus.tick(749);
+  TEST_ASSERT_EQUAL_UINT32(0, intake.reads);
+
+  uint32_t now = step(749);     // REQUESTED -> READ_READY
+  TEST_ASSERT_FALSE(bus.hasNewSample());
+  now = step(now);              // READ_READY -> read
+  TEST_ASSERT_EQUAL_UINT32(750, now);
+  TEST_ASSERT_TRUE(bus.hasNewSample());
+  TEST_ASSERT_TRUE(bus.ready());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.0f, bus.intakeC(0));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 23.0f, bus.intakeC(2));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 32.0f, bus.exhaustC(2));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 30.0f, bus.exhaustC());
+
+  bus.clearNewSampleFlag();
+  TEST_ASSERT_FALSE(bus.hasNewSample());
+}
+
+static void test_samples_every_five_seconds(void) {
+  uint32_t now = 0;
+  now = step(now);
+  now = step(now);
+  now = step(now);
+  const uint32_t firstSample = now;
+
+  TEST_ASSERT_EQUAL_UINT32(5000, bus.msUntilNextStep(now));
+  now = step(now);
+  TEST_ASSERT_EQUAL_UINT32(firstSample + 5000, now);
+  TEST_ASSERT_EQUAL_UINT32(2, intake.requests);
+}
+
+static void test_missing_and_disconnected_sensors_read_nan(void) {
+  intake.devices = 2;
+  exhaust.temps[1] = -127.0f;   // DEVICE_DISCONNECTED_C
+
+  uint32_t now = 0;
+  now = step(now);
+  now = step(now);
+  step(now);
+
+  TEST_ASSERT_EQUAL_UINT8(2, bus.intakeDeviceCount());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 22.0f, bus.intakeC(1));
+  TEST_ASSERT_FLOAT_IS_NAN(bus.intakeC(2));
+  TEST_ASSERT_FLOAT_IS_NAN(bus.exhaustC(1));
+  TEST_ASSERT_FLOAT_IS_NAN(bus.intakeC(7));
+}
+
+static void test_rescans_each_cycle(void) {
+  uint32_t now = 0;
+  for (int i = 0; i < 3; i++) {
+    now = step(now);
+    now = step(now);
+    now = step(now);
+  }
+  // begin() + once per sample request
+  TEST_ASSERT_EQUAL_UINT32(4, intake.scans);
+
+  intake.devices = 0;
+  now = step(now);
+  now = step(now);
+  step(now);
+  TEST_ASSERT_EQUAL_UINT8(0, bus.intakeDeviceCount());
+  TEST_ASSERT_FALSE(bus.ready());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_initialises_both_buses);
+  RUN_TEST(test_first_cycle_requests_then_reads);
+  RUN_TEST(test_samples_every_five_seconds);
+  RUN_TEST(test_missing_and_disconnected_sensors_read_nan);
+  RUN_TEST(test_rescans_each_cycle);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// Liveness tracking cost at fleet scale, on a simulated clock.
+//
+// Every device reports every --interval-ms, phases spread evenly; the
+// tracker is advanced every --tick-ms, as the ingest would. Halfway through,
+// --fail-pct of the devices go silent. Wall time is measured around the
+// onPacket() batches (updates/s) and each advance() call; expiry latency is
+// simulated time from a device's deadline to the advance() that reported it.
+// Prints one CSV line:
+//   devices,updates,updates_per_s,ns_per_update,advance_p99_us,advance_max_us,expired,max_expiry_latency_ms
+//
+//   bench_liveness [--devices N] [--interval-ms I] [--timeout-ms T]
+//                  [--tick-ms K] [--sim-s S] [--fail-pct P]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "LivenessTracker.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int devices = 100000;
+  int intervalMs = 5000;
+  int timeoutMs = 15000;
+  int tickMs = 100;
+  int simS = 120;
+  int failPct = 1;
+};
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const int v = atoi(argv[i + 1]);
+    if (!strcmp(k, "--devices")) o.devices = std::max(v, 2);
+    else if (!strcmp(k, "--interval-ms")) o.intervalMs = std::max(v, 1);
+    else if (!strcmp(k, "--timeout-ms")) o.timeoutMs = std::max(v, 1);
+    else if (!strcmp(k, "--tick-ms")) o.tickMs = std::max(v, 1);
+    else if (!strcmp(k, "--sim-s")) o.simS = std::max(v, 1);
+    else if (!strcmp(k, "--fail-pct")) o.failPct = std::min(std::max(v, 0), 100);
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+
+  const int64_t t0 = 1760000000000LL;
+  LivenessTracker tracker((uint32_t)o.timeoutMs, (uint32_t)o.tickMs, t0);
+  for (int i = 0; i < o.devices; i++) {
+    // Two controllers per rack.
+    tracker.addDevice(0x246F28000000ULL + (uint64_t)i, "rack-" + std::to_string(i / 2), (i % 2) ? 'B' : 'A');
+  }
+
+  // Devices sorted by their phase within the interval, so each tick
+  // delivers a contiguous run.
+  std::vector<int64_t> phase((size_t)o.devices);
+  for (int i = 0; i < o.devices; i++) phase[(size_t)i] = ((int64_t)i * o.intervalMs / o.devices);
+  const int failEvery = o.failPct ? 100 / o.failPct : 0;
+  auto failed = [&](int i) { return failEvery && i % failEvery == 0; };
+
+  const int64_t end = t0 + (int64_t)o.simS * 1000;
+  const int64_t failAt = t0 + (int64_t)o.simS * 500;
+  uint64_t updates = 0;
+  double updateSecs = 0;
+  std::vector<double> advanceUs;
+  uint64_t expired = 0;
+  int64_t maxLatencyMs = 0;
+  std::vector<LivenessTracker::Event> events;
+
+  for (int64_t now = t0; now < end; now += o.tickMs) {
+    const Clock::time_point u0 = Clock::now();
+    // Packets whose send time falls in (now - tick, now].
+    const int64_t lo = now - o.tickMs, hi = now;
+    for (int64_t k = lo / o.intervalMs; k * o.intervalMs <= hi; k++) {
+      const int64_t base = k * o.intervalMs;
+      const int first = (int)(std::upper_bound(phase.begin(), phase.end(), lo - base) - phase.begin());
+      for (int i = first; i < o.devices; i++) {
+        const int64_t t = base + phase[(size_t)i];
+        if (t > hi) break;
+        if (t >= failAt && failed(i)) continue;
+        tracker.onPacket(0x246F28000000ULL + (uint64_t)i, t, (i % 2) == 0);
+        updates++;
+      }
+    }
+    const Clock::time_point u1 = Clock::now();
+    updateSecs += std::chrono::duration<double>(u1 - u0).count();
+
+    tracker.advance(now);
+    advanceUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - u1).count());
+
+    events.clear();
+    tracker.takeEvents(events);
+    for (const LivenessTracker::Event& e : events) {
+      if (e.type != LivenessTracker::EventType::DEVICE_DOWN) continue;
+      expired++;
+      maxLatencyMs = std::max(maxLatencyMs, now - e.tMs);
+    }
+  }
+
+  std::sort(advanceUs.begin(), advanceUs.end());
+  const double p99 = advanceUs[advanceUs.size() * 99 / 100];
+  std::printf("devices,updates,updates_per_s,ns_per_update,advance_p99_us,advance_max_us,expired,max_expiry_latency_ms\n");
+  std::printf("%d,%llu,%.0f,%.1f,%.1f,%.1f,%llu,%lld\n", o.devices, (unsigned long long)updates,
+              (double)updates / updateSecs, 1e9 * updateSecs / (double)std::max<uint64_t>(updates, 1), p99,
+              advanceUs.back(), (unsigned long long)expired, (long long)maxLatencyMs);
+
+  // Every silenced device must have been reported, within one tick.
+  uint64_t silenced = 0;
+  for (int i = 0; i < o.devices; i++) silenced += failed(i);
+  const bool timedOut = failAt + o.intervalMs + o.timeoutMs + o.tickMs < end;
+  if (timedOut && expired != silenced) return 1;
+  if (maxLatencyMs > o.tickMs) return 1;
+  return 0;
+}
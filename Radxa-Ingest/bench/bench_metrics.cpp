@@ -0,0 +1,243 @@
+// Cost of the metrics instrumentation on the ingest path.
+//
+// Each thread plays a receive thread over a pool of firmware-sized telemetry
+// datagrams: parse the envelope (parseTelemetryFields) and resolve the rack
+// (RackMap), 64 datagrams per simulated recvmmsg batch. The instrumented
+// variant also does what the ingest path records: packets and bytes per
+// thread, parse failures, unknown MACs, and the batch's processing time
+// into a histogram. Meanwhile a scraper thread renders the registry every
+// --scrape-ms.
+//
+// A throughput difference of 2% is far below the run-to-run noise of a
+// shared host, so the two variants alternate batch by batch in the same
+// thread, each batch timed on its own, and the per-batch times are compared
+// at their 10th and 50th percentiles: interference only ever adds time, and
+// it hits both variants alike. The scrape runs on its own thread and is
+// reported separately, as a share of one core. Prints one CSV line per
+// thread count:
+//   threads,plain_pps,metrics_pps,overhead_pct,overhead_p50_pct,scrape_us,scrape_core_pct
+// where the rates and overhead_pct come from the 10th percentiles. Exits 1
+// if overhead_pct is above --max-overhead-pct.
+//
+//   bench_metrics [--duration-ms D] [--max-threads T] [--scrape-ms S]
+//                 [--max-overhead-pct P]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mac.h"
+#include "Metrics.h"
+#include "RackMap.h"
+#include "RackTable.h"
+#include "TelemetryFields.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int durationMs = 2000;
+  int maxThreads = 0;   // 0 = hardware threads
+  int scrapeMs = 1000;
+  double maxOverheadPct = 2.0;
+};
+
+static constexpr int DEVICES = 10000;
+static constexpr size_t POOL = 1024;
+static constexpr size_t BATCH = 64;
+
+// A telemetry message as the firmware sends it (heartbeat, sensors, counters).
+static std::string datagram(uint64_t mac, uint32_t seq) {
+  char text[18];
+  formatMac(mac, text);
+  char buf[1024];
+  std::snprintf(buf, sizeof(buf),
+                "{\"message_type\": \"telemetry\", \"device\": {\"mac\": \"%s\", \"controller\": \"A\"}, "
+                "\"seq\": %u, \"timestamp_device_ms\": %u, \"timestamp_epoch_ms\": 1760000000%03u, "
+                "\"timestamp_uncertainty_ms\": 3, \"items\": [{\"kind\": \"heartbeat\", "
+                "\"controller_a_alive\": true, \"controller_b_alive\": true}, {\"kind\": \"sensors\", "
+                "\"readings\": [{\"bus\": 0, \"rom\": \"28FF4C6A91160301\", \"temp_c\": 24.5}, {\"bus\": 0, "
+                "\"rom\": \"28FF4C6A91160302\", \"temp_c\": 26.1}, {\"bus\": 1, \"temp_c\": 25.0, "
+                "\"humidity_pct\": 41.2}]}, {\"kind\": \"counters\", \"udp_sent\": %u, \"udp_failed\": 0, "
+                "\"sensor_errors\": 1, \"link_switches\": 0}]}",
+                text, seq, seq * 1000, seq % 1000, seq);
+  return buf;
+}
+
+struct Recorders {
+  Metrics::Counter* packets;
+  Metrics::Counter* bytes;
+  Metrics::Counter* parseFailed;
+  Metrics::Counter* unknown;
+  Metrics::Histogram* batchNs;
+};
+
+// One receive batch starting at datagram first; returns its time in ns.
+template <bool INSTRUMENTED>
+static uint64_t batch(RackMap& map, RackMap::Reader& reader, const std::vector<std::string>& pool, size_t first,
+                      const Recorders& m, uint64_t& sink) {
+  const Clock::time_point t0 = Clock::now();
+  {
+    RackMap::ReadSection s(map, reader);
+    for (size_t i = 0; i < BATCH; i++) {
+      const std::string& d = pool[(first + i) & (POOL - 1)];
+      if (INSTRUMENTED) {
+        m.packets->add();
+        m.bytes->add(d.size());
+      }
+      TelemetryFields f;
+      if (!parseTelemetryFields(d.data(), d.size(), f)) {
+        if (INSTRUMENTED) m.parseFailed->add();
+        continue;
+      }
+      const char* rack = s.rackId(f.mac);
+      if (INSTRUMENTED && rack == RackMap::UNKNOWN) m.unknown->add();
+      sink += f.seq + (uintptr_t)rack;
+    }
+  }
+  const uint64_t ns = (uint64_t)std::chrono::nanoseconds(Clock::now() - t0).count();
+  if (INSTRUMENTED) m.batchNs->record(ns);
+  return ns;
+}
+
+static double percentile(std::vector<uint64_t>& v, double p) {
+  std::sort(v.begin(), v.end());
+  return (double)v[(size_t)(p / 100.0 * (double)(v.size() - 1))];
+}
+
+struct Run {
+  double plainP10, metricsP10;
+  double plainP50, metricsP50;
+  double scrapeUs;
+};
+
+static Run runOnce(const Options& o, int threads, RackMap& map, std::vector<RackMap::Reader*>& readers,
+                   const std::vector<std::string>& pool, Metrics& metrics, std::vector<Recorders>& recorders) {
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> sink{0};
+  std::vector<std::vector<uint64_t>> plain((size_t)threads), instrumented((size_t)threads);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      RackMap::Reader& r = *readers[(size_t)t];
+      const Recorders& m = recorders[(size_t)t];
+      std::vector<uint64_t>& p = plain[(size_t)t];
+      std::vector<uint64_t>& q = instrumented[(size_t)t];
+      while (!go.load(std::memory_order_acquire)) {}
+      uint64_t h = 0;
+      // Warm-up, then the two variants over the same datagrams, taking turns
+      // to go first (the second finds them in cache).
+      for (size_t first = 0; first < POOL; first += BATCH) batch<true>(map, r, pool, first, m, h);
+      for (size_t first = 0; !stop.load(std::memory_order_relaxed); first += BATCH) {
+        if ((first / BATCH) & 1) {
+          p.push_back(batch<false>(map, r, pool, first, m, h));
+          q.push_back(batch<true>(map, r, pool, first, m, h));
+        } else {
+          q.push_back(batch<true>(map, r, pool, first, m, h));
+          p.push_back(batch<false>(map, r, pool, first, m, h));
+        }
+      }
+      sink += h;
+    });
+  }
+
+  const Clock::time_point end = Clock::now() + std::chrono::milliseconds(o.durationMs);
+  go.store(true, std::memory_order_release);
+  std::string page;
+  double scrapeUs = 0;
+  while (Clock::now() < end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(o.scrapeMs, o.durationMs)));
+    page.clear();
+    const Clock::time_point s0 = Clock::now();
+    metrics.render(page);
+    scrapeUs = std::max(scrapeUs, std::chrono::duration<double, std::micro>(Clock::now() - s0).count());
+  }
+  stop = true;
+  for (std::thread& w : workers) w.join();
+  if (sink.load() == 1) std::printf("#\n");
+
+  std::vector<uint64_t> p, q;
+  for (int t = 0; t < threads; t++) {
+    p.insert(p.end(), plain[(size_t)t].begin(), plain[(size_t)t].end());
+    q.insert(q.end(), instrumented[(size_t)t].begin(), instrumented[(size_t)t].end());
+  }
+  Run r;
+  r.plainP10 = percentile(p, 10);
+  r.metricsP10 = percentile(q, 10);
+  r.plainP50 = percentile(p, 50);
+  r.metricsP50 = percentile(q, 50);
+  r.scrapeUs = scrapeUs;
+  return r;
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const char* v = argv[i + 1];
+    if (!strcmp(k, "--duration-ms")) o.durationMs = std::max(atoi(v), 10);
+    else if (!strcmp(k, "--max-threads")) o.maxThreads = atoi(v);
+    else if (!strcmp(k, "--scrape-ms")) o.scrapeMs = std::max(atoi(v), 1);
+    else if (!strcmp(k, "--max-overhead-pct")) o.maxOverheadPct = atof(v);
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  if (o.maxThreads <= 0) o.maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+  // 10% of datagrams come from unmapped boards, 1% are not telemetry at all.
+  std::unique_ptr<RackTable> table(new RackTable());
+  for (int i = 0; i < DEVICES; i++) table->insert(0x246F28000000ULL + (uint64_t)i, "rack-" + std::to_string(i / 2));
+  RackMap map;
+  map.publish(std::move(table));
+  std::vector<std::string> pool;
+  uint32_t rng = 0x9E3779B9u;
+  for (size_t i = 0; i < POOL; i++) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    if (rng % 100 == 0) {
+      pool.push_back("{\"message_type\": \"time_request\", \"t0_ms\": 1760000000000}");
+    } else {
+      const bool unknown = rng % 100 < 11;
+      pool.push_back(datagram(unknown ? 0x02AB00000000ULL + rng : 0x246F28000000ULL + rng % DEVICES, (uint32_t)i));
+    }
+  }
+
+  std::vector<RackMap::Reader*> readers;
+  for (int t = 0; t < o.maxThreads; t++) readers.push_back(map.addReader());
+
+  std::printf("threads,plain_pps,metrics_pps,overhead_pct,overhead_p50_pct,scrape_us,scrape_core_pct\n");
+  bool ok = true;
+  for (int t = 1; t <= o.maxThreads; t *= 2) {
+    Metrics metrics;
+    std::vector<Recorders> recorders;
+    for (int i = 0; i < t; i++) {
+      const std::string thread = Metrics::label("thread", std::to_string(i));
+      recorders.push_back({&metrics.counter("ingest_packets_total", "Datagrams received.", thread),
+                           &metrics.counter("ingest_bytes_total", "Datagram bytes received.", thread),
+                           &metrics.counter("ingest_parse_failures_total", "Datagrams that did not parse.",
+                                            "reason=\"not_telemetry\""),
+                           &metrics.counter("ingest_unknown_mac_total", "Datagrams from unmapped MACs."),
+                           &metrics.histogram("ingest_batch_seconds", "Processing time of one receive batch.")});
+    }
+
+    const Run r = runOnce(o, t, map, readers, pool, metrics, recorders);
+    const double overhead = 100.0 * (r.metricsP10 - r.plainP10) / r.plainP10;
+    const double overheadP50 = 100.0 * (r.metricsP50 - r.plainP50) / r.plainP50;
+    std::printf("%d,%.0f,%.0f,%.2f,%.2f,%.0f,%.3f\n", t, 1e9 * BATCH * t / r.plainP10,
+                1e9 * BATCH * t / r.metricsP10, overhead, overheadP50, r.scrapeUs,
+                100.0 * r.scrapeUs / (1000.0 * o.scrapeMs));
+    if (overhead > o.maxOverheadPct) ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// MAC -> rack_id lookups per second while the mapping is being reloaded.
+//
+// Reader threads play receive threads: each resolves one MAC per simulated
+// packet inside its own ReadSection, over a mix of mapped and unknown
+// devices. Meanwhile a reload thread rebuilds the table and publishes it
+// every --reload-ms. Prints one CSV line per thread count:
+//   threads,lookups_per_s,ns_per_lookup,reloads,max_publish_us
+//
+//   bench_rack_map [--devices N] [--unknown-pct P] [--duration-ms D]
+//                  [--reload-ms R] [--max-threads T]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mac.h"
+#include "RackMap.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int devices = 100000;
+  int unknownPct = 10;
+  int durationMs = 1000;
+  int reloadMs = 10;
+  int maxThreads = 0;   // 0 = hardware threads
+};
+
+static std::unique_ptr<RackTable> buildTable(int devices, int version) {
+  std::unique_ptr<RackTable> t(new RackTable());
+  for (int i = 0; i < devices; i++) {
+    // Two controllers per rack; the version makes every reload a real change.
+    t->insert(0x246F28000000ULL + (uint64_t)i, "rack-" + std::to_string(i / 2 + version % 2));
+  }
+  return t;
+}
+
+struct Run {
+  double lookupsPerS;
+  double nsPerLookup;
+  uint64_t reloads;
+  double maxPublishUs;
+};
+
+static Run runOnce(const Options& o, int threads) {
+  RackMap map;
+  map.publish(buildTable(o.devices, 0));
+
+  // Pre-generated MAC stream per thread so the loop measures the lookup only.
+  const size_t STREAM = 1 << 16;
+  std::vector<std::vector<uint64_t>> streams((size_t)threads);
+  for (int t = 0; t < threads; t++) {
+    uint32_t rng = 0x9E3779B9u * (uint32_t)(t + 1);
+    streams[(size_t)t].resize(STREAM);
+    for (uint64_t& mac : streams[(size_t)t]) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      const bool unknown = (int)(rng % 100) < o.unknownPct;
+      mac = unknown ? 0x02AB00000000ULL + rng : 0x246F28000000ULL + rng % (uint32_t)o.devices;
+    }
+  }
+
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> sink{0};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < threads; t++) {
+    RackMap::Reader* r = map.addReader();
+    const std::vector<uint64_t>* macs = &streams[(size_t)t];
+    readers.emplace_back([&, r, macs] {
+      while (!go.load(std::memory_order_acquire)) {}
+      uint64_t n = 0;
+      uint64_t h = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < 1024; i++) {
+          RackMap::ReadSection s(map, *r);
+          h += (uintptr_t)s.rackId((*macs)[(n + i) & (STREAM - 1)]);
+        }
+        n += 1024;
+      }
+      total += n;
+      sink += h;
+    });
+  }
+
+  uint64_t reloads = 0;
+  double maxPublishUs = 0;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end = start + std::chrono::milliseconds(o.durationMs);
+  go.store(true, std::memory_order_release);
+
+  while (Clock::now() < end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(o.reloadMs));
+    std::unique_ptr<RackTable> next = buildTable(o.devices, (int)reloads + 1);
+    const Clock::time_point p0 = Clock::now();
+    map.publish(std::move(next));
+    const double us = std::chrono::duration<double, std::micro>(Clock::now() - p0).count();
+    maxPublishUs = std::max(maxPublishUs, us);
+    reloads++;
+  }
+  stop = true;
+  for (std::thread& t : readers) t.join();
+  const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Run r;
+  r.lookupsPerS = (double)total.load() / secs;
+  r.nsPerLookup = 1e9 * secs * threads / (double)std::max<uint64_t>(total.load(), 1);
+  r.reloads = reloads;
+  r.maxPublishUs = maxPublishUs;
+  if (sink.load() == 1) std::printf("#\n");
+  return r;
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const int v = atoi(argv[i + 1]);
+    if (!strcmp(k, "--devices")) o.devices = std::max(v, 1);
+    else if (!strcmp(k, "--unknown-pct")) o.unknownPct = v;
+    else if (!strcmp(k, "--duration-ms")) o.durationMs = v;
+    else if (!strcmp(k, "--reload-ms")) o.reloadMs = std::max(v, 1);
+    else if (!strcmp(k, "--max-threads")) o.maxThreads = v;
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  if (o.maxThreads <= 0) o.maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("threads,lookups_per_s,ns_per_lookup,reloads,max_publish_us\n");
+  for (int t = 1; t <= o.maxThreads; t *= 2) {
+    const Run r = runOnce(o, t);
+    std::printf("%d,%.0f,%.1f,%llu,%.0f\n", t, r.lookupsPerS, r.nsPerLookup,
+                (unsigned long long)r.reloads, r.maxPublishUs);
+    if (r.reloads == 0) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+// WAL throughput and enqueue latency with several receive threads.
+//
+// Producer threads append fixed 64-byte records (about one decoded sensor
+// row) as fast as the WAL takes them for --duration-ms, yielding and retrying
+// when the queue is full; every 16th append() call is timed. That is the
+// cost a receive thread pays per record.
+// The WAL lives in a fresh directory under --dir, removed afterwards. Prints
+// one CSV line per producer count:
+//   producers,records_per_s,enqueue_p50_ns,enqueue_p99_ns,enqueue_max_ns,fsyncs,records_per_fsync,queue_full
+// records_per_s counts records made durable, not just queued; queue_full
+// counts appends refused because the writer was behind.
+//
+//   bench_wal [--duration-ms D] [--max-producers P] [--delay-us U]
+//             [--batch-kb K] [--dir /tmp]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Wal.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int durationMs = 1000;
+  int maxProducers = 0;  // 0 = hardware threads
+  int delayUs = 2000;
+  int batchKb = 1024;
+  std::string dir = "/tmp";
+};
+
+struct Run {
+  double recordsPerS;
+  double p50Ns, p99Ns, maxNs;
+  uint64_t fsyncs;
+  uint64_t records;
+  uint64_t dropped;
+};
+
+static Run runOnce(const Options& o, int producers) {
+  std::string tmpl = o.dir + "/bench_wal_XXXXXX";
+  std::vector<char> path(tmpl.begin(), tmpl.end());
+  path.push_back(0);
+  if (!mkdtemp(path.data())) {
+    std::perror("mkdtemp");
+    std::exit(1);
+  }
+
+  WalWriter::Options wo;
+  wo.dir = path.data();
+  wo.maxDelayUs = (uint32_t)o.delayUs;
+  wo.maxBatchBytes = (size_t)o.batchKb * 1024;
+  WalWriter w(wo);
+  if (!w.open()) {
+    std::fprintf(stderr, "cannot open WAL in %s\n", path.data());
+    std::exit(1);
+  }
+
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<uint32_t>> samples((size_t)producers);
+  std::vector<std::thread> threads;
+  const Clock::time_point start = Clock::now();
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p] {
+      uint8_t rec[64];
+      std::memset(rec, 'a' + p, sizeof(rec));
+      std::vector<uint32_t>& s = samples[(size_t)p];
+      s.reserve(1 << 20);
+      for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); i++) {
+        std::memcpy(rec, &i, sizeof(i));
+        bool ok;
+        if ((i & 15) == 0) {
+          const Clock::time_point t0 = Clock::now();
+          ok = w.append(rec, sizeof(rec));
+          s.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        } else {
+          ok = w.append(rec, sizeof(rec));
+        }
+        if (!ok) std::this_thread::yield();
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(o.durationMs));
+  stop = true;
+  for (std::thread& t : threads) t.join();
+  w.close();
+  const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint32_t> all;
+  for (const auto& s : samples) all.insert(all.end(), s.begin(), s.end());
+  std::sort(all.begin(), all.end());
+  const WalWriter::Stats st = w.stats();
+
+  Run r;
+  r.recordsPerS = (double)st.records / secs;
+  r.p50Ns = all.empty() ? 0 : all[all.size() / 2];
+  r.p99Ns = all.empty() ? 0 : all[all.size() * 99 / 100];
+  r.maxNs = all.empty() ? 0 : all.back();
+  r.fsyncs = st.batches;
+  r.records = st.records;
+  r.dropped = st.dropped;
+
+  const std::string cmd = std::string("rm -rf '") + path.data() + "'";
+  if (std::system(cmd.c_str()) != 0) std::fprintf(stderr, "could not remove %s\n", path.data());
+  return r;
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const char* v = argv[i + 1];
+    if (!strcmp(k, "--duration-ms")) o.durationMs = std::max(atoi(v), 1);
+    else if (!strcmp(k, "--max-producers")) o.maxProducers = atoi(v);
+    else if (!strcmp(k, "--delay-us")) o.delayUs = std::max(atoi(v), 0);
+    else if (!strcmp(k, "--batch-kb")) o.batchKb = std::max(atoi(v), 1);
+    else if (!strcmp(k, "--dir")) o.dir = v;
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  if (o.maxProducers <= 0) o.maxProducers = (int)std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("producers,records_per_s,enqueue_p50_ns,enqueue_p99_ns,enqueue_max_ns,fsyncs,records_per_fsync,queue_full\n");
+  for (int p = 1; p <= o.maxProducers; p *= 2) {
+    const Run r = runOnce(o, p);
+    std::printf("%d,%.0f,%.0f,%.0f,%.0f,%llu,%.1f,%llu\n", p, r.recordsPerS, r.p50Ns, r.p99Ns, r.maxNs,
+                (unsigned long long)r.fsyncs, r.fsyncs ? (double)r.records / (double)r.fsyncs : 0.0,
+                (unsigned long long)r.dropped);
+    if (r.records == 0) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Capture files: raw datagrams as they arrived on RADXA_UDP_PORT, for replay.
+//
+// Layout (host byte order, everything 8-byte aligned so a mapped file can be
+// walked in place):
+//   header   magic "RXCAP\0\0\0", u32 version, u32 header size,
+//            i64 start time (epoch ns), u64 reserved
+//   records  u32 record size (header + payload + padding to 8),
+//            u32 payload length, u64 arrival (ns after start),
+//            u32 source IPv4 (host order), u16 source port, u8 flags,
+//            u8 reserved, payload
+// Payloads are stored byte for byte; FLAG_JSON marks the ones that look like
+// the firmware's JSON, the rest (binary) are replayed all the same. The file
+// is only ever appended to. A record cut short by a crash is ignored on read
+// and cut off when the capture is continued.
+namespace capture {
+
+static constexpr char MAGIC[8] = {'R', 'X', 'C', 'A', 'P', 0, 0, 0};
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t FILE_HEADER = 32;
+static constexpr size_t RECORD_HEADER = 24;
+static constexpr uint32_t MAX_PAYLOAD = 65507;     // largest UDP/IPv4 payload
+static constexpr uint8_t FLAG_JSON = 1;
+
+struct Packet{
+    uint64_t tNs;           // after the file's start time
+    uint32_t ip;
+    uint16_t port;
+    uint8_t flags;
+    const uint8_t* data;
+    uint32_t len;
+};
+
+// FLAG_JSON if the payload starts (after blanks) with '{'.
+uint8_t classify(const void* data, size_t len);
+
+}
+
+// Appends records through a memory buffer, written out every 256 KiB and
+// on flush().
+//
+// A failed write (disk full, quota, I/O error) is counted, any part of it
+// that reached the file is cut off again, and the records stay buffered for
+// the next flush(). While writes keep failing the buffer grows up to
+// bufferLimit bytes; past that append() refuses records, and each refusal
+// is counted, so a full disk never loses data silently.
+class CaptureWriter{
+public:
+    static constexpr size_t DEFAULT_BUFFER_LIMIT = 64u << 20;
+
+    CaptureWriter() {}
+    ~CaptureWriter();
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // Creates the file, or continues an existing capture (keeping its start
+    // time). startNs is used for a new file only.
+    bool open(const std::string& path, int64_t startNs);
+    // Flushes and closes. False if buffered records could not be written;
+    // they are lost then.
+    bool close();
+
+    // False if the record was not taken: writer closed, payload too large,
+    // or the buffer is at its limit because writes are failing.
+    bool append(uint64_t tNs, uint32_t ip, uint16_t port, const void* data, size_t len);
+    // False if the write failed; the records stay buffered.
+    bool flush();
+
+    void setBufferLimit(size_t bytes) {_bufferLimit = bytes;}
+
+    int64_t startNs() const {return _startNs;}
+    uint64_t records() const {return _records;}      // in the file or buffered
+    uint64_t buffered() const {return _bufRecords;}  // not yet in the file
+    uint64_t writeErrors() const {return _writeErrors;}
+    uint64_t refused() const {return _refused;}
+
+private:
+    int _fd = -1;
+    uint64_t _size = 0;         // bytes of whole records in the file
+    int64_t _startNs = 0;
+    uint64_t _records = 0;
+    uint64_t _bufRecords = 0;
+    uint64_t _writeErrors = 0;
+    uint64_t _refused = 0;
+    size_t _bufferLimit = DEFAULT_BUFFER_LIMIT;
+    std::vector<uint8_t> _buf;
+};
+
+// Read side: maps the whole file and walks it without copying.
+class CaptureReader{
+public:
+    CaptureReader() {}
+    ~CaptureReader();
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // Next packet in file order; false at the end (or at a torn record).
+    // Packet::data points into the mapping.
+    bool next(capture::Packet& out);
+    void rewind() {_pos = capture::FILE_HEADER;}
+
+    int64_t startNs() const {return _startNs;}
+    size_t fileSize() const {return _size;}
+    // Offset of the next record; once next() fails, the end of the valid data.
+    size_t position() const {return _pos;}
+
+private:
+    const uint8_t* _base = nullptr;
+    size_t _size = 0;
+    size_t _pos = 0;
+    int64_t _startNs = 0;
+};
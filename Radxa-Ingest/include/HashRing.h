@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Consistent-hash assignment of device MACs to ingest nodes.
+//
+// Every node owns VNODES points on a 64-bit ring; a MAC belongs to the first
+// live node point at or after its hash. Taking a node out moves only the
+// MACs it owned (spread over the others), and bringing it back moves exactly
+// those back. Every node builds the same ring from the same node count, so
+// they agree on owners without talking, as long as they agree on who is
+// alive.
+class HashRing{
+public:
+    static constexpr unsigned VNODES = 128;
+    static constexpr unsigned NONE = ~0u;
+
+    explicit HashRing(unsigned nodes);
+
+    // Rebuilds the ring; O(nodes * VNODES log). Returns true if it changed.
+    bool setAlive(unsigned node, bool alive);
+    bool alive(unsigned node) const {return node < _alive.size() && _alive[node];}
+
+    // NONE if no node is alive.
+    unsigned owner(uint64_t mac) const;
+
+    unsigned nodes() const {return (unsigned)_alive.size();}
+    unsigned liveNodes() const;
+
+private:
+    struct Point{
+        uint64_t hash;
+        unsigned node;
+    };
+
+    std::vector<bool> _alive;
+    std::vector<Point> _points;     // live nodes only, sorted by hash
+
+    static uint64_t hash(uint64_t x);
+    void rebuild();
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HashRing.h"
+#include "LivenessTracker.h"
+#include "Metrics.h"
+#include "RackMap.h"
+#include "StreamStitcher.h"
+#include "UnknownRegistry.h"
+#include "UnknownStore.h"
+#include "Wal.h"
+
+// One of N cooperating ingest nodes. Every node listens on its own UDP
+// address (one of the firmware's COLLECTOR_IPS) and owns the devices that
+// consistent hashing (HashRing) gives it.
+//
+// A device datagram for a device this node owns is processed here. One for
+// a device owned elsewhere is forwarded once to the owner, wrapped with the
+// original source address; a forwarded datagram is always processed where
+// it lands, even if the two nodes briefly disagree about the owner, so
+// nothing loops. time_requests are answered by whichever node receives
+// them, never forwarded: they measure the path to that collector.
+//
+// A device datagram processed here goes through the ingest pipeline, every
+// stage optional. Telemetry is parsed (TelemetryFields) and its MAC resolved
+// (RackMap). An unmapped MAC is recorded in the UnknownRegistry and its
+// telemetry written with rack_id "unknown"; a mapped one moves the device's
+// LivenessTracker deadline and goes through the StreamStitcher. What comes
+// out is written to the WAL as TelemetryRows, tagged with the device's own
+// source address, also for datagrams forwarded from another node. The
+// stages are not thread-safe: they belong to run()'s thread while it runs.
+//
+// Nodes send each other a heartbeat every heartbeatMs. A peer silent for
+// deadAfterMs is taken off the ring and its devices spread over the rest;
+// when it is heard again it takes them back. Per-device state is not moved:
+// the database is the shared record, and the nodes only hold counters.
+//
+// Datagrams on the node port, told apart by their first four bytes:
+//   "RXF1" u32 source IPv4, u16 source port, u16 0, payload   forwarded
+//   "RXH1" u32 node index                                    heartbeat
+//   "RXC1" "stats"                     control: replies with one stats line
+//   anything else                      a device datagram
+class IngestNode{
+public:
+    struct Peer{
+        uint32_t ip;        // host order
+        uint16_t port;
+    };
+
+    struct Options{
+        unsigned self = 0;
+        std::vector<Peer> peers;        // every node, this one included, same order everywhere
+        uint32_t heartbeatMs = 100;
+        uint32_t deadAfterMs = 500;
+        RackMap* rackMap = nullptr;     // optional rack resolution
+        Metrics* metrics = nullptr;     // optional; registered when run() starts, not rendered after the node is gone
+
+        // Pipeline stages; the last three need rackMap.
+        WalWriter* wal = nullptr;               // opened by the caller
+        StreamStitcher* stitcher = nullptr;     // clocked in epoch ms
+        LivenessTracker* liveness = nullptr;    // clocked in CLOCK_MONOTONIC ms
+        UnknownRegistry* unknown = nullptr;
+        UnknownStore* unknownStore = nullptr;   // unknown is flushed to it every unknownFlushMs
+        uint32_t unknownFlushMs = 10000;
+    };
+
+    struct Stats{
+        uint64_t received;      // datagrams from devices, direct
+        uint64_t forwardedOut;
+        uint64_t forwardedIn;
+        uint64_t processed;     // device datagrams handled here (owned or forwarded in)
+        uint64_t misrouted;     // forwarded in although this node is not the owner
+        uint64_t timeRequests;
+        uint64_t noMac;         // processed here: no device.mac to hash
+        uint64_t notTelemetry;  // processed here: a MAC, but not a telemetry message
+        uint64_t unknownRack;
+        uint64_t ringChanges;
+        unsigned liveNodes;
+        uint64_t duplicates;    // dropped by the stitcher: the same datagram again
+        uint64_t overlaps;      // dropped by the stitcher: another controller's sample won
+        uint64_t rows;          // handed to the WAL
+        uint64_t rowsDropped;   // refused by the WAL (queue full)
+        uint64_t devicesDown;
+        uint64_t failovers;
+    };
+
+    IngestNode() {}
+    ~IngestNode();
+    IngestNode(const IngestNode&) = delete;
+    IngestNode& operator=(const IngestNode&) = delete;
+
+    bool open(const Options& options);
+
+    // Serves until stop is set (checked at least every 10 ms).
+    void run(const std::atomic<bool>& stop);
+
+    Stats stats() const;
+    const HashRing& ring() const {return _ring;}
+
+    // Processed datagrams per device MAC, on this node.
+    const std::unordered_map<uint64_t, uint64_t>& deviceCounts() const {return _counts;}
+
+private:
+    static constexpr size_t BATCH = 64;
+
+    Options _options;
+    int _fd = -1;
+    HashRing _ring{1};
+    RackMap::Reader* _reader = nullptr;
+    std::vector<int64_t> _lastHeardMs;
+    int64_t _lastHeartbeatMs = 0;
+
+    std::unordered_map<uint64_t, uint64_t> _counts;
+    Stats _stats = {};
+
+    // Null without Options::metrics.
+    struct Recorders{
+        Metrics::Counter* packets = nullptr;    // per port and receive thread
+        Metrics::Counter* bytes = nullptr;
+        Metrics::Counter* noMac = nullptr;      // parse failures, reason no_mac
+        Metrics::Counter* notTelemetry = nullptr;
+        Metrics::Counter* unknownMac = nullptr;
+        Metrics::Counter* duplicates = nullptr;
+        Metrics::Counter* overlaps = nullptr;
+        Metrics::Counter* rows = nullptr;
+        Metrics::Counter* rowsDropped = nullptr;
+        Metrics::Counter* deviceEvents[3] = {};   // by LivenessTracker::EventType
+        Metrics::Counter* forwardedOut = nullptr;
+        Metrics::Counter* forwardedIn = nullptr;
+        Metrics::Counter* timeRequests = nullptr;
+        Metrics::Gauge* liveNodes = nullptr;
+        Metrics::Histogram* batchTime = nullptr;
+    };
+    Recorders _m;
+
+    // Forwards collected during one receive batch, sent together.
+    struct Forward{
+        unsigned node;
+        uint32_t len;
+        uint8_t data[12 + 1472];
+    };
+    std::vector<Forward> _forwards;
+
+    std::vector<LivenessTracker::Event> _events;
+    int64_t _lastUnknownFlushMs = 0;
+
+    // Newest telemetry per rack (CLOCK_MONOTONIC ms), for the metrics scrape.
+    mutable std::mutex _seenMutex;
+    std::unordered_map<std::string, int64_t> _rackSeenMs;
+
+    void handle(const uint8_t* data, size_t len, uint32_t ip, uint16_t port, int64_t nowMs, int64_t wallMs);
+    void process(const uint8_t* data, size_t len, uint64_t mac, uint32_t ip, uint16_t port, int64_t nowMs,
+        int64_t wallMs);
+    void writeRow(const char* rack, const StreamStitcher::Sample& s, uint8_t flags, const uint8_t* data,
+        size_t len);
+    void forward(unsigned node, const uint8_t* data, size_t len, uint32_t ip, uint16_t port);
+    void answerTime(const uint8_t* data, size_t len, uint32_t ip, uint16_t port);
+    void reply(const char* text, size_t len, uint32_t ip, uint16_t port);
+    void flushForwards();
+    void tick(int64_t nowMs, int64_t wallMs);
+    void drainPipeline(int64_t wallMs);
+    void registerMetrics();
+};
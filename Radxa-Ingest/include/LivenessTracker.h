@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TimerWheel.h"
+
+// Device liveness from last-seen times, without scanning the device list.
+//
+// Every mapped controller has a deadline timer on a TimerWheel. A datagram
+// from it (telemetry or a time_request; both carry device.mac) pushes the
+// deadline to now + timeout, an O(1) move, and the wheel raises DEVICE_DOWN
+// for a device whose deadline passes. The timeout must exceed the longest
+// gap a healthy device leaves: standby controllers send no telemetry, only
+// their clock-sync bursts (CLOCK_SYNC_INTERVAL_MS).
+//
+// Per rack, the tracker also follows which controller is sending telemetry.
+// Only the elected leader does, so telemetry arriving from another of the
+// rack's MACs is a failover (or a failback): FAILOVER reports both MACs and
+// the gap between the old sender's last telemetry and the new one's first.
+//
+// Not thread-safe: feed it from one thread, or serialise.
+class LivenessTracker{
+public:
+    enum class EventType : uint8_t {DEVICE_DOWN, DEVICE_UP, FAILOVER};
+
+    struct Event{
+        EventType type;
+        int64_t tMs;            // DEVICE_DOWN: the deadline; otherwise the packet time
+        uint64_t mac;           // the device, or for FAILOVER the new sender
+        char controller;
+        uint64_t fromMac;       // FAILOVER only
+        char fromController;
+        int64_t gapMs;          // FAILOVER only
+        const char* rack;       // valid as long as the tracker
+    };
+
+    LivenessTracker(uint32_t timeoutMs, uint32_t tickMs, int64_t nowMs);
+
+    // From device_map. controller is 'A' to 'D'. Devices start as not seen;
+    // the first datagram raises DEVICE_UP. Adding a MAC again updates its
+    // rack and controller; devices are never removed.
+    void addDevice(uint64_t mac, const std::string& rackId, char controller);
+
+    // One datagram from mac. False (and nothing else) if mac is not mapped.
+    bool onPacket(uint64_t mac, int64_t nowMs, bool telemetry);
+
+    // Runs the wheel up to nowMs. Call every tick or so; DEVICE_DOWN is
+    // raised at most one tick plus the call interval after the deadline.
+    void advance(int64_t nowMs);
+
+    // Moves the events raised since the last call to the end of out.
+    void takeEvents(std::vector<Event>& out);
+
+    size_t devices() const {return _devices.size();}
+    size_t devicesUp() const {return _up;}
+    uint32_t timeoutMs() const {return _timeoutMs;}
+
+private:
+    static constexpr uint32_t NONE = ~0u;
+
+    struct Device{
+        uint64_t mac;
+        int64_t lastSeenMs = 0;
+        uint32_t rack;
+        char controller;
+        bool up = false;
+        TimerWheel::Timer timer;
+    };
+
+    struct Rack{
+        std::string name;
+        uint32_t sender = NONE;     // device sending telemetry
+        int64_t lastTelemetryMs = 0;
+    };
+
+    uint32_t _timeoutMs;
+    uint32_t _tickMs;               // before _wheel: it is started at tickOf(now)
+    TimerWheel _wheel;
+
+    // A deque, because the wheel links the timers inside it by address.
+    std::deque<Device> _devices;
+    std::vector<uint32_t> _index;   // open addressing, MAC -> device
+    size_t _indexMask = 0;
+    std::deque<Rack> _racks;        // events point at the names
+    std::unordered_map<std::string, uint32_t> _rackIndex;
+
+    std::vector<Event> _events;
+    size_t _up = 0;
+
+    static uint64_t hash(uint64_t mac);
+    size_t slotOf(uint64_t mac) const;
+    void growIndex();
+    uint64_t tickOf(int64_t ms) const;
+};
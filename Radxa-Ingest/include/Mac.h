@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Device MACs as 48-bit integers, first octet most significant. Every ingest
+// table is keyed on this; the "AA:BB:CC:DD:EE:FF" text in device.mac is
+// parsed straight into it without building a string.
+
+// Never a valid 48-bit MAC, so tables can use it as the empty key.
+static constexpr uint64_t MAC_INVALID = ~0ULL;
+
+// Parses "AA:BB:CC:DD:EE:FF" (either case, ':' or '-' separators). Anything
+// else, including trailing characters within len, gives MAC_INVALID.
+uint64_t parseMac(const char* s, size_t len);
+
+// Finds the first "mac": "..." in a datagram (the firmware's JSON) and parses
+// it. The datagram does not need to be NUL-terminated.
+uint64_t findDeviceMac(const char* data, size_t len);
+
+// The same search, returning where the 17-character MAC text starts (for
+// tools that rewrite it in place), or nullptr.
+const char* findDeviceMacText(const char* data, size_t len);
+
+// Writes "AA:BB:CC:DD:EE:FF" plus a NUL (18 bytes).
+void formatMac(uint64_t mac, char out[18]);
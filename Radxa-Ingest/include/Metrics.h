@@ -0,0 +1,170 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Counters, gauges and latency histograms for the ingest path, rendered in
+// the Prometheus text format (MetricsServer serves them over HTTP).
+//
+// Nothing on the recording side locks or allocates, and no two threads
+// write the same cache line. A counter or histogram keeps one
+// cache-line-aligned cell per shard and a scrape sums the cells. A thread
+// claims a shard of its own on its first record and hands it back when it
+// exits; its cell has a single writer, so an add is a relaxed load and
+// store, with no locked instruction. Threads beyond SHARDS at once share
+// one overflow cell with atomic adds: slower, never wrong.
+//
+// Histograms are HDR-style: each power of two is split into 2^SUB_BITS
+// linear sub-buckets, so every value from 1 ns to 2^40 ns (18 min) is kept
+// to within 1/8 of itself in 304 buckets. The exposition folds them into
+// power-of-two `le` bounds, which are exact bucket edges, reported in
+// seconds.
+//
+// Registration (counter(), histogram(), gauge(), collect()) takes a lock and
+// is meant for start-up; the returned references live as long as the
+// registry. Asking again for the same name and labels returns the same
+// metric.
+class Metrics{
+public:
+    static constexpr unsigned SHARDS = 16;
+
+    class Counter{
+    public:
+        void add(uint64_t n = 1){
+            bump(_cells[shard()].v, n);
+        }
+        uint64_t value() const;
+
+    private:
+        struct alignas(64) Cell{
+            std::atomic<uint64_t> v{0};
+        };
+        Cell _cells[SHARDS + 1];
+    };
+
+    // A level set by one owner (a queue depth, a table size).
+    class Gauge{
+    public:
+        void set(int64_t v){_v.store(v, std::memory_order_relaxed);}
+        void add(int64_t n){_v.fetch_add(n, std::memory_order_relaxed);}
+        int64_t value() const {return _v.load(std::memory_order_relaxed);}
+
+    private:
+        std::atomic<int64_t> _v{0};
+    };
+
+    class Histogram{
+    public:
+        static constexpr unsigned SUB_BITS = 3;
+        static constexpr unsigned MAX_BITS = 40;       // values are clamped below 2^40
+        static constexpr unsigned BUCKETS = (1u << SUB_BITS) * (MAX_BITS - SUB_BITS + 1);
+
+        Histogram() : _shards(new Shard[SHARDS + 1]) {}
+
+        // A duration in nanoseconds (or any unit, as long as it is one).
+        void record(uint64_t v){
+            const unsigned i = shard();
+            Shard& s = _shards[i];
+            bump(s.buckets[bucketOf(v)], 1, i);
+            bump(s.sum, v, i);
+        }
+
+        uint64_t count() const;
+        uint64_t sum() const;
+        // The upper edge of the bucket holding the p-th percentile (0-100),
+        // or 0 if nothing was recorded.
+        uint64_t percentile(double p) const;
+        // Values recorded that were below limit; limit a power of two.
+        uint64_t countBelow(uint64_t limit) const;
+
+        static unsigned bucketOf(uint64_t v){
+            if(v >> MAX_BITS) return BUCKETS - 1;
+            if(v < (1u << SUB_BITS)) return (unsigned)v;
+            const unsigned e = 63 - (unsigned)__builtin_clzll(v);
+            const unsigned sub = (unsigned)(v >> (e - SUB_BITS)) & ((1u << SUB_BITS) - 1);
+            return ((e - SUB_BITS + 1) << SUB_BITS) + sub;
+        }
+        // Smallest and largest value of bucket b.
+        static uint64_t bucketLow(unsigned b);
+        static uint64_t bucketHigh(unsigned b);
+
+    private:
+        friend class Metrics;
+
+        struct alignas(64) Shard{
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> buckets[BUCKETS] = {};
+        };
+        std::unique_ptr<Shard[]> _shards;
+
+        void snapshot(uint64_t* counts) const;
+    };
+
+    // Called at scrape time with emit(labels, value) once per series, for
+    // label sets only known then (one series per rack, say).
+    using Emit = std::function<void(const std::string& labels, double value)>;
+    using Collect = std::function<void(const Emit& emit)>;
+
+    Metrics() {}
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // labels is the inside of the braces, e.g. port="5005",thread="0"
+    // (label() escapes a value); "" for none.
+    Counter& counter(const char* name, const char* help, const std::string& labels = "");
+    Gauge& gauge(const char* name, const char* help, const std::string& labels = "");
+    // Histograms of durations: record nanoseconds, exposed in seconds.
+    Histogram& histogram(const char* name, const char* help, const std::string& labels = "");
+    // A gauge family whose series come from fn at every scrape. fn runs on
+    // the scraping thread.
+    void collect(const char* name, const char* help, Collect fn);
+
+    // Appends the exposition of every metric, in registration order.
+    void render(std::string& out) const;
+
+    // key="value" with the value escaped for the exposition format.
+    static std::string label(const char* key, const std::string& value);
+
+    // A small number unique to the calling thread, in order of first use.
+    static unsigned threadIndex();
+
+private:
+    enum class Type : uint8_t {COUNTER, GAUGE, HISTOGRAM};
+
+    struct Series{
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family{
+        std::string name;
+        std::string help;
+        Type type;
+        std::deque<Series> series;
+        Collect collect;
+    };
+
+    mutable std::mutex _mutex;
+    std::deque<Family> _families;
+
+    // The calling thread's shard, or SHARDS (the shared one) if all are taken.
+    static unsigned shard(){
+        thread_local const unsigned s = claimShard();
+        return s;
+    }
+    static unsigned claimShard();
+
+    static void bump(std::atomic<uint64_t>& cell, uint64_t n, unsigned index = shard()){
+        if(index < SHARDS) cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        else cell.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    Series& series(const char* name, const char* help, Type type, const std::string& labels);
+};
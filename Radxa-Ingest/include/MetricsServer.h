@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "Metrics.h"
+
+// Serves a Metrics registry in the Prometheus text format at GET /metrics,
+// for a Prometheus (and the Grafana on top of it) on the same host.
+//
+// One thread of its own accepts a connection at a time, answers it and
+// closes it; a scrape every few seconds needs nothing more. Rendering reads
+// the metrics' atomic cells, so the receive threads never wait for a scrape.
+// There is no authentication: bind it to loopback (the default) or a
+// management interface, never to the devices' network.
+class MetricsServer{
+public:
+    static constexpr uint32_t LOOPBACK = 0x7F000001;
+
+    explicit MetricsServer(const Metrics& metrics) : _metrics(metrics) {}
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Listens on ip:port (host order; port 0 picks a free one) and starts
+    // the serving thread. False if the address can't be bound.
+    bool start(uint16_t port, uint32_t ip = LOOPBACK);
+    void stop();
+
+    // The bound port, once started.
+    uint16_t port() const {return _port;}
+    uint64_t scrapes() const {return _scrapes.load(std::memory_order_relaxed);}
+
+private:
+    const Metrics& _metrics;
+    int _fd = -1;
+    uint16_t _port = 0;
+    std::atomic<bool> _stop{false};
+    std::atomic<uint64_t> _scrapes{0};
+    std::thread _thread;
+
+    void serve();
+    void answer(int fd);
+};
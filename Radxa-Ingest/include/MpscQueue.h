@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue for many producers and one consumer (Vyukov's
+// array queue with a per-cell sequence number).
+//
+// A producer claims a cell with one CAS on the tail and publishes it with a
+// release store of the cell's sequence; the consumer needs no atomic
+// read-modify-write at all. push() never blocks and never allocates: when
+// the queue is full it fails and the caller decides what to drop. T is
+// copied in and out, so keep it trivially copyable.
+template <class T>
+class MpscQueue{
+public:
+    // capacity is rounded up to a power of two.
+    explicit MpscQueue(size_t capacity){
+        size_t n = 2;
+        while(n < capacity) n <<= 1;
+        _mask = n - 1;
+        _cells.reset(new Cell[n]);
+        for(size_t i = 0; i < n; i++) _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread. False if full.
+    bool push(const T& v){
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for(;;){
+            Cell& c = _cells[pos & _mask];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0){
+                if(_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    c.value = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0){
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only. False if empty (or the next producer has claimed
+    // its cell but not finished writing it).
+    bool pop(T& out){
+        Cell& c = _cells[_head & _mask];
+        if(c.seq.load(std::memory_order_acquire) != _head + 1) return false;
+        out = c.value;
+        c.seq.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    // Consumer thread only. Records pushed and not yet popped, counting any
+    // a producer has claimed but not finished writing.
+    size_t size() const {return _tail.load(std::memory_order_relaxed) - _head;}
+
+    size_t capacity() const {return _mask + 1;}
+
+private:
+    struct alignas(64) Cell{
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask = 0;
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) size_t _head = 0;       // consumer only
+};
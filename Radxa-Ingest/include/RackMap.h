@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "RackTable.h"
+
+// The live MAC -> rack_id mapping, shared by every receive thread.
+//
+// The current RackTable is published through an atomic pointer (RCU style).
+// A reload builds a whole new table off to the side and swaps it in; receive
+// threads never wait for it and never take a lock. Lookups that miss return
+// UNKNOWN, a static string, so unmapped devices cost no allocation either.
+//
+// Reclamation uses per-reader epochs. Each receive thread owns a Reader and
+// brackets its lookups with a ReadSection, which just publishes the epoch it
+// entered in. publish() swaps the pointer, advances the epoch and waits until
+// no reader is still inside a section that began before the swap; only then
+// is the old table freed. The waiting is all on the reload side.
+class RackMap{
+public:
+    static constexpr unsigned MAX_READERS = 64;
+    static const char* const UNKNOWN;
+
+    // One per receive thread; not shared between threads.
+    struct alignas(64) Reader{
+        std::atomic<uint64_t> epoch{0};     // 0 = not in a read section
+    };
+
+    // Read-side critical section. Keep it to one packet or one receive batch;
+    // a reload's grace period lasts as long as the longest open section.
+    // Sections on the same Reader must not nest.
+    class ReadSection{
+    public:
+        ReadSection(const RackMap& map, Reader& reader);
+        ~ReadSection();
+        ReadSection(const ReadSection&) = delete;
+        ReadSection& operator=(const ReadSection&) = delete;
+
+        // rack_id for a MAC, or UNKNOWN. Valid until the section ends.
+        const char* rackId(uint64_t mac) const;
+        const RackTable& table() const {return *_table;}
+
+    private:
+        Reader& _reader;
+        const RackTable* _table;
+    };
+
+    RackMap();
+    ~RackMap();
+    RackMap(const RackMap&) = delete;
+    RackMap& operator=(const RackMap&) = delete;
+
+    // nullptr once MAX_READERS are handed out.
+    Reader* addReader();
+
+    // Swaps in a new table and frees the old one after the grace period.
+    // Reloads are serialised; receive threads are never blocked.
+    void publish(std::unique_ptr<RackTable> next);
+
+    // Number of tables published so far.
+    uint64_t version() const {return _version.load(std::memory_order_relaxed);}
+
+private:
+    std::atomic<const RackTable*> _current;
+    std::atomic<uint64_t> _epoch{1};
+    std::atomic<uint64_t> _version{0};
+
+    Reader _readers[MAX_READERS];
+    std::atomic<unsigned> _readerCount{0};
+
+    std::mutex _publishMutex;
+
+    void waitForReaders(uint64_t epoch) const;
+};
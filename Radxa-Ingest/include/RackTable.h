@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// MAC -> rack_id snapshot: an open-addressing hash table (linear probing,
+// power-of-two capacity, at most half full) keyed on the 48-bit MAC.
+//
+// Built once, then published read-only through RackMap; nothing is modified
+// after that, so lookups need no synchronisation of their own. A lookup is
+// one hash and, at this load factor, one or two 16-byte slot reads.
+class RackTable{
+public:
+    RackTable();
+
+    // Build phase only. A later entry for the same MAC replaces the earlier one.
+    void insert(uint64_t mac, const std::string& rackId);
+
+    // nullptr if the MAC is not mapped. The pointer lives as long as the table.
+    const char* find(uint64_t mac) const;
+
+    size_t size() const {return _count;}
+    size_t capacity() const {return _slots.size();}
+
+    // Loads "mac,rack_id" lines, e.g. the output of
+    //   \copy (SELECT mac, rack_id FROM device_map) TO 'map.csv' CSV
+    // Blank lines, '#' comments and a header line are skipped. badLines
+    // (optional) counts lines that were neither. False if the file can't be read.
+    bool loadCsv(const char* path, size_t* badLines = nullptr);
+
+private:
+    struct Slot{
+        uint64_t mac;       // MAC_INVALID = empty
+        uint32_t rack;      // index into _racks
+    };
+
+    std::vector<Slot> _slots;
+    size_t _count = 0;
+    size_t _mask = 0;
+
+    // Rack names, each stored once however many devices map to it.
+    std::vector<std::string> _racks;
+    std::unordered_map<std::string, uint32_t> _rackIndex;
+
+    static uint64_t hash(uint64_t mac);
+    uint32_t internRack(const std::string& rackId);
+    void grow();
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Capture.h"
+
+// Records datagrams arriving on a UDP port into a capture file. Arrival
+// times are the kernel's receive timestamps (SO_TIMESTAMPNS), so a busy
+// recorder does not skew them.
+class UdpRecorder{
+public:
+    struct Stats{
+        uint64_t packets;       // taken by the capture
+        uint64_t json;          // json and bytes: of every datagram received, lost or not
+        uint64_t bytes;
+        uint64_t truncated;     // larger than the receive buffer; not recorded
+        uint64_t lost;          // refused by the capture: writes failing and its buffer full
+        uint64_t writeErrors;   // failed writes to the capture file
+        uint64_t unwritten;     // taken, but still buffered because the last flush failed
+    };
+
+    UdpRecorder() {}
+    ~UdpRecorder();
+    UdpRecorder(const UdpRecorder&) = delete;
+    UdpRecorder& operator=(const UdpRecorder&) = delete;
+
+    // bindIp in host order (0 = any). Port 0 picks a free one; see port().
+    bool open(uint32_t bindIp, uint16_t port);
+    uint16_t port() const {return _port;}
+
+    // Receives into out until stop is set (checked every 100 ms) or, if
+    // maxPackets > 0, that many were recorded. Flushes out before returning;
+    // whatever that could not write stays in out (Stats::unwritten).
+    Stats run(CaptureWriter& out, const std::atomic<bool>& stop, uint64_t maxPackets = 0);
+
+private:
+    int _fd = -1;
+    uint16_t _port = 0;
+};
+
+// Re-sends a capture to 127.0.0.1:port. Loopback only, by design: it can
+// multiply traffic many times over and must never be pointed at a network.
+//
+// speed 1 keeps the recorded gaps, N plays N times faster, 0 sends as fast
+// as the socket takes it. With copies > 1 every datagram is sent that many
+// times: copy 0 as recorded, copy k from source address 127.0.0.1 + k and,
+// if the payload carries device.mac, with the MAC rewritten to
+// replayMac(mac, k). One recorded rack becomes `copies` distinct racks.
+class UdpReplayer{
+public:
+    struct Options{
+        uint16_t port = 9000;
+        double speed = 1.0;
+        unsigned copies = 1;
+        bool rewriteMac = true;
+    };
+
+    struct Result{
+        uint64_t packets;       // datagrams handed to the kernel
+        uint64_t bytes;
+        uint64_t sendErrors;
+        uint64_t rewritten;     // datagrams whose MAC was changed
+        double seconds;
+        double packetsPerS;
+        double maxLateUs;       // worst send time behind schedule (timed modes)
+    };
+
+    static constexpr unsigned MAX_COPIES = 1u << 16;
+
+    UdpReplayer() {}
+    ~UdpReplayer();
+    UdpReplayer(const UdpReplayer&) = delete;
+    UdpReplayer& operator=(const UdpReplayer&) = delete;
+
+    bool open(const Options& options);
+    Result run(CaptureReader& in);
+
+    // Copy k of a device: locally administered (bit 1 of the first octet
+    // set), k in octets 2-3, the low three octets kept. Copy 0 is unchanged.
+    static uint64_t replayMac(uint64_t mac, unsigned copy);
+
+private:
+    static constexpr size_t BATCH = 64;
+
+    Options _options;
+    int _fd = -1;
+
+    struct Pending{
+        const uint8_t* data;
+        uint32_t len;
+        unsigned copy;
+    };
+    std::vector<Pending> _pending;
+    std::vector<std::vector<uint8_t>> _scratch;     // rewritten payloads
+
+    size_t flush(Result& r);
+};
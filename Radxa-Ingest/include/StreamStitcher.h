@@ -0,0 +1,166 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Merges the telemetry streams of a rack's controllers into one time-ordered
+// series per rack, before anything reaches the database.
+//
+// Around a failover or recovery two controllers can report the same rack at
+// once, under different MACs and with unrelated device clocks. Samples are
+// therefore placed on the Radxa-synced timestamp_epoch_ms (the caller falls
+// back to arrival time while a device is unsynced). Two samples of one rack
+// from different controllers closer than windowMs are the same point: the
+// one from the rack's designated sender is kept, the other dropped. The
+// designated sender is the leader advertised in the membership item with the
+// newest term; until one is known, whichever sample came first wins. A
+// datagram seen twice (same MAC, seq and time: a retry-queue resend or a
+// replay) is dropped outright.
+//
+// Each rack has a bounded reorder buffer. A sample waits there holdMs after
+// its arrival so an earlier one, still in flight on the other controller's
+// path, can be placed before it; points leave in time order. When the buffer
+// is full the oldest point leaves early. Every released point carries its
+// source: MAC, controller and whether it came from the designated sender.
+//
+// Not thread-safe: one stitcher per receive thread, with racks sharded over
+// threads, or the caller serialises.
+class StreamStitcher{
+public:
+    struct Options{
+        uint32_t windowMs = 500;        // under the telemetry period (TELEMETRY_SEND_MS)
+        uint32_t holdMs = 2000;
+        uint32_t maxPending = 64;       // per rack
+        size_t maxRacks = 4096;
+    };
+
+    struct Sample{
+        uint64_t mac;
+        char controller;        // 'A' to 'D'
+        uint32_t seq;
+        int64_t timeMs;         // epoch ms
+        char leader;            // membership item; 0 if the message has none
+        uint32_t term;
+        uint32_t ip;            // source address (host order), carried through
+        uint16_t port;
+    };
+
+    struct Point{
+        const char* rack;       // valid as long as the stitcher
+        Sample sample;
+        bool designated;        // sent by the rack's designated sender
+        bool replaced;          // a sample from another controller was dropped for this one
+        bool late;              // older than a point of its rack already released
+        const uint8_t* data;    // the datagram; valid during the callback only
+        uint32_t len;
+    };
+
+    enum class Verdict : uint8_t {
+        ACCEPTED,
+        REPLACED,       // accepted, dropping the other controller's sample
+        DUPLICATE,      // dropped: the same datagram again
+        OVERLAP,        // dropped: another controller's sample for this point wins
+        UNSTITCHED,     // maxRacks reached; the caller passes the datagram on as is
+    };
+
+    struct Stats{
+        uint64_t accepted;
+        uint64_t duplicates;
+        uint64_t overlaps;
+        uint64_t replaced;
+        uint64_t late;
+        uint64_t forced;        // released before holdMs because the buffer was full
+        uint64_t unstitched;
+    };
+
+    explicit StreamStitcher(const Options& options);
+
+    Verdict add(const char* rack, const Sample& s, const void* data, size_t len, int64_t nowMs);
+
+    // Releases, in time order per rack, every point that has waited holdMs
+    // (and any forced out by a full buffer). fn(const Point&). Returns the
+    // number released.
+    template <class Fn>
+    size_t drain(int64_t nowMs, Fn fn);
+
+    // Releases everything, e.g. at shutdown.
+    template <class Fn>
+    size_t flush(Fn fn) {return drain(INT64_MAX, fn);}
+
+    // The rack's designated sender, or 0 if none is known yet.
+    char designated(const char* rack) const;
+
+    size_t racks() const {return _racks.size();}
+    size_t pending() const;
+    const Stats& stats() const {return _stats;}
+
+private:
+    static constexpr uint32_t RECENT = 64;     // released points kept for dedup
+
+    struct Slot{
+        Sample s;
+        int64_t arrivalMs;
+        bool replaced;
+        std::string data;
+    };
+
+    struct Released{
+        uint64_t mac;
+        uint32_t seq;
+        int64_t timeMs;
+    };
+
+    struct Rack{
+        std::string name;
+        std::vector<Slot> pending;      // sorted by time
+        Released recent[RECENT];
+        uint32_t recentCount = 0;
+        uint32_t recentNext = 0;
+        int64_t releasedMs = INT64_MIN; // newest point released
+        char leader = 0;
+        uint32_t term = 0;
+    };
+
+    struct Ready{
+        uint32_t rack;
+        bool late;
+        Slot slot;
+    };
+
+    Options _options;
+    std::deque<Rack> _racks;            // points refer to the names
+    std::unordered_map<std::string, uint32_t> _rackIndex;
+    std::vector<Ready> _ready;
+    Stats _stats = {};
+
+    void learnLeader(Rack& r, const Sample& s);
+    // Records slot as released; true if it is late.
+    bool noteReleased(Rack& r, const Slot& slot);
+    Point pointOf(const Rack& r, const Slot& slot, bool late) const;
+};
+
+template <class Fn>
+size_t StreamStitcher::drain(int64_t nowMs, Fn fn){
+    size_t n = 0;
+    for(Ready& x : _ready){
+        fn(pointOf(_racks[x.rack], x.slot, x.late));
+        n++;
+    }
+    _ready.clear();
+
+    for(Rack& r : _racks){
+        size_t k = 0;
+        while(k < r.pending.size() && (nowMs == INT64_MAX || r.pending[k].arrivalMs + _options.holdMs <= nowMs)){
+            const Slot& slot = r.pending[k];
+            const bool late = noteReleased(r, slot);
+            fn(pointOf(r, slot, late));
+            k++;
+        }
+        r.pending.erase(r.pending.begin(), r.pending.begin() + (ptrdiff_t)k);
+        n += k;
+    }
+    return n;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// The envelope fields of a firmware telemetry message, read straight from
+// the datagram like findDeviceMac(): no JSON tree, no allocation. Keys are
+// matched with their quotes, so "controller" never matches
+// "controller_a_alive".
+struct TelemetryFields{
+    uint64_t mac;           // MAC_INVALID if absent
+    char controller;        // device.controller, 0 if absent
+    bool hasSeq;
+    uint32_t seq;
+    int64_t deviceMs;       // timestamp_device_ms, -1 if absent
+    int64_t epochMs;        // timestamp_epoch_ms, 0 if null (clock not synced) or absent
+    char leader;            // membership item, 0 if absent
+    uint32_t term;
+    bool sensors;           // carries a "sensors" item (not an items-only report)
+};
+
+// False unless message_type is "telemetry" and device.mac parses.
+bool parseTelemetryFields(const char* data, size_t len, TelemetryFields& out);
+
+// The temperatures of the sensors item, per bus ("cool" and "exhaust"), in
+// hundredths of a degree C. A null entry (sensor not read) or one missing
+// from the array stays NO_READING.
+struct Temperatures{
+    static constexpr unsigned SENSORS = 3;          // per bus, TemperatureBus::SENSORS_PER_BUS
+    static constexpr int16_t NO_READING = INT16_MIN;
+
+    int16_t cool[SENSORS];
+    int16_t exhaust[SENSORS];
+};
+
+// False if the datagram has neither bus; out is filled either way.
+bool parseTemperatures(const char* data, size_t len, Temperatures& out);
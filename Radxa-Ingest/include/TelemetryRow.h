@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "TelemetryFields.h"
+
+// One telemetry point as an ingest node writes it to the WAL: the stitched
+// envelope, where the datagram came from and its decoded temperatures. The
+// encoding is a fixed layout in host byte order, like the WAL framing, and
+// is at most MAX_BYTES long, so a row always fits one WAL record:
+//   u64 mac | i64 time ms | u32 seq | u32 source IPv4 | u16 source port |
+//   u8 controller | u8 flags | i16 cool[3] | i16 exhaust[3] |
+//   u8 rack_id length | rack_id
+struct TelemetryRow{
+    static constexpr size_t MAX_RACK = 63;      // longer rack ids are cut
+    static constexpr size_t FIXED_BYTES = 8 + 8 + 4 + 4 + 2 + 1 + 1 + 4 * Temperatures::SENSORS + 1;
+    static constexpr size_t MAX_BYTES = FIXED_BYTES + MAX_RACK;
+
+    enum Flag : uint8_t{
+        DESIGNATED = 1,     // from the rack's designated sender
+        REPLACED = 2,       // another controller's sample for this point was dropped
+        LATE = 4,           // older than a point of its rack already written
+        UNSYNCED = 8,       // no timestamp_epoch_ms yet: timeMs is the arrival time
+        UNMAPPED = 16,      // MAC not in device_map; rack is "unknown"
+        UNSTITCHED = 32,    // written as received, without stitching
+    };
+
+    uint64_t mac;
+    int64_t timeMs;         // epoch ms
+    uint32_t seq;
+    uint32_t ip;            // host order
+    uint16_t port;
+    char controller;        // 0 if the datagram had none
+    uint8_t flags;
+    Temperatures temps;
+    char rack[MAX_RACK + 1];
+};
+
+// Writes the row to out (room for MAX_BYTES) and returns its length.
+size_t encodeRow(const TelemetryRow& row, uint8_t* out);
+
+// False unless data is exactly one encoded row.
+bool decodeRow(const uint8_t* data, size_t len, TelemetryRow& out);
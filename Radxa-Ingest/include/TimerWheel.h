@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Hierarchical timing wheel (the classic kernel layout): 256 one-tick slots,
+// then three levels of 64 slots, each slot of level n spanning 256 * 64^(n-1)
+// ticks, so 2^26 ticks in all. Deadlines further out are clamped to that.
+//
+// Timers are intrusive: the caller owns each Timer (typically one per
+// device, inside its own record), so schedule() and cancel() are O(1)
+// pointer splices and nothing is allocated. Rescheduling a pending timer
+// moves it. Timers in the higher levels are cascaded down as the wheel turns,
+// at most three times each; a timer fires on the exact tick it was set for.
+//
+// Not thread-safe.
+class TimerWheel{
+public:
+    struct Timer{
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expires = 0;   // tick
+        uint32_t id = 0;        // free for the owner, e.g. its own index
+
+        bool pending() const {return next != nullptr;}
+    };
+
+    static constexpr unsigned LEVEL0_BITS = 8;
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t MAX_DELTA = (1ULL << (LEVEL0_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+    explicit TimerWheel(uint64_t nowTick = 0);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Fires at advance() reaching expiresTick; a tick already passed means
+    // the next advance().
+    void schedule(Timer& t, uint64_t expiresTick);
+    void cancel(Timer& t);
+
+    // Processes every tick up to and including nowTick, calling
+    // onExpire(Timer&) for each timer due. The callback may schedule or
+    // cancel any timer, including the one passed to it.
+    template <class Fn>
+    void advance(uint64_t nowTick, Fn onExpire);
+
+    uint64_t nextTick() const {return _now;}
+    size_t pending() const {return _pending;}
+
+private:
+    static constexpr unsigned LEVEL0_SIZE = 1u << LEVEL0_BITS;
+    static constexpr unsigned LEVEL_SIZE = 1u << LEVEL_BITS;
+
+    Timer _level0[LEVEL0_SIZE];
+    Timer _levels[LEVELS - 1][LEVEL_SIZE];
+    uint64_t _now;      // next tick to process
+    size_t _pending = 0;
+
+    static void initSlot(Timer& head);
+    static void unlink(Timer& t);
+    void place(Timer& t);
+    void cascade(unsigned level);
+};
+
+template <class Fn>
+void TimerWheel::advance(uint64_t nowTick, Fn onExpire){
+    while(_now <= nowTick){
+        if(_pending == 0){
+            _now = nowTick + 1;
+            return;
+        }
+        if((_now & (LEVEL0_SIZE - 1)) == 0) cascade(0);
+
+        // Detach the whole slot first so callbacks can reschedule into it.
+        Timer& head = _level0[_now & (LEVEL0_SIZE - 1)];
+        Timer due;
+        initSlot(due);
+        if(head.next != &head){
+            due.next = head.next;
+            due.prev = head.prev;
+            due.next->prev = &due;
+            due.prev->next = &due;
+            initSlot(head);
+        }
+        _now++;
+
+        while(due.next != &due){
+            Timer& t = *due.next;
+            unlink(t);
+            _pending--;
+            onExpire(t);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class UnknownStore;
+
+// Unknown (unmapped) devices seen by the ingest, in fixed memory.
+//
+// Each tracked MAC keeps first/last seen, its last source address and
+// interface, and a 24 x 1 h ring of message counts, so the rolling 24-hour
+// count is a sum of buckets rather than a row per packet. All storage is
+// allocated up front for maxDevices entries; record() never allocates.
+//
+// When the registry is full a new MAC evicts an old one (segmented LRU). A
+// MAC seen once sits in a probation list; a second message promotes it to a
+// protected list holding up to 4/5 of the entries. Evictions come from the
+// probation end first, so a flood of spoofed one-off MACs churns through
+// probation while a real unregistered board that reports every few seconds
+// stays tracked.
+//
+// Not thread-safe: one registry per receive thread, or the caller serialises.
+class UnknownRegistry{
+public:
+    static constexpr uint8_t HOURS = 24;
+    static constexpr uint8_t MAX_INTERFACES = 8;
+
+    struct Device{
+        uint64_t mac;
+        int64_t firstSeenS;
+        int64_t lastSeenS;
+        uint32_t ip;            // IPv4, host byte order
+        uint16_t port;
+        uint8_t iface;          // index into interfaceName()
+        int64_t newestHour;     // hour (epoch s / 3600) of counts[newestHour % HOURS]
+        uint16_t counts[HOURS]; // messages per hour, saturating
+    };
+
+    explicit UnknownRegistry(size_t maxDevices);
+
+    // One datagram from an unmapped MAC.
+    void record(uint64_t mac, int64_t nowS, uint32_t ip, uint16_t port, const char* iface);
+
+    const Device* find(uint64_t mac) const;
+    uint32_t count24h(const Device& d, int64_t nowS) const;
+
+    size_t size() const {return _size;}
+    size_t capacity() const {return _entries.size();}
+    uint64_t evictions() const {return _evictions;}
+    const char* interfaceName(uint8_t idx) const;
+
+    // Tracked devices, in no particular order.
+    template <class Fn>
+    void forEach(Fn fn) const{
+        for(uint32_t i = 0; i < _entries.size(); i++){
+            if(_entries[i].mac != EMPTY) fn(_entries[i]);
+        }
+    }
+
+    // Writes every device whose row changed since the last flush (new
+    // traffic, or its 24 h count aged) to the store. Call periodically, not
+    // per packet. Returns the number of rows written.
+    size_t flush(UnknownStore& store, int64_t nowS);
+
+private:
+    static constexpr uint64_t EMPTY = ~0ULL;
+    static constexpr uint32_t NONE = ~0u;
+
+    struct Entry : Device{
+        uint32_t prev;          // LRU list, most recent at _head[list]
+        uint32_t next;
+        uint32_t flushedCount;  // 24 h count in the last flushed row
+        uint8_t list;
+        bool dirty;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<uint32_t> _index;   // open addressing, MAC -> entry
+    size_t _indexMask = 0;
+    std::vector<uint32_t> _free;
+    size_t _size = 0;
+
+    enum List : uint8_t {PROBATION = 0, PROTECTED = 1};
+    uint32_t _head[2] = {NONE, NONE};
+    uint32_t _tail[2] = {NONE, NONE};
+    size_t _listSize[2] = {0, 0};
+    size_t _protectedMax = 0;
+    uint64_t _evictions = 0;
+
+    char _ifaces[MAX_INTERFACES][16] = {};
+    uint8_t _ifaceCount = 0;
+
+    static uint64_t hash(uint64_t mac);
+    size_t slotOf(uint64_t mac) const;
+    void unlink(uint32_t i);
+    void pushFront(uint32_t i, uint8_t list);
+    void removeFromIndex(uint64_t mac);
+    uint32_t evict();
+    uint8_t internInterface(const char* iface);
+    static void roll(Device& d, int64_t hour);
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Where unknown-device state is persisted: the unknown_devices rows and the
+// time of the last 24 h summary. The PostgreSQL adapter maps upsert() to
+// INSERT ... ON CONFLICT (mac) DO UPDATE, keeping the earliest first_seen_ts.
+class UnknownStore{
+public:
+    struct Row{
+        uint64_t mac;
+        int64_t firstSeenS;
+        int64_t lastSeenS;
+        uint32_t count24h;
+        uint32_t ip;
+        uint16_t port;
+        const char* iface;
+    };
+
+    virtual ~UnknownStore() {}
+
+    virtual bool upsert(const Row* rows, size_t n) = 0;
+
+    // Epoch seconds of the last summary sent, 0 if never. Must survive restarts.
+    virtual int64_t lastSummaryS() = 0;
+    virtual bool setLastSummaryS(int64_t s) = 0;
+};
+
+// File-backed store for hosts without the database (and for tests). Rows are
+// appended to <dir>/unknown_devices.csv, one fsync per batch; the newest row
+// per MAC wins. The summary time lives in <dir>/unknown_summary.state and is
+// replaced atomically (write, fsync, rename).
+class FileUnknownStore : public UnknownStore{
+public:
+    explicit FileUnknownStore(const std::string& dir);
+
+    bool upsert(const Row* rows, size_t n) override;
+    int64_t lastSummaryS() override;
+    bool setLastSummaryS(int64_t s) override;
+
+    std::string rowsPath() const {return _dir + "/unknown_devices.csv";}
+    std::string statePath() const {return _dir + "/unknown_summary.state";}
+
+private:
+    std::string _dir;
+};
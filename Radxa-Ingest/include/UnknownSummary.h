@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+class UnknownRegistry;
+class UnknownStore;
+
+// The warning-level unknown-device notification, at most once per 24 h.
+//
+// The limit is enforced from the store's persisted state, not from memory,
+// so restarting the ingest (or running several) cannot send a second one.
+// The new summary time is persisted before the text is handed out: a crash
+// in between loses one summary rather than sending two.
+class UnknownSummary{
+public:
+    static constexpr int64_t PERIOD_S = 24 * 3600;
+    static constexpr unsigned TOP_DEVICES = 10;
+
+    // True (and out filled) if a summary is due and there is something to
+    // report. False if the last one is less than PERIOD_S old, no unknown
+    // device was seen in the last 24 h, or the state could not be saved.
+    static bool generate(const UnknownRegistry& reg, UnknownStore& store, int64_t nowS, std::string& out);
+};
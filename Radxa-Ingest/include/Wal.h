@@ -0,0 +1,189 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+#include "MpscQueue.h"
+
+// Local write-ahead log between the receive threads and the database, so a
+// slow or absent database never blocks ingestion.
+//
+// Records are opaque byte strings (the decoded rows) numbered by a log
+// sequence number (LSN) from 1. On disk they live in segment files
+// <dir>/wal-<first LSN, 16 hex digits>.log, each record framed as
+//   u32 length | u32 CRC-32 of (LSN, payload) | u64 LSN | payload
+// in host byte order. Only the newest segment is ever written.
+
+// Writer side. Receive threads append() into a lock-free MPSC queue and
+// return at once; one writer thread drains the queue into batches and makes
+// each batch durable with a single write() + fdatasync() (group commit).
+// A batch is committed when it reaches maxBatchBytes or when its oldest
+// record has waited maxDelayUs, whichever comes first; records that arrive
+// during an fsync ride in the next batch.
+class WalWriter{
+public:
+    static constexpr size_t MAX_RECORD = 240;
+    static constexpr size_t HEADER = 16;
+
+    struct Options{
+        std::string dir;
+        size_t queueCapacity = 1 << 16;
+        uint32_t maxDelayUs = 2000;
+        size_t maxBatchBytes = 1 << 20;
+        size_t segmentBytes = 64u << 20;
+        Metrics* metrics = nullptr;     // optional: queue depth and commit time
+    };
+
+    struct Stats{
+        uint64_t records;       // durable
+        uint64_t batches;       // = fsyncs of record data
+        uint64_t bytes;
+        uint64_t dropped;       // queue full or record too large
+        uint64_t segments;      // opened by this writer
+        uint64_t writeErrors;
+    };
+
+    explicit WalWriter(const Options& options);
+    ~WalWriter();
+    WalWriter(const WalWriter&) = delete;
+    WalWriter& operator=(const WalWriter&) = delete;
+
+    // Recovers the log (a torn record at the end of the newest segment, from
+    // a crash mid-write, is cut off) and starts the writer thread. False if
+    // the directory can't be used.
+    bool open();
+
+    // Commits everything queued so far and stops the writer thread.
+    void close();
+
+    // Any thread; never blocks. False (and counted as dropped) if the queue
+    // is full or len > MAX_RECORD.
+    bool append(const void* data, size_t len);
+
+    // Every record up to this LSN is on disk.
+    uint64_t durableLsn() const {return _durableLsn.load(std::memory_order_acquire);}
+
+    Stats stats() const;
+
+private:
+    struct Slot{
+        uint32_t len;
+        uint8_t data[MAX_RECORD];
+    };
+
+    Options _options;
+    MpscQueue<Slot> _queue;
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+
+    int _fd = -1;
+    size_t _segmentSize = 0;
+    uint64_t _nextLsn = 1;
+    std::vector<uint8_t> _batch;
+
+    std::atomic<uint64_t> _durableLsn{0};
+    std::atomic<uint64_t> _records{0};
+    std::atomic<uint64_t> _batches{0};
+    std::atomic<uint64_t> _bytes{0};
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _segments{0};
+    std::atomic<uint64_t> _writeErrors{0};
+
+    Metrics::Gauge* _queueDepth = nullptr;
+    Metrics::Histogram* _commitTime = nullptr;
+
+    void run();
+    size_t drain(uint64_t& batchFirstLsn);
+    bool commit();
+    bool openSegment(uint64_t firstLsn);
+};
+
+// Backing store for the loader, e.g. PostgreSQL via COPY ... FROM STDIN
+// inside a transaction. copy() must be all-or-nothing: true only once every
+// row is committed. After a failure or a crash the loader re-sends from its
+// last checkpoint, so the store must skip rows whose LSN it already has
+// (e.g. a unique lsn column with ON CONFLICT DO NOTHING).
+class BulkStore{
+public:
+    struct Row{
+        uint64_t lsn;
+        const uint8_t* data;
+        uint32_t len;
+    };
+
+    virtual ~BulkStore() {}
+    virtual bool copy(const Row* rows, size_t n) = 0;
+};
+
+// Replays the log into a BulkStore in batches. After each committed batch
+// the position (LSN, segment, offset) is written to <dir>/checkpoint with
+// write, fsync, rename, so a restarted loader resumes where the store left
+// off. Segments wholly below the checkpoint can then be deleted.
+class WalLoader{
+public:
+    // With metrics, the time of every copy() and the records durable but not
+    // yet loaded are exported.
+    WalLoader(const std::string& dir, BulkStore& store, size_t batchRows = 4096, Metrics* metrics = nullptr);
+    ~WalLoader();
+    WalLoader(const WalLoader&) = delete;
+    WalLoader& operator=(const WalLoader&) = delete;
+
+    // Reads the checkpoint. False if it exists but can't be parsed.
+    bool open();
+
+    // Sends the next batch of records with LSN <= maxLsn (pass the writer's
+    // durableLsn() so nothing not yet fsync'd is loaded). Returns the rows
+    // loaded, 0 if there was nothing to load, -1 if the store failed.
+    long loadOnce(uint64_t maxLsn);
+
+    // Deletes segments that are fully loaded, never the newest. Returns the
+    // number removed.
+    size_t removeLoaded();
+
+    // Background mode: loads whatever writer has made durable, backing off
+    // (up to maxBackoffMs) while the store fails.
+    void start(const WalWriter& writer, uint32_t idleMs = 10, uint32_t maxBackoffMs = 1000);
+    void stop();
+
+    uint64_t checkpointLsn() const {return _checkpointLsn.load(std::memory_order_acquire);}
+    uint64_t storeFailures() const {return _storeFailures.load(std::memory_order_relaxed);}
+
+private:
+    std::string _dir;
+    BulkStore& _store;
+    size_t _batchRows;
+
+    std::atomic<uint64_t> _checkpointLsn{0};
+    uint64_t _segment = 0;      // first LSN of the segment being read, 0 = none yet
+    uint64_t _offset = 0;
+    std::vector<uint8_t> _buf;
+    std::vector<BulkStore::Row> _rows;
+
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+    std::atomic<uint64_t> _storeFailures{0};
+
+    Metrics::Histogram* _copyTime = nullptr;
+    Metrics::Counter* _copyFailures = nullptr;
+    Metrics::Gauge* _backlog = nullptr;
+
+    bool saveCheckpoint(uint64_t lsn, uint64_t segment, uint64_t offset);
+    bool nextSegment();
+};
+
+namespace wal {
+
+// First LSNs of the segments in dir, ascending.
+std::vector<uint64_t> listSegments(const std::string& dir);
+std::string segmentPath(const std::string& dir, uint64_t firstLsn);
+uint32_t crc32(uint32_t crc, const void* data, size_t len);
+
+// Parses the record at p (avail bytes). Returns its total size, or 0 if the
+// bytes there are not a whole valid record.
+size_t parseRecord(const uint8_t* p, size_t avail, BulkStore::Row& out);
+
+}
@@ -0,0 +1,216 @@
+#include "Capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr size_t FLUSH_BYTES = 256 * 1024;
+
+static size_t padded(size_t n){
+    return (n + 7) & ~(size_t)7;
+}
+
+namespace capture {
+
+uint8_t classify(const void* data, size_t len){
+    const char* p = (const char*)data;
+    const char* end = p + len;
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return (p < end && *p == '{') ? FLAG_JSON : 0;
+}
+
+// Parses the record at pos; its total size, or 0 if it is not whole.
+static size_t parseRecord(const uint8_t* base, size_t size, size_t pos, Packet& out){
+    if(pos + RECORD_HEADER > size) return 0;
+    const uint8_t* p = base + pos;
+    uint32_t total, len;
+    std::memcpy(&total, p, 4);
+    std::memcpy(&len, p + 4, 4);
+    if(len > MAX_PAYLOAD || total != padded(RECORD_HEADER + len) || pos + total > size) return 0;
+
+    std::memcpy(&out.tNs, p + 8, 8);
+    std::memcpy(&out.ip, p + 16, 4);
+    std::memcpy(&out.port, p + 20, 2);
+    out.flags = p[22];
+    out.data = p + RECORD_HEADER;
+    out.len = len;
+    return total;
+}
+
+}
+
+// ------------------
+// CaptureWriter
+// ------------------
+
+CaptureWriter::~CaptureWriter(){
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path, int64_t startNs){
+    close();
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0){
+        ::close(fd);
+        return false;
+    }
+
+    if(st.st_size == 0){
+        uint8_t header[capture::FILE_HEADER] = {};
+        std::memcpy(header, capture::MAGIC, 8);
+        const uint32_t version = capture::VERSION, headerSize = capture::FILE_HEADER;
+        std::memcpy(header + 8, &version, 4);
+        std::memcpy(header + 12, &headerSize, 4);
+        std::memcpy(header + 16, &startNs, 8);
+        if(::write(fd, header, sizeof(header)) != (ssize_t)sizeof(header)){
+            ::close(fd);
+            return false;
+        }
+        _startNs = startNs;
+    } else {
+        CaptureReader r;
+        if(!r.open(path)){
+            ::close(fd);
+            return false;
+        }
+        _startNs = r.startNs();
+        // Continue after the last whole record, dropping a torn one.
+        capture::Packet pkt;
+        while(r.next(pkt)) _records++;
+        const size_t end = r.position();
+        if(end < (size_t)st.st_size && ::ftruncate(fd, (off_t)end) != 0){
+            ::close(fd);
+            return false;
+        }
+    }
+
+    const off_t size = ::lseek(fd, 0, SEEK_END);
+    if(size < 0){
+        ::close(fd);
+        return false;
+    }
+    _fd = fd;
+    _size = (uint64_t)size;
+    _bufRecords = 0;
+    _buf.reserve(FLUSH_BYTES + capture::RECORD_HEADER + capture::MAX_PAYLOAD + 8);
+    return true;
+}
+
+bool CaptureWriter::append(uint64_t tNs, uint32_t ip, uint16_t port, const void* data, size_t len){
+    if(_fd < 0 || len > capture::MAX_PAYLOAD) return false;
+
+    const uint32_t total = (uint32_t)padded(capture::RECORD_HEADER + len);
+    if(_buf.size() + total > _bufferLimit && !flush()){
+        _refused++;
+        return false;
+    }
+
+    const uint32_t plen = (uint32_t)len;
+    uint8_t header[capture::RECORD_HEADER] = {};
+    std::memcpy(header, &total, 4);
+    std::memcpy(header + 4, &plen, 4);
+    std::memcpy(header + 8, &tNs, 8);
+    std::memcpy(header + 16, &ip, 4);
+    std::memcpy(header + 20, &port, 2);
+    header[22] = capture::classify(data, len);
+
+    _buf.insert(_buf.end(), header, header + sizeof(header));
+    _buf.insert(_buf.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+    _buf.resize(_buf.size() + (total - capture::RECORD_HEADER - len), 0);
+    _records++;
+    _bufRecords++;
+    // A failed write keeps the record buffered; flush() will try again.
+    if(_buf.size() >= FLUSH_BYTES) flush();
+    return true;
+}
+
+bool CaptureWriter::flush(){
+    if(_fd < 0) return false;
+    size_t done = 0;
+    while(done < _buf.size()){
+        const ssize_t n = ::pwrite(_fd, _buf.data() + done, _buf.size() - done, (off_t)(_size + done));
+        if(n > 0){
+            done += (size_t)n;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        // Cut off the part that got in, so the file ends on a whole record.
+        _writeErrors++;
+        if(done > 0){
+            const int rc = ::ftruncate(_fd, (off_t)_size);
+            (void)rc;
+        }
+        return false;
+    }
+    _size += _buf.size();
+    _buf.clear();
+    _bufRecords = 0;
+    return true;
+}
+
+bool CaptureWriter::close(){
+    if(_fd < 0) return true;
+    const bool ok = flush();
+    ::close(_fd);
+    _fd = -1;
+    _buf.clear();
+    _bufRecords = 0;
+    return ok;
+}
+
+// ------------------
+// CaptureReader
+// ------------------
+
+CaptureReader::~CaptureReader(){
+    close();
+}
+
+bool CaptureReader::open(const std::string& path){
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || (size_t)st.st_size < capture::FILE_HEADER){
+        ::close(fd);
+        return false;
+    }
+    void* base = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(base == MAP_FAILED) return false;
+
+    const uint8_t* p = (const uint8_t*)base;
+    uint32_t version;
+    std::memcpy(&version, p + 8, 4);
+    if(std::memcmp(p, capture::MAGIC, 8) != 0 || version != capture::VERSION){
+        ::munmap(base, (size_t)st.st_size);
+        return false;
+    }
+    ::madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    _base = p;
+    _size = (size_t)st.st_size;
+    std::memcpy(&_startNs, p + 16, 8);
+    rewind();
+    return true;
+}
+
+void CaptureReader::close(){
+    if(_base) ::munmap((void*)_base, _size);
+    _base = nullptr;
+    _size = 0;
+}
+
+bool CaptureReader::next(capture::Packet& out){
+    if(!_base) return false;
+    const size_t n = capture::parseRecord(_base, _size, _pos, out);
+    if(n == 0) return false;
+    _pos += n;
+    return true;
+}
@@ -0,0 +1,52 @@
+#include "HashRing.h"
+
+#include <algorithm>
+
+HashRing::HashRing(unsigned nodes) : _alive(nodes, true){
+    rebuild();
+}
+
+uint64_t HashRing::hash(uint64_t x){
+    // splitmix64 finaliser, as in RackTable.
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void HashRing::rebuild(){
+    _points.clear();
+    for(unsigned n = 0; n < _alive.size(); n++){
+        if(!_alive[n]) continue;
+        for(unsigned v = 0; v < VNODES; v++){
+            // Distinct from any MAC's hash input: MACs are 48-bit.
+            _points.push_back(Point{hash((uint64_t)(n + 1) << 48 | v), n});
+        }
+    }
+    std::sort(_points.begin(), _points.end(), [](const Point& a, const Point& b){
+        return a.hash < b.hash || (a.hash == b.hash && a.node < b.node);
+    });
+}
+
+bool HashRing::setAlive(unsigned node, bool alive){
+    if(node >= _alive.size() || _alive[node] == alive) return false;
+    _alive[node] = alive;
+    rebuild();
+    return true;
+}
+
+unsigned HashRing::liveNodes() const{
+    return (unsigned)std::count(_alive.begin(), _alive.end(), true);
+}
+
+unsigned HashRing::owner(uint64_t mac) const{
+    if(_points.empty()) return NONE;
+    const uint64_t h = hash(mac);
+    auto it = std::lower_bound(_points.begin(), _points.end(), h, [](const Point& p, uint64_t v){
+        return p.hash < v;
+    });
+    if(it == _points.end()) it = _points.begin();
+    return it->node;
+}
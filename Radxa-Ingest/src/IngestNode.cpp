@@ -0,0 +1,424 @@
+#include "IngestNode.h"
+#include "Mac.h"
+#include "TelemetryFields.h"
+#include "TelemetryRow.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static constexpr char FORWARD[4] = {'R', 'X', 'F', '1'};
+static constexpr char HEARTBEAT[4] = {'R', 'X', 'H', '1'};
+static constexpr char CONTROL[4] = {'R', 'X', 'C', '1'};
+static constexpr size_t FORWARD_HEADER = 12;
+static constexpr size_t MAX_FORWARD = 1472;
+static_assert(TelemetryRow::MAX_BYTES <= WalWriter::MAX_RECORD, "a row fits one WAL record");
+
+static int64_t clockMs(clockid_t clock){
+    timespec ts;
+    ::clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static sockaddr_in toAddr(uint32_t ip, uint16_t port){
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(ip);
+    a.sin_port = htons(port);
+    return a;
+}
+
+IngestNode::~IngestNode(){
+    if(_fd >= 0) ::close(_fd);
+}
+
+bool IngestNode::open(const Options& options){
+    _options = options;
+    if(_options.self >= _options.peers.size()) return false;
+
+    _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if(_fd < 0) return false;
+    const int buf = 8 << 20;
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    ::setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    const timeval tv = {0, 10000};
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    const Peer& me = _options.peers[_options.self];
+    const sockaddr_in addr = toAddr(me.ip, me.port);
+    if(::bind(_fd, (const sockaddr*)&addr, sizeof(addr)) != 0) return false;
+
+    // Every peer counts as alive until it has had deadAfterMs to say so.
+    _ring = HashRing((unsigned)_options.peers.size());
+    _lastHeardMs.assign(_options.peers.size(), clockMs(CLOCK_MONOTONIC));
+    if(_options.rackMap) _reader = _options.rackMap->addReader();
+    _forwards.reserve(BATCH);
+    return true;
+}
+
+IngestNode::Stats IngestNode::stats() const{
+    Stats s = _stats;
+    s.liveNodes = _ring.liveNodes();
+    return s;
+}
+
+void IngestNode::registerMetrics(){
+    Metrics& m = *_options.metrics;
+    const std::string port = Metrics::label("port", std::to_string(_options.peers[_options.self].port));
+    const std::string thread = port + "," + Metrics::label("thread", std::to_string(Metrics::threadIndex()));
+    _m.packets = &m.counter("ingest_packets_total", "Datagrams received, per port and receive thread.", thread);
+    _m.bytes = &m.counter("ingest_bytes_total", "Datagram bytes received, per port and receive thread.", thread);
+    _m.noMac = &m.counter("ingest_parse_failures_total", "Device datagrams that could not be used, by reason.",
+        "reason=\"no_mac\"");
+    _m.notTelemetry = &m.counter("ingest_parse_failures_total", "Device datagrams that could not be used, by reason.",
+        "reason=\"not_telemetry\"");
+    _m.unknownMac = &m.counter("ingest_unknown_mac_total", "Datagrams from MACs missing from device_map.");
+    _m.duplicates = &m.counter("ingest_stitch_dropped_total", "Samples dropped by the stream stitcher, by reason.",
+        "reason=\"duplicate\"");
+    _m.overlaps = &m.counter("ingest_stitch_dropped_total", "Samples dropped by the stream stitcher, by reason.",
+        "reason=\"overlap\"");
+    _m.rows = &m.counter("ingest_rows_total", "Telemetry rows handed to the WAL.");
+    _m.rowsDropped = &m.counter("ingest_rows_dropped_total", "Telemetry rows the WAL refused (queue full).");
+    static const char* const EVENTS[3] = {"type=\"device_down\"", "type=\"device_up\"", "type=\"failover\""};
+    for(unsigned i = 0; i < 3; i++){
+        _m.deviceEvents[i] = &m.counter("ingest_device_events_total", "Liveness events, by type.", EVENTS[i]);
+    }
+    _m.forwardedOut = &m.counter("ingest_forwarded_total", "Datagrams passed between ingest nodes.",
+        "direction=\"out\"");
+    _m.forwardedIn = &m.counter("ingest_forwarded_total", "Datagrams passed between ingest nodes.",
+        "direction=\"in\"");
+    _m.timeRequests = &m.counter("ingest_time_requests_total", "Clock-sync requests answered.");
+    _m.liveNodes = &m.gauge("ingest_live_nodes", "Ingest nodes on the hash ring, this one included.");
+    _m.batchTime = &m.histogram("ingest_batch_seconds", "Time to handle one receive batch.");
+    m.collect("ingest_rack_last_seen_seconds", "Seconds since this node last processed telemetry from the rack.",
+        [this](const Metrics::Emit& emit){
+            const int64_t now = clockMs(CLOCK_MONOTONIC);
+            std::lock_guard<std::mutex> lock(_seenMutex);
+            for(const auto& kv : _rackSeenMs) emit(Metrics::label("rack", kv.first), (double)(now - kv.second) / 1e3);
+        });
+}
+
+void IngestNode::run(const std::atomic<bool>& stop){
+    static constexpr size_t BUF = 65536;
+    std::vector<uint8_t> bufs(BATCH * BUF);
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    sockaddr_in from[BATCH];
+    if(_options.metrics && !_m.packets) registerMetrics();
+
+    while(!stop.load(std::memory_order_relaxed)){
+        for(size_t i = 0; i < BATCH; i++){
+            iov[i] = {bufs.data() + i * BUF, BUF};
+            msgs[i].msg_hdr = {};
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int n = ::recvmmsg(_fd, msgs, BATCH, MSG_WAITFORONE, nullptr);
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        const int64_t nowMs = clockMs(CLOCK_MONOTONIC);
+        const int64_t wallMs = clockMs(CLOCK_REALTIME);
+        for(int i = 0; i < n; i++){
+            if(_m.packets){
+                _m.packets->add();
+                _m.bytes->add(msgs[i].msg_len);
+            }
+            handle(bufs.data() + (size_t)i * BUF, msgs[i].msg_len, ntohl(from[i].sin_addr.s_addr),
+                ntohs(from[i].sin_port), nowMs, wallMs);
+        }
+        flushForwards();
+        tick(nowMs, wallMs);
+        if(_m.batchTime && n > 0){
+            _m.batchTime->record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+        }
+    }
+
+    // Whatever the stitcher still holds goes out now, not with the next run.
+    drainPipeline(INT64_MAX);
+    if(_options.unknown && _options.unknownStore){
+        _options.unknown->flush(*_options.unknownStore, clockMs(CLOCK_REALTIME) / 1000);
+    }
+}
+
+void IngestNode::handle(const uint8_t* data, size_t len, uint32_t ip, uint16_t port, int64_t nowMs,
+    int64_t wallMs){
+    if(len >= 4 && std::memcmp(data, HEARTBEAT, 4) == 0){
+        uint32_t node;
+        if(len < 8) return;
+        std::memcpy(&node, data + 4, 4);
+        if(node >= _lastHeardMs.size() || node == _options.self) return;
+        _lastHeardMs[node] = nowMs;
+        if(_ring.setAlive(node, true)) _stats.ringChanges++;
+        return;
+    }
+
+    if(len >= FORWARD_HEADER && std::memcmp(data, FORWARD, 4) == 0){
+        _stats.forwardedIn++;
+        if(_m.forwardedIn) _m.forwardedIn->add();
+        // The device's address, as the receiving node saw it.
+        uint32_t srcIp;
+        uint16_t srcPort;
+        std::memcpy(&srcIp, data + 4, 4);
+        std::memcpy(&srcPort, data + 8, 2);
+        const uint8_t* payload = data + FORWARD_HEADER;
+        const size_t plen = len - FORWARD_HEADER;
+        const uint64_t mac = findDeviceMac((const char*)payload, plen);
+        if(mac != MAC_INVALID && _ring.owner(mac) != _options.self) _stats.misrouted++;
+        process(payload, plen, mac, srcIp, srcPort, nowMs, wallMs);
+        return;
+    }
+
+    if(len >= 4 && std::memcmp(data, CONTROL, 4) == 0){
+        if(len == 9 && std::memcmp(data + 4, "stats", 5) == 0){
+            const Stats s = stats();
+            char line[448];
+            const int n = std::snprintf(line, sizeof(line),
+                "node=%u live=%u received=%llu processed=%llu forwarded_out=%llu forwarded_in=%llu "
+                "misrouted=%llu time_requests=%llu no_mac=%llu unknown_rack=%llu ring_changes=%llu "
+                "not_telemetry=%llu duplicates=%llu overlaps=%llu rows=%llu rows_dropped=%llu\n",
+                _options.self, s.liveNodes, (unsigned long long)s.received, (unsigned long long)s.processed,
+                (unsigned long long)s.forwardedOut, (unsigned long long)s.forwardedIn,
+                (unsigned long long)s.misrouted, (unsigned long long)s.timeRequests,
+                (unsigned long long)s.noMac, (unsigned long long)s.unknownRack,
+                (unsigned long long)s.ringChanges, (unsigned long long)s.notTelemetry,
+                (unsigned long long)s.duplicates, (unsigned long long)s.overlaps, (unsigned long long)s.rows,
+                (unsigned long long)s.rowsDropped);
+            reply(line, (size_t)n, ip, port);
+        }
+        return;
+    }
+
+    _stats.received++;
+    if(memmem(data, len, "\"time_request\"", 14)){
+        answerTime(data, len, ip, port);
+        // Standby controllers send nothing else. A device not yet seen in
+        // telemetry here is not tracked, and onPacket() ignores it.
+        if(_options.liveness){
+            const uint64_t mac = findDeviceMac((const char*)data, len);
+            if(mac != MAC_INVALID) _options.liveness->onPacket(mac, nowMs, false);
+        }
+        return;
+    }
+
+    const uint64_t mac = findDeviceMac((const char*)data, len);
+    const unsigned owner = (mac == MAC_INVALID) ? _options.self : _ring.owner(mac);
+    if(owner == _options.self || owner == HashRing::NONE || len > MAX_FORWARD){
+        process(data, len, mac, ip, port, nowMs, wallMs);
+    } else {
+        forward(owner, data, len, ip, port);
+    }
+}
+
+void IngestNode::process(const uint8_t* data, size_t len, uint64_t mac, uint32_t ip, uint16_t port,
+    int64_t nowMs, int64_t wallMs){
+    _stats.processed++;
+    if(mac == MAC_INVALID){
+        _stats.noMac++;
+        if(_m.noMac) _m.noMac->add();
+        return;
+    }
+    _counts[mac]++;
+
+    TelemetryFields f;
+    if(!parseTelemetryFields((const char*)data, len, f)){
+        _stats.notTelemetry++;
+        if(_m.notTelemetry) _m.notTelemetry->add();
+        return;
+    }
+    // Until the device has synced its clock, its sample sits at arrival time.
+    const StreamStitcher::Sample sample = {mac, f.controller, f.seq, f.epochMs ? f.epochMs : wallMs, f.leader,
+        f.term, ip, port};
+    const uint8_t unsynced = f.epochMs ? 0 : TelemetryRow::UNSYNCED;
+    if(!_reader){
+        writeRow("", sample, unsynced | TelemetryRow::UNSTITCHED, data, len);
+        return;
+    }
+
+    RackMap::ReadSection s(*_options.rackMap, *_reader);
+    const char* rack = s.rackId(mac);
+    if(rack == RackMap::UNKNOWN){
+        _stats.unknownRack++;
+        if(_m.unknownMac) _m.unknownMac->add();
+        if(_options.unknown) _options.unknown->record(mac, wallMs / 1000, ip, port, nullptr);
+        writeRow(rack, sample, unsynced | TelemetryRow::UNMAPPED | TelemetryRow::UNSTITCHED, data, len);
+        return;
+    }
+
+    if(_options.liveness && !_options.liveness->onPacket(mac, nowMs, true)){
+        _options.liveness->addDevice(mac, rack, f.controller);
+        _options.liveness->onPacket(mac, nowMs, true);
+    }
+    if(_m.packets){
+        std::lock_guard<std::mutex> lock(_seenMutex);
+        _rackSeenMs[rack] = nowMs;
+    }
+
+    if(_options.stitcher){
+        switch(_options.stitcher->add(rack, sample, data, len, wallMs)){
+        case StreamStitcher::Verdict::ACCEPTED:
+        case StreamStitcher::Verdict::REPLACED:
+            return;
+        case StreamStitcher::Verdict::DUPLICATE:
+            _stats.duplicates++;
+            if(_m.duplicates) _m.duplicates->add();
+            return;
+        case StreamStitcher::Verdict::OVERLAP:
+            _stats.overlaps++;
+            if(_m.overlaps) _m.overlaps->add();
+            return;
+        case StreamStitcher::Verdict::UNSTITCHED:
+            break;
+        }
+    }
+    writeRow(rack, sample, unsynced | TelemetryRow::UNSTITCHED, data, len);
+}
+
+void IngestNode::writeRow(const char* rack, const StreamStitcher::Sample& s, uint8_t flags, const uint8_t* data,
+    size_t len){
+    if(!_options.wal) return;
+    TelemetryRow row;
+    row.mac = s.mac;
+    row.timeMs = s.timeMs;
+    row.seq = s.seq;
+    row.ip = s.ip;
+    row.port = s.port;
+    row.controller = s.controller;
+    row.flags = flags;
+    parseTemperatures((const char*)data, len, row.temps);
+    std::strncpy(row.rack, rack, TelemetryRow::MAX_RACK);
+    row.rack[TelemetryRow::MAX_RACK] = 0;
+
+    uint8_t buf[TelemetryRow::MAX_BYTES];
+    if(_options.wal->append(buf, encodeRow(row, buf))){
+        _stats.rows++;
+        if(_m.rows) _m.rows->add();
+    } else {
+        _stats.rowsDropped++;
+        if(_m.rowsDropped) _m.rowsDropped->add();
+    }
+}
+
+void IngestNode::drainPipeline(int64_t wallMs){
+    if(!_options.stitcher) return;
+    _options.stitcher->drain(wallMs, [this](const StreamStitcher::Point& p){
+        uint8_t flags = 0;
+        if(p.designated) flags |= TelemetryRow::DESIGNATED;
+        if(p.replaced) flags |= TelemetryRow::REPLACED;
+        if(p.late) flags |= TelemetryRow::LATE;
+        TelemetryFields f;
+        if(parseTelemetryFields((const char*)p.data, p.len, f) && !f.epochMs) flags |= TelemetryRow::UNSYNCED;
+        writeRow(p.rack, p.sample, flags, p.data, p.len);
+    });
+}
+
+void IngestNode::forward(unsigned node, const uint8_t* data, size_t len, uint32_t ip, uint16_t port){
+    if(_forwards.size() == BATCH) flushForwards();
+    _forwards.emplace_back();
+    Forward& f = _forwards.back();
+    f.node = node;
+    f.len = (uint32_t)(FORWARD_HEADER + len);
+    std::memcpy(f.data, FORWARD, 4);
+    std::memcpy(f.data + 4, &ip, 4);
+    std::memcpy(f.data + 8, &port, 2);
+    f.data[10] = f.data[11] = 0;
+    std::memcpy(f.data + FORWARD_HEADER, data, len);
+    _stats.forwardedOut++;
+    if(_m.forwardedOut) _m.forwardedOut->add();
+}
+
+void IngestNode::flushForwards(){
+    if(_forwards.empty()) return;
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    sockaddr_in to[BATCH];
+    const size_t n = _forwards.size();
+    for(size_t i = 0; i < n; i++){
+        const Peer& p = _options.peers[_forwards[i].node];
+        to[i] = toAddr(p.ip, p.port);
+        iov[i] = {_forwards[i].data, _forwards[i].len};
+        msgs[i].msg_hdr = {};
+        msgs[i].msg_hdr.msg_name = &to[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t sent = 0;
+    while(sent < n){
+        const int k = ::sendmmsg(_fd, msgs + sent, (unsigned)(n - sent), 0);
+        sent += (k > 0) ? (size_t)k : 1;    // a peer that refuses is skipped
+    }
+    _forwards.clear();
+}
+
+void IngestNode::answerTime(const uint8_t* data, size_t len, uint32_t ip, uint16_t port){
+    _stats.timeRequests++;
+    if(_m.timeRequests) _m.timeRequests->add();
+    const uint64_t t1 = (uint64_t)clockMs(CLOCK_REALTIME);
+
+    // "t0_ms": <n>, echoed back so the device can match the reply.
+    const char* key = (const char*)memmem(data, len, "\"t0_ms\"", 7);
+    if(!key) return;
+    const char* p = key + 7;
+    const char* end = (const char*)data + len;
+    while(p < end && (*p == ' ' || *p == ':')) p++;
+    char digits[24] = {};
+    for(size_t i = 0; p < end && i + 1 < sizeof(digits) && *p >= '0' && *p <= '9'; i++) digits[i] = *p++;
+    if(!digits[0]) return;
+
+    char out[160];
+    const int n = std::snprintf(out, sizeof(out),
+        "{\"message_type\": \"time_response\", \"t0_ms\": %s, \"t1_ms\": %llu, \"t2_ms\": %llu}",
+        digits, (unsigned long long)t1, (unsigned long long)clockMs(CLOCK_REALTIME));
+    reply(out, (size_t)n, ip, port);
+}
+
+void IngestNode::reply(const char* text, size_t len, uint32_t ip, uint16_t port){
+    const sockaddr_in to = toAddr(ip, port);
+    ::sendto(_fd, text, len, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+void IngestNode::tick(int64_t nowMs, int64_t wallMs){
+    if(nowMs - _lastHeartbeatMs >= _options.heartbeatMs){
+        _lastHeartbeatMs = nowMs;
+        uint8_t hb[8];
+        const uint32_t self = _options.self;
+        std::memcpy(hb, HEARTBEAT, 4);
+        std::memcpy(hb + 4, &self, 4);
+        for(unsigned i = 0; i < _options.peers.size(); i++){
+            if(i == _options.self) continue;
+            const sockaddr_in to = toAddr(_options.peers[i].ip, _options.peers[i].port);
+            ::sendto(_fd, hb, sizeof(hb), 0, (const sockaddr*)&to, sizeof(to));
+        }
+    }
+
+    for(unsigned i = 0; i < _lastHeardMs.size(); i++){
+        if(i == _options.self) continue;
+        if(nowMs - _lastHeardMs[i] > _options.deadAfterMs && _ring.setAlive(i, false)) _stats.ringChanges++;
+    }
+    if(_m.liveNodes) _m.liveNodes->set(_ring.liveNodes());
+
+    drainPipeline(wallMs);
+    if(_options.liveness){
+        _options.liveness->advance(nowMs);
+        _options.liveness->takeEvents(_events);
+        for(const LivenessTracker::Event& e : _events){
+            if(e.type == LivenessTracker::EventType::DEVICE_DOWN) _stats.devicesDown++;
+            if(e.type == LivenessTracker::EventType::FAILOVER) _stats.failovers++;
+            if(_m.deviceEvents[(unsigned)e.type]) _m.deviceEvents[(unsigned)e.type]->add();
+        }
+        _events.clear();
+    }
+    if(_options.unknown && _options.unknownStore && nowMs - _lastUnknownFlushMs >= _options.unknownFlushMs){
+        _lastUnknownFlushMs = nowMs;
+        _options.unknown->flush(*_options.unknownStore, wallMs / 1000);
+    }
+}
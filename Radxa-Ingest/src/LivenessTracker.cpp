@@ -0,0 +1,111 @@
+#include "LivenessTracker.h"
+#include "Mac.h"
+
+LivenessTracker::LivenessTracker(uint32_t timeoutMs, uint32_t tickMs, int64_t nowMs)
+    : _timeoutMs(timeoutMs), _tickMs(tickMs ? tickMs : 1), _wheel(tickOf(nowMs)),
+      _index(16, NONE), _indexMask(15) {}
+
+uint64_t LivenessTracker::hash(uint64_t mac){
+    // splitmix64 finaliser, as in RackTable.
+    mac ^= mac >> 30;
+    mac *= 0xbf58476d1ce4e5b9ULL;
+    mac ^= mac >> 27;
+    mac *= 0x94d049bb133111ebULL;
+    mac ^= mac >> 31;
+    return mac;
+}
+
+uint64_t LivenessTracker::tickOf(int64_t ms) const{
+    return (ms <= 0) ? 0 : (uint64_t)ms / _tickMs;
+}
+
+size_t LivenessTracker::slotOf(uint64_t mac) const{
+    size_t i = hash(mac) & _indexMask;
+    while(_index[i] != NONE && _devices[_index[i]].mac != mac) i = (i + 1) & _indexMask;
+    return i;
+}
+
+void LivenessTracker::growIndex(){
+    std::vector<uint32_t> old(_index.size() * 2, NONE);
+    old.swap(_index);
+    _indexMask = _index.size() - 1;
+    for(uint32_t d : old){
+        if(d != NONE) _index[slotOf(_devices[d].mac)] = d;
+    }
+}
+
+void LivenessTracker::addDevice(uint64_t mac, const std::string& rackId, char controller){
+    if(mac == MAC_INVALID) return;
+
+    uint32_t rack;
+    auto it = _rackIndex.find(rackId);
+    if(it != _rackIndex.end()){
+        rack = it->second;
+    } else {
+        rack = (uint32_t)_racks.size();
+        _racks.emplace_back();
+        _racks.back().name = rackId;
+        _rackIndex.emplace(rackId, rack);
+    }
+
+    const size_t slot = slotOf(mac);
+    if(_index[slot] != NONE){
+        Device& d = _devices[_index[slot]];
+        d.rack = rack;
+        d.controller = controller;
+        return;
+    }
+
+    _devices.emplace_back();
+    Device& d = _devices.back();
+    d.mac = mac;
+    d.rack = rack;
+    d.controller = controller;
+    d.timer.id = (uint32_t)(_devices.size() - 1);
+    _index[slot] = d.timer.id;
+    if(_devices.size() * 2 > _index.size()) growIndex();
+}
+
+bool LivenessTracker::onPacket(uint64_t mac, int64_t nowMs, bool telemetry){
+    const uint32_t i = _index[slotOf(mac)];
+    if(i == NONE) return false;
+
+    Device& d = _devices[i];
+    d.lastSeenMs = nowMs;
+    // Round the deadline up so the device is never declared down early.
+    const int64_t deadline = nowMs + _timeoutMs;
+    _wheel.schedule(d.timer, tickOf(deadline + _tickMs - 1));
+
+    if(!d.up){
+        d.up = true;
+        _up++;
+        _events.push_back(Event{EventType::DEVICE_UP, nowMs, mac, d.controller, 0, 0, 0, _racks[d.rack].name.c_str()});
+    }
+
+    if(telemetry){
+        Rack& r = _racks[d.rack];
+        if(r.sender != NONE && r.sender != i){
+            const Device& from = _devices[r.sender];
+            _events.push_back(Event{EventType::FAILOVER, nowMs, mac, d.controller,
+                from.mac, from.controller, nowMs - r.lastTelemetryMs, r.name.c_str()});
+        }
+        r.sender = i;
+        r.lastTelemetryMs = nowMs;
+    }
+    return true;
+}
+
+void LivenessTracker::advance(int64_t nowMs){
+    _wheel.advance(tickOf(nowMs), [this](TimerWheel::Timer& t){
+        Device& d = _devices[t.id];
+        d.up = false;
+        _up--;
+        _events.push_back(Event{EventType::DEVICE_DOWN, d.lastSeenMs + _timeoutMs, d.mac, d.controller,
+            0, 0, 0, _racks[d.rack].name.c_str()});
+    });
+}
+
+void LivenessTracker::takeEvents(std::vector<Event>& out){
+    out.insert(out.end(), _events.begin(), _events.end());
+    _events.clear();
+}
@@ -0,0 +1,56 @@
+#include "Mac.h"
+
+#include <cstring>
+
+static int hexDigit(char c){
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+uint64_t parseMac(const char* s, size_t len){
+    if(!s || len != 17) return MAC_INVALID;
+
+    uint64_t mac = 0;
+    for(size_t i = 0; i < 6; i++){
+        const char* p = s + i * 3;
+        if(i > 0 && p[-1] != ':' && p[-1] != '-') return MAC_INVALID;
+        const int hi = hexDigit(p[0]);
+        const int lo = hexDigit(p[1]);
+        if(hi < 0 || lo < 0) return MAC_INVALID;
+        mac = (mac << 8) | (uint64_t)(hi << 4 | lo);
+    }
+    return mac;
+}
+
+const char* findDeviceMacText(const char* data, size_t len){
+    static const char KEY[] = "\"mac\"";
+    const char* p = (const char*)memmem(data, len, KEY, sizeof(KEY) - 1);
+    if(!p) return nullptr;
+
+    const char* end = data + len;
+    p += sizeof(KEY) - 1;
+    while(p < end && (*p == ' ' || *p == ':')) p++;
+    if(p >= end || *p != '"') return nullptr;
+    p++;
+
+    const char* close = (const char*)memchr(p, '"', (size_t)(end - p));
+    if(!close || parseMac(p, (size_t)(close - p)) == MAC_INVALID) return nullptr;
+    return p;
+}
+
+uint64_t findDeviceMac(const char* data, size_t len){
+    const char* p = findDeviceMacText(data, len);
+    return p ? parseMac(p, 17) : MAC_INVALID;
+}
+
+void formatMac(uint64_t mac, char out[18]){
+    static const char HEX[] = "0123456789ABCDEF";
+    for(int i = 0; i < 6; i++){
+        const uint8_t b = (uint8_t)(mac >> (40 - 8 * i));
+        out[i * 3] = HEX[b >> 4];
+        out[i * 3 + 1] = HEX[b & 0x0F];
+        out[i * 3 + 2] = (i < 5) ? ':' : '\0';
+    }
+}
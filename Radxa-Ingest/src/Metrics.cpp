@@ -0,0 +1,248 @@
+#include "Metrics.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+// Power-of-two `le` bounds of the exposition: 2^10 ns (~1 us) to 2^36 ns (~69 s).
+static constexpr unsigned LE_MIN_BITS = 10;
+static constexpr unsigned LE_MAX_BITS = 36;
+
+uint64_t Metrics::Counter::value() const{
+    uint64_t v = 0;
+    for(const Cell& c : _cells) v += c.v.load(std::memory_order_relaxed);
+    return v;
+}
+
+uint64_t Metrics::Histogram::bucketLow(unsigned b){
+    if(b < (1u << SUB_BITS)) return b;
+    const unsigned e = (b >> SUB_BITS) + SUB_BITS - 1;
+    const uint64_t sub = b & ((1u << SUB_BITS) - 1);
+    return ((1ull << SUB_BITS) + sub) << (e - SUB_BITS);
+}
+
+uint64_t Metrics::Histogram::bucketHigh(unsigned b){
+    if(b < (1u << SUB_BITS)) return b;
+    const unsigned e = (b >> SUB_BITS) + SUB_BITS - 1;
+    return bucketLow(b) + (1ull << (e - SUB_BITS)) - 1;
+}
+
+void Metrics::Histogram::snapshot(uint64_t* counts) const{
+    std::memset(counts, 0, sizeof(uint64_t) * BUCKETS);
+    for(unsigned s = 0; s <= SHARDS; s++){
+        for(unsigned b = 0; b < BUCKETS; b++) counts[b] += _shards[s].buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t Metrics::Histogram::count() const{
+    uint64_t counts[BUCKETS];
+    snapshot(counts);
+    uint64_t n = 0;
+    for(uint64_t c : counts) n += c;
+    return n;
+}
+
+uint64_t Metrics::Histogram::sum() const{
+    uint64_t v = 0;
+    for(unsigned s = 0; s <= SHARDS; s++) v += _shards[s].sum.load(std::memory_order_relaxed);
+    return v;
+}
+
+uint64_t Metrics::Histogram::percentile(double p) const{
+    uint64_t counts[BUCKETS];
+    snapshot(counts);
+    uint64_t total = 0;
+    for(uint64_t c : counts) total += c;
+    if(total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)total + 0.999999);
+    if(rank < 1) rank = 1;
+    if(rank > total) rank = total;
+    uint64_t seen = 0;
+    for(unsigned b = 0; b < BUCKETS; b++){
+        seen += counts[b];
+        if(seen >= rank) return bucketHigh(b);
+    }
+    return bucketHigh(BUCKETS - 1);
+}
+
+uint64_t Metrics::Histogram::countBelow(uint64_t limit) const{
+    uint64_t counts[BUCKETS];
+    snapshot(counts);
+    uint64_t n = 0;
+    const unsigned end = bucketOf(limit);
+    for(unsigned b = 0; b < end; b++) n += counts[b];
+    return n;
+}
+
+// Bit i set: shard i is owned by a live thread.
+static std::atomic<uint32_t> gShardsTaken{0};
+static_assert(Metrics::SHARDS <= 32, "one bit per shard");
+
+namespace{
+struct ShardClaim{
+    unsigned index = Metrics::SHARDS;
+
+    ShardClaim(){
+        uint32_t taken = gShardsTaken.load(std::memory_order_relaxed);
+        for(;;){
+            const uint32_t free = ~taken & ((1ull << Metrics::SHARDS) - 1);
+            if(!free) return;
+            const unsigned i = (unsigned)__builtin_ctz(free);
+            if(gShardsTaken.compare_exchange_weak(taken, taken | (1u << i), std::memory_order_acquire)){
+                index = i;
+                return;
+            }
+        }
+    }
+    // The next owner's first load sees this thread's last stores.
+    ~ShardClaim(){
+        if(index < Metrics::SHARDS) gShardsTaken.fetch_and(~(1u << index), std::memory_order_release);
+    }
+};
+}
+
+unsigned Metrics::claimShard(){
+    thread_local const ShardClaim claim;
+    return claim.index;
+}
+
+unsigned Metrics::threadIndex(){
+    static std::atomic<unsigned> next{0};
+    thread_local const unsigned index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+std::string Metrics::label(const char* key, const std::string& value){
+    std::string s = key;
+    s += "=\"";
+    for(char c : value){
+        if(c == '\\' || c == '"') s += '\\';
+        if(c == '\n'){
+            s += "\\n";
+            continue;
+        }
+        s += c;
+    }
+    s += '"';
+    return s;
+}
+
+Metrics::Series& Metrics::series(const char* name, const char* help, Type type, const std::string& labels){
+    std::lock_guard<std::mutex> lock(_mutex);
+    Family* f = nullptr;
+    for(Family& x : _families){
+        if(x.name == name){
+            f = &x;
+            break;
+        }
+    }
+    if(!f){
+        _families.emplace_back();
+        f = &_families.back();
+        f->name = name;
+        f->help = help;
+        f->type = type;
+    }
+    for(Series& s : f->series){
+        if(s.labels == labels) return s;
+    }
+    f->series.emplace_back();
+    Series& s = f->series.back();
+    s.labels = labels;
+    switch(type){
+    case Type::COUNTER: s.counter.reset(new Counter()); break;
+    case Type::GAUGE: s.gauge.reset(new Gauge()); break;
+    case Type::HISTOGRAM: s.histogram.reset(new Histogram()); break;
+    }
+    return s;
+}
+
+Metrics::Counter& Metrics::counter(const char* name, const char* help, const std::string& labels){
+    return *series(name, help, Type::COUNTER, labels).counter;
+}
+
+Metrics::Gauge& Metrics::gauge(const char* name, const char* help, const std::string& labels){
+    return *series(name, help, Type::GAUGE, labels).gauge;
+}
+
+Metrics::Histogram& Metrics::histogram(const char* name, const char* help, const std::string& labels){
+    return *series(name, help, Type::HISTOGRAM, labels).histogram;
+}
+
+void Metrics::collect(const char* name, const char* help, Collect fn){
+    std::lock_guard<std::mutex> lock(_mutex);
+    _families.emplace_back();
+    Family& f = _families.back();
+    f.name = name;
+    f.help = help;
+    f.type = Type::GAUGE;
+    f.collect = std::move(fn);
+}
+
+// name{labels} or name{labels,extra}, then the value.
+static void appendSample(std::string& out, const std::string& name, const char* suffix, const std::string& labels,
+    const char* extra, const char* value){
+    out += name;
+    out += suffix;
+    if(!labels.empty() || extra){
+        out += '{';
+        out += labels;
+        if(extra){
+            if(!labels.empty()) out += ',';
+            out += extra;
+        }
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+void Metrics::render(std::string& out) const{
+    std::lock_guard<std::mutex> lock(_mutex);
+    char value[32];
+    char le[48];
+    for(const Family& f : _families){
+        out += "# HELP " + f.name + ' ' + f.help + '\n';
+        out += "# TYPE " + f.name + (f.type == Type::COUNTER ? " counter\n" :
+            f.type == Type::HISTOGRAM ? " histogram\n" : " gauge\n");
+
+        if(f.collect){
+            f.collect([&](const std::string& labels, double v){
+                std::snprintf(value, sizeof(value), "%.15g", v);
+                appendSample(out, f.name, "", labels, nullptr, value);
+            });
+            continue;
+        }
+        for(const Series& s : f.series){
+            if(s.counter){
+                std::snprintf(value, sizeof(value), "%" PRIu64, s.counter->value());
+                appendSample(out, f.name, "", s.labels, nullptr, value);
+            } else if(s.gauge){
+                std::snprintf(value, sizeof(value), "%" PRId64, s.gauge->value());
+                appendSample(out, f.name, "", s.labels, nullptr, value);
+            } else {
+                uint64_t counts[Histogram::BUCKETS];
+                s.histogram->snapshot(counts);
+                uint64_t below = 0;
+                unsigned b = 0;
+                for(unsigned bits = LE_MIN_BITS; bits <= LE_MAX_BITS; bits++){
+                    // Buckets end exactly at 2^bits - 1 ns.
+                    const unsigned end = Histogram::bucketOf(1ull << bits);
+                    for(; b < end; b++) below += counts[b];
+                    std::snprintf(le, sizeof(le), "le=\"%.12g\"", (double)((1ull << bits) - 1) / 1e9);
+                    std::snprintf(value, sizeof(value), "%" PRIu64, below);
+                    appendSample(out, f.name, "_bucket", s.labels, le, value);
+                }
+                for(; b < Histogram::BUCKETS; b++) below += counts[b];
+                std::snprintf(value, sizeof(value), "%" PRIu64, below);
+                appendSample(out, f.name, "_bucket", s.labels, "le=\"+Inf\"", value);
+                std::snprintf(value, sizeof(value), "%.9g", (double)s.histogram->sum() / 1e9);
+                appendSample(out, f.name, "_sum", s.labels, nullptr, value);
+                std::snprintf(value, sizeof(value), "%" PRIu64, below);
+                appendSample(out, f.name, "_count", s.labels, nullptr, value);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include "MetricsServer.h"
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t MAX_REQUEST = 8192;
+
+MetricsServer::~MetricsServer(){
+    stop();
+}
+
+bool MetricsServer::start(uint16_t port, uint32_t ip){
+    _fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(_fd < 0) return false;
+    const int one = 1;
+    ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(ip);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if(::bind(_fd, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(_fd, 16) != 0 ||
+        ::getsockname(_fd, (sockaddr*)&addr, &len) != 0){
+        ::close(_fd);
+        _fd = -1;
+        return false;
+    }
+    _port = ntohs(addr.sin_port);
+    _stop = false;
+    _thread = std::thread([this]{serve();});
+    return true;
+}
+
+void MetricsServer::stop(){
+    _stop = true;
+    if(_thread.joinable()) _thread.join();
+    if(_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+void MetricsServer::serve(){
+    while(!_stop.load(std::memory_order_relaxed)){
+        pollfd p = {_fd, POLLIN, 0};
+        if(::poll(&p, 1, 100) <= 0) continue;
+        const int c = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(c < 0) continue;
+        // A client that connects and says nothing holds the server for 1 s at most.
+        const timeval tv = {1, 0};
+        ::setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ::setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        answer(c);
+        ::close(c);
+    }
+}
+
+static void sendAll(int fd, const char* p, size_t len){
+    while(len > 0){
+        const ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if(n <= 0) return;
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+void MetricsServer::answer(int fd){
+    // Only the request line matters; read until the end of the headers.
+    std::string req;
+    char buf[1024];
+    while(req.size() < MAX_REQUEST && req.find("\r\n\r\n") == std::string::npos){
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if(n <= 0) break;
+        req.append(buf, (size_t)n);
+    }
+
+    const bool get = req.compare(0, 4, "GET ") == 0;
+    const size_t pathEnd = req.find_first_of(" ?\r\n", 4);
+    const bool metrics = get && pathEnd != std::string::npos && req.compare(4, pathEnd - 4, "/metrics") == 0;
+
+    std::string body;
+    const char* status = "404 Not Found";
+    const char* type = "text/plain";
+    if(metrics){
+        _metrics.render(body);
+        status = "200 OK";
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        _scrapes.fetch_add(1, std::memory_order_relaxed);
+    } else if(!get){
+        status = "405 Method Not Allowed";
+    }
+    if(!metrics) body = std::string(status) + "\n";
+
+    char head[192];
+    const int n = std::snprintf(head, sizeof(head),
+        "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        status, type, body.size());
+    sendAll(fd, head, (size_t)n);
+    sendAll(fd, body.data(), body.size());
+}
@@ -0,0 +1,60 @@
+#include "RackMap.h"
+
+#include <thread>
+
+const char* const RackMap::UNKNOWN = "unknown";
+
+RackMap::RackMap() : _current(new RackTable()) {}
+
+RackMap::~RackMap(){
+    delete _current.load();
+}
+
+RackMap::Reader* RackMap::addReader(){
+    const unsigned i = _readerCount.fetch_add(1);
+    if(i >= MAX_READERS){
+        _readerCount.store(MAX_READERS);
+        return nullptr;
+    }
+    return &_readers[i];
+}
+
+RackMap::ReadSection::ReadSection(const RackMap& map, Reader& reader) : _reader(reader){
+    // The epoch store must be visible before the pointer load (store-load
+    // ordering), so both are seq_cst. publish() relies on this: a reader that
+    // can still see the old table has an epoch older than the swap.
+    _reader.epoch.store(map._epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    _table = map._current.load(std::memory_order_seq_cst);
+}
+
+RackMap::ReadSection::~ReadSection(){
+    _reader.epoch.store(0, std::memory_order_release);
+}
+
+const char* RackMap::ReadSection::rackId(uint64_t mac) const{
+    const char* rack = _table->find(mac);
+    return rack ? rack : UNKNOWN;
+}
+
+void RackMap::publish(std::unique_ptr<RackTable> next){
+    if(!next) return;
+    std::lock_guard<std::mutex> lock(_publishMutex);
+
+    const RackTable* old = _current.exchange(next.release(), std::memory_order_seq_cst);
+    const uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    _version.fetch_add(1, std::memory_order_relaxed);
+
+    waitForReaders(epoch);
+    delete old;
+}
+
+void RackMap::waitForReaders(uint64_t epoch) const{
+    const unsigned n = _readerCount.load(std::memory_order_acquire);
+    for(unsigned i = 0; i < n && i < MAX_READERS; i++){
+        for(;;){
+            const uint64_t e = _readers[i].epoch.load(std::memory_order_seq_cst);
+            if(e == 0 || e >= epoch) break;
+            std::this_thread::yield();
+        }
+    }
+}
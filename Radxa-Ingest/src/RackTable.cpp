@@ -0,0 +1,110 @@
+#include "RackTable.h"
+#include "Mac.h"
+
+#include <fstream>
+
+static constexpr size_t INITIAL_CAPACITY = 64;
+
+RackTable::RackTable() : _slots(INITIAL_CAPACITY, Slot{MAC_INVALID, 0}), _mask(INITIAL_CAPACITY - 1) {}
+
+uint64_t RackTable::hash(uint64_t mac){
+    // splitmix64 finaliser: vendor OUIs share the high bits, so mix everything.
+    mac ^= mac >> 30;
+    mac *= 0xbf58476d1ce4e5b9ULL;
+    mac ^= mac >> 27;
+    mac *= 0x94d049bb133111ebULL;
+    mac ^= mac >> 31;
+    return mac;
+}
+
+uint32_t RackTable::internRack(const std::string& rackId){
+    auto it = _rackIndex.find(rackId);
+    if(it != _rackIndex.end()) return it->second;
+
+    _racks.push_back(rackId);
+    const uint32_t idx = (uint32_t)(_racks.size() - 1);
+    _rackIndex.emplace(rackId, idx);
+    return idx;
+}
+
+void RackTable::insert(uint64_t mac, const std::string& rackId){
+    if(mac == MAC_INVALID) return;
+    if((_count + 1) * 2 > _slots.size()) grow();
+
+    const uint32_t rack = internRack(rackId);
+    for(size_t i = hash(mac) & _mask;; i = (i + 1) & _mask){
+        Slot& s = _slots[i];
+        if(s.mac == MAC_INVALID){
+            s.mac = mac;
+            s.rack = rack;
+            _count++;
+            return;
+        }
+        if(s.mac == mac){
+            s.rack = rack;
+            return;
+        }
+    }
+}
+
+const char* RackTable::find(uint64_t mac) const{
+    for(size_t i = hash(mac) & _mask;; i = (i + 1) & _mask){
+        const Slot& s = _slots[i];
+        if(s.mac == mac) return _racks[s.rack].c_str();
+        if(s.mac == MAC_INVALID) return nullptr;
+    }
+}
+
+void RackTable::grow(){
+    std::vector<Slot> old(_slots.size() * 2, Slot{MAC_INVALID, 0});
+    old.swap(_slots);
+    _mask = _slots.size() - 1;
+
+    for(const Slot& s : old){
+        if(s.mac == MAC_INVALID) continue;
+        size_t i = hash(s.mac) & _mask;
+        while(_slots[i].mac != MAC_INVALID) i = (i + 1) & _mask;
+        _slots[i] = s;
+    }
+}
+
+// Strips surrounding blanks and one pair of CSV quotes.
+static std::string trimField(const std::string& s){
+    size_t b = 0;
+    size_t e = s.size();
+    while(b < e && (s[b] == ' ' || s[b] == '\t')) b++;
+    while(e > b && (s[e - 1] == ' ' || s[e - 1] == '\t')) e--;
+    if(e - b >= 2 && s[b] == '"' && s[e - 1] == '"'){
+        b++;
+        e--;
+    }
+    return s.substr(b, e - b);
+}
+
+bool RackTable::loadCsv(const char* path, size_t* badLines){
+    std::ifstream in(path);
+    if(!in) return false;
+
+    size_t bad = 0;
+    bool first = true;
+    std::string line;
+    while(std::getline(in, line)){
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        const bool header = first;
+        first = false;
+        if(line.empty() || line[0] == '#') continue;
+
+        const size_t comma = line.find(',');
+        const std::string macField = trimField(line.substr(0, comma));
+        const uint64_t mac = (comma == std::string::npos) ? MAC_INVALID : parseMac(macField.c_str(), macField.size());
+        const std::string rack = (comma == std::string::npos) ? std::string() : trimField(line.substr(comma + 1));
+        if(mac == MAC_INVALID || rack.empty()){
+            if(!header) bad++;
+            continue;
+        }
+        insert(mac, rack);
+    }
+
+    if(badLines) *badLines = bad;
+    return true;
+}
@@ -0,0 +1,251 @@
+#include "Replay.h"
+#include "Mac.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t LOOPBACK = 0x7F000001;   // 127.0.0.1
+
+// ------------------
+// UdpRecorder
+// ------------------
+
+UdpRecorder::~UdpRecorder(){
+    if(_fd >= 0) ::close(_fd);
+}
+
+bool UdpRecorder::open(uint32_t bindIp, uint16_t port){
+    _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if(_fd < 0) return false;
+
+    const int on = 1;
+    const int rcvbuf = 8 << 20;
+    ::setsockopt(_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    const timeval tv = {0, 100000};
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(bindIp);
+    addr.sin_port = htons(port);
+    if(::bind(_fd, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(_fd, (sockaddr*)&addr, &len);
+    _port = ntohs(addr.sin_port);
+    return true;
+}
+
+UdpRecorder::Stats UdpRecorder::run(CaptureWriter& out, const std::atomic<bool>& stop, uint64_t maxPackets){
+    static constexpr size_t BATCH = 32;
+    static constexpr size_t BUF = capture::MAX_PAYLOAD + 1;
+
+    Stats st = {};
+    const uint64_t writeErrors = out.writeErrors();
+    std::vector<uint8_t> bufs(BATCH * BUF);
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    sockaddr_in from[BATCH];
+    alignas(cmsghdr) char ctrl[BATCH][CMSG_SPACE(sizeof(timespec))];
+
+    while(!stop.load(std::memory_order_relaxed) && (maxPackets == 0 || st.packets < maxPackets)){
+        for(size_t i = 0; i < BATCH; i++){
+            iov[i] = {bufs.data() + i * BUF, BUF};
+            msgs[i].msg_hdr = {};
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = ctrl[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+        }
+        const int n = ::recvmmsg(_fd, msgs, BATCH, MSG_WAITFORONE, nullptr);
+        if(n <= 0) continue;    // timeout: re-check stop
+
+        for(int i = 0; i < n; i++){
+            const msghdr& h = msgs[i].msg_hdr;
+            if(h.msg_flags & MSG_TRUNC){
+                st.truncated++;
+                continue;
+            }
+            int64_t arrivalNs = 0;
+            for(cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR((msghdr*)&h, c)){
+                if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS){
+                    timespec ts;
+                    std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    arrivalNs = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+                }
+            }
+            if(arrivalNs == 0){
+                timespec ts;
+                ::clock_gettime(CLOCK_REALTIME, &ts);
+                arrivalNs = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+            }
+            const int64_t rel = arrivalNs - out.startNs();
+
+            const uint8_t* data = bufs.data() + (size_t)i * BUF;
+            st.bytes += msgs[i].msg_len;
+            st.json += capture::classify(data, msgs[i].msg_len) == capture::FLAG_JSON;
+            if(!out.append(rel > 0 ? (uint64_t)rel : 0, ntohl(from[i].sin_addr.s_addr), ntohs(from[i].sin_port),
+                data, msgs[i].msg_len)){
+                st.lost++;
+                continue;
+            }
+            st.packets++;
+        }
+    }
+    if(!out.flush()) st.unwritten = out.buffered();
+    st.writeErrors = out.writeErrors() - writeErrors;
+    return st;
+}
+
+// ------------------
+// UdpReplayer
+// ------------------
+
+UdpReplayer::~UdpReplayer(){
+    if(_fd >= 0) ::close(_fd);
+}
+
+uint64_t UdpReplayer::replayMac(uint64_t mac, unsigned copy){
+    if(copy == 0) return mac;
+    const uint64_t first = ((mac >> 40) & 0xFF) | 0x02;
+    return first << 40 | (uint64_t)(copy & 0xFFFF) << 24 | (mac & 0xFFFFFF);
+}
+
+bool UdpReplayer::open(const Options& options){
+    _options = options;
+    _options.copies = std::min(std::max(_options.copies, 1u), MAX_COPIES);
+    _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if(_fd < 0) return false;
+    const int sndbuf = 8 << 20;
+    ::setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    // Bound to the wildcard so each datagram can pick its own 127.x source.
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(::bind(_fd, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+
+    _pending.reserve(BATCH);
+    _scratch.resize(BATCH);
+    return true;
+}
+
+// Sends everything pending in one sendmmsg() per BATCH.
+size_t UdpReplayer::flush(Result& r){
+    if(_pending.empty()) return 0;
+
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    alignas(cmsghdr) char ctrl[BATCH][CMSG_SPACE(sizeof(in_pktinfo))];
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(LOOPBACK);
+    to.sin_port = htons(_options.port);
+
+    const size_t n = _pending.size();
+    for(size_t i = 0; i < n; i++){
+        const Pending& p = _pending[i];
+        iov[i] = {(void*)p.data, p.len};
+        msghdr& h = msgs[i].msg_hdr;
+        h = {};
+        h.msg_name = &to;
+        h.msg_namelen = sizeof(to);
+        h.msg_iov = &iov[i];
+        h.msg_iovlen = 1;
+        if(p.copy > 0){
+            // Source address for this datagram only.
+            h.msg_control = ctrl[i];
+            h.msg_controllen = sizeof(ctrl[i]);
+            cmsghdr* c = CMSG_FIRSTHDR(&h);
+            c->cmsg_level = IPPROTO_IP;
+            c->cmsg_type = IP_PKTINFO;
+            c->cmsg_len = CMSG_LEN(sizeof(in_pktinfo));
+            in_pktinfo info = {};
+            info.ipi_spec_dst.s_addr = htonl(LOOPBACK + p.copy);
+            std::memcpy(CMSG_DATA(c), &info, sizeof(info));
+        }
+    }
+
+    size_t sent = 0;
+    while(sent < n){
+        const int k = ::sendmmsg(_fd, msgs + sent, (unsigned)(n - sent), 0);
+        if(k <= 0){
+            // Skip the datagram that failed and carry on with the rest.
+            r.sendErrors++;
+            sent++;
+            continue;
+        }
+        for(int i = 0; i < k; i++) r.bytes += msgs[sent + (size_t)i].msg_len;
+        r.packets += (uint64_t)k;
+        sent += (size_t)k;
+    }
+    _pending.clear();
+    return n;
+}
+
+static void sleepUntil(Clock::time_point t){
+    // Sleep most of the way, then spin: timer slack alone is ~50 us.
+    const Clock::time_point spinFrom = t - std::chrono::microseconds(200);
+    if(Clock::now() < spinFrom) std::this_thread::sleep_until(spinFrom);
+    while(Clock::now() < t) {}
+}
+
+UdpReplayer::Result UdpReplayer::run(CaptureReader& in){
+    Result r = {};
+    const bool timed = _options.speed > 0;
+    const Clock::time_point start = Clock::now();
+    bool first = true;
+    uint64_t firstNs = 0;
+
+    capture::Packet pkt;
+    while(in.next(pkt)){
+        if(timed){
+            if(first){
+                firstNs = pkt.tNs;
+                first = false;
+            }
+            const double offsetNs = (double)(pkt.tNs - std::min(pkt.tNs, firstNs)) / _options.speed;
+            const Clock::time_point due = start + std::chrono::nanoseconds((int64_t)offsetNs);
+            if(due > Clock::now()){
+                flush(r);
+                sleepUntil(due);
+            }
+            const double lateUs = std::chrono::duration<double, std::micro>(Clock::now() - due).count();
+            r.maxLateUs = std::max(r.maxLateUs, lateUs);
+        }
+
+        const char* macText = (_options.rewriteMac && _options.copies > 1 && (pkt.flags & capture::FLAG_JSON))
+            ? findDeviceMacText((const char*)pkt.data, pkt.len) : nullptr;
+        for(unsigned k = 0; k < _options.copies; k++){
+            if(_pending.size() == BATCH) flush(r);
+            Pending p = {pkt.data, pkt.len, k};
+            if(k > 0 && macText){
+                std::vector<uint8_t>& buf = _scratch[_pending.size()];
+                buf.assign(pkt.data, pkt.data + pkt.len);
+                char text[18];
+                formatMac(replayMac(parseMac(macText, 17), k), text);
+                std::memcpy(buf.data() + (macText - (const char*)pkt.data), text, 17);
+                p.data = buf.data();
+                r.rewritten++;
+            }
+            _pending.push_back(p);
+        }
+    }
+    flush(r);
+
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    r.packetsPerS = r.seconds > 0 ? (double)r.packets / r.seconds : 0;
+    return r;
+}
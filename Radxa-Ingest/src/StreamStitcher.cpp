@@ -0,0 +1,134 @@
+#include "StreamStitcher.h"
+
+#include <algorithm>
+
+StreamStitcher::StreamStitcher(const Options& options) : _options(options){
+    if(_options.maxPending == 0) _options.maxPending = 1;
+}
+
+size_t StreamStitcher::pending() const{
+    size_t n = _ready.size();
+    for(const Rack& r : _racks) n += r.pending.size();
+    return n;
+}
+
+char StreamStitcher::designated(const char* rack) const{
+    auto it = _rackIndex.find(rack);
+    return it == _rackIndex.end() ? 0 : _racks[it->second].leader;
+}
+
+void StreamStitcher::learnLeader(Rack& r, const Sample& s){
+    if(!s.leader) return;
+    // Terms are 8 bits on the heartbeat bus and wrap; newer is ahead by < 128.
+    const bool newer = r.leader == 0 || (int8_t)(uint8_t)(s.term - r.term) > 0;
+    if(newer){
+        r.leader = s.leader;
+        r.term = s.term;
+    }
+}
+
+bool StreamStitcher::noteReleased(Rack& r, const Slot& slot){
+    const bool late = slot.s.timeMs < r.releasedMs;
+    if(late) _stats.late++;
+    else r.releasedMs = slot.s.timeMs;
+
+    r.recent[r.recentNext] = Released{slot.s.mac, slot.s.seq, slot.s.timeMs};
+    r.recentNext = (r.recentNext + 1) % RECENT;
+    if(r.recentCount < RECENT) r.recentCount++;
+    return late;
+}
+
+StreamStitcher::Point StreamStitcher::pointOf(const Rack& r, const Slot& slot, bool late) const{
+    Point p;
+    p.rack = r.name.c_str();
+    p.sample = slot.s;
+    p.designated = r.leader != 0 && slot.s.controller == r.leader;
+    p.replaced = slot.replaced;
+    p.late = late;
+    p.data = (const uint8_t*)slot.data.data();
+    p.len = (uint32_t)slot.data.size();
+    return p;
+}
+
+StreamStitcher::Verdict StreamStitcher::add(const char* rack, const Sample& s, const void* data, size_t len,
+    int64_t nowMs){
+    uint32_t ri;
+    auto it = _rackIndex.find(rack);
+    if(it != _rackIndex.end()){
+        ri = it->second;
+    } else {
+        if(_racks.size() >= _options.maxRacks){
+            _stats.unstitched++;
+            return Verdict::UNSTITCHED;
+        }
+        ri = (uint32_t)_racks.size();
+        _racks.emplace_back();
+        _racks.back().name = rack;
+        _rackIndex.emplace(rack, ri);
+    }
+    Rack& r = _racks[ri];
+    learnLeader(r, s);
+
+    const int64_t window = _options.windowMs;
+    auto sameDatagram = [&s](uint64_t mac, uint32_t seq, int64_t timeMs){
+        return mac == s.mac && seq == s.seq && timeMs == s.timeMs;
+    };
+    auto overlaps = [&s, window](uint64_t mac, int64_t timeMs){
+        return mac != s.mac && (timeMs > s.timeMs ? timeMs - s.timeMs : s.timeMs - timeMs) < window;
+    };
+
+    // Against points already released: those cannot be taken back.
+    for(uint32_t i = 0; i < r.recentCount; i++){
+        const Released& x = r.recent[i];
+        if(sameDatagram(x.mac, x.seq, x.timeMs)){
+            _stats.duplicates++;
+            return Verdict::DUPLICATE;
+        }
+        if(overlaps(x.mac, x.timeMs)){
+            _stats.overlaps++;
+            return Verdict::OVERLAP;
+        }
+    }
+
+    // Against the buffer: the designated sender's sample replaces the other.
+    Slot* rival = nullptr;
+    for(Slot& x : r.pending){
+        if(sameDatagram(x.s.mac, x.s.seq, x.s.timeMs)){
+            _stats.duplicates++;
+            return Verdict::DUPLICATE;
+        }
+        if(!rival && overlaps(x.s.mac, x.s.timeMs)) rival = &x;
+    }
+    bool replaced = false;
+    if(rival){
+        const bool mine = r.leader != 0 && s.controller == r.leader && rival->s.controller != r.leader;
+        if(!mine){
+            _stats.overlaps++;
+            return Verdict::OVERLAP;
+        }
+        r.pending.erase(r.pending.begin() + (rival - r.pending.data()));
+        _stats.replaced++;
+        replaced = true;
+    }
+
+    if(r.pending.size() >= _options.maxPending){
+        // Full: the oldest point leaves now rather than holding up the rest.
+        Slot& oldest = r.pending.front();
+        const bool late = noteReleased(r, oldest);
+        _ready.push_back(Ready{ri, late, std::move(oldest)});
+        r.pending.erase(r.pending.begin());
+        _stats.forced++;
+    }
+
+    auto at = std::upper_bound(r.pending.begin(), r.pending.end(), s.timeMs, [](int64_t t, const Slot& x){
+        return t < x.s.timeMs;
+    });
+    Slot slot;
+    slot.s = s;
+    slot.arrivalMs = nowMs;
+    slot.replaced = replaced;
+    slot.data.assign((const char*)data, len);
+    r.pending.insert(at, std::move(slot));
+    _stats.accepted++;
+    return replaced ? Verdict::REPLACED : Verdict::ACCEPTED;
+}
@@ -0,0 +1,122 @@
+#include "TelemetryFields.h"
+#include "Mac.h"
+
+#include <cstring>
+
+// Start of the value after "key": (blanks and the colon skipped), or nullptr.
+static const char* findValue(const char* data, size_t len, const char* key){
+    const size_t keyLen = std::strlen(key);
+    const char* p = (const char*)memmem(data, len, key, keyLen);
+    if(!p) return nullptr;
+    const char* end = data + len;
+    p += keyLen;
+    while(p < end && (*p == ' ' || *p == ':' || *p == '\n')) p++;
+    return p < end ? p : nullptr;
+}
+
+static bool readUnsigned(const char* p, const char* end, uint64_t& out){
+    if(!p || p >= end || *p < '0' || *p > '9') return false;
+    uint64_t v = 0;
+    for(; p < end && *p >= '0' && *p <= '9'; p++) v = v * 10 + (uint64_t)(*p - '0');
+    out = v;
+    return true;
+}
+
+// The single character of a one-letter string value such as "A".
+static char readLetter(const char* p, const char* end){
+    if(!p || end - p < 3 || p[0] != '"' || p[2] != '"') return 0;
+    return p[1];
+}
+
+bool parseTelemetryFields(const char* data, size_t len, TelemetryFields& out){
+    out = TelemetryFields();
+    out.mac = MAC_INVALID;
+    out.deviceMs = -1;
+
+    const char* end = data + len;
+    const char* type = findValue(data, len, "\"message_type\"");
+    if(!type || (size_t)(end - type) < 11 || std::memcmp(type, "\"telemetry\"", 11) != 0) return false;
+    out.mac = findDeviceMac(data, len);
+    if(out.mac == MAC_INVALID) return false;
+
+    uint64_t v;
+    out.controller = readLetter(findValue(data, len, "\"controller\""), end);
+    if(readUnsigned(findValue(data, len, "\"seq\""), end, v)){
+        out.hasSeq = true;
+        out.seq = (uint32_t)v;
+    }
+    if(readUnsigned(findValue(data, len, "\"timestamp_device_ms\""), end, v)) out.deviceMs = (int64_t)v;
+    if(readUnsigned(findValue(data, len, "\"timestamp_epoch_ms\""), end, v)) out.epochMs = (int64_t)v;
+
+    // The first "leader" is the membership item's own; the members follow it.
+    out.leader = readLetter(findValue(data, len, "\"leader\""), end);
+    if(readUnsigned(findValue(data, len, "\"term\""), end, v)) out.term = (uint32_t)v;
+
+    const char* kind = findValue(data, len, "\"kind\"");
+    while(kind){
+        if((size_t)(end - kind) >= 9 && std::memcmp(kind, "\"sensors\"", 9) == 0){
+            out.sensors = true;
+            break;
+        }
+        kind = findValue(kind, (size_t)(end - kind), "\"kind\"");
+    }
+    return true;
+}
+
+// One "temperatures_c" entry: null, or a decimal such as -3.5 or 21.23.
+// Returns where it ends, or nullptr if it is neither.
+static const char* readCentiDegrees(const char* p, const char* end, int16_t& out){
+    if(end - p >= 4 && std::memcmp(p, "null", 4) == 0){
+        out = Temperatures::NO_READING;
+        return p + 4;
+    }
+    const bool negative = p < end && *p == '-';
+    if(negative) p++;
+    if(p >= end || *p < '0' || *p > '9') return nullptr;
+    int32_t v = 0;
+    for(; p < end && *p >= '0' && *p <= '9'; p++) v = v < 100000 ? v * 10 + (*p - '0') : v;
+    v *= 100;
+    if(p < end && *p == '.'){
+        p++;
+        int32_t scale = 10;
+        for(; p < end && *p >= '0' && *p <= '9'; p++){
+            v += (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if(v > INT16_MAX) v = INT16_MAX;
+    out = (int16_t)(negative ? -v : v);
+    return p;
+}
+
+// The array after the first "temperatures_c" following "bus": "<name>".
+static bool readBus(const char* data, size_t len, const char* name, int16_t* out){
+    for(unsigned i = 0; i < Temperatures::SENSORS; i++) out[i] = Temperatures::NO_READING;
+    const char* end = data + len;
+    const char* bus = findValue(data, len, "\"bus\"");
+    const size_t nameLen = std::strlen(name);
+    while(bus && !((size_t)(end - bus) >= nameLen + 2 && bus[0] == '"' &&
+        std::memcmp(bus + 1, name, nameLen) == 0 && bus[nameLen + 1] == '"')){
+        bus = findValue(bus, (size_t)(end - bus), "\"bus\"");
+    }
+    if(!bus) return false;
+    const char* p = findValue(bus, (size_t)(end - bus), "\"temperatures_c\"");
+    if(!p || *p != '[') return false;
+    p++;
+    for(unsigned i = 0; p < end; i++){
+        while(p < end && *p == ' ') p++;
+        if(p < end && *p == ']') break;
+        int16_t v;
+        p = readCentiDegrees(p, end, v);
+        if(!p) return false;
+        if(i < Temperatures::SENSORS) out[i] = v;
+        while(p < end && (*p == ' ' || *p == ',')) p++;
+    }
+    return true;
+}
+
+bool parseTemperatures(const char* data, size_t len, Temperatures& out){
+    const bool cool = readBus(data, len, "cool", out.cool);
+    const bool exhaust = readBus(data, len, "exhaust", out.exhaust);
+    return cool || exhaust;
+}
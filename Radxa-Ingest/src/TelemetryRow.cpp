@@ -0,0 +1,51 @@
+#include "TelemetryRow.h"
+
+#include <cstring>
+
+template <class T>
+static uint8_t* put(uint8_t* p, const T& v){
+    std::memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+template <class T>
+static const uint8_t* get(const uint8_t* p, T& v){
+    std::memcpy(&v, p, sizeof(v));
+    return p + sizeof(v);
+}
+
+size_t encodeRow(const TelemetryRow& row, uint8_t* out){
+    uint8_t* p = out;
+    p = put(p, row.mac);
+    p = put(p, row.timeMs);
+    p = put(p, row.seq);
+    p = put(p, row.ip);
+    p = put(p, row.port);
+    p = put(p, row.controller);
+    p = put(p, row.flags);
+    for(int16_t v : row.temps.cool) p = put(p, v);
+    for(int16_t v : row.temps.exhaust) p = put(p, v);
+    const size_t rackLen = strnlen(row.rack, TelemetryRow::MAX_RACK);
+    *p++ = (uint8_t)rackLen;
+    std::memcpy(p, row.rack, rackLen);
+    return (size_t)(p - out) + rackLen;
+}
+
+bool decodeRow(const uint8_t* data, size_t len, TelemetryRow& out){
+    if(len < TelemetryRow::FIXED_BYTES) return false;
+    const uint8_t* p = data;
+    p = get(p, out.mac);
+    p = get(p, out.timeMs);
+    p = get(p, out.seq);
+    p = get(p, out.ip);
+    p = get(p, out.port);
+    p = get(p, out.controller);
+    p = get(p, out.flags);
+    for(int16_t& v : out.temps.cool) p = get(p, v);
+    for(int16_t& v : out.temps.exhaust) p = get(p, v);
+    const size_t rackLen = *p++;
+    if(rackLen > TelemetryRow::MAX_RACK || len != TelemetryRow::FIXED_BYTES + rackLen) return false;
+    std::memcpy(out.rack, p, rackLen);
+    out.rack[rackLen] = 0;
+    return true;
+}
@@ -0,0 +1,73 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(uint64_t nowTick) : _now(nowTick){
+    for(Timer& h : _level0) initSlot(h);
+    for(auto& level : _levels){
+        for(Timer& h : level) initSlot(h);
+    }
+}
+
+void TimerWheel::initSlot(Timer& head){
+    head.prev = head.next = &head;
+}
+
+void TimerWheel::unlink(Timer& t){
+    t.prev->next = t.next;
+    t.next->prev = t.prev;
+    t.prev = t.next = nullptr;
+}
+
+void TimerWheel::place(Timer& t){
+    if(t.expires < _now) t.expires = _now;
+    uint64_t delta = t.expires - _now;
+    if(delta > MAX_DELTA){
+        t.expires = _now + MAX_DELTA;
+        delta = MAX_DELTA;
+    }
+
+    Timer* head;
+    if(delta < LEVEL0_SIZE){
+        head = &_level0[t.expires & (LEVEL0_SIZE - 1)];
+    } else {
+        unsigned level = 0;
+        unsigned shift = LEVEL0_BITS;
+        while(delta >= (1ULL << (shift + LEVEL_BITS))){
+            level++;
+            shift += LEVEL_BITS;
+        }
+        head = &_levels[level][(t.expires >> shift) & (LEVEL_SIZE - 1)];
+    }
+
+    t.next = head;
+    t.prev = head->prev;
+    head->prev->next = &t;
+    head->prev = &t;
+}
+
+// Called when the level below wraps: re-places the current slot of this
+// level, whose timers are now all within reach of the finer levels.
+void TimerWheel::cascade(unsigned level){
+    const unsigned shift = LEVEL0_BITS + level * LEVEL_BITS;
+    const unsigned idx = (unsigned)((_now >> shift) & (LEVEL_SIZE - 1));
+    if(idx == 0 && level + 1 < LEVELS - 1) cascade(level + 1);
+
+    Timer& head = _levels[level][idx];
+    while(head.next != &head){
+        Timer& t = *head.next;
+        unlink(t);
+        place(t);
+    }
+}
+
+void TimerWheel::schedule(Timer& t, uint64_t expiresTick){
+    if(t.pending()) unlink(t);
+    else _pending++;
+    t.expires = expiresTick;
+    place(t);
+}
+
+void TimerWheel::cancel(Timer& t){
+    if(!t.pending()) return;
+    unlink(t);
+    _pending--;
+}
@@ -0,0 +1,209 @@
+#include "UnknownRegistry.h"
+#include "UnknownStore.h"
+
+#include <cstring>
+
+static size_t indexSizeFor(size_t maxDevices){
+    size_t n = 16;
+    while(n < maxDevices * 2) n <<= 1;
+    return n;
+}
+
+UnknownRegistry::UnknownRegistry(size_t maxDevices)
+    : _entries(maxDevices ? maxDevices : 1),
+      _index(indexSizeFor(maxDevices ? maxDevices : 1), NONE){
+    _indexMask = _index.size() - 1;
+    _protectedMax = _entries.size() * 4 / 5;
+    _free.reserve(_entries.size());
+    for(size_t i = _entries.size(); i > 0; i--){
+        _entries[i - 1].mac = EMPTY;
+        _free.push_back((uint32_t)(i - 1));
+    }
+    std::strcpy(_ifaces[0], "?");
+    _ifaceCount = 1;
+}
+
+uint64_t UnknownRegistry::hash(uint64_t mac){
+    mac ^= mac >> 33;
+    mac *= 0xff51afd7ed558ccdULL;
+    mac ^= mac >> 33;
+    return mac;
+}
+
+// Index slot holding mac, or the empty slot where it would go.
+size_t UnknownRegistry::slotOf(uint64_t mac) const{
+    size_t i = hash(mac) & _indexMask;
+    while(_index[i] != NONE && _entries[_index[i]].mac != mac) i = (i + 1) & _indexMask;
+    return i;
+}
+
+const UnknownRegistry::Device* UnknownRegistry::find(uint64_t mac) const{
+    const uint32_t e = _index[slotOf(mac)];
+    return (e == NONE) ? nullptr : &_entries[e];
+}
+
+void UnknownRegistry::removeFromIndex(uint64_t mac){
+    // Linear probing delete: shift later members of the cluster back so no
+    // lookup ever stops early at the hole.
+    size_t hole = slotOf(mac);
+    if(_index[hole] == NONE) return;
+    _index[hole] = NONE;
+
+    for(size_t i = (hole + 1) & _indexMask; _index[i] != NONE; i = (i + 1) & _indexMask){
+        const size_t home = hash(_entries[_index[i]].mac) & _indexMask;
+        // Move it if its home is not in (hole, i], cyclically.
+        const bool stays = (hole <= i) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if(stays) continue;
+        _index[hole] = _index[i];
+        _index[i] = NONE;
+        hole = i;
+    }
+}
+
+void UnknownRegistry::unlink(uint32_t i){
+    Entry& e = _entries[i];
+    if(e.prev != NONE) _entries[e.prev].next = e.next; else _head[e.list] = e.next;
+    if(e.next != NONE) _entries[e.next].prev = e.prev; else _tail[e.list] = e.prev;
+    e.prev = e.next = NONE;
+    _listSize[e.list]--;
+}
+
+void UnknownRegistry::pushFront(uint32_t i, uint8_t list){
+    Entry& e = _entries[i];
+    e.list = list;
+    e.prev = NONE;
+    e.next = _head[list];
+    if(_head[list] != NONE) _entries[_head[list]].prev = i;
+    _head[list] = i;
+    if(_tail[list] == NONE) _tail[list] = i;
+    _listSize[list]++;
+}
+
+uint32_t UnknownRegistry::evict(){
+    const uint32_t victim = (_tail[PROBATION] != NONE) ? _tail[PROBATION] : _tail[PROTECTED];
+    unlink(victim);
+    removeFromIndex(_entries[victim].mac);
+    _entries[victim].mac = EMPTY;
+    _size--;
+    _evictions++;
+    return victim;
+}
+
+uint8_t UnknownRegistry::internInterface(const char* iface){
+    if(!iface || !iface[0]) return 0;
+    for(uint8_t i = 1; i < _ifaceCount; i++){
+        if(std::strncmp(_ifaces[i], iface, sizeof(_ifaces[i]) - 1) == 0) return i;
+    }
+    if(_ifaceCount >= MAX_INTERFACES) return 0;
+    std::strncpy(_ifaces[_ifaceCount], iface, sizeof(_ifaces[0]) - 1);
+    return _ifaceCount++;
+}
+
+const char* UnknownRegistry::interfaceName(uint8_t idx) const{
+    return (idx < _ifaceCount) ? _ifaces[idx] : _ifaces[0];
+}
+
+// Advances the ring to hour, clearing the buckets it skips over.
+void UnknownRegistry::roll(Device& d, int64_t hour){
+    if(hour <= d.newestHour) return;
+    const int64_t gap = hour - d.newestHour;
+    if(gap >= HOURS){
+        std::memset(d.counts, 0, sizeof(d.counts));
+    } else {
+        for(int64_t h = d.newestHour + 1; h <= hour; h++) d.counts[h % HOURS] = 0;
+    }
+    d.newestHour = hour;
+}
+
+uint32_t UnknownRegistry::count24h(const Device& d, int64_t nowS) const{
+    const int64_t hour = nowS / 3600;
+    uint32_t sum = 0;
+    for(int64_t h = d.newestHour; h > d.newestHour - HOURS; h--){
+        if(hour - h >= HOURS) break;
+        if(h <= hour) sum += d.counts[h % HOURS];
+    }
+    return sum;
+}
+
+void UnknownRegistry::record(uint64_t mac, int64_t nowS, uint32_t ip, uint16_t port, const char* iface){
+    if(mac == EMPTY) return;
+
+    const size_t slot = slotOf(mac);
+    uint32_t i = _index[slot];
+    uint8_t list = PROBATION;
+
+    if(i == NONE){
+        if(_free.empty()){
+            _free.push_back(evict());
+        }
+        i = _free.back();
+        _free.pop_back();
+
+        Entry& e = _entries[i];
+        e.mac = mac;
+        e.firstSeenS = nowS;
+        e.newestHour = nowS / 3600;
+        std::memset(e.counts, 0, sizeof(e.counts));
+        e.flushedCount = 0;
+        e.prev = e.next = NONE;
+        // The eviction may have shifted the index; look the slot up again.
+        _index[slotOf(mac)] = i;
+        _size++;
+    } else {
+        // Seen before: (re)enter the protected list. If that overflows, its
+        // least recent member drops back to probation rather than out.
+        unlink(i);
+        list = PROTECTED;
+        if(_listSize[PROTECTED] >= _protectedMax && _tail[PROTECTED] != NONE){
+            const uint32_t demoted = _tail[PROTECTED];
+            unlink(demoted);
+            pushFront(demoted, PROBATION);
+        }
+    }
+
+    Entry& e = _entries[i];
+    e.lastSeenS = nowS;
+    e.ip = ip;
+    e.port = port;
+    e.iface = internInterface(iface);
+    e.dirty = true;
+
+    roll(e, nowS / 3600);
+    uint16_t& c = e.counts[(nowS / 3600) % HOURS];
+    if(c < 0xFFFF) c++;
+
+    if(list == PROTECTED && _protectedMax == 0) list = PROBATION;
+    pushFront(i, list);
+}
+
+size_t UnknownRegistry::flush(UnknownStore& store, int64_t nowS){
+    std::vector<UnknownStore::Row> rows;
+    std::vector<uint32_t> idx;
+
+    for(uint32_t i = 0; i < _entries.size(); i++){
+        Entry& e = _entries[i];
+        if(e.mac == EMPTY) continue;
+        const uint32_t count = count24h(e, nowS);
+        if(!e.dirty && count == e.flushedCount) continue;
+
+        UnknownStore::Row r;
+        r.mac = e.mac;
+        r.firstSeenS = e.firstSeenS;
+        r.lastSeenS = e.lastSeenS;
+        r.count24h = count;
+        r.ip = e.ip;
+        r.port = e.port;
+        r.iface = interfaceName(e.iface);
+        rows.push_back(r);
+        idx.push_back(i);
+    }
+
+    if(rows.empty()) return 0;
+    if(!store.upsert(rows.data(), rows.size())) return 0;
+
+    for(size_t k = 0; k < idx.size(); k++){
+        _entries[idx[k]].dirty = false;
+        _entries[idx[k]].flushedCount = rows[k].count24h;
+    }
+    return rows.size();
+}
@@ -0,0 +1,71 @@
+#include "UnknownStore.h"
+#include "Mac.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileUnknownStore::FileUnknownStore(const std::string& dir) : _dir(dir) {}
+
+static bool writeAll(int fd, const char* p, size_t n){
+    while(n > 0){
+        const ssize_t w = ::write(fd, p, n);
+        if(w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+bool FileUnknownStore::upsert(const Row* rows, size_t n){
+    const int fd = ::open(rowsPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0) return false;
+
+    std::string buf;
+    char line[160];
+    char mac[18];
+    for(size_t i = 0; i < n; i++){
+        const Row& r = rows[i];
+        formatMac(r.mac, mac);
+        const int len = std::snprintf(line, sizeof(line), "%s,%lld,%lld,%u,%u.%u.%u.%u,%u,%s\n",
+            mac, (long long)r.firstSeenS, (long long)r.lastSeenS, (unsigned)r.count24h,
+            (unsigned)(r.ip >> 24), (unsigned)(r.ip >> 16 & 0xFF),
+            (unsigned)(r.ip >> 8 & 0xFF), (unsigned)(r.ip & 0xFF),
+            (unsigned)r.port, r.iface ? r.iface : "?");
+        if(len > 0) buf.append(line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    }
+
+    const bool ok = writeAll(fd, buf.data(), buf.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+int64_t FileUnknownStore::lastSummaryS(){
+    FILE* f = std::fopen(statePath().c_str(), "r");
+    if(!f) return 0;
+    long long s = 0;
+    if(std::fscanf(f, "%lld", &s) != 1) s = 0;
+    std::fclose(f);
+    return s;
+}
+
+bool FileUnknownStore::setLastSummaryS(int64_t s){
+    const std::string tmp = statePath() + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+
+    char buf[32];
+    const int len = std::snprintf(buf, sizeof(buf), "%lld\n", (long long)s);
+    const bool ok = writeAll(fd, buf, (size_t)len) && ::fsync(fd) == 0;
+    ::close(fd);
+    if(!ok || std::rename(tmp.c_str(), statePath().c_str()) != 0) return false;
+
+    // Make the rename itself durable.
+    const int dfd = ::open(_dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(dfd >= 0){
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#include "UnknownSummary.h"
+#include "UnknownRegistry.h"
+#include "UnknownStore.h"
+#include "Mac.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+bool UnknownSummary::generate(const UnknownRegistry& reg, UnknownStore& store, int64_t nowS, std::string& out){
+    const int64_t last = store.lastSummaryS();
+    if(last != 0 && nowS - last < PERIOD_S) return false;
+
+    struct Top{uint64_t mac; uint32_t count; int64_t lastSeenS;};
+    std::vector<Top> seen;
+    uint64_t messages = 0;
+    reg.forEach([&](const UnknownRegistry::Device& d){
+        const uint32_t c = reg.count24h(d, nowS);
+        if(c == 0) return;
+        seen.push_back({d.mac, c, d.lastSeenS});
+        messages += c;
+    });
+    if(seen.empty()) return false;
+
+    // Persist first: a crash after this loses one summary, never doubles it.
+    if(!store.setLastSummaryS(nowS)) return false;
+
+    const size_t top = std::min<size_t>(seen.size(), TOP_DEVICES);
+    std::partial_sort(seen.begin(), seen.begin() + top, seen.end(), [](const Top& a, const Top& b){
+        return a.count > b.count || (a.count == b.count && a.mac < b.mac);
+    });
+
+    char line[96];
+    std::snprintf(line, sizeof(line), "%zu unknown devices, %llu messages in the last 24 h",
+        seen.size(), (unsigned long long)messages);
+    out = line;
+    if(reg.evictions() > 0){
+        std::snprintf(line, sizeof(line), " (registry full, %llu evicted since start)",
+            (unsigned long long)reg.evictions());
+        out += line;
+    }
+    out += "\n";
+
+    char mac[18];
+    for(size_t i = 0; i < top; i++){
+        formatMac(seen[i].mac, mac);
+        std::snprintf(line, sizeof(line), "  %s  %u msgs, last seen %llds ago\n",
+            mac, (unsigned)seen[i].count, (long long)(nowS - seen[i].lastSeenS));
+        out += line;
+    }
+    return true;
+}
@@ -0,0 +1,461 @@
+#include "Wal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint32_t IDLE_POLL_US = 100;
+static constexpr size_t READ_CHUNK = 1 << 20;
+
+// ------------------
+// Segment files
+// ------------------
+
+namespace wal {
+
+uint32_t crc32(uint32_t crc, const void* data, size_t len){
+    static const struct Table{
+        uint32_t t[256];
+        Table(){
+            for(uint32_t i = 0; i < 256; i++){
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+        }
+    } table;
+
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while(len--) crc = table.t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+std::string segmentPath(const std::string& dir, uint64_t firstLsn){
+    char name[32];
+    std::snprintf(name, sizeof(name), "/wal-%016" PRIx64 ".log", firstLsn);
+    return dir + name;
+}
+
+std::vector<uint64_t> listSegments(const std::string& dir){
+    std::vector<uint64_t> out;
+    DIR* d = ::opendir(dir.c_str());
+    if(!d) return out;
+    while(const dirent* e = ::readdir(d)){
+        uint64_t lsn;
+        char tail[8];
+        if(std::strlen(e->d_name) == 24 && std::sscanf(e->d_name, "wal-%16" SCNx64 "%4s", &lsn, tail) == 2 &&
+           std::strcmp(tail, ".log") == 0){
+            out.push_back(lsn);
+        }
+    }
+    ::closedir(d);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+size_t parseRecord(const uint8_t* p, size_t avail, BulkStore::Row& out){
+    if(avail < WalWriter::HEADER) return 0;
+    uint32_t len, crc;
+    uint64_t lsn;
+    std::memcpy(&len, p, 4);
+    std::memcpy(&crc, p + 4, 4);
+    std::memcpy(&lsn, p + 8, 8);
+    if(len > WalWriter::MAX_RECORD || lsn == 0 || avail < WalWriter::HEADER + len) return 0;
+    if(crc32(crc32(0, &lsn, 8), p + WalWriter::HEADER, len) != crc) return 0;
+
+    out.lsn = lsn;
+    out.data = p + WalWriter::HEADER;
+    out.len = len;
+    return WalWriter::HEADER + len;
+}
+
+}
+
+static bool writeAll(int fd, const uint8_t* p, size_t n, uint64_t offset){
+    while(n > 0){
+        const ssize_t w = ::pwrite(fd, p, n, (off_t)offset);
+        if(w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+        offset += (uint64_t)w;
+    }
+    return true;
+}
+
+static void syncDir(const std::string& dir){
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd >= 0){
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+static void sleepUs(uint32_t us){
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// ------------------
+// WalWriter
+// ------------------
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point since){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+WalWriter::WalWriter(const Options& options) : _options(options), _queue(options.queueCapacity){
+    _batch.reserve(_options.maxBatchBytes + HEADER + MAX_RECORD);
+    if(_options.metrics){
+        _queueDepth = &_options.metrics->gauge("ingest_wal_queue_depth",
+            "Records queued for the WAL writer when its last batch closed.");
+        _commitTime = &_options.metrics->histogram("ingest_wal_commit_seconds",
+            "Time to write and fdatasync one WAL batch.");
+    }
+}
+
+WalWriter::~WalWriter(){
+    close();
+}
+
+bool WalWriter::open(){
+    if(_running) return true;
+    ::mkdir(_options.dir.c_str(), 0755);
+
+    const std::vector<uint64_t> segments = wal::listSegments(_options.dir);
+    if(segments.empty()){
+        if(!openSegment(1)) return false;
+        _nextLsn = 1;
+    } else {
+        // Only the newest segment can end in a torn write; keep its valid prefix.
+        const uint64_t first = segments.back();
+        _fd = ::open(wal::segmentPath(_options.dir, first).c_str(), O_RDWR);
+        if(_fd < 0) return false;
+
+        std::vector<uint8_t> data;
+        uint8_t chunk[65536];
+        for(;;){
+            const ssize_t r = ::read(_fd, chunk, sizeof(chunk));
+            if(r < 0) return false;
+            if(r == 0) break;
+            data.insert(data.end(), chunk, chunk + r);
+        }
+
+        size_t pos = 0;
+        uint64_t last = first - 1;
+        BulkStore::Row row;
+        while(size_t n = wal::parseRecord(data.data() + pos, data.size() - pos, row)){
+            last = row.lsn;
+            pos += n;
+        }
+        if(pos < data.size()){
+            if(::ftruncate(_fd, (off_t)pos) != 0 || ::fdatasync(_fd) != 0) return false;
+        }
+        _segmentSize = pos;
+        _nextLsn = last + 1;
+    }
+
+    _durableLsn.store(_nextLsn - 1, std::memory_order_release);
+    _running = true;
+    _thread = std::thread(&WalWriter::run, this);
+    return true;
+}
+
+void WalWriter::close(){
+    if(_running.exchange(false)) _thread.join();
+    if(_fd >= 0){
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+bool WalWriter::append(const void* data, size_t len){
+    if(len > MAX_RECORD){
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Slot s;
+    s.len = (uint32_t)len;
+    std::memcpy(s.data, data, len);
+    if(!_queue.push(s)){
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+WalWriter::Stats WalWriter::stats() const{
+    Stats s;
+    s.records = _records.load(std::memory_order_relaxed);
+    s.batches = _batches.load(std::memory_order_relaxed);
+    s.bytes = _bytes.load(std::memory_order_relaxed);
+    s.dropped = _dropped.load(std::memory_order_relaxed);
+    s.segments = _segments.load(std::memory_order_relaxed);
+    s.writeErrors = _writeErrors.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool WalWriter::openSegment(uint64_t firstLsn){
+    if(_fd >= 0) ::close(_fd);
+    _fd = ::open(wal::segmentPath(_options.dir, firstLsn).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(_fd < 0) return false;
+    syncDir(_options.dir);
+    _segmentSize = 0;
+    _segments.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Moves queued records into the batch, framed and numbered, until it is
+// full. Returns the number taken.
+size_t WalWriter::drain(uint64_t& batchFirstLsn){
+    size_t n = 0;
+    Slot s;
+    while(_batch.size() < _options.maxBatchBytes && _queue.pop(s)){
+        const uint64_t lsn = _nextLsn++;
+        if(_batch.empty()) batchFirstLsn = lsn;
+        const uint32_t crc = wal::crc32(wal::crc32(0, &lsn, 8), s.data, s.len);
+
+        uint8_t header[HEADER];
+        std::memcpy(header, &s.len, 4);
+        std::memcpy(header + 4, &crc, 4);
+        std::memcpy(header + 8, &lsn, 8);
+        _batch.insert(_batch.end(), header, header + HEADER);
+        _batch.insert(_batch.end(), s.data, s.data + s.len);
+        n++;
+    }
+    return n;
+}
+
+void WalWriter::run(){
+    using Clock = std::chrono::steady_clock;
+    uint64_t batchFirstLsn = 0;
+
+    for(;;){
+        const bool running = _running.load(std::memory_order_acquire);
+        drain(batchFirstLsn);
+        if(_batch.empty()){
+            if(_queueDepth) _queueDepth->set(0);
+            if(!running) return;
+            sleepUs(IDLE_POLL_US);
+            continue;
+        }
+
+        // Gather more until the batch is full or its first record has
+        // waited long enough. Stopping commits at once.
+        const Clock::time_point deadline = Clock::now() + std::chrono::microseconds(_options.maxDelayUs);
+        while(running && _batch.size() < _options.maxBatchBytes && Clock::now() < deadline){
+            if(drain(batchFirstLsn) == 0) sleepUs(std::min<uint32_t>(50, _options.maxDelayUs));
+        }
+
+        if(_queueDepth) _queueDepth->set((int64_t)_queue.size());
+
+        if(_segmentSize > 0 && _segmentSize + _batch.size() > _options.segmentBytes){
+            // The old segment is already durable up to its end.
+            if(!openSegment(batchFirstLsn)) _writeErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+        const Clock::time_point t0 = Clock::now();
+        commit();
+        if(_commitTime) _commitTime->record(elapsedNs(t0));
+    }
+}
+
+// Writes and syncs the batch. On failure the batch is dropped (and the file
+// cut back) rather than retried forever; its LSNs are simply never used.
+bool WalWriter::commit(){
+    const uint64_t records = _nextLsn - 1 - _durableLsn.load(std::memory_order_relaxed);
+    bool ok = _fd >= 0 && writeAll(_fd, _batch.data(), _batch.size(), _segmentSize) && ::fdatasync(_fd) == 0;
+
+    if(ok){
+        _segmentSize += _batch.size();
+        _records.fetch_add(records, std::memory_order_relaxed);
+        _batches.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(_batch.size(), std::memory_order_relaxed);
+    } else {
+        // Cut off whatever part of the batch reached the file.
+        if(_fd >= 0){
+            const int rc = ::ftruncate(_fd, (off_t)_segmentSize);
+            (void)rc;
+        }
+        _writeErrors.fetch_add(1, std::memory_order_relaxed);
+        _dropped.fetch_add(records, std::memory_order_relaxed);
+    }
+    _durableLsn.store(_nextLsn - 1, std::memory_order_release);
+    _batch.clear();
+    return ok;
+}
+
+// ------------------
+// WalLoader
+// ------------------
+
+WalLoader::WalLoader(const std::string& dir, BulkStore& store, size_t batchRows, Metrics* metrics)
+    : _dir(dir), _store(store), _batchRows(batchRows ? batchRows : 1){
+    _rows.reserve(_batchRows);
+    if(metrics){
+        _copyTime = &metrics->histogram("ingest_db_write_seconds", "Time to copy one batch into the database.");
+        _copyFailures = &metrics->counter("ingest_db_write_failures_total", "Batches the database refused.");
+        _backlog = &metrics->gauge("ingest_db_backlog_records", "Records durable in the WAL, not yet loaded.");
+    }
+}
+
+WalLoader::~WalLoader(){
+    stop();
+}
+
+bool WalLoader::open(){
+    FILE* f = std::fopen((_dir + "/checkpoint").c_str(), "r");
+    if(!f) return true;
+    uint64_t lsn, segment, offset;
+    const bool ok = std::fscanf(f, "%" SCNu64 " %" SCNu64 " %" SCNu64, &lsn, &segment, &offset) == 3;
+    std::fclose(f);
+    if(!ok) return false;
+    _checkpointLsn.store(lsn, std::memory_order_release);
+    _segment = segment;
+    _offset = offset;
+    return true;
+}
+
+bool WalLoader::saveCheckpoint(uint64_t lsn, uint64_t segment, uint64_t offset){
+    const std::string path = _dir + "/checkpoint";
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+
+    char buf[80];
+    const int len = std::snprintf(buf, sizeof(buf), "%" PRIu64 " %" PRIu64 " %" PRIu64 "\n", lsn, segment, offset);
+    const bool ok = writeAll(fd, (const uint8_t*)buf, (size_t)len, 0) && ::fsync(fd) == 0;
+    ::close(fd);
+    if(!ok || std::rename(tmp.c_str(), path.c_str()) != 0) return false;
+    syncDir(_dir);
+    return true;
+}
+
+// Moves to the segment after the current one (or, at the start, the one
+// holding the record after the checkpoint). False if there is none yet.
+bool WalLoader::nextSegment(){
+    const std::vector<uint64_t> segments = wal::listSegments(_dir);
+    if(_segment == 0){
+        const uint64_t want = _checkpointLsn.load(std::memory_order_relaxed) + 1;
+        for(uint64_t s : segments){
+            if(s <= want || _segment == 0) _segment = s;
+            if(s > want) break;
+        }
+        _offset = 0;
+        return _segment != 0;
+    }
+    for(uint64_t s : segments){
+        if(s > _segment){
+            _segment = s;
+            _offset = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+long WalLoader::loadOnce(uint64_t maxLsn){
+    if(_segment == 0 && !nextSegment()) return 0;
+    const uint64_t checkpoint = _checkpointLsn.load(std::memory_order_relaxed);
+
+    for(;;){
+        _rows.clear();
+        _buf.resize(READ_CHUNK);
+        const int fd = ::open(wal::segmentPath(_dir, _segment).c_str(), O_RDONLY);
+        if(fd < 0){
+            if(nextSegment()) continue;
+            return 0;
+        }
+        const ssize_t r = ::pread(fd, _buf.data(), _buf.size(), (off_t)_offset);
+        ::close(fd);
+        if(r < 0) return 0;
+
+        // Whole records only; a batch never spans segments, so the rows can
+        // point into _buf.
+        size_t pos = 0;
+        bool limited = false;
+        BulkStore::Row row;
+        while(_rows.size() < _batchRows){
+            const size_t n = wal::parseRecord(_buf.data() + pos, (size_t)r - pos, row);
+            if(n == 0) break;
+            if(row.lsn > maxLsn){
+                limited = true;
+                break;
+            }
+            if(row.lsn > checkpoint) _rows.push_back(row);
+            pos += n;
+        }
+
+        if(_rows.empty()){
+            _offset += pos;     // only already-loaded records were skipped
+            if(pos > 0) continue;
+            if(limited) return 0;
+            // Nothing more here. A newer segment means this one is sealed.
+            if(nextSegment()) continue;
+            return 0;
+        }
+
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        const bool copied = _store.copy(_rows.data(), _rows.size());
+        if(_copyTime) _copyTime->record(elapsedNs(t0));
+        if(!copied){
+            _storeFailures.fetch_add(1, std::memory_order_relaxed);
+            if(_copyFailures) _copyFailures->add();
+            return -1;
+        }
+        const uint64_t last = _rows.back().lsn;
+        _offset += pos;
+        // A failed save only means this batch may be sent again after a
+        // restart, which the store tolerates.
+        saveCheckpoint(last, _segment, _offset);
+        _checkpointLsn.store(last, std::memory_order_release);
+        return (long)_rows.size();
+    }
+}
+
+size_t WalLoader::removeLoaded(){
+    const std::vector<uint64_t> segments = wal::listSegments(_dir);
+    const uint64_t checkpoint = _checkpointLsn.load(std::memory_order_relaxed);
+    size_t removed = 0;
+    for(size_t i = 0; i + 1 < segments.size(); i++){
+        // Every record in segment i has an LSN below the next one's first.
+        if(segments[i + 1] > checkpoint + 1 || segments[i] == _segment) break;
+        if(::unlink(wal::segmentPath(_dir, segments[i]).c_str()) == 0) removed++;
+    }
+    return removed;
+}
+
+void WalLoader::start(const WalWriter& writer, uint32_t idleMs, uint32_t maxBackoffMs){
+    if(_running.exchange(true)) return;
+    _thread = std::thread([this, &writer, idleMs, maxBackoffMs]{
+        uint32_t backoffMs = idleMs;
+        while(_running.load(std::memory_order_acquire)){
+            const uint64_t durable = writer.durableLsn();
+            const long n = loadOnce(durable);
+            const uint64_t loaded = checkpointLsn();
+            if(_backlog) _backlog->set(durable > loaded ? (int64_t)(durable - loaded) : 0);
+            uint32_t waitMs = 0;
+            if(n < 0){
+                waitMs = backoffMs;
+                backoffMs = std::min(backoffMs * 2, maxBackoffMs);
+            } else {
+                backoffMs = idleMs;
+                if(n == 0){
+                    removeLoaded();
+                    waitMs = idleMs;
+                }
+            }
+            // In small steps, so stop() doesn't wait out a long backoff.
+            for(uint32_t t = 0; t < waitMs && _running.load(std::memory_order_relaxed); t += 5) sleepUs(5000);
+        }
+    });
+}
+
+void WalLoader::stop(){
+    if(_running.exchange(false)) _thread.join();
+}
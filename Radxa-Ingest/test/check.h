@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+
+// Minimal test harness: ctest only needs an exit code, and these tests run
+// on any Linux box without fetching a framework. Output follows the firmware's
+// Unity tests (file:test:PASS / FAIL lines and a summary).
+//
+//   static void test_something() { CHECK(x == 1); CHECK_EQ(a, b); }
+//   int main() { RUN(test_something); return checkSummary(); }
+
+inline int gCheckFailures = 0;
+inline int gCheckTests = 0;
+inline int gCheckTestsFailed = 0;
+
+#define CHECK(cond)                                                           \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);    \
+      gCheckFailures++;                                                       \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                        \
+  do {                                                                        \
+    const auto _va = (a);                                                     \
+    const auto _vb = (b);                                                     \
+    if (!(_va == _vb)) {                                                      \
+      std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, \
+                  __LINE__, #a, #b, (long long)_va, (long long)_vb);          \
+      gCheckFailures++;                                                       \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_STR(a, b)                                                       \
+  do {                                                                        \
+    const char* _sa = (a);                                                    \
+    const char* _sb = (b);                                                    \
+    if (!_sa || !_sb || std::strcmp(_sa, _sb) != 0) {                         \
+      std::printf("%s:%d: CHECK_STR(%s, %s) failed: \"%s\" != \"%s\"\n",      \
+                  __FILE__, __LINE__, #a, #b, _sa ? _sa : "(null)",           \
+                  _sb ? _sb : "(null)");                                      \
+      gCheckFailures++;                                                       \
+    }                                                                         \
+  } while (0)
+
+#define RUN(fn)                                                               \
+  do {                                                                        \
+    const int _before = gCheckFailures;                                       \
+    gCheckTests++;                                                            \
+    fn();                                                                     \
+    const bool _ok = (gCheckFailures == _before);                             \
+    if (!_ok) gCheckTestsFailed++;                                            \
+    std::printf("%s:%s:%s\n", __FILE__, #fn, _ok ? "PASS" : "FAIL");          \
+  } while (0)
+
+inline int checkSummary() {
+  std::printf("-----\n%d Tests %d Failures\n%s\n", gCheckTests, gCheckTestsFailed,
+              gCheckTestsFailed ? "FAIL" : "OK");
+  return gCheckTestsFailed ? 1 : 0;
+}
@@ -0,0 +1,373 @@
+#include <check.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Capture.h"
+#include "Mac.h"
+#include "Replay.h"
+
+static std::string tempPath() {
+  char path[] = "/tmp/capture_XXXXXX";
+  const int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  std::remove(path);  // CaptureWriter creates it
+  return path;
+}
+
+static std::string telemetry(const char* mac, int seq) {
+  return std::string("{\"message_type\": \"telemetry\", \"device\": {\"mac\": \"") + mac +
+         "\", \"controller\": \"A\"}, \"seq\": " + std::to_string(seq) + "}";
+}
+
+static void test_file_round_trip() {
+  const std::string path = tempPath();
+  const std::string json = telemetry("24:6F:28:AA:BB:CC", 1);
+  const uint8_t binary[] = {0xAA, 0x55, 0x41, 0x07, 0x00, 0x00, 0x9C};
+  {
+    CaptureWriter w;
+    CHECK(w.open(path, 1760000000000000000LL));
+    CHECK(w.append(0, 0xC0A80132, 5005, json.data(), json.size()));
+    CHECK(w.append(5000000, 0xC0A80133, 5006, binary, sizeof(binary)));
+    CHECK(w.append(5000001, 0xC0A80132, 5005, "", 0));
+    CHECK(w.close());
+  }
+
+  CaptureReader r;
+  CHECK(r.open(path));
+  CHECK_EQ(r.startNs(), 1760000000000000000LL);
+  capture::Packet p;
+  CHECK(r.next(p));
+  CHECK_EQ(p.tNs, 0u);
+  CHECK_EQ(p.ip, 0xC0A80132u);
+  CHECK_EQ(p.port, 5005);
+  CHECK_EQ(p.flags, capture::FLAG_JSON);
+  CHECK(std::string((const char*)p.data, p.len) == json);
+  CHECK_EQ((uintptr_t)p.data % 8, 0u);
+  CHECK(r.next(p));
+  CHECK_EQ(p.tNs, 5000000u);
+  CHECK_EQ(p.flags, 0);
+  CHECK_EQ(p.len, sizeof(binary));
+  CHECK(memcmp(p.data, binary, sizeof(binary)) == 0);
+  CHECK(r.next(p));
+  CHECK_EQ(p.len, 0u);
+  CHECK(!r.next(p));
+  std::remove(path.c_str());
+}
+
+// A torn last record is skipped on read and cut off when recording resumes.
+static void test_torn_record_and_continue() {
+  const std::string path = tempPath();
+  {
+    CaptureWriter w;
+    CHECK(w.open(path, 1));
+    for (int i = 0; i < 10; i++) CHECK(w.append((uint64_t)i, 1, 2, "abc", 3));
+  }
+  FILE* f = std::fopen(path.c_str(), "ab");
+  const uint8_t torn[] = {40, 0, 0, 0, 12, 0, 0, 0, 1, 2, 3};
+  std::fwrite(torn, 1, sizeof(torn), f);
+  std::fclose(f);
+
+  {
+    CaptureReader r;
+    CHECK(r.open(path));
+    capture::Packet p;
+    int n = 0;
+    while (r.next(p)) n++;
+    CHECK_EQ(n, 10);
+  }
+  {
+    CaptureWriter w;
+    CHECK(w.open(path, 999));
+    CHECK_EQ(w.startNs(), 1);
+    CHECK_EQ(w.records(), 10u);
+    CHECK(w.append(10, 1, 2, "defg", 4));
+  }
+  CaptureReader r;
+  CHECK(r.open(path));
+  capture::Packet p;
+  int n = 0;
+  while (r.next(p)) n++;
+  CHECK_EQ(n, 11);
+  CHECK(std::string((const char*)p.data, p.len) == "defg");
+  CHECK_EQ(r.position(), r.fileSize());
+  std::remove(path.c_str());
+}
+
+// Lowers RLIMIT_FSIZE while it lives: writes past the limit then fail with
+// EFBIG, as on a full disk, instead of raising SIGXFSZ.
+struct FileSizeLimit {
+  rlimit saved;
+  explicit FileSizeLimit(rlim_t bytes) {
+    std::signal(SIGXFSZ, SIG_IGN);
+    getrlimit(RLIMIT_FSIZE, &saved);
+    rlimit l = saved;
+    l.rlim_cur = bytes;
+    setrlimit(RLIMIT_FSIZE, &l);
+  }
+  ~FileSizeLimit() { setrlimit(RLIMIT_FSIZE, &saved); }
+};
+
+// Whole records in the file; the file must end right after the last one.
+static int wholeRecords(const std::string& path) {
+  CaptureReader r;
+  if (!r.open(path)) return -1;
+  capture::Packet p;
+  int n = 0;
+  while (r.next(p)) n++;
+  return r.position() == r.fileSize() ? n : -1;
+}
+
+static void test_unwritable_target() {
+  CaptureWriter w;
+  CHECK(!w.open("/dev/full", 0));
+  CHECK(!w.append(0, 1, 2, "abc", 3));
+}
+
+// A failed write leaves no torn record and loses nothing: the records stay
+// buffered until a later flush gets them out.
+static void test_failed_write_keeps_records() {
+  const std::string path = tempPath();
+  const std::string payload(1000, 'x');
+  CaptureWriter w;
+  CHECK(w.open(path, 1));
+  {
+    FileSizeLimit full(4096);
+    for (int i = 0; i < 10; i++) CHECK(w.append((uint64_t)i, 1, 2, payload.data(), payload.size()));
+    CHECK(!w.flush());
+    CHECK(w.writeErrors() >= 1);
+    CHECK_EQ(w.buffered(), 10u);
+    CHECK_EQ(wholeRecords(path), 0);
+    CHECK(!w.flush());
+    CHECK_EQ(w.buffered(), 10u);
+  }
+  CHECK(w.flush());
+  CHECK_EQ(w.buffered(), 0u);
+  CHECK(w.append(10, 1, 2, "abc", 3));
+  CHECK(w.close());
+
+  CaptureReader r;
+  CHECK(r.open(path));
+  capture::Packet p;
+  for (uint64_t i = 0; i < 11; i++) {
+    CHECK(r.next(p));
+    CHECK_EQ(p.tNs, i);
+  }
+  CHECK(!r.next(p));
+  std::remove(path.c_str());
+}
+
+// With writes failing, the buffer stops at its limit and further records
+// are refused and counted, not dropped silently.
+static void test_full_buffer_refuses_records() {
+  const std::string path = tempPath();
+  const std::string payload(1000, 'x');  // 1024 bytes per record
+  CaptureWriter w;
+  CHECK(w.open(path, 1));
+  w.setBufferLimit(4 * 1024);
+  {
+    FileSizeLimit full(1000);
+    for (int i = 0; i < 4; i++) CHECK(w.append((uint64_t)i, 1, 2, payload.data(), payload.size()));
+    CHECK(!w.append(4, 1, 2, payload.data(), payload.size()));
+    CHECK(!w.append(5, 1, 2, payload.data(), payload.size()));
+    CHECK_EQ(w.refused(), 2u);
+    CHECK_EQ(w.buffered(), 4u);
+    CHECK(!w.close());
+  }
+  CHECK_EQ(wholeRecords(path), 0);
+  std::remove(path.c_str());
+}
+
+static void test_replay_mac_is_distinct() {
+  const uint64_t a = 0x246F28AABBCCULL, b = 0x246F28AABBCDULL;
+  CHECK_EQ(UdpReplayer::replayMac(a, 0), a);
+  std::set<uint64_t> seen;
+  for (unsigned k = 0; k < 1000; k++) {
+    seen.insert(UdpReplayer::replayMac(a, k));
+    seen.insert(UdpReplayer::replayMac(b, k));
+  }
+  CHECK_EQ(seen.size(), 2000u);
+  CHECK_EQ(UdpReplayer::replayMac(a, 1) >> 40 & 0x02, 0x02u);
+}
+
+struct RecordingThread {
+  UdpRecorder rec;
+  CaptureWriter writer;
+  std::atomic<bool> stop{false};
+  UdpRecorder::Stats stats = {};
+  std::thread thread;
+
+  bool start(const std::string& path) {
+    if (!rec.open(0x7F000001, 0) || !writer.open(path, 0)) return false;
+    thread = std::thread([this] { stats = rec.run(writer, stop); });
+    return true;
+  }
+  void finish() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    stop = true;
+    thread.join();
+    writer.close();
+  }
+};
+
+// The recorder reports every datagram the full disk kept out of the
+// capture, and the ones it took are still written once space returns.
+static void test_recorder_counts_write_failures() {
+  const std::string path = tempPath();
+  static const int N = 40;
+  UdpRecorder rec;
+  CaptureWriter w;
+  CHECK(rec.open(0x7F000001, 0));
+  CHECK(w.open(path, 0));
+  w.setBufferLimit(2048);
+
+  UdpRecorder::Stats st = {};
+  {
+    FileSizeLimit full(64);
+    std::atomic<bool> stop{false};
+    std::thread t([&] { st = rec.run(w, stop); });
+    const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(0x7F000001);
+    to.sin_port = htons(rec.port());
+    for (int i = 0; i < N; i++) {
+      const std::string msg = telemetry("24:6F:28:AA:BB:CC", i);
+      sendto(tx, msg.data(), msg.size(), 0, (sockaddr*)&to, sizeof(to));
+    }
+    close(tx);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop = true;
+    t.join();
+  }
+  CHECK_EQ(st.packets + st.lost, (uint64_t)N);
+  CHECK(st.lost > 0);
+  CHECK(st.packets > 0);
+  CHECK(st.writeErrors >= 1);
+  CHECK_EQ(st.unwritten, st.packets);
+  CHECK(w.close());
+  CHECK_EQ(wholeRecords(path), (int)st.packets);
+  std::remove(path.c_str());
+}
+
+// Record real datagrams on loopback, then replay them twice as fast as
+// three racks into a second recorder.
+static void test_record_and_replay_on_loopback() {
+  const std::string first = tempPath(), second = tempPath();
+  static const int N = 6;
+  static const int GAP_MS = 30;
+
+  RecordingThread a;
+  CHECK(a.start(first));
+  const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = htonl(0x7F000001);
+  to.sin_port = htons(a.rec.port());
+  const uint8_t binary[] = {0xAA, 0x55, 0x42, 0x01, 0x00, 0x00, 0x11};
+  for (int i = 0; i < N; i++) {
+    if (i == 3) {
+      sendto(tx, binary, sizeof(binary), 0, (sockaddr*)&to, sizeof(to));
+    } else {
+      const std::string msg = telemetry("24:6F:28:AA:BB:CC", i);
+      sendto(tx, msg.data(), msg.size(), 0, (sockaddr*)&to, sizeof(to));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(GAP_MS));
+  }
+  close(tx);
+  a.finish();
+  CHECK_EQ(a.stats.packets, (uint64_t)N);
+  CHECK_EQ(a.stats.json, (uint64_t)N - 1);
+
+  RecordingThread b;
+  CHECK(b.start(second));
+  CaptureReader in;
+  CHECK(in.open(first));
+  UdpReplayer player;
+  UdpReplayer::Options o;
+  o.port = b.rec.port();
+  o.speed = 2;
+  o.copies = 3;
+  CHECK(player.open(o));
+  const UdpReplayer::Result res = player.run(in);
+  b.finish();
+
+  CHECK_EQ(res.packets, (uint64_t)N * 3);
+  CHECK_EQ(res.rewritten, (uint64_t)(N - 1) * 2);
+  CHECK_EQ(b.stats.packets, (uint64_t)N * 3);
+  // Twice as fast: the first to last packet span halves.
+  const double expectS = (N - 1) * GAP_MS / 2 / 1000.0;
+  CHECK(res.seconds > expectS * 0.9 && res.seconds < expectS * 2);
+
+  CaptureReader out;
+  CHECK(out.open(second));
+  std::set<uint32_t> sources;
+  std::set<uint64_t> macs;
+  capture::Packet p;
+  uint64_t firstNs = 0, lastNs = 0;
+  int n = 0, binaryIntact = 0;
+  while (out.next(p)) {
+    if (n++ == 0) firstNs = p.tNs;
+    lastNs = p.tNs;
+    sources.insert(p.ip);
+    if (p.flags & capture::FLAG_JSON) {
+      macs.insert(findDeviceMac((const char*)p.data, p.len));
+    } else {
+      binaryIntact += p.len == sizeof(binary) && memcmp(p.data, binary, sizeof(binary)) == 0;
+    }
+  }
+  CHECK_EQ(sources.size(), 3u);
+  CHECK(sources.count(0x7F000001) && sources.count(0x7F000002) && sources.count(0x7F000003));
+  CHECK_EQ(macs.size(), 3u);
+  CHECK(macs.count(0x246F28AABBCCULL) && macs.count(UdpReplayer::replayMac(0x246F28AABBCCULL, 2)));
+  CHECK_EQ(binaryIntact, 3);
+  const double spanS = (double)(lastNs - firstNs) / 1e9;
+  CHECK(spanS > expectS * 0.9 && spanS < expectS * 2);
+  std::printf("replay x2, 3 copies: %llu packets in %.3f s (recorded span %.3f s), max late %.0f us\n",
+              (unsigned long long)res.packets, res.seconds, spanS, res.maxLateUs);
+
+  // As fast as possible.
+  RecordingThread c;
+  const std::string third = tempPath();
+  CHECK(c.start(third));
+  UdpReplayer fast;
+  o.port = c.rec.port();
+  o.speed = 0;
+  o.copies = 500;
+  CHECK(fast.open(o));
+  in.rewind();
+  const UdpReplayer::Result max = fast.run(in);
+  c.finish();
+  CHECK_EQ(max.packets, (uint64_t)N * 500);
+  CHECK(c.stats.packets > 0);
+  std::printf("replay max speed: %llu packets, %.0f packets/s sent, %llu received\n",
+              (unsigned long long)max.packets, max.packetsPerS, (unsigned long long)c.stats.packets);
+
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+  std::remove(third.c_str());
+}
+
+int main() {
+  RUN(test_file_round_trip);
+  RUN(test_torn_record_and_continue);
+  RUN(test_unwritable_target);
+  RUN(test_failed_write_keeps_records);
+  RUN(test_full_buffer_refuses_records);
+  RUN(test_replay_mac_is_distinct);
+  RUN(test_recorder_counts_write_failures);
+  RUN(test_record_and_replay_on_loopback);
+  return checkSummary();
+}
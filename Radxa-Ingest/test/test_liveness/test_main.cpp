@@ -0,0 +1,152 @@
+#include <check.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "LivenessTracker.h"
+#include "TimerWheel.h"
+
+static const int64_t T0 = 1760000000000LL;  // epoch ms
+
+// Timers set at deltas from one tick to past the last level all fire on
+// exactly their tick, however the wheel is advanced.
+static void test_wheel_fires_on_exact_tick() {
+  static const uint64_t DELTAS[] = {0, 1, 255, 256, 257, 1000, 16383, 16384, 70000,
+                                    1048575, 1048576, 5000000};
+  static const int N = sizeof(DELTAS) / sizeof(DELTAS[0]);
+  const uint64_t start = 123456;
+  TimerWheel w(start);
+  std::vector<TimerWheel::Timer> timers(N);
+  std::vector<uint64_t> firedAt(N, 0);
+  for (int i = 0; i < N; i++) {
+    timers[i].id = (uint32_t)i;
+    w.schedule(timers[i], start + DELTAS[i]);
+  }
+  CHECK_EQ(w.pending(), (size_t)N);
+
+  // Uneven steps, so cascades happen inside a single advance() too.
+  uint64_t now = start;
+  uint64_t step = 1;
+  while (w.pending() > 0) {
+    now += step;
+    step = step * 3 % 997 + 1;
+    // The tick being processed is the one just before nextTick().
+    w.advance(now, [&](TimerWheel::Timer& t) { firedAt[t.id] = w.nextTick() - 1; });
+  }
+  for (int i = 0; i < N; i++) CHECK_EQ(firedAt[i], start + DELTAS[i]);
+}
+
+static void test_wheel_reschedule_and_cancel() {
+  TimerWheel w(0);
+  TimerWheel::Timer a, b;
+  int fired = 0;
+  auto count = [&](TimerWheel::Timer&) { fired++; };
+
+  w.schedule(a, 100);
+  w.schedule(b, 100);
+  w.schedule(a, 50000);  // moved, not duplicated
+  CHECK_EQ(w.pending(), 2u);
+  w.cancel(b);
+  CHECK(!b.pending());
+  w.advance(49999, count);
+  CHECK_EQ(fired, 0);
+  w.advance(50000, count);
+  CHECK_EQ(fired, 1);
+  CHECK_EQ(w.pending(), 0u);
+
+  // A past deadline fires on the next advance; a callback may re-arm.
+  w.schedule(a, 10);
+  w.advance(50001, [&](TimerWheel::Timer& t) {
+    fired++;
+    w.schedule(t, 50005);
+  });
+  CHECK_EQ(fired, 2);
+  CHECK(a.pending());
+  CHECK_EQ(a.expires, 50005u);
+}
+
+static void addRacks(LivenessTracker& t) {
+  t.addDevice(0x246F28000001ULL, "rack-01", 'A');
+  t.addDevice(0x246F28000002ULL, "rack-01", 'B');
+  t.addDevice(0x246F28000003ULL, "rack-02", 'A');
+}
+
+static void test_device_down_after_timeout() {
+  LivenessTracker t(15000, 100, T0);
+  addRacks(t);
+  std::vector<LivenessTracker::Event> ev;
+
+  CHECK(t.onPacket(0x246F28000001ULL, T0 + 10, true));
+  CHECK(!t.onPacket(0x246F28FFFFFFULL, T0 + 10, true));
+  t.takeEvents(ev);
+  CHECK_EQ(ev.size(), 1u);
+  CHECK(ev[0].type == LivenessTracker::EventType::DEVICE_UP);
+  CHECK_STR(ev[0].rack, "rack-01");
+  CHECK_EQ(t.devicesUp(), 1u);
+
+  // Still reporting every 5 s: never down.
+  int64_t now = T0 + 10;
+  for (int i = 0; i < 10; i++) {
+    now += 5000;
+    t.advance(now);
+    t.onPacket(0x246F28000001ULL, now, true);
+  }
+  ev.clear();
+  t.takeEvents(ev);
+  CHECK(ev.empty());
+
+  // Silent: down at the deadline, not before.
+  const int64_t deadline = now + 15000;
+  t.advance(deadline - 1);
+  t.takeEvents(ev);
+  CHECK(ev.empty());
+  t.advance(deadline + 99);
+  t.takeEvents(ev);
+  CHECK_EQ(ev.size(), 1u);
+  CHECK(ev[0].type == LivenessTracker::EventType::DEVICE_DOWN);
+  CHECK_EQ(ev[0].mac, 0x246F28000001ULL);
+  CHECK_EQ(ev[0].tMs, deadline);
+  CHECK_EQ(t.devicesUp(), 0u);
+}
+
+// A stops sending, B takes over 2.5 s later, A comes back: one failover each
+// way, with the gap between the senders' telemetry.
+static void test_failover_and_failback() {
+  LivenessTracker t(70000, 100, T0);
+  addRacks(t);
+  std::vector<LivenessTracker::Event> ev;
+  const uint64_t A = 0x246F28000001ULL, B = 0x246F28000002ULL;
+
+  t.onPacket(A, T0, true);
+  t.onPacket(B, T0 + 100, false);  // B's clock sync: alive, not sending telemetry
+  t.onPacket(A, T0 + 5000, true);
+  t.onPacket(0x246F28000003ULL, T0 + 5000, true);  // other rack, unaffected
+  t.onPacket(B, T0 + 7500, true);
+  t.onPacket(B, T0 + 12500, true);
+  t.onPacket(A, T0 + 30000, false);  // A back, syncing first
+  t.onPacket(A, T0 + 31000, true);
+  t.takeEvents(ev);
+
+  std::vector<LivenessTracker::Event> failovers;
+  for (const LivenessTracker::Event& e : ev) {
+    if (e.type == LivenessTracker::EventType::FAILOVER) failovers.push_back(e);
+  }
+  CHECK_EQ(failovers.size(), 2u);
+  CHECK_EQ(failovers[0].fromMac, A);
+  CHECK_EQ(failovers[0].mac, B);
+  CHECK_EQ(failovers[0].fromController, 'A');
+  CHECK_EQ(failovers[0].controller, 'B');
+  CHECK_EQ(failovers[0].gapMs, 2500);
+  CHECK_STR(failovers[0].rack, "rack-01");
+  CHECK_EQ(failovers[1].fromMac, B);
+  CHECK_EQ(failovers[1].mac, A);
+  CHECK_EQ(failovers[1].gapMs, 18500);
+}
+
+int main() {
+  RUN(test_wheel_fires_on_exact_tick);
+  RUN(test_wheel_reschedule_and_cancel);
+  RUN(test_device_down_after_timeout);
+  RUN(test_failover_and_failback);
+  return checkSummary();
+}
@@ -0,0 +1,191 @@
+#include <check.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Metrics.h"
+#include "MetricsServer.h"
+
+static bool contains(const std::string& s, const std::string& part) { return s.find(part) != std::string::npos; }
+
+// More threads than shards, all alive at once: the extra ones share the
+// overflow cell, and nothing is lost either way.
+static void test_counter_sums_over_threads() {
+  Metrics m;
+  Metrics::Counter& c = m.counter("c_total", "c");
+  const int threads = Metrics::SHARDS + 4;
+  const int adds = 100000;
+  std::atomic<int> ready{0};
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; t++) {
+    ts.emplace_back([&] {
+      c.add(0);  // claims a shard
+      ready++;
+      while (ready.load() < threads) std::this_thread::yield();
+      for (int i = 0; i < adds; i++) c.add();
+    });
+  }
+  for (std::thread& t : ts) t.join();
+  CHECK_EQ(c.value(), (uint64_t)threads * adds);
+}
+
+// A thread's shard goes back when it exits; a later thread keeps adding to it.
+static void test_shards_are_reused() {
+  Metrics m;
+  Metrics::Counter& c = m.counter("c_total", "c");
+  for (int i = 0; i < 200; i++) std::thread([&] { c.add(3); }).join();
+  CHECK_EQ(c.value(), 600u);
+}
+
+static void test_same_name_and_labels_is_same_metric() {
+  Metrics m;
+  Metrics::Counter& a = m.counter("x_total", "x", "port=\"1\"");
+  Metrics::Counter& b = m.counter("x_total", "x", "port=\"1\"");
+  Metrics::Counter& c = m.counter("x_total", "x", "port=\"2\"");
+  CHECK(&a == &b);
+  CHECK(&a != &c);
+}
+
+// Buckets tile the range without gaps, and each is at most 1/8 of its values wide.
+static void test_histogram_buckets() {
+  using H = Metrics::Histogram;
+  CHECK_EQ(H::BUCKETS, 304u);
+  for (unsigned b = 0; b < H::BUCKETS; b++) {
+    CHECK_EQ(H::bucketOf(H::bucketLow(b)), b);
+    CHECK_EQ(H::bucketOf(H::bucketHigh(b)), b);
+    if (b + 1 < H::BUCKETS) CHECK_EQ(H::bucketHigh(b) + 1, H::bucketLow(b + 1));
+    if (b >= 8) CHECK(H::bucketHigh(b) - H::bucketLow(b) + 1 <= H::bucketLow(b) / 8);
+  }
+  CHECK_EQ(H::bucketLow(0), 0u);
+  CHECK_EQ(H::bucketHigh(H::BUCKETS - 1), (1ull << H::MAX_BITS) - 1);
+  CHECK_EQ(H::bucketOf(1ull << H::MAX_BITS), H::BUCKETS - 1);
+  CHECK_EQ(H::bucketOf(~0ull), H::BUCKETS - 1);
+}
+
+// Percentiles of an even spread are never low and at most 1/8 high.
+static void test_histogram_percentiles() {
+  Metrics m;
+  Metrics::Histogram& h = m.histogram("h_seconds", "h");
+  CHECK_EQ(h.percentile(50), 0u);
+  for (uint64_t v = 1; v <= 100000; v++) h.record(v * 10);
+  CHECK_EQ(h.count(), 100000u);
+  CHECK_EQ(h.sum(), 10ull * 100000 * 100001 / 2);
+  static const double PCTS[] = {1, 10, 50, 90, 99, 99.9, 100};
+  for (double p : PCTS) {
+    const uint64_t exact = (uint64_t)(p * 10000);
+    const uint64_t got = h.percentile(p);
+    CHECK(got >= exact);
+    CHECK(got <= exact + exact / 8);
+  }
+  CHECK_EQ(h.countBelow(1024), 102u);     // 10, 20, ... 1020
+}
+
+static void test_render() {
+  Metrics m;
+  m.counter("ingest_packets_total", "Datagrams received.", "port=\"5005\",thread=\"0\"").add(3);
+  m.counter("ingest_packets_total", "Datagrams received.", "port=\"5005\",thread=\"1\"").add(4);
+  m.gauge("ingest_queue_depth", "Records waiting.").set(-2);
+  Metrics::Histogram& h = m.histogram("db_write_seconds", "Database batch time.");
+  h.record(500);          // below the first bound, 1023 ns
+  h.record(1023);
+  h.record(1024);
+  h.record(3000000000);   // 3 s
+  m.collect("rack_last_seen_seconds", "Age of each rack's newest datagram.", [](const Metrics::Emit& emit) {
+    emit(Metrics::label("rack", "r-1"), 1.5);
+    emit(Metrics::label("rack", "odd\"name\\"), 0);
+  });
+
+  std::string page;
+  m.render(page);
+  CHECK(contains(page, "# HELP ingest_packets_total Datagrams received.\n"
+                       "# TYPE ingest_packets_total counter\n"
+                       "ingest_packets_total{port=\"5005\",thread=\"0\"} 3\n"
+                       "ingest_packets_total{port=\"5005\",thread=\"1\"} 4\n"));
+  CHECK(contains(page, "# TYPE ingest_queue_depth gauge\ningest_queue_depth -2\n"));
+  CHECK(contains(page, "# TYPE db_write_seconds histogram\n"));
+  CHECK(contains(page, "db_write_seconds_bucket{le=\"1.023e-06\"} 2\n"));
+  CHECK(contains(page, "db_write_seconds_bucket{le=\"2.047e-06\"} 3\n"));
+  CHECK(contains(page, "db_write_seconds_bucket{le=\"2.147483647\"} 3\n"));
+  CHECK(contains(page, "db_write_seconds_bucket{le=\"4.294967295\"} 4\n"));
+  CHECK(contains(page, "db_write_seconds_bucket{le=\"+Inf\"} 4\n"));
+  CHECK(contains(page, "db_write_seconds_sum 3.00000255\n"));
+  CHECK(contains(page, "db_write_seconds_count 4\n"));
+  CHECK(contains(page, "# TYPE rack_last_seen_seconds gauge\n"
+                       "rack_last_seen_seconds{rack=\"r-1\"} 1.5\n"
+                       "rack_last_seen_seconds{rack=\"odd\\\"name\\\\\"} 0\n"));
+
+  // Cumulative buckets never go down.
+  uint64_t last = 0;
+  size_t at = 0;
+  int buckets = 0;
+  while ((at = page.find("db_write_seconds_bucket{", at)) != std::string::npos) {
+    at = page.find("} ", at) + 2;
+    const uint64_t v = std::stoull(page.substr(at));
+    CHECK(v >= last);
+    last = v;
+    buckets++;
+  }
+  CHECK_EQ(buckets, 28);
+}
+
+// GET /metrics over a real socket; returns the whole response.
+static std::string request(uint16_t port, const std::string& text) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(MetricsServer::LOOPBACK);
+  a.sin_port = htons(port);
+  std::string out;
+  if (connect(fd, (sockaddr*)&a, sizeof(a)) == 0) {
+    send(fd, text.data(), text.size(), 0);
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) out.append(buf, (size_t)n);
+  }
+  close(fd);
+  return out;
+}
+
+static void test_server() {
+  Metrics m;
+  Metrics::Counter& c = m.counter("ingest_packets_total", "Datagrams received.");
+  c.add(7);
+  MetricsServer server(m);
+  CHECK(server.start(0));
+  CHECK(server.port() != 0);
+
+  const std::string ok = request(server.port(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  CHECK(contains(ok, "HTTP/1.1 200 OK\r\n"));
+  CHECK(contains(ok, "Content-Type: text/plain; version=0.0.4"));
+  CHECK(contains(ok, "\r\n\r\n# HELP ingest_packets_total"));
+  CHECK(contains(ok, "ingest_packets_total 7\n"));
+  const size_t body = ok.find("\r\n\r\n") + 4;
+  CHECK(contains(ok, "Content-Length: " + std::to_string(ok.size() - body) + "\r\n"));
+
+  // A later scrape sees later counts.
+  c.add(1);
+  CHECK(contains(request(server.port(), "GET /metrics?x=1 HTTP/1.1\r\n\r\n"), "ingest_packets_total 8\n"));
+
+  CHECK(contains(request(server.port(), "GET / HTTP/1.1\r\n\r\n"), "HTTP/1.1 404 Not Found\r\n"));
+  CHECK(contains(request(server.port(), "GET /metricsx HTTP/1.1\r\n\r\n"), "HTTP/1.1 404 Not Found\r\n"));
+  CHECK(contains(request(server.port(), "POST /metrics HTTP/1.1\r\n\r\n"), "HTTP/1.1 405"));
+  CHECK_EQ(server.scrapes(), 2u);
+  server.stop();
+}
+
+int main() {
+  RUN(test_counter_sums_over_threads);
+  RUN(test_shards_are_reused);
+  RUN(test_same_name_and_labels_is_same_metric);
+  RUN(test_histogram_buckets);
+  RUN(test_histogram_percentiles);
+  RUN(test_render);
+  RUN(test_server);
+  return checkSummary();
+}
@@ -0,0 +1,200 @@
+#include <check.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mac.h"
+#include "RackMap.h"
+#include "RackTable.h"
+
+static void test_parse_and_format_round_trip() {
+  const char* s = "24:6F:28:AA:BB:CC";
+  const uint64_t mac = parseMac(s, strlen(s));
+  CHECK_EQ(mac, 0x246F28AABBCCULL);
+
+  char out[18];
+  formatMac(mac, out);
+  CHECK_STR(out, s);
+
+  CHECK_EQ(parseMac("24-6f-28-aa-bb-cc", 17), 0x246F28AABBCCULL);
+}
+
+static void test_parse_rejects_malformed() {
+  CHECK_EQ(parseMac("24:6F:28:AA:BB", 14), MAC_INVALID);
+  CHECK_EQ(parseMac("24:6F:28:AA:BB:CC:", 18), MAC_INVALID);
+  CHECK_EQ(parseMac("24:6F:28:AA:BB:CG", 17), MAC_INVALID);
+  CHECK_EQ(parseMac("246F:28:AA:BB:CC:", 17), MAC_INVALID);
+  CHECK_EQ(parseMac(nullptr, 17), MAC_INVALID);
+}
+
+static void test_find_mac_in_firmware_payload() {
+  // The envelope the firmware sends, cut short: no NUL needed.
+  const std::string json =
+      "{\n  \"message_type\": \"telemetry\",\n\n  \"device\": {\n"
+      "    \"mac\": \"24:6F:28:AA:BB:CC\",\n    \"controller\": \"A\"\n  },\n";
+  CHECK_EQ(findDeviceMac(json.data(), json.size()), 0x246F28AABBCCULL);
+
+  const std::string noMac = "{\"message_type\": \"time_request\"}";
+  CHECK_EQ(findDeviceMac(noMac.data(), noMac.size()), MAC_INVALID);
+
+  // Truncated inside the value.
+  CHECK_EQ(findDeviceMac(json.data(), json.find("BB:CC")), MAC_INVALID);
+}
+
+static void test_table_finds_and_misses() {
+  RackTable t;
+  t.insert(0x246F28AABBCCULL, "rack-01");
+  t.insert(0x246F28AABBCDULL, "rack-01");
+  t.insert(0x246F28000001ULL, "rack-02");
+  CHECK_EQ(t.size(), 3u);
+  CHECK_STR(t.find(0x246F28AABBCCULL), "rack-01");
+  CHECK_STR(t.find(0x246F28000001ULL), "rack-02");
+  CHECK(t.find(0x246F28000002ULL) == nullptr);
+  // Same rack name is stored once.
+  CHECK(t.find(0x246F28AABBCCULL) == t.find(0x246F28AABBCDULL));
+
+  t.insert(0x246F28AABBCCULL, "rack-09");
+  CHECK_EQ(t.size(), 3u);
+  CHECK_STR(t.find(0x246F28AABBCCULL), "rack-09");
+}
+
+static void test_table_grows_and_stays_half_empty() {
+  RackTable t;
+  // Sequential MACs from one OUI, the common real-world shape.
+  for (uint64_t i = 0; i < 20000; i++) {
+    t.insert(0x246F28000000ULL + i, "rack-" + std::to_string(i / 2));
+  }
+  CHECK_EQ(t.size(), 20000u);
+  CHECK(t.capacity() >= 2 * t.size());
+  CHECK_STR(t.find(0x246F28000000ULL + 12345), "rack-6172");
+  CHECK(t.find(0x246F28000000ULL + 20000) == nullptr);
+}
+
+static void test_load_csv() {
+  char path[] = "/tmp/rack_map_XXXXXX";
+  const int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  FILE* f = fdopen(fd, "w");
+  std::fputs("mac,rack_id\n"
+              "# racks in row 3\n"
+              "24:6F:28:AA:BB:CC,rack-01\r\n"
+              "\n"
+              " 24:6f:28:aa:bb:cd , \"rack-02\"\n"
+              "not-a-mac,rack-03\n"
+              "24:6F:28:AA:BB:CE,\n",
+              f);
+  std::fclose(f);
+
+  RackTable t;
+  size_t bad = 0;
+  CHECK(t.loadCsv(path, &bad));
+  CHECK_EQ(t.size(), 2u);
+  CHECK_EQ(bad, 2u);
+  CHECK_STR(t.find(0x246F28AABBCCULL), "rack-01");
+  CHECK_STR(t.find(0x246F28AABBCDULL), "rack-02");
+  std::remove(path);
+
+  CHECK(!t.loadCsv("/nonexistent/map.csv"));
+}
+
+static void test_map_unknown_and_publish() {
+  RackMap map;
+  RackMap::Reader* r = map.addReader();
+  CHECK(r != nullptr);
+
+  {
+    RackMap::ReadSection s(map, *r);
+    CHECK(s.rackId(0x246F28AABBCCULL) == RackMap::UNKNOWN);
+  }
+
+  std::unique_ptr<RackTable> t(new RackTable());
+  t->insert(0x246F28AABBCCULL, "rack-01");
+  map.publish(std::move(t));
+  CHECK_EQ(map.version(), 1u);
+
+  RackMap::ReadSection s(map, *r);
+  CHECK_STR(s.rackId(0x246F28AABBCCULL), "rack-01");
+  CHECK_STR(s.rackId(0x246F28AABBCDULL), "unknown");
+}
+
+// Receive threads keep resolving while the mapping is reloaded over and over.
+// Every table maps all MACs to the same "v<N>" name, so a section that ever
+// sees two different names was reading a table that changed under it.
+static void test_concurrent_reload() {
+  static const int DEVICES = 512;
+  static const int RELOADS = 100;
+  RackMap map;
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::atomic<long> lookups{0};
+  std::atomic<int> started{0};
+
+  auto build = [](int version) {
+    std::unique_ptr<RackTable> t(new RackTable());
+    const std::string name = "v" + std::to_string(version);
+    for (int i = 0; i < DEVICES; i++) t->insert(0x246F28000000ULL + i, name);
+    return t;
+  };
+  map.publish(build(0));
+
+  std::vector<std::thread> readers;
+  for (int n = 0; n < 4; n++) {
+    RackMap::Reader* r = map.addReader();
+    readers.emplace_back([&, r, n] {
+      uint64_t i = (uint64_t)n;
+      long local = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        RackMap::ReadSection s(map, *r);
+        const char* first = s.rackId(0x246F28000000ULL + i % DEVICES);
+        for (int k = 0; k < 16; k++) {
+          const char* rack = s.rackId(0x246F28000000ULL + (i + k * 31) % DEVICES);
+          if (strcmp(rack, first) != 0) torn++;
+        }
+        if (i++ == (uint64_t)n) started++;
+        local += 17;
+      }
+      lookups += local;
+    });
+  }
+
+  // On a single core the reloads could otherwise finish before any reader runs.
+  while (started.load() < 4) std::this_thread::yield();
+  for (int v = 1; v <= RELOADS; v++) map.publish(build(v));
+  stop = true;
+  for (std::thread& t : readers) t.join();
+
+  CHECK_EQ(torn.load(), 0);
+  CHECK(lookups.load() > 0);
+  CHECK_EQ(map.version(), (uint64_t)RELOADS + 1);
+
+  RackMap::Reader* r = map.addReader();
+  RackMap::ReadSection s(map, *r);
+  const std::string last = "v" + std::to_string(RELOADS);
+  CHECK_STR(s.rackId(0x246F28000000ULL), last.c_str());
+}
+
+static void test_reader_slots_are_bounded() {
+  RackMap map;
+  for (unsigned i = 0; i < RackMap::MAX_READERS; i++) CHECK(map.addReader() != nullptr);
+  CHECK(map.addReader() == nullptr);
+  // Reloads still work with every slot taken and idle.
+  map.publish(std::unique_ptr<RackTable>(new RackTable()));
+  CHECK_EQ(map.version(), 1u);
+}
+
+int main() {
+  RUN(test_parse_and_format_round_trip);
+  RUN(test_parse_rejects_malformed);
+  RUN(test_find_mac_in_firmware_payload);
+  RUN(test_table_finds_and_misses);
+  RUN(test_table_grows_and_stays_half_empty);
+  RUN(test_load_csv);
+  RUN(test_map_unknown_and_publish);
+  RUN(test_concurrent_reload);
+  RUN(test_reader_slots_are_bounded);
+  return checkSummary();
+}
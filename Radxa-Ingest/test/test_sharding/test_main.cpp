@@ -0,0 +1,650 @@
+#include <check.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <netinet/in.h>
+#include <spawn.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "HashRing.h"
+#include "IngestNode.h"
+#include "LivenessTracker.h"
+#include "Mac.h"
+#include "Metrics.h"
+#include "RackMap.h"
+#include "RackTable.h"
+#include "StreamStitcher.h"
+#include "TelemetryRow.h"
+#include "UnknownRegistry.h"
+#include "Wal.h"
+
+extern char** environ;
+
+static constexpr uint32_t LOOPBACK = 0x7F000001;
+
+using Clock = std::chrono::steady_clock;
+
+static void sleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+static uint64_t deviceMac(unsigned i) { return 0x246F28000000ULL | i; }
+
+static std::string macText(uint64_t mac) {
+  char text[18];
+  formatMac(mac, text);
+  return text;
+}
+
+static std::string telemetry(uint64_t mac, int seq) {
+  char text[18];
+  formatMac(mac, text);
+  return std::string("{\"message_type\": \"telemetry\", \"device\": {\"mac\": \"") + text +
+         "\", \"controller\": \"A\"}, \"seq\": " + std::to_string(seq) + "}";
+}
+
+// A full firmware telemetry message: sensors on both buses and, like every
+// controller's, the membership item naming the rack's leader.
+static std::string fullTelemetry(uint64_t mac, char controller, int seq, uint64_t epochMs, char leader) {
+  char text[18];
+  formatMac(mac, text);
+  char buf[1024];
+  std::snprintf(buf, sizeof(buf),
+                "{\n  \"message_type\": \"telemetry\",\n\n  \"device\": {\n    \"mac\": \"%s\",\n"
+                "    \"controller\": \"%c\"\n  },\n\n  \"seq\": %d,\n  \"timestamp_device_ms\": 5000,\n"
+                "  \"timestamp_epoch_ms\": %llu,\n  \"timestamp_uncertainty_ms\": 3,\n\n  \"items\": [\n"
+                "    {\n      \"kind\": \"sensors\",\n      \"buses\": [\n        {\n"
+                "          \"bus\": \"cool\",\n          \"temperatures_c\": [21.23, null, -0.50]\n        },\n"
+                "        {\n          \"bus\": \"exhaust\",\n          \"temperatures_c\": [35.00, 36.10, 37.25]\n"
+                "        }\n      ]\n    },\n    {\n      \"kind\": \"membership\",\n"
+                "      \"leader\": \"%c\",\n      \"term\": 1,\n      \"members\": []\n    }\n  ]\n}\n",
+                text, controller, seq, (unsigned long long)epochMs, leader);
+  return buf;
+}
+
+static sockaddr_in loopback(uint16_t port) {
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(LOOPBACK);
+  a.sin_port = htons(port);
+  return a;
+}
+
+static int clientSocket(int timeoutMs) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  const int buf = 8 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+  const timeval tv = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+// Free loopback ports: bound together so they differ, released for the nodes.
+static std::vector<uint16_t> freePorts(unsigned n) {
+  std::vector<int> fds;
+  std::vector<uint16_t> ports;
+  for (unsigned i = 0; i < n; i++) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in a = loopback(0);
+    bind(fd, (sockaddr*)&a, sizeof(a));
+    socklen_t len = sizeof(a);
+    getsockname(fd, (sockaddr*)&a, &len);
+    fds.push_back(fd);
+    ports.push_back(ntohs(a.sin_port));
+  }
+  for (int fd : fds) close(fd);
+  return ports;
+}
+
+static std::string portList(const std::vector<uint16_t>& ports) {
+  std::string s;
+  for (uint16_t p : ports) s += (s.empty() ? "" : ",") + std::to_string(p);
+  return s;
+}
+
+// ------------------
+// Child: one node, until SIGTERM; then its per-device counts go to dumpPath.
+// ------------------
+
+static std::atomic<bool> gStop{false};
+
+static void onSignal(int) { gStop = true; }
+
+static int runNode(unsigned self, const char* ports, const char* dumpPath) {
+  IngestNode::Options o;
+  o.self = self;
+  for (const char* p = ports; *p;) {
+    o.peers.push_back({LOOPBACK, (uint16_t)strtoul(p, (char**)&p, 10)});
+    if (*p == ',') p++;
+  }
+  IngestNode node;
+  if (!node.open(o)) return 1;
+  std::signal(SIGTERM, onSignal);
+  node.run(gStop);
+
+  FILE* f = std::fopen(dumpPath, "w");
+  if (!f) return 1;
+  for (const auto& kv : node.deviceCounts()) {
+    std::fprintf(f, "%llu %llu\n", (unsigned long long)kv.first, (unsigned long long)kv.second);
+  }
+  std::fclose(f);
+  return 0;
+}
+
+// ------------------
+// Parent side: a group of node processes on loopback.
+// ------------------
+
+struct NodeStats {
+  bool ok;
+  unsigned live;
+  uint64_t received, processed, forwardedOut, forwardedIn, misrouted;
+};
+
+static NodeStats queryStats(int fd, uint16_t port) {
+  NodeStats s = {};
+  const sockaddr_in to = loopback(port);
+  for (int attempt = 0; attempt < 10 && !s.ok; attempt++) {
+    sendto(fd, "RXC1stats", 9, 0, (const sockaddr*)&to, sizeof(to));
+    char line[512];
+    sockaddr_in from = {};
+    socklen_t fromLen = sizeof(from);
+    const ssize_t n = recvfrom(fd, line, sizeof(line) - 1, 0, (sockaddr*)&from, &fromLen);
+    if (n <= 0 || from.sin_port != to.sin_port) continue;  // a late reply to an earlier query
+    line[n] = 0;
+    unsigned long long r, p, fo, fi, m;
+    unsigned node, live;
+    s.ok = std::sscanf(line, "node=%u live=%u received=%llu processed=%llu forwarded_out=%llu forwarded_in=%llu "
+                             "misrouted=%llu", &node, &live, &r, &p, &fo, &fi, &m) == 7;
+    s.live = live;
+    s.received = r;
+    s.processed = p;
+    s.forwardedOut = fo;
+    s.forwardedIn = fi;
+    s.misrouted = m;
+  }
+  return s;
+}
+
+class NodeGroup {
+ public:
+  explicit NodeGroup(unsigned n) : ports(freePorts(n)), _pids(n, -1), _fd(clientSocket(200)) {
+    char dir[] = "/tmp/sharding_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    _dir = dir;
+    const std::string list = portList(ports);
+    for (unsigned i = 0; i < n; i++) {
+      const std::string self = std::to_string(i);
+      const std::string dump = dumpPath(i);
+      char* argv[] = {(char*)"test_sharding", (char*)"--node", (char*)self.c_str(), (char*)list.c_str(),
+                      (char*)dump.c_str(), nullptr};
+      CHECK_EQ(posix_spawn(&_pids[i], "/proc/self/exe", nullptr, nullptr, argv, environ), 0);
+    }
+    for (unsigned i = 0; i < n; i++) CHECK(queryStats(_fd, ports[i]).ok);
+  }
+
+  ~NodeGroup() {
+    for (pid_t pid : _pids) {
+      if (pid > 0) kill(pid, SIGKILL), waitpid(pid, nullptr, 0);
+    }
+    close(_fd);
+    const std::string cmd = "rm -rf '" + _dir + "'";
+    CHECK_EQ(std::system(cmd.c_str()), 0);
+  }
+
+  NodeStats stats(unsigned i) { return queryStats(_fd, ports[i]); }
+
+  void killNode(unsigned i) {
+    kill(_pids[i], SIGKILL);
+    waitpid(_pids[i], nullptr, 0);
+    _pids[i] = -1;
+  }
+
+  uint64_t processed() {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < ports.size(); i++) {
+      if (_pids[i] > 0) total += stats(i).processed;
+    }
+    return total;
+  }
+
+  bool waitProcessed(uint64_t target, int timeoutMs) {
+    const Clock::time_point end = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (Clock::now() < end) {
+      if (processed() >= target) return true;
+      sleepMs(5);
+    }
+    return false;
+  }
+
+  // Stops the live nodes and reads back which node processed each device.
+  std::map<uint64_t, std::map<unsigned, uint64_t>> stopAndCollect() {
+    std::map<uint64_t, std::map<unsigned, uint64_t>> counts;
+    for (unsigned i = 0; i < _pids.size(); i++) {
+      if (_pids[i] <= 0) continue;
+      kill(_pids[i], SIGTERM);
+      int status = 0;
+      waitpid(_pids[i], &status, 0);
+      CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+      _pids[i] = -1;
+      FILE* f = std::fopen(dumpPath(i).c_str(), "r");
+      CHECK(f != nullptr);
+      unsigned long long mac, n;
+      while (f && std::fscanf(f, "%llu %llu", &mac, &n) == 2) counts[mac][i] += n;
+      if (f) std::fclose(f);
+    }
+    return counts;
+  }
+
+  std::vector<uint16_t> ports;
+
+ private:
+  std::vector<pid_t> _pids;
+  int _fd;
+  std::string _dir;
+
+  std::string dumpPath(unsigned i) const { return _dir + "/node" + std::to_string(i) + ".counts"; }
+};
+
+// Sends `rounds` datagrams for each of `devices` devices, device d to
+// ports[targets[d % targets.size()]]. paced adds a short sleep now and then
+// so the receive buffers never overflow.
+static uint64_t sendWave(const std::vector<uint16_t>& ports, const std::vector<unsigned>& targets,
+                         unsigned devices, int rounds, bool paced) {
+  const int fd = clientSocket(0);
+  std::vector<std::string> payloads;
+  for (unsigned d = 0; d < devices; d++) payloads.push_back(telemetry(deviceMac(d), 0));
+  static constexpr size_t BATCH = 64;
+  mmsghdr msgs[BATCH];
+  iovec iov[BATCH];
+  sockaddr_in to[BATCH];
+  uint64_t sent = 0;
+  size_t n = 0;
+  auto flush = [&] {
+    size_t done = 0;
+    while (done < n) {
+      const int k = sendmmsg(fd, msgs + done, (unsigned)(n - done), 0);
+      if (k <= 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      done += (size_t)k;
+    }
+    sent += n;
+    n = 0;
+    if (paced) sleepMs(1);
+  };
+  for (int r = 0; r < rounds; r++) {
+    for (unsigned d = 0; d < devices; d++) {
+      to[n] = loopback(ports[targets[d % targets.size()]]);
+      iov[n] = {(void*)payloads[d].data(), payloads[d].size()};
+      msgs[n].msg_hdr = {};
+      msgs[n].msg_hdr.msg_name = &to[n];
+      msgs[n].msg_hdr.msg_namelen = sizeof(to[n]);
+      msgs[n].msg_hdr.msg_iov = &iov[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+      if (++n == BATCH) flush();
+    }
+  }
+  if (n) flush();
+  close(fd);
+  return sent;
+}
+
+// ------------------
+// Tests
+// ------------------
+
+static void test_ring_balance() {
+  HashRing ring(4);
+  static const unsigned N = 100000;
+  unsigned owned[4] = {};
+  for (unsigned i = 0; i < N; i++) owned[ring.owner(deviceMac(i))]++;
+  for (unsigned n = 0; n < 4; n++) {
+    CHECK(owned[n] > N / 4 * 8 / 10);
+    CHECK(owned[n] < N / 4 * 12 / 10);
+  }
+  std::printf("4 nodes, %u devices: %u %u %u %u\n", N, owned[0], owned[1], owned[2], owned[3]);
+}
+
+static void test_ring_moves_only_dead_node_keys() {
+  HashRing ring(4);
+  static const unsigned N = 20000;
+  std::vector<unsigned> before(N);
+  for (unsigned i = 0; i < N; i++) before[i] = ring.owner(deviceMac(i));
+
+  CHECK(ring.setAlive(2, false));
+  CHECK(!ring.setAlive(2, false));
+  CHECK_EQ(ring.liveNodes(), 3u);
+  unsigned moved = 0;
+  unsigned spread[4] = {};
+  for (unsigned i = 0; i < N; i++) {
+    const unsigned now = ring.owner(deviceMac(i));
+    CHECK(now != 2);
+    if (before[i] != 2) CHECK_EQ(now, before[i]);
+    else moved++, spread[now]++;
+  }
+  // The dead node's devices go to all of the others, not just one.
+  for (unsigned n : {0u, 1u, 3u}) CHECK(spread[n] > moved / 6);
+
+  CHECK(ring.setAlive(2, true));
+  for (unsigned i = 0; i < N; i++) CHECK_EQ(ring.owner(deviceMac(i)), before[i]);
+
+  for (unsigned n = 0; n < 4; n++) ring.setAlive(n, false);
+  CHECK_EQ(ring.owner(deviceMac(1)), HashRing::NONE);
+}
+
+static void test_time_request_answered_locally() {
+  const std::vector<uint16_t> ports = freePorts(2);
+  IngestNode::Options o;
+  o.peers = {{LOOPBACK, ports[0]}, {LOOPBACK, ports[1]}};
+  IngestNode node;
+  CHECK(node.open(o));
+  std::atomic<bool> stop{false};
+  std::thread t([&] { node.run(stop); });
+
+  const int fd = clientSocket(1000);
+  const sockaddr_in to = loopback(ports[0]);
+  const std::string req = "{\"message_type\": \"time_request\", \"device\": {\"mac\": \"24:6F:28:00:00:01\"}, "
+                          "\"t0_ms\": 123456}";
+  sendto(fd, req.data(), req.size(), 0, (const sockaddr*)&to, sizeof(to));
+  char reply[256] = {};
+  CHECK(recv(fd, reply, sizeof(reply) - 1, 0) > 0);
+  close(fd);
+  stop = true;
+  t.join();
+
+  unsigned long long t0 = 0, t1 = 0, t2 = 0;
+  CHECK(std::strstr(reply, "\"time_response\"") != nullptr);
+  const char* p = std::strstr(reply, "\"t0_ms\"");
+  CHECK(p && std::sscanf(p, "\"t0_ms\": %llu, \"t1_ms\": %llu, \"t2_ms\": %llu", &t0, &t1, &t2) == 3);
+  CHECK_EQ(t0, 123456u);
+  CHECK(t1 > 1700000000000ULL && t2 >= t1);
+  // Never forwarded, even though node 1 (not running) may own the MAC.
+  CHECK_EQ(node.stats().timeRequests, 1u);
+  CHECK_EQ(node.stats().forwardedOut, 0u);
+}
+
+// The owner's pipeline, fed through the other node: parse, unknown registry,
+// liveness, stitching, and TelemetryRows in the WAL that carry the device's
+// own address, not the forwarding node's.
+static void test_forwarded_telemetry_reaches_the_owners_pipeline() {
+  char dir[] = "/tmp/sharding_wal_XXXXXX";
+  CHECK(mkdtemp(dir) != nullptr);
+
+  // Two controllers of one rack and an unmapped board, all owned by node 1.
+  const HashRing ring(2);
+  std::vector<uint64_t> macs;
+  for (unsigned i = 0; macs.size() < 3; i++) {
+    if (ring.owner(deviceMac(i)) == 1) macs.push_back(deviceMac(i));
+  }
+  const uint64_t a = macs[0], b = macs[1], unmapped = macs[2];
+  std::unique_ptr<RackTable> table(new RackTable());
+  table->insert(a, "rack-1");
+  table->insert(b, "rack-1");
+  RackMap rackMap;
+  rackMap.publish(std::move(table));
+
+  Metrics metrics;
+  WalWriter::Options wo;
+  wo.dir = dir;
+  WalWriter wal(wo);
+  CHECK(wal.open());
+  StreamStitcher::Options so;
+  so.holdMs = 100;
+  StreamStitcher stitcher(so);
+  LivenessTracker liveness(60000, 100, 0);
+  UnknownRegistry unknown(16);
+
+  const std::vector<uint16_t> ports = freePorts(2);
+  IngestNode::Options o[2];
+  for (IngestNode::Options& x : o) x.peers = {{LOOPBACK, ports[0]}, {LOOPBACK, ports[1]}};
+  o[1].self = 1;
+  o[1].rackMap = &rackMap;
+  o[1].metrics = &metrics;
+  o[1].wal = &wal;
+  o[1].stitcher = &stitcher;
+  o[1].liveness = &liveness;
+  o[1].unknown = &unknown;
+  IngestNode nodes[2];
+  CHECK(nodes[0].open(o[0]) && nodes[1].open(o[1]));
+  std::atomic<bool> stop{false};
+  std::thread t0([&] { nodes[0].run(stop); });
+  std::thread t1([&] { nodes[1].run(stop); });
+
+  const int fd = clientSocket(200);
+  sockaddr_in self = loopback(0);
+  bind(fd, (sockaddr*)&self, sizeof(self));
+  socklen_t selfLen = sizeof(self);
+  getsockname(fd, (sockaddr*)&self, &selfLen);
+  const uint64_t T = 1760000000000ULL;
+  const std::string sent[] = {
+      fullTelemetry(a, 'A', 1, T, 'A'),
+      fullTelemetry(b, 'B', 7, T + 100, 'A'),     // the same point from the standby: dropped
+      fullTelemetry(a, 'A', 1, T, 'A'),           // resent: dropped
+      fullTelemetry(a, 'A', 2, T + 1000, 'A'),
+      fullTelemetry(unmapped, 'A', 1, T, 'A'),
+      "{\"message_type\": \"event\", \"device\": {\"mac\": \"" + macText(a) + "\"}}",
+  };
+  const sockaddr_in to = loopback(ports[0]);
+  for (const std::string& d : sent) {
+    sendto(fd, d.data(), d.size(), 0, (const sockaddr*)&to, sizeof(to));
+    sleepMs(2);
+  }
+  const Clock::time_point end = Clock::now() + std::chrono::seconds(5);
+  while (queryStats(fd, ports[1]).processed < 6 && Clock::now() < end) sleepMs(5);
+  stop = true;
+  t0.join();
+  t1.join();
+  close(fd);
+  wal.close();
+
+  const IngestNode::Stats s = nodes[1].stats();
+  CHECK_EQ(nodes[0].stats().forwardedOut, 6u);
+  CHECK_EQ(s.processed, 6u);
+  CHECK_EQ(s.notTelemetry, 1u);
+  CHECK_EQ(s.duplicates, 1u);
+  CHECK_EQ(s.overlaps, 1u);
+  CHECK_EQ(s.unknownRack, 1u);
+  CHECK_EQ(s.rows, 3u);
+
+  // Every row, in LSN order.
+  std::vector<TelemetryRow> rows;
+  for (uint64_t first : wal::listSegments(dir)) {
+    std::ifstream in(wal::segmentPath(dir, first), std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    BulkStore::Row r;
+    for (size_t at = 0, n; (n = wal::parseRecord((const uint8_t*)bytes.data() + at, bytes.size() - at, r)) > 0;
+         at += n) {
+      TelemetryRow row;
+      CHECK(decodeRow(r.data, r.len, row));
+      rows.push_back(row);
+    }
+  }
+  CHECK_EQ(rows.size(), 3u);
+  std::map<std::pair<uint64_t, uint32_t>, TelemetryRow> byPoint;
+  for (const TelemetryRow& r : rows) {
+    byPoint[{r.mac, r.seq}] = r;
+    CHECK_EQ(r.ip, LOOPBACK);
+    CHECK_EQ(r.port, ntohs(self.sin_port));
+  }
+  const TelemetryRow first = byPoint[std::make_pair(a, 1u)];
+  CHECK_STR(first.rack, "rack-1");
+  CHECK_EQ(first.controller, 'A');
+  CHECK_EQ(first.timeMs, (int64_t)T);
+  CHECK_EQ(first.flags, (uint8_t)TelemetryRow::DESIGNATED);
+  CHECK_EQ(first.temps.cool[0], 2123);
+  CHECK_EQ(first.temps.cool[1], Temperatures::NO_READING);
+  CHECK_EQ(first.temps.cool[2], -50);
+  CHECK_EQ(first.temps.exhaust[2], 3725);
+  CHECK_EQ(byPoint[std::make_pair(a, 2u)].timeMs, (int64_t)(T + 1000));
+  const TelemetryRow stray = byPoint[std::make_pair(unmapped, 1u)];
+  CHECK_STR(stray.rack, RackMap::UNKNOWN);
+  CHECK_EQ(stray.flags, (uint8_t)(TelemetryRow::UNMAPPED | TelemetryRow::UNSTITCHED));
+
+  const UnknownRegistry::Device* d = unknown.find(unmapped);
+  CHECK(d != nullptr);
+  CHECK(d && d->ip == LOOPBACK && d->port == ntohs(self.sin_port));
+  CHECK(unknown.find(a) == nullptr);
+  CHECK_EQ(liveness.devices(), 2u);
+  CHECK_EQ(liveness.devicesUp(), 2u);
+
+  std::string page;
+  metrics.render(page);
+  CHECK(page.find("ingest_parse_failures_total{reason=\"not_telemetry\"} 1\n") != std::string::npos);
+  CHECK(page.find("ingest_stitch_dropped_total{reason=\"duplicate\"} 1\n") != std::string::npos);
+  CHECK(page.find("ingest_stitch_dropped_total{reason=\"overlap\"} 1\n") != std::string::npos);
+  CHECK(page.find("ingest_rows_total 3\n") != std::string::npos);
+  CHECK(page.find("ingest_rack_last_seen_seconds{rack=\"rack-1\"} ") != std::string::npos);
+
+  const std::string cmd = std::string("rm -rf '") + dir + "'";
+  CHECK_EQ(std::system(cmd.c_str()), 0);
+}
+
+static void test_every_device_processed_once_by_its_owner() {
+  static const unsigned K = 3, DEVICES = 600;
+  static const int ROUNDS = 10;
+  NodeGroup g(K);
+  // Devices spread over the collectors regardless of owner, as COLLECTOR_IPS
+  // failover would leave them.
+  const uint64_t sent = sendWave(g.ports, {0, 1, 2}, DEVICES, ROUNDS, true);
+  CHECK(g.waitProcessed(sent, 10000));
+
+  uint64_t received = 0, forwarded = 0, misrouted = 0;
+  for (unsigned i = 0; i < K; i++) {
+    const NodeStats s = g.stats(i);
+    CHECK_EQ(s.live, K);
+    received += s.received;
+    forwarded += s.forwardedOut;
+    misrouted += s.misrouted;
+  }
+  CHECK_EQ(received, sent);
+  CHECK_EQ(misrouted, 0u);
+  // Sending to a random node hits the owner one time in K.
+  CHECK(forwarded > sent * (K - 1) / K * 9 / 10);
+  CHECK(forwarded < sent * (K - 1) / K * 11 / 10);
+
+  const auto counts = g.stopAndCollect();
+  const HashRing ring(K);
+  CHECK_EQ(counts.size(), (size_t)DEVICES);
+  unsigned wrong = 0;
+  for (unsigned d = 0; d < DEVICES; d++) {
+    const auto it = counts.find(deviceMac(d));
+    if (it == counts.end() || it->second.size() != 1 || it->second.begin()->first != ring.owner(deviceMac(d)) ||
+        it->second.begin()->second != (uint64_t)ROUNDS) {
+      wrong++;
+    }
+  }
+  CHECK_EQ(wrong, 0u);
+  std::printf("%u nodes: %llu datagrams, %llu forwarded, every device on its owner\n", K,
+              (unsigned long long)sent, (unsigned long long)forwarded);
+}
+
+static void test_dead_node_devices_rebalance() {
+  static const unsigned K = 3, DEVICES = 600;
+  static const int ROUNDS = 5;
+  NodeGroup g(K);
+  g.killNode(2);
+
+  // Heartbeats stop; both survivors drop node 2 after deadAfterMs.
+  const Clock::time_point killed = Clock::now();
+  bool rebalanced = false;
+  while (!rebalanced && Clock::now() - killed < std::chrono::seconds(5)) {
+    rebalanced = g.stats(0).live == K - 1 && g.stats(1).live == K - 1;
+    if (!rebalanced) sleepMs(10);
+  }
+  CHECK(rebalanced);
+  const double detectMs = std::chrono::duration<double, std::milli>(Clock::now() - killed).count();
+  // The last heartbeat may have left up to one interval before the kill.
+  const IngestNode::Options defaults;
+  CHECK(detectMs >= defaults.deadAfterMs - 2.0 * defaults.heartbeatMs);
+
+  // Devices whose collector died fail over to the others.
+  const uint64_t sent = sendWave(g.ports, {0, 1}, DEVICES, ROUNDS, true);
+  CHECK(g.waitProcessed(sent, 10000));
+
+  const auto counts = g.stopAndCollect();
+  const HashRing full(K);
+  HashRing degraded(K);
+  degraded.setAlive(2, false);
+  unsigned wrong = 0, stayed = 0, moved = 0;
+  for (unsigned d = 0; d < DEVICES; d++) {
+    const uint64_t mac = deviceMac(d);
+    const auto it = counts.find(mac);
+    if (it == counts.end() || it->second.size() != 1 || it->second.begin()->first != degraded.owner(mac) ||
+        it->second.begin()->second != (uint64_t)ROUNDS) {
+      wrong++;
+      continue;
+    }
+    if (full.owner(mac) == 2) moved++;
+    else if (it->second.begin()->first == full.owner(mac)) stayed++;
+  }
+  CHECK_EQ(wrong, 0u);
+  CHECK_EQ(stayed + moved, DEVICES);
+  CHECK(moved > 0);
+  std::printf("node 2 dropped after %.0f ms; %u devices moved, %u kept their owner\n", detectMs, moved, stayed);
+}
+
+// Throughput from 1 to 4 nodes. The datagrams go round robin over the nodes,
+// so with K nodes (K-1)/K of them take a forwarding hop. The numbers only
+// mean something on a box with a core per node; only correctness is checked.
+static void test_scaling_1_to_4_nodes() {
+  static const unsigned DEVICES = 2000;
+  static const int ROUNDS = 25;
+  const unsigned cpus = std::thread::hardware_concurrency();
+  std::printf("nodes,sent,processed,seconds,processed_per_s (%u cpus)\n", cpus);
+  for (unsigned k = 1; k <= 4; k++) {
+    NodeGroup g(k);
+    std::vector<unsigned> targets;
+    for (unsigned i = 0; i < k; i++) targets.push_back(i);
+    const Clock::time_point start = Clock::now();
+    const uint64_t sent = sendWave(g.ports, targets, DEVICES, ROUNDS, false);
+    // Unpaced: the kernel may drop some; wait until the count stops moving.
+    uint64_t processed = 0, last = ~0ULL;
+    Clock::time_point lastChange = Clock::now(), done = lastChange;
+    while (processed < sent && Clock::now() - lastChange < std::chrono::milliseconds(300)) {
+      processed = g.processed();
+      if (processed != last) last = processed, lastChange = done = Clock::now();
+      sleepMs(2);
+    }
+    const double seconds = std::chrono::duration<double>(done - start).count();
+    std::printf("%u,%llu,%llu,%.3f,%.0f\n", k, (unsigned long long)sent, (unsigned long long)processed, seconds,
+                seconds > 0 ? processed / seconds : 0.0);
+    CHECK(processed > 0);
+    CHECK(processed <= sent);
+
+    // Whatever got through was processed by its owner alone.
+    const auto counts = g.stopAndCollect();
+    const HashRing ring(k);
+    unsigned wrong = 0;
+    for (const auto& kv : counts) {
+      if (kv.second.size() != 1 || kv.second.begin()->first != ring.owner(kv.first)) wrong++;
+    }
+    CHECK_EQ(wrong, 0u);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc == 5 && std::string(argv[1]) == "--node") return runNode((unsigned)atoi(argv[2]), argv[3], argv[4]);
+
+  RUN(test_ring_balance);
+  RUN(test_ring_moves_only_dead_node_keys);
+  RUN(test_time_request_answered_locally);
+  RUN(test_forwarded_telemetry_reaches_the_owners_pipeline);
+  RUN(test_every_device_processed_once_by_its_owner);
+  RUN(test_dead_node_devices_rebalance);
+  RUN(test_scaling_1_to_4_nodes);
+  return checkSummary();
+}
@@ -0,0 +1,229 @@
+#include <check.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mac.h"
+#include "StreamStitcher.h"
+#include "TelemetryFields.h"
+
+static const int64_t T0 = 1760000000000LL;  // epoch ms
+static const uint64_t MAC_A = 0x246F28AA0001ULL;
+static const uint64_t MAC_B = 0x246F28BB0002ULL;
+
+// The firmware's layout (buildTelemetryJson plus a membership item).
+static std::string telemetry(const char* mac, char controller, uint32_t seq, const char* epoch, char leader,
+                             unsigned term) {
+  char buf[1024];
+  std::snprintf(buf, sizeof(buf),
+                "{\n  \"message_type\": \"telemetry\",\n\n  \"device\": {\n    \"mac\": \"%s\",\n"
+                "    \"controller\": \"%c\"\n  },\n\n  \"seq\": %u,\n  \"timestamp_device_ms\": 81234,\n"
+                "  \"timestamp_epoch_ms\": %s,\n  \"timestamp_uncertainty_ms\": null,\n\n  \"items\": [\n"
+                "    {\n      \"kind\": \"heartbeat\",\n      \"controller_a_alive\": true,\n"
+                "      \"controller_b_alive\": false\n    },\n    {\n      \"kind\": \"sensors\",\n"
+                "      \"buses\": []\n    },\n    {\n      \"kind\": \"membership\",\n      \"leader\": \"%c\",\n"
+                "      \"term\": %u,\n      \"members\": [\n        {\"id\": \"B\", \"alive\": true, "
+                "\"age_ms\": 0, \"leader\": \"Z\", \"term\": 99}\n      ]\n    }\n  ]\n}\n",
+                mac, controller, seq, epoch, leader, term);
+  return buf;
+}
+
+static StreamStitcher::Sample sample(uint64_t mac, char controller, uint32_t seq, int64_t t, char leader = 0,
+                                     uint32_t term = 0) {
+  return StreamStitcher::Sample{mac, controller, seq, t, leader, term, 0, 0};
+}
+
+struct Out {
+  std::string rack;
+  StreamStitcher::Sample s;
+  bool designated, replaced, late;
+  std::string data;
+};
+
+static size_t drain(StreamStitcher& st, int64_t nowMs, std::vector<Out>& out) {
+  return st.drain(nowMs, [&out](const StreamStitcher::Point& p) {
+    out.push_back(Out{p.rack, p.sample, p.designated, p.replaced, p.late, std::string((const char*)p.data, p.len)});
+  });
+}
+
+static StreamStitcher::Verdict add(StreamStitcher& st, const char* rack, const StreamStitcher::Sample& s,
+                                   int64_t nowMs) {
+  const std::string payload = "seq " + std::to_string(s.seq);
+  return st.add(rack, s, payload.data(), payload.size(), nowMs);
+}
+
+static StreamStitcher::Options options(uint32_t windowMs, uint32_t holdMs, uint32_t maxPending = 64) {
+  StreamStitcher::Options o;
+  o.windowMs = windowMs;
+  o.holdMs = holdMs;
+  o.maxPending = maxPending;
+  return o;
+}
+
+static void test_parse_fields() {
+  const std::string json = telemetry("24:6F:28:AA:00:01", 'B', 4242, "1760000001234", 'A', 7);
+  TelemetryFields f;
+  CHECK(parseTelemetryFields(json.data(), json.size(), f));
+  CHECK_EQ(f.mac, MAC_A);
+  CHECK_EQ(f.controller, 'B');
+  CHECK(f.hasSeq);
+  CHECK_EQ(f.seq, 4242u);
+  CHECK_EQ(f.deviceMs, 81234);
+  CHECK_EQ(f.epochMs, 1760000001234LL);
+  CHECK_EQ(f.leader, 'A');  // the membership item's, not a member's
+  CHECK_EQ(f.term, 7u);
+  CHECK(f.sensors);
+
+  // Unsynced clock, no membership, items-only.
+  const std::string bare = "{\"message_type\": \"telemetry\", \"device\": {\"mac\": \"24:6F:28:AA:00:01\", "
+                           "\"controller\": \"A\"}, \"seq\": 3, \"timestamp_epoch_ms\": null, "
+                           "\"items\": [{\"kind\": \"profile\"}]}";
+  CHECK(parseTelemetryFields(bare.data(), bare.size(), f));
+  CHECK_EQ(f.epochMs, 0);
+  CHECK_EQ(f.leader, 0);
+  CHECK(!f.sensors);
+
+  const std::string req = "{\"message_type\": \"time_request\", \"device\": {\"mac\": \"24:6F:28:AA:00:01\"}}";
+  CHECK(!parseTelemetryFields(req.data(), req.size(), f));
+  const std::string noMac = "{\"message_type\": \"telemetry\", \"seq\": 1}";
+  CHECK(!parseTelemetryFields(noMac.data(), noMac.size(), f));
+}
+
+// A retry-queue resend or a replayed capture: the same datagram twice, both
+// while the first copy is buffered and after it has been released.
+static void test_duplicate_datagrams_dropped() {
+  StreamStitcher st(options(500, 1000));
+  std::vector<Out> out;
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 10, T0), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 10, T0), T0 + 50) == StreamStitcher::Verdict::DUPLICATE);
+  CHECK_EQ(drain(st, T0 + 1000, out), 1u);
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 10, T0), T0 + 1500) == StreamStitcher::Verdict::DUPLICATE);
+
+  // After a reboot seq restarts: same seq, new time, not a duplicate.
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 10, T0 + 60000), T0 + 60000) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK_EQ(drain(st, T0 + 61000, out), 1u);
+  CHECK_EQ(out.size(), 2u);
+  CHECK_EQ(st.stats().duplicates, 2u);
+  CHECK(out[0].data == "seq 10");
+}
+
+// Both controllers report the rack around a failover. The designated sender
+// (membership leader) wins whichever order the samples arrive in.
+static void test_overlap_prefers_designated_sender() {
+  StreamStitcher st(options(500, 1000));
+  std::vector<Out> out;
+
+  // B's sample first, then A's for the same moment: A is the leader.
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 500, T0 + 20, 'A', 3), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 90, T0, 'A', 3), T0 + 5) == StreamStitcher::Verdict::REPLACED);
+  // The other way round.
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 91, T0 + 1000, 'A', 3), T0 + 1000) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 501, T0 + 1100, 'A', 3), T0 + 1001) == StreamStitcher::Verdict::OVERLAP);
+  CHECK_EQ(st.designated("r1"), 'A');
+
+  // B takes over in term 4: now B is preferred.
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 502, T0 + 2000, 'B', 4), T0 + 2000) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 92, T0 + 2010, 'A', 3), T0 + 2001) == StreamStitcher::Verdict::OVERLAP);
+  CHECK_EQ(st.designated("r1"), 'B');
+
+  CHECK_EQ(st.flush([&out](const StreamStitcher::Point& p) {
+    out.push_back(Out{p.rack, p.sample, p.designated, p.replaced, p.late, ""});
+  }), 3u);
+  CHECK_EQ(out.size(), 3u);
+  CHECK_EQ(out[0].s.controller, 'A');
+  CHECK(out[0].replaced);
+  CHECK_EQ(out[1].s.controller, 'A');
+  CHECK(!out[1].replaced);
+  CHECK_EQ(out[2].s.controller, 'B');
+  CHECK_EQ(out[2].s.mac, MAC_B);
+  // Source tags are resolved at release, against the current leader.
+  CHECK(out[2].designated);
+  CHECK(!out[0].designated);
+  CHECK_EQ(st.stats().overlaps, 2u);
+  CHECK_EQ(st.stats().replaced, 1u);
+}
+
+// Without a membership item nobody is designated and the first sample stays.
+static void test_overlap_without_leader_keeps_first() {
+  StreamStitcher st(options(500, 1000));
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 1, T0), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 1, T0 + 100), T0) == StreamStitcher::Verdict::OVERLAP);
+  // Another rack at the same moment is not an overlap.
+  CHECK(add(st, "r2", sample(MAC_A, 'A', 1, T0 + 100), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK_EQ(st.racks(), 2u);
+}
+
+// Arrival order 3, 1, 2 within the hold time leaves in time order; a sample
+// older than what was already released still comes out, marked late.
+static void test_out_of_order_arrival_is_reordered() {
+  StreamStitcher st(options(500, 2000));
+  std::vector<Out> out;
+  add(st, "r1", sample(MAC_A, 'A', 3, T0 + 3000, 'A', 1), T0 + 3010);
+  add(st, "r1", sample(MAC_B, 'B', 1, T0 + 1000), T0 + 3020);
+  add(st, "r1", sample(MAC_A, 'A', 2, T0 + 2000, 'A', 1), T0 + 3030);
+  CHECK_EQ(drain(st, T0 + 5000, out), 0u);  // nothing has waited 2 s yet
+  CHECK_EQ(drain(st, T0 + 5030, out), 3u);
+  CHECK_EQ(out.size(), 3u);
+  for (size_t i = 0; i < out.size(); i++) {
+    CHECK_EQ(out[i].s.timeMs, T0 + 1000 * (int64_t)(i + 1));
+    CHECK(!out[i].late);
+  }
+  CHECK_EQ(out[0].s.controller, 'B');
+  CHECK(!out[0].designated);
+  CHECK(out[1].designated);
+
+  add(st, "r1", sample(MAC_A, 'A', 0, T0 + 500, 'A', 1), T0 + 5100);
+  CHECK_EQ(drain(st, T0 + 7100, out), 1u);
+  CHECK(out.back().late);
+  CHECK_EQ(st.stats().late, 1u);
+  CHECK_EQ(st.pending(), 0u);
+}
+
+// Only samples closer than the window are one point; at the window and
+// beyond both are kept, buffered or already released.
+static void test_window_expiry() {
+  StreamStitcher st(options(300, 1000));
+  std::vector<Out> out;
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 1, T0), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 1, T0 + 299), T0) == StreamStitcher::Verdict::OVERLAP);
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 2, T0 + 300), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK(add(st, "r1", sample(MAC_B, 'B', 3, T0 - 300), T0) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK_EQ(drain(st, T0 + 1000, out), 3u);
+
+  // Released points still block overlaps within the window...
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 2, T0 + 310), T0 + 1100) == StreamStitcher::Verdict::OVERLAP);
+  // ...and nothing outside it.
+  CHECK(add(st, "r1", sample(MAC_A, 'A', 3, T0 + 600), T0 + 1100) == StreamStitcher::Verdict::ACCEPTED);
+  CHECK_EQ(drain(st, T0 + 2100, out), 1u);
+  CHECK_EQ(out.size(), 4u);
+}
+
+// A rack's buffer never holds more than maxPending; the oldest leaves early.
+static void test_buffer_is_bounded() {
+  StreamStitcher st(options(10, 60000, 4));
+  std::vector<Out> out;
+  for (uint32_t i = 0; i < 10; i++) {
+    CHECK(add(st, "r1", sample(MAC_A, 'A', i, T0 + 1000 * (int64_t)i), T0 + i) == StreamStitcher::Verdict::ACCEPTED);
+    CHECK(st.pending() <= 4u + st.stats().forced);
+  }
+  CHECK_EQ(st.stats().forced, 6u);
+  CHECK_EQ(drain(st, T0 + 100, out), 6u);  // only the forced ones
+  CHECK_EQ(st.pending(), 4u);
+  CHECK_EQ(st.flush([&out](const StreamStitcher::Point& p) {
+    out.push_back(Out{p.rack, p.sample, p.designated, p.replaced, p.late, ""});
+  }), 4u);
+  for (uint32_t i = 0; i < 10; i++) CHECK_EQ(out[i].s.seq, i);
+  CHECK_EQ(st.stats().late, 0u);
+}
+
+int main() {
+  RUN(test_parse_fields);
+  RUN(test_duplicate_datagrams_dropped);
+  RUN(test_overlap_prefers_designated_sender);
+  RUN(test_overlap_without_leader_keeps_first);
+  RUN(test_out_of_order_arrival_is_reordered);
+  RUN(test_window_expiry);
+  RUN(test_buffer_is_bounded);
+  return checkSummary();
+}
@@ -0,0 +1,214 @@
+#include <check.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <unistd.h>
+
+#include "UnknownRegistry.h"
+#include "UnknownStore.h"
+#include "UnknownSummary.h"
+
+// Counts heap allocations so the tests can prove record() never makes one.
+static size_t gAllocs = 0;
+void* operator new(size_t n) {
+  gAllocs++;
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static const int64_t T0 = 1760000000;  // an hour boundary
+static const uint32_t IP = 0x0A000102;  // 10.0.1.2
+
+// Store that keeps rows in memory, for counting what a flush writes.
+class MemoryStore : public UnknownStore {
+ public:
+  size_t rows = 0;
+  size_t batches = 0;
+  int64_t last = 0;
+  bool upsert(const Row*, size_t n) override {
+    rows += n;
+    batches++;
+    return true;
+  }
+  int64_t lastSummaryS() override { return last; }
+  bool setLastSummaryS(int64_t s) override {
+    last = s;
+    return true;
+  }
+};
+
+static std::string makeTempDir() {
+  char dir[] = "/tmp/unknown_XXXXXX";
+  CHECK(mkdtemp(dir) != nullptr);
+  return dir;
+}
+
+static void removeStore(const FileUnknownStore& s, const std::string& dir) {
+  std::remove(s.rowsPath().c_str());
+  std::remove(s.statePath().c_str());
+  rmdir(dir.c_str());
+}
+
+static void test_records_and_counts() {
+  UnknownRegistry reg(16);
+  reg.record(0x246F28000001ULL, T0, IP, 5005, "eth0");
+  reg.record(0x246F28000001ULL, T0 + 5, IP + 1, 5006, "wlan0");
+  reg.record(0x246F28000002ULL, T0 + 6, IP, 5005, "eth0");
+
+  CHECK_EQ(reg.size(), 2u);
+  const UnknownRegistry::Device* d = reg.find(0x246F28000001ULL);
+  CHECK(d != nullptr);
+  CHECK_EQ(d->firstSeenS, T0);
+  CHECK_EQ(d->lastSeenS, T0 + 5);
+  CHECK_EQ(d->ip, IP + 1);
+  CHECK_EQ(d->port, 5006);
+  CHECK_STR(reg.interfaceName(d->iface), "wlan0");
+  CHECK_EQ(reg.count24h(*d, T0 + 5), 2u);
+  CHECK(reg.find(0x246F28000003ULL) == nullptr);
+}
+
+static void test_count_ages_out_after_24h() {
+  UnknownRegistry reg(4);
+  const uint64_t mac = 0x246F28000001ULL;
+  // 10 messages in hour 0, 5 in hour 12.
+  for (int i = 0; i < 10; i++) reg.record(mac, T0 + i, IP, 5005, "eth0");
+  for (int i = 0; i < 5; i++) reg.record(mac, T0 + 12 * 3600 + i, IP, 5005, "eth0");
+  const UnknownRegistry::Device* d = reg.find(mac);
+
+  CHECK_EQ(reg.count24h(*d, T0 + 23 * 3600), 15u);
+  // Hour 0 leaves the window, hour 12 is still in it.
+  CHECK_EQ(reg.count24h(*d, T0 + 24 * 3600), 5u);
+  CHECK_EQ(reg.count24h(*d, T0 + 36 * 3600), 0u);
+
+  // A message after a gap longer than the ring clears every old bucket.
+  reg.record(mac, T0 + 100 * 3600, IP, 5005, "eth0");
+  CHECK_EQ(reg.count24h(*d, T0 + 100 * 3600), 1u);
+  CHECK_EQ(d->firstSeenS, T0);
+}
+
+// A real unregistered board reporting every 5 s must survive a flood of
+// spoofed one-off MACs many times the registry's size, and the flood must
+// neither grow memory nor allocate.
+static void test_flood_keeps_steady_devices() {
+  static const size_t CAPACITY = 1000;
+  static const int STEADY = 20;
+  static const int FLOOD = 200000;
+  UnknownRegistry reg(CAPACITY);
+
+  int64_t now = T0;
+  for (int k = 0; k < 12; k++, now += 5) {
+    for (int s = 0; s < STEADY; s++) reg.record(0x246F28000000ULL + s, now, IP, 5005, "eth0");
+  }
+
+  uint64_t x = 88172645463325252ULL;
+  const size_t allocsBefore = gAllocs;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLOOD; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    reg.record((x & 0xFEFFFFFFFFFFULL) | 0x020000000000ULL, now, IP, 5005, "eth0");
+    // The steady boards keep reporting through the flood.
+    if (i % 2000 == 0) {
+      now += 5;
+      for (int s = 0; s < STEADY; s++) reg.record(0x246F28000000ULL + s, now, IP, 5005, "eth0");
+    }
+  }
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const size_t allocs = gAllocs - allocsBefore;
+
+  CHECK_EQ(allocs, 0u);
+  CHECK(reg.size() <= reg.capacity());
+  CHECK_EQ(reg.capacity(), CAPACITY);
+  CHECK(reg.evictions() >= (uint64_t)(FLOOD - CAPACITY));
+  int kept = 0;
+  for (int s = 0; s < STEADY; s++) kept += reg.find(0x246F28000000ULL + s) != nullptr;
+  CHECK_EQ(kept, STEADY);
+  std::printf("flood: %d random MACs into %zu slots, %.1f M records/s, %llu evictions, %d/%d steady kept\n",
+              FLOOD, CAPACITY, FLOOD / secs / 1e6, (unsigned long long)reg.evictions(), kept, STEADY);
+}
+
+static void test_flush_writes_changed_rows_only() {
+  UnknownRegistry reg(16);
+  MemoryStore store;
+  reg.record(0x246F28000001ULL, T0, IP, 5005, "eth0");
+  reg.record(0x246F28000002ULL, T0, IP, 5005, "eth0");
+
+  CHECK_EQ(reg.flush(store, T0 + 1), 2u);
+  CHECK_EQ(reg.flush(store, T0 + 2), 0u);
+  CHECK_EQ(store.batches, 1u);
+
+  reg.record(0x246F28000002ULL, T0 + 10, IP, 5005, "eth0");
+  CHECK_EQ(reg.flush(store, T0 + 11), 1u);
+
+  // Nothing new, but the 24 h counts drop to zero: both rows change.
+  CHECK_EQ(reg.flush(store, T0 + 25 * 3600), 2u);
+  CHECK_EQ(reg.flush(store, T0 + 26 * 3600), 0u);
+}
+
+static void test_file_store_appends_rows() {
+  const std::string dir = makeTempDir();
+  FileUnknownStore store(dir);
+  UnknownRegistry reg(4);
+  reg.record(0x246F28AABBCCULL, T0, IP, 5005, "eth0");
+  CHECK_EQ(reg.flush(store, T0), 1u);
+  reg.record(0x246F28AABBCCULL, T0 + 5, IP, 5005, "eth0");
+  CHECK_EQ(reg.flush(store, T0 + 5), 1u);
+
+  std::ifstream in(store.rowsPath());
+  std::string first, second, extra;
+  std::getline(in, first);
+  std::getline(in, second);
+  CHECK(!std::getline(in, extra));
+  CHECK_STR(first.c_str(), "24:6F:28:AA:BB:CC,1760000000,1760000000,1,10.0.1.2,5005,eth0");
+  CHECK_STR(second.c_str(), "24:6F:28:AA:BB:CC,1760000000,1760000005,2,10.0.1.2,5005,eth0");
+  removeStore(store, dir);
+}
+
+// The once-per-24 h limit comes from the store, so a restarted ingest (a new
+// registry and a reopened store) cannot send another summary early.
+static void test_summary_limit_survives_restart() {
+  const std::string dir = makeTempDir();
+  std::string text;
+  {
+    FileUnknownStore store(dir);
+    UnknownRegistry reg(16);
+    CHECK(!UnknownSummary::generate(reg, store, T0, text));  // nothing seen yet
+    CHECK_EQ(store.lastSummaryS(), 0);
+
+    for (int i = 0; i < 3; i++) reg.record(0x246F28000001ULL, T0 + i, IP, 5005, "eth0");
+    reg.record(0x246F28000002ULL, T0, IP, 5005, "eth0");
+    CHECK(UnknownSummary::generate(reg, store, T0 + 10, text));
+    CHECK(text.find("2 unknown devices, 4 messages") != std::string::npos);
+    CHECK(text.find("24:6F:28:00:00:01  3 msgs") < text.find("24:6F:28:00:00:02  1 msgs"));
+    CHECK(!UnknownSummary::generate(reg, store, T0 + 20, text));
+  }
+  {
+    FileUnknownStore store(dir);
+    UnknownRegistry reg(16);
+    reg.record(0x246F28000003ULL, T0 + 3600, IP, 5005, "eth0");
+    CHECK_EQ(store.lastSummaryS(), T0 + 10);
+    CHECK(!UnknownSummary::generate(reg, store, T0 + 10 + UnknownSummary::PERIOD_S - 1, text));
+
+    reg.record(0x246F28000003ULL, T0 + 20 * 3600, IP, 5005, "eth0");
+    CHECK(UnknownSummary::generate(reg, store, T0 + 10 + UnknownSummary::PERIOD_S, text));
+    CHECK(text.find("1 unknown devices, 2 messages") != std::string::npos);
+    removeStore(store, dir);
+  }
+}
+
+int main() {
+  RUN(test_records_and_counts);
+  RUN(test_count_ages_out_after_24h);
+  RUN(test_flood_keeps_steady_devices);
+  RUN(test_flush_writes_changed_rows_only);
+  RUN(test_file_store_appends_rows);
+  RUN(test_summary_limit_survives_restart);
+  return checkSummary();
+}
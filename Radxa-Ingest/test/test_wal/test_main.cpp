@@ -0,0 +1,460 @@
+#include <check.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <spawn.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "MpscQueue.h"
+#include "Wal.h"
+
+extern char** environ;
+
+static std::string makeTempDir() {
+  char dir[] = "/tmp/wal_XXXXXX";
+  CHECK(mkdtemp(dir) != nullptr);
+  return dir;
+}
+
+static void removeDir(const std::string& dir) {
+  const std::string cmd = "rm -rf '" + dir + "'";
+  CHECK_EQ(std::system(cmd.c_str()), 0);
+}
+
+static void sleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+static bool waitFor(const std::atomic<uint64_t>* value, uint64_t target, int timeoutMs) {
+  for (int t = 0; t < timeoutMs; t += 5) {
+    if (value->load() >= target) return true;
+    sleepMs(5);
+  }
+  return false;
+}
+
+// Keeps committed rows in memory and, like the real table's unique lsn
+// column, ignores rows it already has.
+class MemoryStore : public BulkStore {
+ public:
+  std::vector<std::pair<uint64_t, std::string>> rows;
+  uint64_t maxLsn = 0;
+  size_t batches = 0;
+  bool fail = false;
+
+  bool copy(const Row* r, size_t n) override {
+    if (fail) return false;
+    batches++;
+    for (size_t i = 0; i < n; i++) {
+      if (r[i].lsn <= maxLsn) continue;
+      rows.emplace_back(r[i].lsn, std::string((const char*)r[i].data, r[i].len));
+      maxLsn = r[i].lsn;
+    }
+    return true;
+  }
+};
+
+static void loadAll(const std::string& dir, MemoryStore& store, uint64_t maxLsn) {
+  WalLoader loader(dir, store, 1000);
+  CHECK(loader.open());
+  while (loader.loadOnce(maxLsn) > 0) {}
+}
+
+static bool contiguous(const MemoryStore& store, uint64_t count) {
+  if (store.rows.size() != count) return false;
+  for (size_t i = 0; i < store.rows.size(); i++) {
+    if (store.rows[i].first != i + 1) return false;
+  }
+  return true;
+}
+
+static void test_queue_many_producers() {
+  struct Item {
+    uint32_t producer;
+    uint32_t seq;
+  };
+  static const uint32_t PRODUCERS = 4, PER = 50000;
+  MpscQueue<Item> q(1024);
+  CHECK_EQ(q.capacity(), 1024u);
+
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&q, p] {
+      for (uint32_t i = 0; i < PER; i++) {
+        while (!q.push(Item{p, i})) std::this_thread::yield();
+      }
+    });
+  }
+
+  std::vector<uint32_t> next(PRODUCERS, 0);
+  uint32_t received = 0, outOfOrder = 0;
+  Item item;
+  while (received < PRODUCERS * PER) {
+    if (!q.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.seq != next[item.producer]) outOfOrder++;
+    next[item.producer] = item.seq + 1;
+    received++;
+  }
+  for (std::thread& t : producers) t.join();
+  CHECK_EQ(outOfOrder, 0u);
+  CHECK(!q.pop(item));
+
+  // Full: push fails instead of blocking.
+  MpscQueue<Item> small(4);
+  for (uint32_t i = 0; i < 4; i++) CHECK(small.push(Item{0, i}));
+  CHECK(!small.push(Item{0, 4}));
+  CHECK(small.pop(item));
+  CHECK(small.push(Item{0, 4}));
+}
+
+// Many appending threads, few fsyncs, and every record comes back once.
+static void test_group_commit_round_trip() {
+  const std::string dir = makeTempDir();
+  static const int PRODUCERS = 4, PER = 5000;
+  WalWriter::Options o;
+  o.dir = dir;
+  o.maxDelayUs = 1000;
+  {
+    WalWriter w(o);
+    CHECK(w.open());
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+      producers.emplace_back([&w, p] {
+        for (int i = 0; i < PER; i++) {
+          const std::string rec = "p" + std::to_string(p) + "-" + std::to_string(i);
+          while (!w.append(rec.data(), rec.size())) std::this_thread::yield();
+        }
+      });
+    }
+    for (std::thread& t : producers) t.join();
+    w.close();
+
+    const WalWriter::Stats s = w.stats();
+    CHECK_EQ(s.records, (uint64_t)PRODUCERS * PER);
+    CHECK_EQ(w.durableLsn(), (uint64_t)PRODUCERS * PER);
+    CHECK(s.batches > 0 && s.batches < s.records / 10);
+    std::printf("group commit: %llu records in %llu fsyncs\n", (unsigned long long)s.records,
+                (unsigned long long)s.batches);
+
+    // Oversized records are refused, not truncated.
+    char big[WalWriter::MAX_RECORD + 1] = {};
+    CHECK(!w.append(big, sizeof(big)));
+  }
+
+  MemoryStore store;
+  loadAll(dir, store, ~0ULL);
+  CHECK(contiguous(store, PRODUCERS * PER));
+  std::vector<int> next(PRODUCERS, 0);
+  int bad = 0;
+  for (const auto& r : store.rows) {
+    int p = 0, i = 0;
+    if (std::sscanf(r.second.c_str(), "p%d-%d", &p, &i) != 2 || p >= PRODUCERS || i != next[p]) bad++;
+    else next[p]++;
+  }
+  CHECK_EQ(bad, 0);
+  removeDir(dir);
+}
+
+// A crash mid-write leaves part of a record at the end of the newest
+// segment; reopening cuts it off and numbering carries on.
+static void test_torn_tail_is_cut() {
+  const std::string dir = makeTempDir();
+  WalWriter::Options o;
+  o.dir = dir;
+  {
+    WalWriter w(o);
+    CHECK(w.open());
+    for (int i = 0; i < 100; i++) CHECK(w.append("record", 6));
+  }
+
+  const std::vector<uint64_t> segments = wal::listSegments(dir);
+  CHECK_EQ(segments.size(), 1u);
+  FILE* f = std::fopen(wal::segmentPath(dir, segments[0]).c_str(), "ab");
+  const uint8_t torn[] = {6, 0, 0, 0, 0xAA, 0xBB, 0xCC, 0xDD, 101, 0, 0};
+  std::fwrite(torn, 1, sizeof(torn), f);
+  std::fclose(f);
+
+  {
+    WalWriter w(o);
+    CHECK(w.open());
+    CHECK_EQ(w.durableLsn(), 100u);
+    CHECK(w.append("after", 5));
+    w.close();
+    CHECK_EQ(w.durableLsn(), 101u);
+  }
+
+  MemoryStore store;
+  loadAll(dir, store, ~0ULL);
+  CHECK(contiguous(store, 101));
+  CHECK(store.rows.back().second == "after");
+  removeDir(dir);
+}
+
+// Small segments, a loader restarted halfway, and a store outage: the store
+// still ends up with every record exactly once, and loaded segments go away.
+static void test_checkpoint_survives_loader_restart() {
+  const std::string dir = makeTempDir();
+  static const int N = 2000;
+  WalWriter::Options o;
+  o.dir = dir;
+  o.segmentBytes = 4096;
+  o.maxBatchBytes = 1024;
+  {
+    WalWriter w(o);
+    CHECK(w.open());
+    for (int i = 0; i < N; i++) {
+      const std::string rec = std::to_string(i + 1);
+      while (!w.append(rec.data(), rec.size())) std::this_thread::yield();
+    }
+    w.close();
+    CHECK(w.stats().segments > 5);
+  }
+
+  MemoryStore store;
+  {
+    WalLoader loader(dir, store, 150);
+    CHECK(loader.open());
+    // Batches stop at segment ends, so some are short.
+    long n;
+    while (loader.checkpointLsn() < 450 && (n = loader.loadOnce(~0ULL)) > 0) CHECK(n <= 150);
+    const uint64_t before = loader.checkpointLsn();
+    store.fail = true;
+    CHECK_EQ(loader.loadOnce(~0ULL), -1);
+    CHECK_EQ(loader.checkpointLsn(), before);
+    store.fail = false;
+    // Only up to what the writer has made durable.
+    while (loader.loadOnce(500) > 0) {}
+    CHECK_EQ(loader.checkpointLsn(), 500u);
+  }
+  {
+    WalLoader loader(dir, store, 150);
+    CHECK(loader.open());
+    CHECK_EQ(loader.checkpointLsn(), 500u);
+    while (loader.loadOnce(~0ULL) > 0) {}
+    CHECK_EQ(loader.checkpointLsn(), (uint64_t)N);
+    CHECK(loader.removeLoaded() > 0);
+    CHECK_EQ(wal::listSegments(dir).size(), 1u);
+  }
+  CHECK(contiguous(store, N));
+  int bad = 0;
+  for (const auto& r : store.rows) bad += r.second != std::to_string(r.first);
+  CHECK_EQ(bad, 0);
+  removeDir(dir);
+}
+
+// ------------------
+// Database stand-in: a separate process the test can kill
+// ------------------
+//
+// Speaks a tiny COPY-like protocol over a Unix socket:
+//   COPY <n>\n  <lsn> <payload>\n ... \.\n   ->   COMMIT <lsn>\n
+// A batch is appended to the data file and fsync'd only once complete, and
+// rows it already has are skipped, as a transaction with ON CONFLICT would.
+
+static uint64_t lastLsnIn(const char* dataPath) {
+  FILE* f = std::fopen(dataPath, "r");
+  if (!f) return 0;
+  unsigned long long lsn = 0, last = 0;
+  char payload[300];
+  while (std::fscanf(f, "%llu %299s", &lsn, payload) == 2) last = lsn;
+  std::fclose(f);
+  return last;
+}
+
+static int runDbStandIn(const char* sockPath, const char* dataPath) {
+  uint64_t committed = lastLsnIn(dataPath);
+  const int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sockPath);
+  unlink(sockPath);
+  if (bind(ls, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(ls, 4) != 0) return 1;
+
+  for (;;) {
+    const int c = accept(ls, nullptr, nullptr);
+    if (c < 0) continue;
+    FILE* in = fdopen(c, "r");
+    unsigned long n;
+    while (std::fscanf(in, " COPY %lu", &n) == 1) {
+      std::vector<std::pair<unsigned long long, std::string>> batch;
+      unsigned long long lsn;
+      char payload[300];
+      for (unsigned long i = 0; i < n && std::fscanf(in, "%llu %299s", &lsn, payload) == 2; i++) {
+        batch.emplace_back(lsn, payload);
+      }
+      char end[4] = {};
+      if (batch.size() != n || std::fscanf(in, "%3s", end) != 1 || std::string(end) != "\\.") break;
+
+      FILE* out = std::fopen(dataPath, "a");
+      for (const auto& r : batch) {
+        if (r.first <= committed) continue;
+        std::fprintf(out, "%llu %s\n", r.first, r.second.c_str());
+        committed = r.first;
+      }
+      std::fflush(out);
+      fsync(fileno(out));
+      std::fclose(out);
+      dprintf(c, "COMMIT %llu\n", (unsigned long long)committed);
+    }
+    std::fclose(in);
+  }
+}
+
+// Client side of the stand-in; any error drops the connection and fails the
+// batch, and the next batch reconnects.
+class StandInStore : public BulkStore {
+ public:
+  explicit StandInStore(const std::string& sockPath) : _path(sockPath) {}
+  ~StandInStore() override { disconnect(); }
+
+  bool copy(const Row* rows, size_t n) override {
+    if (_fd < 0 && !connectNow()) return false;
+    std::string msg = "COPY " + std::to_string(n) + "\n";
+    for (size_t i = 0; i < n; i++) {
+      msg += std::to_string(rows[i].lsn) + " ";
+      msg.append((const char*)rows[i].data, rows[i].len);
+      msg += "\n";
+    }
+    msg += "\\.\n";
+    if (send(_fd, msg.data(), msg.size(), MSG_NOSIGNAL) != (ssize_t)msg.size()) return disconnect();
+
+    char reply[64];
+    size_t got = 0;
+    while (got < sizeof(reply) - 1) {
+      const ssize_t r = recv(_fd, reply + got, 1, 0);
+      if (r <= 0) return disconnect();
+      if (reply[got++] == '\n') break;
+    }
+    reply[got] = 0;
+    unsigned long long lsn = 0;
+    if (std::sscanf(reply, "COMMIT %llu", &lsn) != 1 || lsn < rows[n - 1].lsn) return disconnect();
+    return true;
+  }
+
+ private:
+  std::string _path;
+  int _fd = -1;
+
+  bool connectNow() {
+    _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", _path.c_str());
+    timeval tv = {2, 0};
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(_fd, (sockaddr*)&addr, sizeof(addr)) == 0) return true;
+    disconnect();
+    return false;
+  }
+
+  bool disconnect() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+    return false;
+  }
+};
+
+static pid_t startDbStandIn(const std::string& sockPath, const std::string& dataPath) {
+  unlink(sockPath.c_str());
+  char* argv[] = {(char*)"test_wal", (char*)"--db-standin", (char*)sockPath.c_str(), (char*)dataPath.c_str(),
+                  nullptr};
+  pid_t pid = -1;
+  if (posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argv, environ) != 0) return -1;
+  for (int t = 0; t < 2000 && access(sockPath.c_str(), F_OK) != 0; t += 5) sleepMs(5);
+  return pid;
+}
+
+static void test_db_killed_mid_load() {
+  const std::string dir = makeTempDir();
+  const std::string sockPath = dir + "/db.sock";
+  const std::string dataPath = dir + "/db.rows";
+  static const uint64_t N = 20000;
+
+  pid_t db = startDbStandIn(sockPath, dataPath);
+  CHECK(db > 0);
+
+  WalWriter::Options o;
+  o.dir = dir + "/wal";
+  o.segmentBytes = 64 * 1024;
+  WalWriter w(o);
+  CHECK(w.open());
+  StandInStore store(sockPath);
+  WalLoader loader(o.dir, store, 200);
+  CHECK(loader.open());
+  loader.start(w, 2, 50);
+
+  // Ingestion carries on throughout; the database dies a third of the way
+  // into the load and comes back while records are still arriving.
+  std::thread producer([&w] {
+    for (uint64_t i = 1; i <= N; i++) {
+      const std::string rec = "r" + std::to_string(i);
+      while (!w.append(rec.data(), rec.size())) std::this_thread::yield();
+      if (i % 1000 == 0) sleepMs(5);
+    }
+  });
+
+  std::atomic<uint64_t> checkpoint{0};
+  std::thread watch([&] {
+    while (checkpoint.load() < N) {
+      checkpoint = loader.checkpointLsn();
+      sleepMs(1);
+    }
+  });
+
+  CHECK(waitFor(&checkpoint, N / 3, 10000));
+  kill(db, SIGKILL);
+  waitpid(db, nullptr, 0);
+  sleepMs(150);
+  const uint64_t stalledAt = loader.checkpointLsn();
+  CHECK(loader.storeFailures() > 0);
+  db = startDbStandIn(sockPath, dataPath);
+  CHECK(db > 0);
+
+  producer.join();
+  const bool done = waitFor(&checkpoint, N, 20000);
+  checkpoint = N;
+  watch.join();
+  CHECK(done);
+  loader.stop();
+  w.close();
+  kill(db, SIGKILL);
+  waitpid(db, nullptr, 0);
+
+  // Every record once, in order, with its payload.
+  FILE* f = std::fopen(dataPath.c_str(), "r");
+  CHECK(f != nullptr);
+  unsigned long long lsn, expect = 1;
+  char payload[64];
+  int bad = 0;
+  while (f && std::fscanf(f, "%llu %63s", &lsn, payload) == 2) {
+    if (lsn != expect || std::string(payload) != "r" + std::to_string(lsn)) bad++;
+    expect = lsn + 1;
+  }
+  if (f) std::fclose(f);
+  CHECK_EQ(bad, 0);
+  CHECK_EQ(expect - 1, N);
+  std::printf("db killed at checkpoint %llu, %llu failed batches, all %llu rows loaded once\n",
+              (unsigned long long)stalledAt, (unsigned long long)loader.storeFailures(), (unsigned long long)N);
+  removeDir(dir);
+}
+
+int main(int argc, char** argv) {
+  if (argc == 4 && std::string(argv[1]) == "--db-standin") return runDbStandIn(argv[2], argv[3]);
+
+  RUN(test_queue_many_producers);
+  RUN(test_group_commit_round_trip);
+  RUN(test_torn_tail_is_cut);
+  RUN(test_checkpoint_survives_loader_restart);
+  RUN(test_db_killed_mid_load);
+  return checkSummary();
+}
@@ -0,0 +1,179 @@
+// Runs one ingest node of a sharded group.
+//
+//   rx_node --node I --peers IP:PORT,IP:PORT,... [--map map.csv] [--dump FILE]
+//           [--metrics-port P] [--wal DIR] [--unknown-dir DIR]
+//           [--device-timeout-ms T]
+//
+// Every node gets the same --peers list, in the same order; I is this node's
+// index in it. Devices may send to any node (COLLECTOR_IPS in the firmware);
+// each device is processed by the node consistent hashing gives it. With
+// --wal, its telemetry rows go to a write-ahead log in DIR. With --map,
+// racks are stitched, device liveness tracked (a device silent for T ms,
+// default 200000, is down) and unmapped MACs recorded, and flushed to DIR
+// with --unknown-dir. With --metrics-port, http://127.0.0.1:P/metrics serves
+// its counters to Prometheus. On SIGINT/SIGTERM it prints its counters and,
+// with --dump, writes "MAC count" lines for the devices it processed.
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <time.h>
+
+#include "IngestNode.h"
+#include "Mac.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "RackMap.h"
+#include "RackTable.h"
+#include "StreamStitcher.h"
+#include "UnknownRegistry.h"
+#include "UnknownStore.h"
+#include "Wal.h"
+
+static std::atomic<bool> gStop{false};
+
+static void onSignal(int) { gStop = true; }
+
+static int64_t monotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool parsePeers(const std::string& list, std::vector<IngestNode::Peer>& out) {
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) end = list.size();
+    const std::string item = list.substr(pos, end - pos);
+    const size_t colon = item.rfind(':');
+    if (colon == std::string::npos) return false;
+    in_addr addr;
+    const int port = atoi(item.c_str() + colon + 1);
+    if (inet_pton(AF_INET, item.substr(0, colon).c_str(), &addr) != 1 || port <= 0 || port > 65535) return false;
+    out.push_back({ntohl(addr.s_addr), (uint16_t)port});
+    pos = end + 1;
+  }
+  return !out.empty();
+}
+
+int main(int argc, char** argv) {
+  int node = -1;
+  int metricsPort = 0;
+  int deviceTimeoutMs = 200000;   // over the standby controllers' clock-sync interval
+  std::string peers, map, dump, walDir, unknownDir;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const char* v = argv[i + 1];
+    if (!strcmp(k, "--node")) node = atoi(v);
+    else if (!strcmp(k, "--peers")) peers = v;
+    else if (!strcmp(k, "--map")) map = v;
+    else if (!strcmp(k, "--dump")) dump = v;
+    else if (!strcmp(k, "--metrics-port")) metricsPort = atoi(v);
+    else if (!strcmp(k, "--wal")) walDir = v;
+    else if (!strcmp(k, "--unknown-dir")) unknownDir = v;
+    else if (!strcmp(k, "--device-timeout-ms")) deviceTimeoutMs = atoi(v);
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  IngestNode::Options o;
+  if (node < 0 || !parsePeers(peers, o.peers) || (size_t)node >= o.peers.size() || metricsPort < 0 ||
+      metricsPort > 65535 || deviceTimeoutMs <= 0) {
+    std::fprintf(stderr,
+                 "usage: rx_node --node I --peers IP:PORT,... [--map map.csv] [--dump FILE] [--metrics-port P]\n"
+                 "               [--wal DIR] [--unknown-dir DIR] [--device-timeout-ms T]\n");
+    return 2;
+  }
+  o.self = (unsigned)node;
+
+  RackMap rackMap;
+  if (!map.empty()) {
+    std::unique_ptr<RackTable> table(new RackTable());
+    size_t bad = 0;
+    if (!table->loadCsv(map.c_str(), &bad)) {
+      std::fprintf(stderr, "cannot read %s\n", map.c_str());
+      return 1;
+    }
+    std::fprintf(stderr, "%zu devices mapped, %zu bad lines\n", table->size(), bad);
+    rackMap.publish(std::move(table));
+    o.rackMap = &rackMap;
+  }
+  StreamStitcher stitcher{StreamStitcher::Options()};
+  LivenessTracker liveness((uint32_t)deviceTimeoutMs, 100, monotonicMs());
+  UnknownRegistry unknown(4096);
+  FileUnknownStore unknownStore(unknownDir);
+  if (o.rackMap) {
+    o.stitcher = &stitcher;
+    o.liveness = &liveness;
+    o.unknown = &unknown;
+    if (!unknownDir.empty()) o.unknownStore = &unknownStore;
+  }
+
+  Metrics metrics;
+  MetricsServer metricsServer(metrics);
+  if (metricsPort) {
+    if (!metricsServer.start((uint16_t)metricsPort)) {
+      std::perror("metrics port");
+      return 1;
+    }
+    o.metrics = &metrics;
+  }
+
+  WalWriter::Options wo;
+  wo.dir = walDir;
+  if (metricsPort) wo.metrics = &metrics;
+  WalWriter wal(wo);
+  if (!walDir.empty()) {
+    if (!wal.open()) {
+      std::fprintf(stderr, "cannot open the WAL in %s\n", walDir.c_str());
+      return 1;
+    }
+    o.wal = &wal;
+  }
+
+  IngestNode n;
+  if (!n.open(o)) {
+    std::perror("bind");
+    return 1;
+  }
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  n.run(gStop);
+  // The scrape reads the node's state; nothing may render it from here on.
+  metricsServer.stop();
+  if (o.wal) wal.close();
+
+  const IngestNode::Stats s = n.stats();
+  std::printf("received,processed,forwarded_out,forwarded_in,misrouted,time_requests,no_mac,not_telemetry,"
+              "unknown_rack,ring_changes,live_nodes,duplicates,overlaps,rows,rows_dropped,devices_down,failovers\n");
+  std::printf("%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%u,%llu,%llu,%llu,%llu,%llu,%llu\n",
+              (unsigned long long)s.received, (unsigned long long)s.processed, (unsigned long long)s.forwardedOut,
+              (unsigned long long)s.forwardedIn, (unsigned long long)s.misrouted,
+              (unsigned long long)s.timeRequests, (unsigned long long)s.noMac, (unsigned long long)s.notTelemetry,
+              (unsigned long long)s.unknownRack, (unsigned long long)s.ringChanges, s.liveNodes,
+              (unsigned long long)s.duplicates, (unsigned long long)s.overlaps, (unsigned long long)s.rows,
+              (unsigned long long)s.rowsDropped, (unsigned long long)s.devicesDown,
+              (unsigned long long)s.failovers);
+
+  if (!dump.empty()) {
+    FILE* f = std::fopen(dump.c_str(), "w");
+    if (!f) {
+      std::perror(dump.c_str());
+      return 1;
+    }
+    char text[18];
+    for (const auto& kv : n.deviceCounts()) {
+      formatMac(kv.first, text);
+      std::fprintf(f, "%s %llu\n", text, (unsigned long long)kv.second);
+    }
+    std::fclose(f);
+  }
+  return 0;
+}
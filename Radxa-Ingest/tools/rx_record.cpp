@@ -0,0 +1,101 @@
+// Records the telemetry datagrams arriving on a UDP port into a capture file.
+//
+//   rx_record --out FILE [--port 9000] [--bind 0.0.0.0]
+//             [--duration-s S] [--max-packets N]
+//
+// Stops after S seconds, N packets, or on Ctrl-C. An existing FILE is
+// continued, not overwritten. Prints packets, JSON/binary split, rate and
+// how many were written.
+// Exits 1 if any datagram received could not be written to FILE (disk full,
+// I/O error), with the number lost on stderr.
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <time.h>
+
+#include "Capture.h"
+#include "Replay.h"
+
+static std::atomic<bool> gStop{false};
+
+static void onSignal(int) { gStop = true; }
+
+int main(int argc, char** argv) {
+  std::string out;
+  std::string bind = "0.0.0.0";
+  int port = 9000;
+  int durationS = 0;
+  unsigned long long maxPackets = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* k = argv[i];
+    const char* v = argv[i + 1];
+    if (!strcmp(k, "--out")) out = v;
+    else if (!strcmp(k, "--port")) port = atoi(v);
+    else if (!strcmp(k, "--bind")) bind = v;
+    else if (!strcmp(k, "--duration-s")) durationS = atoi(v);
+    else if (!strcmp(k, "--max-packets")) maxPackets = strtoull(v, nullptr, 10);
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  in_addr addr;
+  if (out.empty() || port <= 0 || port > 65535 || inet_pton(AF_INET, bind.c_str(), &addr) != 1) {
+    std::fprintf(stderr, "usage: rx_record --out FILE [--port 9000] [--bind IP] [--duration-s S] [--max-packets N]\n");
+    return 2;
+  }
+
+  UdpRecorder rec;
+  if (!rec.open(ntohl(addr.s_addr), (uint16_t)port)) {
+    std::perror("bind");
+    return 1;
+  }
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  CaptureWriter writer;
+  if (!writer.open(out, (int64_t)now.tv_sec * 1000000000 + now.tv_nsec)) {
+    std::fprintf(stderr, "cannot open %s\n", out.c_str());
+    return 1;
+  }
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  // Past a file size limit a write should fail and be counted, not kill us.
+  std::signal(SIGXFSZ, SIG_IGN);
+  std::thread timer;
+  if (durationS > 0) {
+    timer = std::thread([durationS] {
+      for (int t = 0; t < durationS * 10 && !gStop; t++) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      gStop = true;
+    });
+  }
+
+  std::fprintf(stderr, "recording %s:%d to %s\n", bind.c_str(), rec.port(), out.c_str());
+  const auto t0 = std::chrono::steady_clock::now();
+  const UdpRecorder::Stats st = rec.run(writer, gStop, maxPackets);
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  gStop = true;
+  if (timer.joinable()) timer.join();
+  // close() retries what the last flush could not write.
+  const uint64_t pending = writer.buffered();
+  const uint64_t lost = st.lost + (writer.close() ? 0 : pending);
+  const uint64_t received = st.packets + st.lost;
+
+  std::printf("packets,json,binary,bytes,truncated,written,lost,write_errors,seconds,packets_per_s\n");
+  std::printf("%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.2f,%.0f\n", (unsigned long long)received,
+              (unsigned long long)st.json, (unsigned long long)(received - st.json), (unsigned long long)st.bytes,
+              (unsigned long long)st.truncated, (unsigned long long)(received - lost), (unsigned long long)lost,
+              (unsigned long long)writer.writeErrors(), secs, secs > 0 ? received / secs : 0.0);
+  if (lost > 0) {
+    std::fprintf(stderr, "%llu datagrams not written to %s\n", (unsigned long long)lost, out.c_str());
+    return 1;
+  }
+  return 0;
+}
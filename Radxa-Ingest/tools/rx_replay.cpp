@@ -0,0 +1,69 @@
+// Replays a capture file to 127.0.0.1 (loopback only) and reports the rate.
+//
+//   rx_replay --in FILE [--port 9000] [--speed X | --max]
+//             [--copies K] [--no-mac-rewrite] [--repeat R]
+//
+// --speed 1 (default) keeps the recorded timing, --speed 10 plays ten times
+// faster, --max sends as fast as possible. --copies K sends every datagram
+// K times, copy k from 127.0.0.1+k with device.mac rewritten, so one rack
+// looks like K racks.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Capture.h"
+#include "Replay.h"
+
+int main(int argc, char** argv) {
+  std::string in;
+  UdpReplayer::Options o;
+  int repeat = 1;
+  for (int i = 1; i < argc; i++) {
+    const char* k = argv[i];
+    const char* v = (i + 1 < argc) ? argv[i + 1] : "";
+    if (!strcmp(k, "--max")) o.speed = 0;
+    else if (!strcmp(k, "--no-mac-rewrite")) o.rewriteMac = false;
+    else if (!strcmp(k, "--in")) in = v, i++;
+    else if (!strcmp(k, "--port")) o.port = (uint16_t)atoi(v), i++;
+    else if (!strcmp(k, "--speed")) o.speed = atof(v), i++;
+    else if (!strcmp(k, "--copies")) o.copies = (unsigned)atoi(v), i++;
+    else if (!strcmp(k, "--repeat")) repeat = atoi(v), i++;
+    else {
+      std::fprintf(stderr, "unknown option %s\n", k);
+      return 2;
+    }
+  }
+  if (in.empty() || o.port == 0 || o.speed < 0 || repeat < 1) {
+    std::fprintf(stderr, "usage: rx_replay --in FILE [--port 9000] [--speed X | --max] [--copies K] "
+                         "[--no-mac-rewrite] [--repeat R]\n");
+    return 2;
+  }
+  if (o.copies > UdpReplayer::MAX_COPIES) {
+    std::fprintf(stderr, "--copies is at most %u\n", UdpReplayer::MAX_COPIES);
+    return 2;
+  }
+
+  CaptureReader reader;
+  if (!reader.open(in)) {
+    std::fprintf(stderr, "cannot read capture %s\n", in.c_str());
+    return 1;
+  }
+  UdpReplayer player;
+  if (!player.open(o)) {
+    std::perror("socket");
+    return 1;
+  }
+
+  std::printf("run,packets,bytes,send_errors,rewritten,seconds,packets_per_s,mbit_per_s,max_late_us\n");
+  for (int r = 1; r <= repeat; r++) {
+    reader.rewind();
+    const UdpReplayer::Result res = player.run(reader);
+    std::printf("%d,%llu,%llu,%llu,%llu,%.3f,%.0f,%.1f,%.0f\n", r, (unsigned long long)res.packets,
+                (unsigned long long)res.bytes, (unsigned long long)res.sendErrors,
+                (unsigned long long)res.rewritten, res.seconds, res.packetsPerS,
+                res.seconds > 0 ? res.bytes * 8 / res.seconds / 1e6 : 0.0, res.maxLateUs);
+  }
+  return 0;
+}